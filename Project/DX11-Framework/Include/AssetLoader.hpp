@@ -0,0 +1,74 @@
+/****************************************************************************/
+/*!
+\file
+   AssetLoader.hpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Streams meshes in the background. File reads and imports run on loader
+    threads, finished meshes go onto a lock-free ready queue and the render
+    thread creates a bounded number of GPU buffers per frame.
+*/
+/****************************************************************************/
+#ifndef ASSETLOADER_H
+#define ASSETLOADER_H
+#pragma once
+
+#include "DX11PCH.hpp"
+#include "Mesh.hpp"
+#include "RingQueue.hpp"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace DX11
+{
+    class AssetLoader
+    {
+    public:
+        explicit AssetLoader(uint32_t threadCount = 1, size_t readyCapacity = 64);
+        ~AssetLoader();
+        AssetLoader(const AssetLoader&) = delete;
+        AssetLoader& operator=(const AssetLoader&) = delete;
+
+        std::shared_ptr<DX11::Mesh> LoadMesh(const std::string& path, DX11::VertexFormat format = DX11::VertexFormat::Full);
+        uint32_t Upload(DX11::Device device, DX11::StagingPool& staging, uint32_t maxUploads);
+
+        uint32_t Pending() const;
+
+    private:
+        struct Request
+        {
+            std::shared_ptr<DX11::Mesh> mesh;
+            std::string path;
+            DX11::VertexFormat format = DX11::VertexFormat::Full;
+        };
+
+        struct Loaded
+        {
+            std::shared_ptr<DX11::Mesh> mesh;
+            std::string path;
+            std::string error;
+        };
+
+        void LoaderLoop();
+
+        std::vector<std::thread> mThreads;
+
+        // requests, only touched under the lock
+        std::mutex mMutex;
+        std::condition_variable mWake;
+        std::deque<Request> mRequests;
+        std::atomic<bool> mQuit = false;
+
+        // loaders push, the render thread pops
+        DX11::RingQueue<Loaded> mReady;
+        std::atomic<uint32_t> mPending = 0;
+    };
+}
+
+#endif // ASSETLOADER_H
@@ -0,0 +1,47 @@
+/****************************************************************************/
+/*!
+\file
+   Benchmarks.hpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    CPU benchmarks for the renderer's systems. They run on a headless
+    device so they need no window or GPU, see "--bench" in Main.cpp.
+*/
+/****************************************************************************/
+#ifndef BENCHMARKS_H
+#define BENCHMARKS_H
+#pragma once
+
+#include "DX11PCH.hpp"
+
+namespace DX11
+{
+    namespace Benchmark
+    {
+        bool Run(const std::string& name, uint32_t count);
+
+        void RenderQueue(uint32_t count);
+        void Instancing(uint32_t count);
+        void DeferredRecording(uint32_t count);
+        void Culling(uint32_t count);
+        void Hierarchy(uint32_t count);
+        void Occlusion(uint32_t count);
+        void Simplification(uint32_t count);
+        void Clustering(uint32_t count);
+        void Transforms(uint32_t count);
+        void Jobs(uint32_t count);
+        void Pipelining(uint32_t count);
+        void Allocations(uint32_t count);
+        void RingAllocation(uint32_t count);
+        void VertexEncoding(uint32_t count);
+        void IndexPacking(uint32_t count);
+        void Import(uint32_t count);
+        void Logging(uint32_t count);
+    }
+}
+
+#endif // BENCHMARKS_H
@@ -20,22 +20,36 @@
 
 namespace DX11
 {
+    //! how often the contents change, picks the D3D11 usage and CPU access
+    enum class BufferUsage : uint32_t
+    {
+        Immutable,  //!< set once at creation, GPU only
+        Default,    //!< GPU only, occasional updates through a StagingPool
+        Dynamic,    //!< rewritten by the CPU every frame with Map
+        Readback,   //!< staging copy the CPU reads GPU results from
+        Upload      //!< staging copy the CPU writes, see StagingPool
+    };
+
     class Buffer : public DX11::DXPtr<ID3D11Buffer>
     {
     public:
         Buffer() = default;
         Buffer(DX11::Device device, D3D11_BUFFER_DESC desc, D3D11_SUBRESOURCE_DATA data);
         Buffer(DX11::Device device, uint32_t size, D3D11_USAGE dynamic = D3D11_USAGE_DEFAULT);
+        Buffer(DX11::Device device, uint32_t size, uint32_t bindFlags, DX11::BufferUsage usage, const void* data = nullptr);
 
-        void Update(DX11::Device device, void* data, uint32_t offset, uint32_t size, D3D11_MAP mapType = D3D11_MAP_WRITE_DISCARD);
-        void Map(DX11::Device device, D3D11_MAP mapType = D3D11_MAP_WRITE_DISCARD);
-        void Unmap(DX11::Device device);
+        void Update(const DX11::Device& device, const void* data, uint32_t offset, uint32_t size, D3D11_MAP mapType = D3D11_MAP_WRITE_DISCARD);
+        void Map(const DX11::Device& device, D3D11_MAP mapType = D3D11_MAP_WRITE_DISCARD);
+        void Unmap(const DX11::Device& device);
 
         void* Data() const;
+        uint32_t Size() const;
+        ID3D11Buffer* Get() const;
 
     private:
         uint32_t pSize = 0;
         void* pData = nullptr;
+        ID3D11Buffer* pHeadless = nullptr;  //!< stands in for the buffer on a headless device, never released
     };
 }
 
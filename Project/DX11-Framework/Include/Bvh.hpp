@@ -0,0 +1,114 @@
+/****************************************************************************/
+/*!
+\file
+   Bvh.hpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Bounding volume hierarchy over world space object boxes. Built top down
+    with binned SAH, the big nodes near the root bin across the worker pool
+    and the subtrees below them build one per thread. Moving objects only
+    refit the boxes, the tree is rebuilt once refitting has made it too
+    much worse than it was when built.
+*/
+/****************************************************************************/
+#ifndef BVH_H
+#define BVH_H
+#pragma once
+
+#include "DX11PCH.hpp"
+#include "VisibilitySet.hpp"
+#include <atomic>
+#include <cfloat>
+#include <functional>
+
+namespace DX11
+{
+    class WorkerPool;
+
+    //! axis aligned box, arrays so the build can pick an axis by index
+    struct Aabb
+    {
+        float min[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+        float max[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+        Aabb() = default;
+        Aabb(const DirectX::XMFLOAT3& boundsMin, const DirectX::XMFLOAT3& boundsMax);
+    };
+
+    struct Ray
+    {
+        DirectX::XMFLOAT3 origin = { 0, 0, 0 };
+        DirectX::XMFLOAT3 direction = { 0, 0, 1 };
+        float maxDistance = FLT_MAX;
+    };
+
+    struct RayHit
+    {
+        uint32_t object = 0xffffffff;   //!< 0xffffffff when nothing was hit
+        float distance = 0.0f;
+    };
+
+    class Bvh
+    {
+    public:
+        static const uint32_t MAX_LEAF_SIZE = 4;
+        static const uint32_t MAX_DEPTH = 64;       //!< deeper nodes become leaves, bounds the traversal stacks
+        static const uint32_t BIN_COUNT = 16;       //!< SAH candidates per axis
+        static const uint32_t SUBTREE_SIZE = 8192;  //!< nodes this small build as one job
+
+        Bvh() = default;
+
+        void Build(const std::vector<DX11::Aabb>& bounds);
+        void Build(const std::vector<DX11::Aabb>& bounds, DX11::WorkerPool& pool);
+        void Refit(const std::vector<DX11::Aabb>& bounds);
+        bool Update(const std::vector<DX11::Aabb>& bounds, DX11::WorkerPool& pool);
+        void SetRebuildThreshold(float ratio);
+
+        size_t Cull(const DX11::Frustum& frustum, std::vector<uint32_t>& visible) const;
+        bool Raycast(const DX11::Ray& ray, DX11::RayHit& hit, const std::function<bool(uint32_t, float&)>& test = nullptr) const;
+
+        size_t ObjectCount() const;
+        size_t NodeCount() const;
+        uint32_t Depth() const;
+        float Cost() const;
+        float BuildCost() const;
+
+    private:
+        //! children are allocated in pairs after their parent, right is left + 1
+        struct Node
+        {
+            DX11::Aabb bounds;
+            uint32_t first = 0;     //!< first entry in mOrder under this node
+            uint32_t count = 0;     //!< objects under this node
+            uint32_t left = 0;      //!< 0 for leaves, the root is never a child
+        };
+
+        //! a node waiting to be split
+        struct Task
+        {
+            uint32_t node;
+            uint32_t first;
+            uint32_t count;
+            uint32_t depth;
+        };
+
+        bool Split(const Task& task, std::atomic<uint32_t>& allocated, DX11::WorkerPool* pool, Task children[2]);
+        void BuildSubtree(const Task& task, std::atomic<uint32_t>& allocated);
+        float ComputeCost() const;
+
+        std::vector<DX11::Aabb> mObjects;
+        std::vector<uint32_t> mOrder;       //!< object indices, each node covers a contiguous range
+        std::vector<Node> mNodes;
+
+        uint32_t mDepth = 0;
+        float mCost = 0.0f;
+        float mBuildCost = 0.0f;
+        float mRebuildThreshold = 1.5f;
+    };
+}
+
+#endif // BVH_H
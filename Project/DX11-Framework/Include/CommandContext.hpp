@@ -0,0 +1,76 @@
+/****************************************************************************/
+/*!
+\file
+   CommandContext.hpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Backend interface for everything the renderer does per frame. The
+    wrappers go through this instead of ID3D11DeviceContext so the same
+    render path can run on D3D11 or on a recorder with no GPU at all.
+*/
+/****************************************************************************/
+#ifndef COMMANDCONTEXT_H
+#define COMMANDCONTEXT_H
+#pragma once
+
+#include "DX11PCH.hpp"
+#include <memory>
+
+namespace DX11
+{
+    typedef DX11::DXPtr<ID3D11CommandList> CommandList;
+
+    class CommandContext
+    {
+    public:
+        virtual ~CommandContext() = default;
+
+        // input assembler
+        virtual void SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology) = 0;
+        virtual void SetInputLayout(ID3D11InputLayout* layout) = 0;
+        virtual void SetVertexBuffers(uint32_t slot, uint32_t count, ID3D11Buffer* const* buffers, const uint32_t* strides, const uint32_t* offsets) = 0;
+        virtual void SetIndexBuffer(ID3D11Buffer* buffer, DXGI_FORMAT format, uint32_t offset) = 0;
+
+        // shaders, a constantCount of 0 binds the whole buffer
+        virtual void SetVertexShader(ID3D11VertexShader* shader) = 0;
+        virtual void SetPixelShader(ID3D11PixelShader* shader) = 0;
+        virtual void SetVSConstantBuffer(uint32_t slot, ID3D11Buffer* buffer, uint32_t firstConstant = 0, uint32_t constantCount = 0) = 0;
+        virtual void SetPSConstantBuffer(uint32_t slot, ID3D11Buffer* buffer, uint32_t firstConstant = 0, uint32_t constantCount = 0) = 0;
+
+        // rasterizer / output merger
+        virtual void SetRasterizerState(ID3D11RasterizerState* state) = 0;
+        virtual void SetViewports(uint32_t count, const D3D11_VIEWPORT* viewports) = 0;
+        virtual void SetBlendState(ID3D11BlendState* state, const float factors[4], uint32_t sampleMask) = 0;
+        virtual void SetDepthStencilState(ID3D11DepthStencilState* state, uint32_t stencilRef) = 0;
+        virtual void SetRenderTargets(uint32_t count, ID3D11RenderTargetView* const* views, ID3D11DepthStencilView* depth) = 0;
+        virtual void ClearRenderTargetView(ID3D11RenderTargetView* view, const float color[4]) = 0;
+        virtual void ClearDepthStencilView(ID3D11DepthStencilView* view, uint32_t flags, float depth, uint8_t stencil) = 0;
+
+        // work
+        virtual void DrawIndexed(uint32_t indexCount, uint32_t firstIndex, int32_t baseVertex) = 0;
+        virtual void DrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t baseVertex, uint32_t firstInstance) = 0;
+
+        // resources, size is how much of the resource the caller will touch
+        virtual void* Map(ID3D11Resource* resource, D3D11_MAP mapType, uint32_t size) = 0;
+        virtual void Unmap(ID3D11Resource* resource) = 0;
+        virtual void CopyBufferRegion(ID3D11Buffer* destination, uint32_t destinationOffset, ID3D11Buffer* source, uint32_t sourceOffset, uint32_t size) = 0;
+
+        // synchronization, GetQueryData returns S_OK once the GPU passed the query
+        virtual void EndQuery(ID3D11Query* query) = 0;
+        virtual HRESULT GetQueryData(ID3D11Query* query, bool flush) = 0;
+
+        virtual void ClearState() = 0;
+        virtual void Flush() = 0;
+
+        // deferred recording, finishing and executing both leave the context in its default state
+        virtual std::shared_ptr<DX11::CommandContext> CreateDeferred() = 0;
+        virtual DX11::CommandList FinishCommandList() = 0;
+        virtual void ExecuteCommandList(ID3D11CommandList* list) = 0;
+    };
+}
+
+#endif // COMMANDCONTEXT_H
@@ -0,0 +1,67 @@
+/****************************************************************************/
+/*!
+\file
+   CommandScheduler.hpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Decides how a frame's draws are cut into slices for deferred recording
+    and which threads record them. Kept behind an interface so the split
+    can be stubbed out and measured without a GPU.
+*/
+/****************************************************************************/
+#ifndef COMMANDSCHEDULER_H
+#define COMMANDSCHEDULER_H
+#pragma once
+
+#include "DX11PCH.hpp"
+#include <functional>
+
+namespace DX11
+{
+    class WorkerPool;
+
+    class CommandScheduler
+    {
+    public:
+        virtual ~CommandScheduler() = default;
+
+        //! how many slices to record drawCount draws in, 1 records on the immediate context
+        virtual uint32_t Partition(size_t drawCount) const = 0;
+
+        //! call record(slice) for every slice in [0, sliceCount) and return once all are done
+        virtual void Run(uint32_t sliceCount, const std::function<void(uint32_t)>& record) = 0;
+    };
+
+    //! records every slice on the calling thread, for measuring the split on its own
+    class InlineScheduler : public DX11::CommandScheduler
+    {
+    public:
+        explicit InlineScheduler(uint32_t slices = 1);
+
+        uint32_t Partition(size_t drawCount) const override;
+        void Run(uint32_t sliceCount, const std::function<void(uint32_t)>& record) override;
+
+    private:
+        uint32_t mSlices;
+    };
+
+    //! one slice per pool thread, as long as every slice gets at least minDraws
+    class WorkerPoolScheduler : public DX11::CommandScheduler
+    {
+    public:
+        explicit WorkerPoolScheduler(DX11::WorkerPool& pool, uint32_t minDraws = 256);
+
+        uint32_t Partition(size_t drawCount) const override;
+        void Run(uint32_t sliceCount, const std::function<void(uint32_t)>& record) override;
+
+    private:
+        DX11::WorkerPool* mPool;
+        uint32_t mMinDraws;
+    };
+}
+
+#endif // COMMANDSCHEDULER_H
@@ -0,0 +1,85 @@
+/****************************************************************************/
+/*!
+\file
+   ConstantRing.hpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    One large dynamic constant buffer shared by every draw. Constants are
+    written into 256 byte aligned slices between Begin and End (one map,
+    NO_OVERWRITE after the first DISCARD) and bound by offset with
+    VSSetConstantBuffers1. Event queries fence each frame so the ring only
+    wraps over memory the GPU is done with.
+*/
+/****************************************************************************/
+#ifndef CONSTANTRING_H
+#define CONSTANTRING_H
+#pragma once
+
+#include "DX11PCH.hpp"
+#include "Device.hpp"
+#include "Buffer.hpp"
+#include "RingAllocator.hpp"
+#include <array>
+
+namespace DX11
+{
+    typedef DX11::DXPtr<ID3D11Query> Query;
+
+    class ConstantRing
+    {
+    public:
+        //! constant buffer offsets are in 16 byte constants, 16 at a time
+        static const uint32_t SLICE_ALIGNMENT = 256;
+
+        //! most a single slice can hold, the D3D11 constant buffer limit
+        static const uint32_t MAX_SLICE_SIZE = 4096 * 16;
+
+        struct Slice
+        {
+            void* data = nullptr;       //!< where to write, valid until End
+            uint32_t firstConstant = 0;
+            uint32_t constantCount = 0;
+        };
+
+        ConstantRing() = default;
+        ConstantRing(DX11::Device device, uint32_t size = 1 << 20);
+
+        void Begin(const DX11::Device& device);
+        Slice Allocate(const DX11::Device& device, uint32_t size);
+        void End(const DX11::Device& device);
+
+        void BindVS(const DX11::Device& device, uint32_t slot, const Slice& slice);
+        void BindPS(const DX11::Device& device, uint32_t slot, const Slice& slice);
+        void BindVS(const DX11::Device& device, DX11::CommandContext& context, uint32_t slot, const Slice& slice);
+        void BindPS(const DX11::Device& device, DX11::CommandContext& context, uint32_t slot, const Slice& slice);
+
+        void EndFrame(const DX11::Device& device);
+
+        bool Offsetting() const;
+        size_t Used() const;
+
+    private:
+        void Retire(const DX11::Device& device, bool wait);
+        void Bind(const DX11::Device& device, DX11::CommandContext& commands, uint32_t slot, const Slice& slice, bool pixel);
+
+        DX11::Buffer mBuffer;
+        DX11::RingAllocator mAllocator;
+        uint8_t* mMapped = nullptr;
+        bool mDiscarded = false;
+        bool mOffsetting = false;
+
+        // one event query per frame in flight, same order as the allocator's frames
+        std::array<DX11::Query, DX11::RingAllocator::MAX_FRAMES> mFences;
+        uint32_t mOldestFence = 0;
+
+        // no offset binding, slices live on the CPU and are copied at bind
+        std::vector<uint8_t> mShadow;
+        DX11::Buffer mFallback;
+    };
+}
+
+#endif // CONSTANTRING_H
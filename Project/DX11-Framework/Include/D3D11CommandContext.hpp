@@ -0,0 +1,69 @@
+/****************************************************************************/
+/*!
+\file
+   D3D11CommandContext.hpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    CommandContext that forwards straight to an ID3D11DeviceContext
+*/
+/****************************************************************************/
+#ifndef D3D11COMMANDCONTEXT_H
+#define D3D11COMMANDCONTEXT_H
+#pragma once
+
+#include "DX11PCH.hpp"
+#include "CommandContext.hpp"
+
+namespace DX11
+{
+    class D3D11CommandContext : public DX11::CommandContext
+    {
+    public:
+        explicit D3D11CommandContext(DX11::DXPtr<ID3D11DeviceContext> context);
+
+        void SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology) override;
+        void SetInputLayout(ID3D11InputLayout* layout) override;
+        void SetVertexBuffers(uint32_t slot, uint32_t count, ID3D11Buffer* const* buffers, const uint32_t* strides, const uint32_t* offsets) override;
+        void SetIndexBuffer(ID3D11Buffer* buffer, DXGI_FORMAT format, uint32_t offset) override;
+
+        void SetVertexShader(ID3D11VertexShader* shader) override;
+        void SetPixelShader(ID3D11PixelShader* shader) override;
+        void SetVSConstantBuffer(uint32_t slot, ID3D11Buffer* buffer, uint32_t firstConstant, uint32_t constantCount) override;
+        void SetPSConstantBuffer(uint32_t slot, ID3D11Buffer* buffer, uint32_t firstConstant, uint32_t constantCount) override;
+
+        void SetRasterizerState(ID3D11RasterizerState* state) override;
+        void SetViewports(uint32_t count, const D3D11_VIEWPORT* viewports) override;
+        void SetBlendState(ID3D11BlendState* state, const float factors[4], uint32_t sampleMask) override;
+        void SetDepthStencilState(ID3D11DepthStencilState* state, uint32_t stencilRef) override;
+        void SetRenderTargets(uint32_t count, ID3D11RenderTargetView* const* views, ID3D11DepthStencilView* depth) override;
+        void ClearRenderTargetView(ID3D11RenderTargetView* view, const float color[4]) override;
+        void ClearDepthStencilView(ID3D11DepthStencilView* view, uint32_t flags, float depth, uint8_t stencil) override;
+
+        void DrawIndexed(uint32_t indexCount, uint32_t firstIndex, int32_t baseVertex) override;
+        void DrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t baseVertex, uint32_t firstInstance) override;
+
+        void* Map(ID3D11Resource* resource, D3D11_MAP mapType, uint32_t size) override;
+        void Unmap(ID3D11Resource* resource) override;
+        void CopyBufferRegion(ID3D11Buffer* destination, uint32_t destinationOffset, ID3D11Buffer* source, uint32_t sourceOffset, uint32_t size) override;
+
+        void EndQuery(ID3D11Query* query) override;
+        HRESULT GetQueryData(ID3D11Query* query, bool flush) override;
+
+        void ClearState() override;
+        void Flush() override;
+
+        std::shared_ptr<DX11::CommandContext> CreateDeferred() override;
+        DX11::CommandList FinishCommandList() override;
+        void ExecuteCommandList(ID3D11CommandList* list) override;
+
+    private:
+        DX11::DXPtr<ID3D11DeviceContext> mContext;
+        DX11::DXPtr<ID3D11DeviceContext1> mContext1;    //!< null before D3D11.1
+    };
+}
+
+#endif // D3D11COMMANDCONTEXT_H
@@ -17,6 +17,7 @@
 #pragma once
 #pragma warning(push, 0)
 
+#if defined(_WIN32)
 //System include
 #define WIN32_LEAN_AND_MEAN
 #define NOMINMAX
@@ -42,6 +43,15 @@
 #define GLFW_EXPOSE_NATIVE_WIN32
 #include "glfw3.h"
 #include "glfw3native.h"
+#else
+// no Windows SDK, declare the subset the headless backend needs
+#include "Platform/HeadlessPlatform.hpp"
+#include "Platform/HeadlessMath.hpp"
+
+// GLFW, declarations only, there is no window without Win32
+#define GLFW_INCLUDE_NONE
+#include "glfw3.h"
+#endif // _WIN32
 
 // STL Includes
 #include <algorithm>
@@ -52,6 +62,7 @@
 #include <map>
 #include <cassert>
 #include <cstdint>
+#include <cstring>
 #include <stdexcept>
 
 // CMath
@@ -85,10 +96,17 @@ namespace DX11
 
 inline std::wstring utf8ToUtf16(const std::string& utf8Str)
 {
-    int wchars_num = MultiByteToWideChar(CP_UTF8, 0, utf8Str.c_str(), -1, NULL, 0);
-    wchar_t* wstr = new wchar_t[utf8Str.size()];
-    MultiByteToWideChar(CP_UTF8, 0, utf8Str.c_str(), -1, wstr, wchars_num);
-    return std::wstring(wstr);
+    if (utf8Str.empty())
+    {
+        return std::wstring();
+    }
+
+    // converted straight into the string, the explicit length leaves the terminator to std::wstring
+    int length = int(utf8Str.size());
+    int wchars_num = MultiByteToWideChar(CP_UTF8, 0, utf8Str.data(), length, NULL, 0);
+    std::wstring wstr(size_t(std::max(wchars_num, 0)), L'\0');
+    MultiByteToWideChar(CP_UTF8, 0, utf8Str.data(), length, wstr.data(), wchars_num);
+    return wstr;
 }
 
 #endif // DX11RENDERER_PCH
\ No newline at end of file
@@ -0,0 +1,44 @@
+/****************************************************************************/
+/*!
+\file
+   DeferredRecorder.hpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Records a frame's slices on deferred contexts across threads and plays
+    the resulting command lists back on the immediate context in slice
+    order. The deferred contexts are created once and reused.
+*/
+/****************************************************************************/
+#ifndef DEFERREDRECORDER_H
+#define DEFERREDRECORDER_H
+#pragma once
+
+#include "DX11PCH.hpp"
+#include "Device.hpp"
+#include "CommandScheduler.hpp"
+#include <functional>
+
+namespace DX11
+{
+    class DeferredRecorder
+    {
+    public:
+        DeferredRecorder() = default;
+
+        void Record(const DX11::Device& device, DX11::CommandScheduler& scheduler, uint32_t sliceCount,
+            const std::function<void(DX11::CommandContext&, uint32_t)>& record);
+        void Clear();
+
+        size_t Contexts() const;
+
+    private:
+        std::vector<std::shared_ptr<DX11::CommandContext>> mContexts;
+        std::vector<DX11::CommandList> mLists;
+    };
+}
+
+#endif // DEFERREDRECORDER_H
@@ -16,6 +16,8 @@
 #pragma once
 
 #include "Adapter.hpp"
+#include "StateCacheCommandContext.hpp"
+#include <memory>
 
 #ifdef _DEBUG
 #define USE_DEBUG_DEVICE
@@ -35,7 +37,11 @@ namespace DX11
 
         Device() = default;
         Device(DX11::Adaptor adaptor);
+        explicit Device(std::shared_ptr<DX11::CommandContext> commands);
         DeviceContext Context() const;
+        DX11::CommandContext& Commands() const;
+        DX11::StateCacheCommandContext& StateCache() const;
+        bool Headless() const;
 
 #ifdef USE_DEBUG_DEVICE
         DebugDevice Debug() const;
@@ -43,6 +49,7 @@ namespace DX11
 
     private:
         DeviceContext mContext = nullptr;
+        std::shared_ptr<DX11::StateCacheCommandContext> mCommands;   //!< in front of the real backend
 
 #ifdef USE_DEBUG_DEVICE
         DebugDevice mDebug = nullptr;
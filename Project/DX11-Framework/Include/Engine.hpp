@@ -23,17 +23,22 @@ namespace DX11
     {
     public:
 
-        Engine();
+        explicit Engine(bool headless = false, uint32_t framesInFlight = 2);
         void Init();
         void Run();
+        void RunHeadless(uint32_t frames);
         void ShutDown();
 
     private:
         float UpdateDT();
+        void LogPipeline(const DX11::FramePipelineStats& stats) const;
 
         DX11::Renderer mRenderer;
         WindowPtr mWindow = nullptr;
 
+        // 0 prepares and submits on the main thread, more hands frames to a render thread
+        uint32_t mFramesInFlight = 2;
+
         double pDeltaTime;
         float pFPS;
 
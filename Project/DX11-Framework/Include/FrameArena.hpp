@@ -0,0 +1,130 @@
+/****************************************************************************/
+/*!
+\file
+   FrameArena.hpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Linear allocator for data that only lives for a frame. Allocations bump
+    a pointer through a list of blocks and Reset rewinds to the first one,
+    the blocks are kept so once a scene has been seen a frame never touches
+    the general heap. Every FramePacket owns one, it belongs to whichever
+    thread holds the packet and is reset when the packet is recycled.
+*/
+/****************************************************************************/
+#ifndef FRAMEARENA_H
+#define FRAMEARENA_H
+#pragma once
+
+#include "DX11PCH.hpp"
+#include <memory>
+#include <new>
+
+namespace DX11
+{
+    class FrameArena
+    {
+    public:
+        //! the arena grows by blocks of at least this many bytes
+        static const size_t BLOCK_SIZE = 1 << 16;
+
+        explicit FrameArena(size_t blockSize = BLOCK_SIZE);
+        FrameArena(const FrameArena&) = delete;
+        FrameArena& operator=(const FrameArena&) = delete;
+
+        void* Allocate(size_t size, size_t alignment);
+
+/****************************************************************************/
+/*!
+\brief
+  Allocate and default construct count objects, nothing is ever destroyed
+  so only trivially destructible types are allowed
+
+\param count
+  Number of objects
+
+\return
+  Pointer to the first object
+*/
+/****************************************************************************/
+        template <typename T>
+        T* Alloc(size_t count = 1)
+        {
+            static_assert(std::is_trivially_destructible_v<T>, "FrameArena: T must be trivially destructible");
+            T* data = static_cast<T*>(Allocate(sizeof(T) * count, alignof(T)));
+            std::uninitialized_default_construct_n(data, count);
+            return data;
+        }
+
+        void Reset();
+
+        size_t Used() const;
+        size_t Capacity() const;
+        size_t HighWater() const;
+
+    private:
+        struct Block
+        {
+            std::unique_ptr<uint8_t[]> memory;
+            size_t size = 0;
+        };
+
+        std::vector<Block> mBlocks;     //!< kept across Reset
+        size_t mBlockSize;
+        size_t mBlock = 0;              //!< block being allocated from
+        size_t mOffset = 0;             //!< into that block
+        size_t mBefore = 0;             //!< bytes in the blocks before it
+        size_t mHighWater = 0;
+    };
+
+    //! STL allocator that takes its memory from a FrameArena, deallocate does nothing
+    template <typename T>
+    class FrameAllocator
+    {
+    public:
+        using value_type = T;
+
+        FrameAllocator(FrameArena& arena) : mArena(&arena) {}
+
+        template <typename U>
+        FrameAllocator(const FrameAllocator<U>& other) : mArena(other.Arena()) {}
+
+        T* allocate(size_t count)
+        {
+            return static_cast<T*>(mArena->Allocate(sizeof(T) * count, alignof(T)));
+        }
+
+        void deallocate(T*, size_t)
+        {
+        }
+
+        FrameArena* Arena() const
+        {
+            return mArena;
+        }
+
+        template <typename U>
+        bool operator==(const FrameAllocator<U>& other) const
+        {
+            return mArena == other.Arena();
+        }
+
+        template <typename U>
+        bool operator!=(const FrameAllocator<U>& other) const
+        {
+            return mArena != other.Arena();
+        }
+
+    private:
+        FrameArena* mArena;
+    };
+
+    //! vector for per frame lists, reserve up front, growing leaves the old block behind
+    template <typename T>
+    using FrameVector = std::vector<T, FrameAllocator<T>>;
+}
+
+#endif // FRAMEARENA_H
@@ -0,0 +1,125 @@
+/****************************************************************************/
+/*!
+\file
+   FramePipeline.hpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Hands frames from the main thread to a render thread. The main thread
+    fills a FramePacket with everything a frame submits (camera and the
+    visible draws) and publishes it, the render thread submits it and
+    hands it back, so frame N+1 is simulated and culled while frame N is
+    submitted. A fixed number of packets circulate through two lock-free
+    queues, which bounds how far the main thread can run ahead. Either
+    side only sleeps when it has nothing to do, the main thread keeps
+    pumping window messages while it does.
+*/
+/****************************************************************************/
+#ifndef FRAMEPIPELINE_H
+#define FRAMEPIPELINE_H
+#pragma once
+
+#include "DX11PCH.hpp"
+#include "RenderQueue.hpp"
+#include "FrameArena.hpp"
+#include "RingQueue.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace DX11
+{
+    //! one draw as the main thread queued it, the render thread binds the camera constants
+    struct FrameDraw
+    {
+        uint64_t key = 0;
+        DX11::DrawItem item;
+        DX11::InstanceData instance;
+    };
+
+    //! everything the render thread needs for a frame, not touched by the main thread once published
+    struct FramePacket
+    {
+        //! the packet's per frame memory, reset by the pipeline when the packet comes back to Begin
+        DX11::FrameArena arena;
+
+        uint64_t frame = 0;
+        DirectX::XMMATRIX projection;
+        DirectX::XMMATRIX view;
+        DX11::FrameVector<DX11::FrameDraw> draws{ DX11::FrameAllocator<DX11::FrameDraw>(arena) };
+
+        // stamped by the pipeline
+        std::chrono::steady_clock::time_point begun;
+        std::chrono::steady_clock::time_point published;
+    };
+
+    //! totals over every submitted frame, divide by frames for averages
+    struct FramePipelineStats
+    {
+        uint64_t frames = 0;
+        double stallMilliseconds = 0.0;     //!< main thread waiting for a free packet
+        double idleMilliseconds = 0.0;      //!< render thread waiting for a published packet
+        double queuedMilliseconds = 0.0;    //!< published until the render thread picked it up
+        double latencyMilliseconds = 0.0;   //!< Begin until the render thread finished submitting
+        double maxLatencyMilliseconds = 0.0;
+        size_t arenaHighWater = 0;          //!< most bytes one packet's arena held
+    };
+
+    class FramePipeline
+    {
+    public:
+        //! more than this only adds latency
+        static const uint32_t MAX_FRAMES_IN_FLIGHT = 4;
+
+        //! milliseconds between calls to the pump while the main thread waits
+        static const uint32_t PUMP_INTERVAL = 1;
+
+        FramePipeline(uint32_t framesInFlight, std::function<void(const DX11::FramePacket&)> submit,
+            std::function<void()> pump = nullptr);
+        ~FramePipeline();
+        FramePipeline(const FramePipeline&) = delete;
+        FramePipeline& operator=(const FramePipeline&) = delete;
+
+        DX11::FramePacket& Begin();
+        void End(DX11::FramePacket& packet);
+        void Flush();
+
+        uint32_t FramesInFlight() const;
+        DX11::FramePipelineStats Stats() const;
+
+    private:
+        void RenderLoop();
+        DX11::FramePacket* Take(DX11::RingQueue<DX11::FramePacket*>& queue, double& waited, bool pump);
+        void Give(DX11::RingQueue<DX11::FramePacket*>& queue, DX11::FramePacket* packet);
+
+        std::function<void(const DX11::FramePacket&)> mSubmit;
+        std::function<void()> mPump;
+        std::vector<std::unique_ptr<DX11::FramePacket>> mPackets;
+        uint64_t mFrame = 0;
+
+        // packets go main -> render through mPublished and back through mFree
+        DX11::RingQueue<DX11::FramePacket*> mFree;
+        DX11::RingQueue<DX11::FramePacket*> mPublished;
+
+        // a side that finds its queue empty sleeps until the other pushes
+        std::mutex mMutex;
+        std::condition_variable mWake;
+        std::atomic<uint32_t> mSleeping = 0;
+        bool mQuit = false;
+        std::exception_ptr mError;      //!< thrown by submit, rethrown on the main thread
+
+        mutable std::mutex mStatsMutex;
+        DX11::FramePipelineStats mStats;
+
+        std::thread mThread;
+    };
+}
+
+#endif // FRAMEPIPELINE_H
@@ -17,6 +17,7 @@
 
 #include "DX11PCH.hpp"
 #include "Device.hpp"
+#include "VertexFormat.hpp"
 
 namespace DX11
 {
@@ -27,10 +28,16 @@ namespace DX11
     class InputLayout : public DX11::DXPtr<ID3D11InputLayout>
     {
     public:
+        //! vertex buffer slot the per-instance inputs are read from
+        static const uint32_t INSTANCE_SLOT = 1;
+
         InputLayout() = default;
-        InputLayout(DX11::Device device, DX11::ShaderStage blob);
+        InputLayout(DX11::Device device, DX11::ShaderStage blob, DX11::VertexFormat format = DX11::VertexFormat::Full);
+
+        bool Instanced() const;
 
     private:
+        bool mInstanced = false;
     };
 }
 #endif 
@@ -0,0 +1,57 @@
+/****************************************************************************/
+/*!
+\file
+   InstanceBuffer.hpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Dynamic vertex buffer holding one frame's per-instance data. It is
+    written with a single map per frame and bound to the input layout's
+    instance slot, where INSTANCE0..3 read each instance's transform.
+*/
+/****************************************************************************/
+#ifndef INSTANCEBUFFER_H
+#define INSTANCEBUFFER_H
+#pragma once
+
+#include "DX11PCH.hpp"
+#include "Device.hpp"
+#include "Buffer.hpp"
+
+namespace DX11
+{
+    //! one instance, stored untransposed like the camera matrices so shaders read it the same way
+    struct InstanceData
+    {
+        DirectX::XMFLOAT4X4 world = DirectX::XMFLOAT4X4(
+            1.0f, 0.0f, 0.0f, 0.0f,
+            0.0f, 1.0f, 0.0f, 0.0f,
+            0.0f, 0.0f, 1.0f, 0.0f,
+            0.0f, 0.0f, 0.0f, 1.0f);
+    };
+
+    class InstanceBuffer
+    {
+    public:
+        InstanceBuffer() = default;
+        InstanceBuffer(DX11::Device device, uint32_t capacity = 1024);
+
+        DX11::InstanceData* Begin(const DX11::Device& device, uint32_t count);
+        void End(const DX11::Device& device);
+        void Bind(DX11::CommandContext& context) const;
+
+        uint32_t Capacity() const;
+
+    private:
+        void Create(DX11::Device device, uint32_t capacity);
+
+        DX11::Buffer mBuffer;
+        uint32_t mCapacity = 0;
+        bool mMapped = false;
+    };
+}
+
+#endif // INSTANCEBUFFER_H
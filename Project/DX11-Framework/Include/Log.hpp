@@ -4,11 +4,14 @@
    Log.hpp
 \Author
    Ryan Dugie
-\brief 
+\brief
     Copyright (c) Ryan Dugie. All rights reserved.
     Licensed under the Apache License 2.0
 
-    Master global Log class
+    Master global Log class. Messages are formatted on the caller's stack
+    and copied into a ring buffer owned by the calling thread, a single
+    writer thread batches them out to the file. Nothing allocates or
+    touches the disk on the logging thread.
 */
 /****************************************************************************/
 
@@ -16,64 +19,129 @@
 #define LOG_HPP
 #pragma once
 
+#include <atomic>
+#include <charconv>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
 #include <string>
-#include <fstream>
-#include <iostream>
-#include <sstream>
-#include <ctime>
-
-#define CHECK_FILE_OPEN(ofs, fname)             \
-if (!ofs)                                       \
-{                                               \
-std::cerr << "ERROR: could not open log file "  \
-<< fname << " for writing" << std::endl;        \
-return false;                                   \
-}                                               \
-
-namespace DEBUG 
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+//! compile time log levels, anything above LOG_LEVEL compiles to nothing
+#define LOG_LEVEL_NONE  0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_INFO  2
+
+#ifndef LOG_LEVEL
+#ifdef _DEBUG
+#define LOG_LEVEL LOG_LEVEL_INFO
+#else
+#define LOG_LEVEL LOG_LEVEL_ERROR
+#endif
+#endif
+
+namespace DEBUG
 {
 
-    static class Log 
+    //! one message, formatted into a fixed buffer on the stack
+    class LogRecord
     {
 
     public:
 
+        static const size_t CAPACITY = 512;
+
 /****************************************************************************/
 /*!
 \brief
-  Output some text to the error log
+  Append a value followed by a space, long messages are truncated
 */
 /****************************************************************************/
-        template <typename... Args>
-        bool Error(Args&& ... args) 
+        template <typename T>
+        void Append(const T& value)
         {
-            std::string fname = std::string("Errors_") + PROJECT_NAME;
+            using Type = std::decay_t<T>;
 
-            if (!createLog[0]) 
+            if constexpr (std::is_same_v<Type, bool>)
+            {
+                Write(value ? "true" : "false");
+            }
+            else if constexpr (std::is_same_v<Type, char>)
+            {
+                Write(std::string_view(&value, 1));
+            }
+            else if constexpr (std::is_arithmetic_v<Type>)
+            {
+                char text[32];
+                std::to_chars_result result = std::to_chars(text, text + sizeof(text), value);
+                Write(std::string_view(text, size_t(result.ptr - text)));
+            }
+            else if constexpr (std::is_same_v<Type, const char*> || std::is_same_v<Type, char*>)
             {
-                if (!CreateLog(fname)) 
-                {
-                    return false;
-                }
-                createLog[0] = true;
+                const char* text = value;
+                Write(text ? std::string_view(text) : std::string_view("(null)"));
             }
+            else if constexpr (std::is_convertible_v<const T&, std::string_view>)
+            {
+                Write(std::string_view(value));
+            }
+            else if constexpr (std::is_pointer_v<Type>)
+            {
+                char text[32] = { '0', 'x' };
+                std::to_chars_result result = std::to_chars(text + 2, text + sizeof(text), uintptr_t(value), 16);
+                Write(std::string_view(text, size_t(result.ptr - text)));
+            }
+            else
+            {
+                static_assert(sizeof(Type) == 0, "Log: no formatter for this type");
+            }
+
+            Write(" ");
+        }
+
+        void Write(std::string_view text);
+        void End();
+
+        const char* Data() const;
+        size_t Size() const;
+
+    private:
+
+        char mData[CAPACITY];
+        size_t mSize = 0;
 
-            // open the log file
-            std::ofstream ofs(fname.c_str(), std::ofstream::app);
+    };
 
-            // if it failed to be created
-            CHECK_FILE_OPEN(ofs, fname);
+    class Log
+    {
 
-            // write to the log
-            int dummy[sizeof...(Args)] = { (ofs << std::forward<Args>(args) << ' ', 1)... };
-            UNUSED(dummy);
-            ofs << std::endl;
+    public:
 
-            // close the file
-            ofs.close();
+        Log();
+        ~Log();
+        Log(const Log&) = delete;
+        Log& operator=(const Log&) = delete;
 
-            // return success
+/****************************************************************************/
+/*!
+\brief
+  Output some text to the error log
+*/
+/****************************************************************************/
+        template <typename... Args>
+        bool Error(Args&& ... args)
+        {
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+            return Write(true, "Error:", std::forward<Args>(args)...);
+#else
+            (UNUSED(args), ...);
             return true;
+#endif
         }
 
 /****************************************************************************/
@@ -83,72 +151,66 @@ namespace DEBUG
 */
 /****************************************************************************/
         template <typename... Args>
-        bool Info(Args&& ... args) 
+        bool Info(Args&& ... args)
         {
-
-#ifdef _DEBUG
-            std::string fname = std::string("Errors_") + PROJECT_NAME;
-
-            if (!createLog[1]) 
-            {
-                if (!CreateLog(fname)) 
-                {
-                    return false;
-                }
-                createLog[1] = true;
-            }
-
-            // open the log file
-            std::ofstream ofs(fname.c_str(), std::ofstream::app);
-
-            // if it failed to be created
-            CHECK_FILE_OPEN(ofs, fname);
-
-            // write to the log
-            int dummy[sizeof...(Args)] = { (ofs << std::forward<Args>(args) << ' ', 1)... };
-            UNUSED(dummy);
-            ofs << std::endl;
-
-            // close the file
-            ofs.close();
-#endif // _DEBUG
-
-            // return success
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+            return Write(false, "Info:", std::forward<Args>(args)...);
+#else
+            (UNUSED(args), ...);
             return true;
+#endif
         }
 
+        void Flush();
+        uint64_t Dropped() const;
+
     private:
 
+        struct ThreadBuffer;
+        struct ThreadHandle;
+
 /****************************************************************************/
 /*!
 \brief
-    Create a fresh, empty log
+    Format a message and hand it to the writer
 */
 /****************************************************************************/
-        bool CreateLog(std::string fname)
+        template <typename... Args>
+        bool Write(bool urgent, const char* prefix, Args&& ... args)
         {
-            // create a new log file or overwrite the existing file
-            std::ofstream ofs(fname, std::ofstream::out);
+            LogRecord record;
+            record.Append(prefix);
+            (record.Append(args), ...);
+            record.End();
+            return Push(record, urgent);
+        }
 
-            // if the file failed to open
-            CHECK_FILE_OPEN(ofs, fname);
+        bool Push(const LogRecord& record, bool urgent);
+        ThreadBuffer& LocalBuffer();
+        void WriterLoop();
+        bool Drain();
 
-            // get the current system time
-            std::time_t CurrentTime = time(nullptr);
+        std::FILE* mFile = nullptr;
+        std::thread mWriter;
 
-            // output time to the top of the debug log
-            ofs << fname << " File local time: " << std::time(&CurrentTime) << std::endl;
-            ofs << "Build version: " << __DATE__ << " " << __TIME__ << std::endl << std::endl;
-            ofs.close();
+        // registered thread buffers and writer signalling, under the lock
+        std::mutex mMutex;
+        std::condition_variable mWake;
+        std::condition_variable mFlushed;
+        std::vector<std::shared_ptr<ThreadBuffer>> mBuffers;
+        uint64_t mPass = 0;
+        bool mQuit = false;
 
-            // return success
-            return true;
-        }
+        // writer only
+        std::vector<char> mBatch;
+        uint64_t mReportedDrops = 0;
+
+        std::atomic<uint64_t> mDropped = 0;
 
-        bool createLog[2] = { false, false };
+    };
 
-    }log;
+    inline Log log;
 }
 
 
-#endif // LOG_H
\ No newline at end of file
+#endif // LOG_H
@@ -15,11 +15,23 @@
 
 #include "DX11PCH.hpp"
 #include "Mesh.hpp"
+#include "MeshCache.hpp"
+#include "MeshOptimizer.hpp"
+#include "MeshSimplifier.hpp"
+#include "WorkerPool.hpp"
+#include <chrono>
+#include <cfloat>
 
 /*============================================================================*\
 || --------------------------- GLOBAL VARIABLES ----------------------------- ||
 \*============================================================================*/
 
+namespace
+{
+    //! fraction of the triangles each level keeps from the one before
+    static const float LOD_REDUCTION = 0.5f;
+}
+
 /*============================================================================*\
 || -------------------------- STATIC FUNCTIONS ------------------------------ ||
 \*============================================================================*/
@@ -43,52 +55,151 @@ DX11::Mesh::~Mesh()
 /****************************************************************************/
 /*!
 \brief
-  Constructor, creates a buffer from the device
+  Constructor, loads the mesh and creates its buffers right away
 
 \param device
   The ID3D11Device
 
 \param path
   Path of the file to load
+
+\param format
+  The vertex layout to store the mesh in
 */
 /****************************************************************************/
-DX11::Mesh::Mesh(DX11::Device device, std::string path) 
+DX11::Mesh::Mesh(DX11::Device device, std::string path, DX11::VertexFormat format)
 {
-    // read file via ASSIMP
-    Assimp::Importer importer;
-    const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals);
+    Load(path, format);
+    Upload(device);
+}
 
-    // check for errors
-    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
+/****************************************************************************/
+/*!
+\brief
+  CPU half of loading, touches no D3D state so it can run on a loader
+  thread. Maps the binary mesh cache when it is up to date, otherwise
+  imports with assimp and writes the cache for the next run.
+
+\param path
+  Path of the file to load
+
+\param format
+  The vertex layout to store the mesh in
+*/
+/****************************************************************************/
+void DX11::Mesh::Load(const std::string& path, DX11::VertexFormat format)
+{
+    VertexLayout = format;
+    Stride = DX11::VertexStride(format);
+    LoadState = DX11::MeshState::Loading;
+
+    const uint32_t importFlags = aiProcess_Triangulate | aiProcess_GenSmoothNormals;
+    const uint64_t sourceHash = DX11::MeshCache::HashFile(path);
+    const std::string cachePath = DX11::MeshCache::CachePath(path);
+
+    // warm load, keep the mapping so Upload can hand the blobs straight to the buffers
+    std::unique_ptr<DX11::MeshCache> cache = std::make_unique<DX11::MeshCache>();
+    if (cache->Open(cachePath, sourceHash, importFlags, VertexLayout))
     {
-        throw std::runtime_error(importer.GetErrorString());
+        const DX11::MeshCacheHeader& header = cache->Header();
+        std::copy(header.boundsMin, header.boundsMin + 3, BoundsMin);
+        std::copy(header.boundsExtent, header.boundsExtent + 3, BoundsExtent);
+        SubmeshTable.assign(cache->Submeshes(), cache->Submeshes() + header.submeshCount);
+        MeshletTable.assign(cache->Meshlets(), cache->Meshlets() + header.meshletCount);
+        VertexCount = header.vertexCount;
+        BuildOccluders(static_cast<const uint8_t*>(cache->Vertices()), static_cast<const uint8_t*>(cache->Indices()), DX11::WorkerPool::Global());
+        Cache = std::move(cache);
+        LoadState = DX11::MeshState::Loaded;
+        return;
     }
 
-    // store data
-    for (unsigned i = 0; i < scene->mNumMeshes; ++i)
+    // cold load
+    Import(path, importFlags);
+
+    DX11::MeshCacheHeader header;
+    header.sourceHash = sourceHash;
+    header.importFlags = importFlags;
+    header.vertexFormat = uint32_t(VertexLayout);
+    header.vertexStride = Stride;
+    header.vertexCount = VertexCount;
+    header.indexBytes = uint32_t(IndexData.size());
+    header.submeshCount = uint32_t(SubmeshTable.size());
+    header.meshletCount = uint32_t(MeshletTable.size());
+    std::copy(BoundsMin, BoundsMin + 3, header.boundsMin);
+    std::copy(BoundsExtent, BoundsExtent + 3, header.boundsExtent);
+
+    try
+    {
+        DX11::MeshCache::Write(cachePath, header, VertexData.data(), IndexData.data(), SubmeshTable.data(), MeshletTable.data());
+    }
+    catch (const std::exception& e)
     {
-        aiMesh* mesh = scene->mMeshes[i];
-        GetMesh(mesh);
+        // not fatal, we just import again next time
+        DEBUG::log.Error(e.what());
     }
 
-    // VBO
-    D3D11_BUFFER_DESC bufferDesc = {};
-    bufferDesc.ByteWidth = uint32_t(Vertices.size() * sizeof(Vertex));
-    bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
-    bufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-    bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-    D3D11_SUBRESOURCE_DATA resourceData = {};
-    resourceData.pSysMem = static_cast<void*>(Vertices.data());
-    VBO = DX11::Buffer(device, bufferDesc, resourceData);
+    LoadState = DX11::MeshState::Loaded;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  GPU half of loading, creates the buffers from the loaded data and frees
+  the CPU copy. Must run on the thread that owns the immediate context.
+
+\param device
+  The ID3D11Device
+
+\param staging
+  Streams the data in through the pool's staging blocks, the mesh can be
+  drawn once the pool is flushed. Null creates the buffers with the data.
+*/
+/****************************************************************************/
+void DX11::Mesh::Upload(DX11::Device device, DX11::StagingPool* staging)
+{
+    if (LoadState != DX11::MeshState::Loaded)
+    {
+        throw std::runtime_error("DX11: Mesh is not loaded from Upload!\n");
+    }
 
-    // IBO
-    bufferDesc = {};
-    bufferDesc.ByteWidth = uint32_t(Indices.size() * sizeof(uint32_t));
-    bufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
-    bufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
-    resourceData = {};
-    resourceData.pSysMem = static_cast<void*>(Indices.data());
-    IBO = DX11::Buffer(device, bufferDesc, resourceData);
+    if (Cache)
+    {
+        CreateBuffers(device, staging, Cache->Vertices(), VertexCount, Cache->Indices(), Cache->Header().indexBytes);
+        Cache.reset();
+    }
+    else
+    {
+        CreateBuffers(device, staging, VertexData.data(), VertexCount, IndexData.data(), uint32_t(IndexData.size()));
+    }
+
+    VertexData.clear();
+    VertexData.shrink_to_fit();
+    IndexData.clear();
+    IndexData.shrink_to_fit();
+
+    LoadState = DX11::MeshState::Ready;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the load state, safe to call from any thread
+*/
+/****************************************************************************/
+DX11::MeshState DX11::Mesh::State() const
+{
+    return LoadState;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  True once the buffers exist and the mesh can be drawn
+*/
+/****************************************************************************/
+bool DX11::Mesh::Ready() const
+{
+    return LoadState == DX11::MeshState::Ready;
 }
 
 /****************************************************************************/
@@ -100,14 +211,241 @@ DX11::Mesh::Mesh(DX11::Device device, std::string path)
   The ID3D11Device
 */
 /****************************************************************************/
-void DX11::Mesh::Draw(DX11::Device device) 
+void DX11::Mesh::Draw(const DX11::Device& device) 
+{
+    if (!Ready())
+    {
+        return;
+    }
+
+    for (uint32_t i = 0; i < uint32_t(SubmeshTable.size()); ++i)
+    {
+        DrawSubmesh(device, i);
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Render one submesh out of the shared VBO / IBO
+
+\param device
+  The ID3D11Device
+
+\param index
+  Which submesh to draw
+*/
+/****************************************************************************/
+void DX11::Mesh::DrawSubmesh(const DX11::Device& device, uint32_t index)
 {
-    DX11::DeviceContext context = device.Context();
+    const Submesh& submesh = SubmeshTable[index];
+
+    DX11::CommandContext& context = device.Commands();
     uint32_t offset[] = { 0 };
-    static const uint32_t stride = sizeof(Vertex);
-    context->IASetVertexBuffers(0, 1, VBO.GetAddressOf(), &stride, offset);
-    context->IASetIndexBuffer(IBO.Get(), DXGI_FORMAT_R32_UINT, 0);
-    context->DrawIndexed(UINT(Indices.size()), 0, 0);
+    context.SetVertexBuffers(0, 1, VBO.GetAddressOf(), &Stride, offset);
+
+    // one binding per index width, the submesh indexes into that region
+    context.SetIndexBuffer(IBO.Get(), DXGI_FORMAT(submesh.indexFormat), submesh.indexOffset);
+    context.DrawIndexed(submesh.indexCount, submesh.firstIndex, INT(submesh.baseVertex));
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Fill in the geometry half of a queued draw for one submesh
+
+\param index
+  Which submesh to draw
+
+\param item
+  Receives the buffers and the index range, the rest is left alone
+
+\param lod
+  Which level of detail to draw, clamped to the submesh's levels
+*/
+/****************************************************************************/
+void DX11::Mesh::FillItem(uint32_t index, DX11::DrawItem& item, uint32_t lod) const
+{
+    const Submesh& submesh = SubmeshTable[index];
+    const SubmeshLod& level = submesh.lods[std::min(lod, submesh.lodCount - 1)];
+
+    item.vertexBuffer = VBO.Get();
+    item.stride = Stride;
+    item.indexBuffer = IBO.Get();
+    item.indexFormat = DXGI_FORMAT(submesh.indexFormat);
+    item.indexOffset = submesh.indexOffset;
+    item.indexCount = level.indexCount;
+    item.firstIndex = level.firstIndex;
+    item.baseVertex = int32_t(submesh.baseVertex);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Pick the coarsest level whose error projects to no more than threshold
+  pixels. Going coarser than the current level needs the error to be a
+  margin under the threshold and staying needs it no more than a margin
+  over, so a submesh sitting at a switch distance does not pop every frame.
+
+\param index
+  Which submesh
+
+\param pixelsPerUnit
+  Screen pixels one model unit covers at the submesh, viewport height
+  over 2 tan(fov / 2) over the distance
+
+\param current
+  Level drawn last frame
+
+\param threshold
+  Pixels of error allowed
+
+\param hysteresis
+  Fraction of the threshold the dead band spans either side
+
+\return
+  The level to draw
+*/
+/****************************************************************************/
+uint32_t DX11::Mesh::SelectLod(uint32_t index, float pixelsPerUnit, uint32_t current, float threshold, float hysteresis) const
+{
+    const Submesh& submesh = SubmeshTable[index];
+    for (uint32_t lod = submesh.lodCount - 1; lod > 0; --lod)
+    {
+        const float limit = threshold * (lod > current ? 1.0f - hysteresis : 1.0f + hysteresis);
+        if (submesh.lods[lod].error * pixelsPerUnit <= limit)
+        {
+            return lod;
+        }
+    }
+    return 0;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the submesh table
+*/
+/****************************************************************************/
+const std::vector<DX11::Submesh>& DX11::Mesh::Submeshes() const
+{
+    return SubmeshTable;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the meshlet table, each submesh owns firstMeshlet / meshletCount of it
+*/
+/****************************************************************************/
+const std::vector<DX11::Meshlet>& DX11::Mesh::Meshlets() const
+{
+    return MeshletTable;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the occluder of every submesh, in submesh order. Safe to read once
+  the mesh is Ready.
+*/
+/****************************************************************************/
+const std::vector<DX11::MeshOccluder>& DX11::Mesh::Occluders() const
+{
+    return OccluderTable;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the vertex layout this mesh is stored in
+*/
+/****************************************************************************/
+DX11::VertexFormat DX11::Mesh::Format() const
+{
+    return VertexLayout;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Matrix that takes quantized unorm positions back to model space.
+  Identity for the unquantized layouts, otherwise fold it into the
+  world matrix.
+*/
+/****************************************************************************/
+DirectX::XMMATRIX DX11::Mesh::DequantizeMatrix() const
+{
+    if (VertexLayout != DX11::VertexFormat::Quantized)
+    {
+        return DirectX::XMMatrixIdentity();
+    }
+
+    return DirectX::XMMatrixScaling(BoundsExtent[0], BoundsExtent[1], BoundsExtent[2])
+        * DirectX::XMMatrixTranslation(BoundsMin[0], BoundsMin[1], BoundsMin[2]);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Convert meshes already in memory into the CPU data Upload needs, the
+  part of Load after assimp has parsed the file. Every aiMesh is converted and
+  optimized on its own, vertex ranges are prefix summed into SubmeshTable
+  so encoding and packing can write each submesh straight into its slot
+  of the shared buffers. The load state is left alone, Load publishes it.
+
+\param meshes
+  The meshes, one submesh each
+
+\param count
+  Number of meshes
+
+\param format
+  The vertex layout to store the mesh in
+
+\param pool
+  Runs the submeshes in parallel
+*/
+/****************************************************************************/
+void DX11::Mesh::Convert(const aiMesh* const* meshes, size_t count, DX11::VertexFormat format, DX11::WorkerPool& pool)
+{
+    VertexLayout = format;
+    Stride = DX11::VertexStride(format);
+
+    // convert / optimize each aiMesh on its own
+    std::vector<ImportedMesh> parts(count);
+    pool.ParallelFor(parts.size(), [&](size_t i)
+    {
+        GetMesh(meshes[i], parts[i]);
+    });
+
+    // prefix sum the vertex ranges, meshlets go in one table
+    VertexCount = 0;
+    SubmeshTable.resize(parts.size());
+    MeshletTable.clear();
+    for (size_t i = 0; i < parts.size(); ++i)
+    {
+        ImportedMesh& part = parts[i];
+        part.submesh.baseVertex = VertexCount;
+        VertexCount += part.submesh.vertexCount;
+        part.submesh.firstMeshlet = uint32_t(MeshletTable.size());
+        part.submesh.meshletCount = uint32_t(part.meshlets.size());
+        MeshletTable.insert(MeshletTable.end(), part.meshlets.begin(), part.meshlets.end());
+        SubmeshTable[i] = part.submesh;
+
+        DEBUG::log.Info("Mesh:", meshes[i]->mName.C_Str(), "vertices", part.sourceVertices, "->", part.submesh.vertexCount,
+            "ACMR", part.before.acmr, "->", part.after.acmr, "ATVR", part.before.atvr, "->", part.after.atvr,
+            "meshlets", part.submesh.meshletCount);
+        for (uint32_t lod = 1; lod < part.submesh.lodCount; ++lod)
+        {
+            DEBUG::log.Info("Mesh:   LOD", lod, "triangles", part.submesh.lods[lod].indexCount / 3, "error", part.submesh.lods[lod].error);
+        }
+    }
+
+    EncodeVertices(parts, pool);
+    PackIndices(parts, pool);
+    parts.clear();
+    BuildOccluders(VertexData.data(), IndexData.data(), pool);
 }
 
 /*============================================================================*\
@@ -117,18 +455,302 @@ void DX11::Mesh::Draw(DX11::Device device)
 /****************************************************************************/
 /*!
 \brief
-  Get the vertex and index data from assimp
+  Read a model with assimp and convert it on the shared pool
+
+\param path
+  Path of the file to load
+
+\param importFlags
+  assimp post process flags
+*/
+/****************************************************************************/
+void DX11::Mesh::Import(const std::string& path, uint32_t importFlags)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    // read file via ASSIMP
+    Assimp::Importer importer;
+    const aiScene* scene = importer.ReadFile(path, importFlags);
+
+    // check for errors
+    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
+    {
+        throw std::runtime_error(importer.GetErrorString());
+    }
+
+    auto parsed = std::chrono::steady_clock::now();
+
+    DX11::WorkerPool& pool = DX11::WorkerPool::Global();
+    Convert(scene->mMeshes, scene->mNumMeshes, VertexLayout, pool);
+
+    auto converted = std::chrono::steady_clock::now();
+    DEBUG::log.Info("Mesh:", path, "parse",
+        std::chrono::duration<double, std::milli>(parsed - start).count(), "ms, convert",
+        std::chrono::duration<double, std::milli>(converted - parsed).count(), "ms on", pool.ThreadCount(), "threads");
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Pack every imported vertex into VertexData using the selected vertex
+  layout. Each submesh writes its own slice of the preallocated slab.
+
+\param parts
+  The converted meshes, in SubmeshTable order
+
+\param pool
+  Encodes the submeshes in parallel
+*/
+/****************************************************************************/
+void DX11::Mesh::EncodeVertices(const std::vector<ImportedMesh>& parts, DX11::WorkerPool& pool)
+{
+    VertexData.resize(size_t(VertexCount) * Stride);
+
+    // bounds to quantize against
+    DirectX::XMVECTOR boundsMin = DirectX::XMVectorReplicate(FLT_MAX);
+    DirectX::XMVECTOR boundsMax = DirectX::XMVectorReplicate(-FLT_MAX);
+    for (const Submesh& submesh : SubmeshTable)
+    {
+        boundsMin = DirectX::XMVectorMin(boundsMin, DirectX::XMLoadFloat3(&submesh.boundsMin));
+        boundsMax = DirectX::XMVectorMax(boundsMax, DirectX::XMLoadFloat3(&submesh.boundsMax));
+    }
+
+    if (SubmeshTable.empty())
+    {
+        boundsMin = boundsMax = DirectX::XMVectorZero();
+    }
+
+    DirectX::XMFLOAT3 min, max;
+    DirectX::XMStoreFloat3(&min, boundsMin);
+    DirectX::XMStoreFloat3(&max, boundsMax);
+    BoundsMin[0] = min.x;
+    BoundsMin[1] = min.y;
+    BoundsMin[2] = min.z;
+    BoundsExtent[0] = max.x - min.x;
+    BoundsExtent[1] = max.y - min.y;
+    BoundsExtent[2] = max.z - min.z;
+
+    pool.ParallelFor(parts.size(), [&](size_t i)
+    {
+        const ImportedMesh& part = parts[i];
+        EncodeRange(part.vertices.data(), part.vertices.size(), VertexData.data() + size_t(SubmeshTable[i].baseVertex) * Stride);
+    });
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Encode a run of vertices in the selected vertex layout
+
+\param vertices
+  The vertices to encode
+
+\param count
+  Number of vertices
+
+\param out
+  count * Stride bytes to write to
+*/
+/****************************************************************************/
+void DX11::Mesh::EncodeRange(const Vertex* vertices, size_t count, uint8_t* out) const
+{
+    if (VertexLayout == DX11::VertexFormat::Full)
+    {
+        std::memcpy(out, vertices, count * sizeof(Vertex));
+        return;
+    }
+
+    for (size_t i = 0; i < count; ++i, out += Stride)
+    {
+        DirectX::XMFLOAT3 position, normal;
+        DirectX::XMStoreFloat3(&position, vertices[i].position);
+        DirectX::XMStoreFloat3(&normal, DirectX::XMVector3Normalize(vertices[i].normal));
+        DX11::EncodeVertex(VertexLayout, &position.x, &normal.x, BoundsMin, BoundsExtent, out);
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Pack the imported indices into IndexData with MeshOptimizer::PackIndices,
+  narrowed to 16 bits where the submesh's vertices allow, and point every
+  submesh at its region. A submesh's levels of detail and meshlets follow
+  its full detail indices in the same region.
+
+\param parts
+  The converted meshes, in SubmeshTable order
+
+\param pool
+  Packs the submeshes in parallel
+*/
+/****************************************************************************/
+void DX11::Mesh::PackIndices(const std::vector<ImportedMesh>& parts, DX11::WorkerPool& pool)
+{
+    // indices are local and vertex fetch optimized, so the vertex count bounds them
+    std::vector<const uint32_t*> lists(parts.size());
+    std::vector<size_t> indexCounts(parts.size());
+    std::vector<uint32_t> vertexCounts(parts.size());
+    for (size_t s = 0; s < parts.size(); ++s)
+    {
+        lists[s] = parts[s].indices.data();
+        indexCounts[s] = parts[s].indices.size();
+        vertexCounts[s] = SubmeshTable[s].vertexCount;
+    }
+
+    std::vector<DX11::MeshOptimizer::PackedRange> ranges(parts.size());
+    DX11::MeshOptimizer::PackIndices(lists.data(), indexCounts.data(), vertexCounts.data(), parts.size(), IndexData, ranges.data(), pool);
+
+    for (size_t s = 0; s < SubmeshTable.size(); ++s)
+    {
+        Submesh& submesh = SubmeshTable[s];
+        submesh.indexFormat = ranges[s].indexFormat;
+        submesh.indexOffset = ranges[s].indexOffset;
+        submesh.firstIndex = ranges[s].firstIndex;
+
+        for (uint32_t lod = 0; lod < submesh.lodCount; ++lod)
+        {
+            submesh.lods[lod].firstIndex += submesh.firstIndex;
+        }
+        for (uint32_t m = submesh.firstMeshlet; m < submesh.firstMeshlet + submesh.meshletCount; ++m)
+        {
+            MeshletTable[m].firstIndex += submesh.firstIndex;
+        }
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Keep the coarsest level of every submesh on the CPU as an occluder. Only
+  the vertices the level uses are decoded, to model space, and the
+  indices are rebased onto them. The simplified surface strays up to the
+  level's error from the real one, in either direction, so each vertex is
+  pulled in along its normal by that much to keep the occluder inside
+  what it stands for. Submeshes too thin to shrink that far get no
+  occluder, the faces would cross and end up outside.
+
+\param vertices
+  The encoded vertex data, VertexCount * Stride bytes
+
+\param indices
+  The packed index data
+
+\param pool
+  Builds the submeshes in parallel
+*/
+/****************************************************************************/
+void DX11::Mesh::BuildOccluders(const uint8_t* vertices, const uint8_t* indices, DX11::WorkerPool& pool)
+{
+    OccluderTable.assign(SubmeshTable.size(), DX11::MeshOccluder());
+
+    pool.ParallelFor(SubmeshTable.size(), [&](size_t s)
+    {
+        const Submesh& submesh = SubmeshTable[s];
+        const SubmeshLod& level = submesh.lods[submesh.lodCount - 1];
+        DX11::MeshOccluder& occluder = OccluderTable[s];
+
+        const float thinnest = std::min({ submesh.boundsMax.x - submesh.boundsMin.x,
+            submesh.boundsMax.y - submesh.boundsMin.y, submesh.boundsMax.z - submesh.boundsMin.z });
+        if (2.0f * level.error >= thinnest)
+        {
+            return;
+        }
+
+        // submesh local vertex -> occluder vertex
+        std::vector<uint32_t> remap(submesh.vertexCount, UINT32_MAX);
+        occluder.indices.resize(level.indexCount);
+
+        const uint8_t* region = indices + submesh.indexOffset;
+        for (uint32_t i = 0; i < level.indexCount; ++i)
+        {
+            const uint32_t index = submesh.indexFormat == DXGI_FORMAT_R16_UINT
+                ? reinterpret_cast<const uint16_t*>(region)[level.firstIndex + i]
+                : reinterpret_cast<const uint32_t*>(region)[level.firstIndex + i];
+
+            if (remap[index] == UINT32_MAX)
+            {
+                remap[index] = uint32_t(occluder.positions.size());
+
+                DirectX::XMFLOAT3 position;
+                DirectX::XMFLOAT3 normal;
+                DX11::DecodeVertex(VertexLayout, vertices + size_t(submesh.baseVertex + index) * Stride, BoundsMin, BoundsExtent, &position.x, &normal.x);
+
+                position.x -= normal.x * level.error;
+                position.y -= normal.y * level.error;
+                position.z -= normal.z * level.error;
+                occluder.positions.push_back(position);
+            }
+            occluder.indices[i] = remap[index];
+        }
+    });
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Create the VBO and IBO
+
+\param device
+  The ID3D11Device
+
+\param staging
+  Fill GPU only buffers through this pool, null for immutable buffers
+
+\param vertices
+  vertexCount vertices
+
+\param vertexCount
+  number of vertices
+
+\param indices
+  packed index data
+
+\param indexBytes
+  size of the packed index data
+*/
+/****************************************************************************/
+void DX11::Mesh::CreateBuffers(DX11::Device device, DX11::StagingPool* staging, const void* vertices, uint32_t vertexCount, const void* indices, uint32_t indexBytes)
+{
+    // the data never changes, keep it in GPU only memory
+    if (!staging)
+    {
+        VBO = DX11::Buffer(device, vertexCount * Stride, D3D11_BIND_VERTEX_BUFFER, DX11::BufferUsage::Immutable, vertices);
+        IBO = DX11::Buffer(device, indexBytes, D3D11_BIND_INDEX_BUFFER, DX11::BufferUsage::Immutable, indices);
+        return;
+    }
+
+    // streamed, the copies share the frame's recycled staging blocks
+    VBO = DX11::Buffer(device, vertexCount * Stride, D3D11_BIND_VERTEX_BUFFER, DX11::BufferUsage::Default);
+    IBO = DX11::Buffer(device, indexBytes, D3D11_BIND_INDEX_BUFFER, DX11::BufferUsage::Default);
+    staging->Upload(device, VBO, 0, vertices, vertexCount * Stride);
+    staging->Upload(device, IBO, 0, indices, indexBytes);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the vertex and index data from assimp, weld it, reorder it for the
+  vertex caches, cluster it into meshlets and simplify it into levels of
+  detail. Safe to run on several meshes at once.
 
 \param mesh
   The ASSIMP type mesh
+
+\param out
+  The converted mesh, baseVertex is filled in later
 */
 /****************************************************************************/
-void DX11::Mesh::GetMesh(aiMesh* mesh) 
+void DX11::Mesh::GetMesh(const aiMesh* mesh, ImportedMesh& out) const
 {
+    std::vector<Vertex>& vertices = out.vertices;
+    std::vector<uint32_t>& indices = out.indices;
+    vertices.resize(mesh->mNumVertices);
+    indices.reserve(size_t(mesh->mNumFaces) * 3);
+
     // verticies
     for (unsigned i = 0; i < mesh->mNumVertices; ++i)
     {
-        Vertex vertex;
+        Vertex& vertex = vertices[i];
 
         // position
         vertex.position = DirectX::XMVectorSet(mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z, 1);
@@ -139,17 +761,74 @@ void DX11::Mesh::GetMesh(aiMesh* mesh)
             vertex.normal = DirectX::XMVectorSet(mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z, 1);
             vertex.normal = DirectX::XMVector4Normalize(vertex.normal);
         }
-
-        Vertices.push_back(vertex);
     }
 
-    // indicies
+    // indicies, triangulate can leave points and lines behind
     for (unsigned i = 0; i < mesh->mNumFaces; ++i)
     {
-        aiFace face = mesh->mFaces[i];
-        for (unsigned j = 0; j < face.mNumIndices; ++j)
+        const aiFace& face = mesh->mFaces[i];
+        if (face.mNumIndices == 3)
         {
-            Indices.push_back(face.mIndices[j]);
+            indices.insert(indices.end(), face.mIndices, face.mIndices + 3);
         }
     }
+
+    // weld, reorder for the post-transform cache, group into meshlets and reorder inside them, then reorder for vertex fetch
+    out.sourceVertices = mesh->mNumVertices;
+    out.before = DX11::MeshOptimizer::AnalyzeVertexCache(indices.data(), indices.size(), vertices.size());
+
+    size_t vertexCount = DX11::MeshOptimizer::WeldVertices(vertices.data(), vertices.size(), sizeof(Vertex), indices.data(), indices.size());
+    DX11::MeshOptimizer::OptimizeVertexCache(indices.data(), indices.size(), vertexCount);
+    DX11::Meshlets::Build(indices.data(), indices.size(), vertices.data(), vertexCount, sizeof(Vertex), out.meshlets);
+    DX11::Meshlets::OptimizeVertexCache(indices.data(), vertexCount, out.meshlets);
+    vertexCount = DX11::MeshOptimizer::OptimizeVertexFetch(vertices.data(), vertexCount, sizeof(Vertex), indices.data(), indices.size());
+    vertices.resize(vertexCount);
+
+    out.after = DX11::MeshOptimizer::AnalyzeVertexCache(indices.data(), indices.size(), vertices.size());
+
+    // indices stay local, the draw adds baseVertex
+    Submesh& submesh = out.submesh;
+    submesh.vertexCount = uint32_t(vertices.size());
+    submesh.indexCount = uint32_t(indices.size());
+    submesh.materialId = mesh->mMaterialIndex;
+
+    DirectX::XMVECTOR boundsMin = DirectX::XMVectorReplicate(FLT_MAX);
+    DirectX::XMVECTOR boundsMax = DirectX::XMVectorReplicate(-FLT_MAX);
+    for (const Vertex& vertex : vertices)
+    {
+        boundsMin = DirectX::XMVectorMin(boundsMin, vertex.position);
+        boundsMax = DirectX::XMVectorMax(boundsMax, vertex.position);
+    }
+    if (vertices.empty())
+    {
+        boundsMin = boundsMax = DirectX::XMVectorZero();
+    }
+    DirectX::XMStoreFloat3(&submesh.boundsMin, boundsMin);
+    DirectX::XMStoreFloat3(&submesh.boundsMax, boundsMax);
+
+    // sphere shares the box center, often tighter than the box's corners
+    DirectX::XMVECTOR center = DirectX::XMVectorScale(DirectX::XMVectorAdd(boundsMin, boundsMax), 0.5f);
+    float radiusSquared = 0.0f;
+    for (const Vertex& vertex : vertices)
+    {
+        DirectX::XMVECTOR offset = DirectX::XMVectorSubtract(vertex.position, center);
+        radiusSquared = std::max(radiusSquared, DirectX::XMVectorGetX(DirectX::XMVector3LengthSq(offset)));
+    }
+    submesh.boundingRadius = std::sqrt(radiusSquared);
+
+    // coarser levels collapse onto the same vertices, their indices follow the full detail ones
+    std::vector<DX11::MeshSimplifier::Level> levels;
+    DX11::MeshSimplifier::BuildLevels(indices.data(), indices.size(), vertices.data(), vertices.size(), sizeof(Vertex),
+        LOD_REDUCTION, DX11::MESH_LOD_COUNT - 1, levels);
+
+    submesh.lods[0].firstIndex = 0;
+    submesh.lods[0].indexCount = submesh.indexCount;
+    submesh.lodCount = uint32_t(levels.size()) + 1;
+    for (size_t lod = 0; lod < levels.size(); ++lod)
+    {
+        submesh.lods[lod + 1].firstIndex = uint32_t(indices.size());
+        submesh.lods[lod + 1].indexCount = uint32_t(levels[lod].indices.size());
+        submesh.lods[lod + 1].error = levels[lod].error;
+        indices.insert(indices.end(), levels[lod].indices.begin(), levels[lod].indices.end());
+    }
 }
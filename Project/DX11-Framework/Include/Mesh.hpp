@@ -14,6 +14,14 @@
 
 #include "Device.hpp"
 #include "Buffer.hpp"
+#include "VertexFormat.hpp"
+#include "MeshOptimizer.hpp"
+#include "MeshCache.hpp"
+#include "Meshlets.hpp"
+#include "RenderQueue.hpp"
+#include "StagingPool.hpp"
+#include "WorkerPool.hpp"
+#include <atomic>
 
 #pragma warning(push)
 #pragma warning(disable : 26812 26495 26451)
@@ -31,23 +39,122 @@ namespace DX11
         DirectX::XMVECTOR  normal = DirectX::XMVECTOR();
     };
 
+    //! levels per submesh, the full detail one included
+    static const uint32_t MESH_LOD_COUNT = 4;
+
+    //! one level of detail of a submesh, indexes the submesh's vertices
+    struct SubmeshLod
+    {
+        uint32_t firstIndex = 0;    //!< first index inside the submesh's index region
+        uint32_t indexCount = 0;
+        float error = 0;            //!< how far the level may stray from the full detail surface, model units
+    };
+
+    //! range of the shared vertex / index data that came from one aiMesh
+    struct Submesh
+    {
+        uint32_t baseVertex = 0;
+        uint32_t vertexCount = 0;
+        uint32_t firstIndex = 0;    //!< first index inside the index region
+        uint32_t indexCount = 0;
+        uint32_t indexOffset = 0;   //!< byte offset of the index region in the IBO
+        uint32_t indexFormat = DXGI_FORMAT_R32_UINT;
+        uint32_t materialId = 0;
+        DirectX::XMFLOAT3 boundsMin = { 0, 0, 0 };
+        DirectX::XMFLOAT3 boundsMax = { 0, 0, 0 };
+        float boundingRadius = 0;   //!< sphere around the box center holding every vertex
+        uint32_t lodCount = 1;
+        SubmeshLod lods[MESH_LOD_COUNT];    //!< finest first, lods[0] is firstIndex / indexCount
+        uint32_t firstMeshlet = 0;          //!< clusters of the full detail level in the meshlet table
+        uint32_t meshletCount = 0;
+    };
+
+    //! coarsest level of a submesh in model space, shrunk by its error to stay inside the submesh, empty when too thin
+    struct MeshOccluder
+    {
+        std::vector<DirectX::XMFLOAT3> positions;
+        std::vector<uint32_t> indices;
+    };
+
+    //! where a mesh is between the request and the first draw
+    enum class MeshState : uint32_t
+    {
+        Empty,      //!< nothing loaded
+        Loading,    //!< queued or being read / imported on a loader thread
+        Loaded,     //!< CPU data ready, waiting for Upload
+        Ready,      //!< buffers created, can be drawn
+        Failed      //!< the load threw, nothing to draw
+    };
+
     class Mesh 
     {
     public:
         ~Mesh();
         Mesh() = default;
-        Mesh(DX11::Device device, std::string path);
+        Mesh(DX11::Device device, std::string path, DX11::VertexFormat format = DX11::VertexFormat::Full);
+        Mesh(const Mesh&) = delete;
+        Mesh& operator=(const Mesh&) = delete;
+
+        void Load(const std::string& path, DX11::VertexFormat format);
+        void Convert(const aiMesh* const* meshes, size_t count, DX11::VertexFormat format, DX11::WorkerPool& pool);
+        void Upload(DX11::Device device, DX11::StagingPool* staging = nullptr);
+
+        DX11::MeshState State() const;
+        bool Ready() const;
+
+        void Draw(const DX11::Device& device);
+        void DrawSubmesh(const DX11::Device& device, uint32_t index);
+        void FillItem(uint32_t index, DX11::DrawItem& item, uint32_t lod = 0) const;
+        uint32_t SelectLod(uint32_t index, float pixelsPerUnit, uint32_t current, float threshold = 1.0f, float hysteresis = 0.25f) const;
 
-        void Draw(DX11::Device device);
+        const std::vector<Submesh>& Submeshes() const;
+        const std::vector<DX11::Meshlet>& Meshlets() const;
+        const std::vector<DX11::MeshOccluder>& Occluders() const;
+
+        DX11::VertexFormat Format() const;
+        DirectX::XMMATRIX DequantizeMatrix() const;
 
     private:
-        void GetMesh(aiMesh* mesh);
+        friend class AssetLoader;
+
+        //! one aiMesh converted and optimized, waiting to be packed
+        struct ImportedMesh
+        {
+            std::vector<Vertex> vertices;
+            std::vector<uint32_t> indices;  //!< every level back to back, full detail first
+            Submesh submesh;
+            std::vector<DX11::Meshlet> meshlets;    //!< firstIndex is local until packing
+            uint32_t sourceVertices = 0;
+            DX11::MeshOptimizer::VertexCacheStats before;
+            DX11::MeshOptimizer::VertexCacheStats after;
+        };
+
+        void Import(const std::string& path, uint32_t importFlags);
+        void GetMesh(const aiMesh* mesh, ImportedMesh& out) const;
+        void EncodeVertices(const std::vector<ImportedMesh>& parts, DX11::WorkerPool& pool);
+        void EncodeRange(const Vertex* vertices, size_t count, uint8_t* out) const;
+        void PackIndices(const std::vector<ImportedMesh>& parts, DX11::WorkerPool& pool);
+        void BuildOccluders(const uint8_t* vertices, const uint8_t* indices, DX11::WorkerPool& pool);
+        void CreateBuffers(DX11::Device device, DX11::StagingPool* staging, const void* vertices, uint32_t vertexCount, const void* indices, uint32_t indexBytes);
 
         DX11::Buffer VBO;
         DX11::Buffer IBO;
 
-        std::vector<Vertex> Vertices;
-        std::vector<unsigned> Indices;
+        DX11::VertexFormat VertexLayout = DX11::VertexFormat::Full;
+        uint32_t Stride = sizeof(Vertex);
+        uint32_t VertexCount = 0;
+        float BoundsMin[3] = { 0, 0, 0 };
+        float BoundsExtent[3] = { 0, 0, 0 };
+
+        std::vector<uint8_t> VertexData;
+        std::vector<uint8_t> IndexData;
+        std::vector<Submesh> SubmeshTable;
+        std::vector<DX11::Meshlet> MeshletTable;
+        std::vector<DX11::MeshOccluder> OccluderTable;  //!< one per submesh, kept after Upload
+
+        // CPU payload between Load and Upload, either the mapped cache or the packed data
+        std::unique_ptr<DX11::MeshCache> Cache;
+        std::atomic<DX11::MeshState> LoadState = DX11::MeshState::Empty;
     };
 }
 
@@ -0,0 +1,83 @@
+/****************************************************************************/
+/*!
+\file
+   MeshCache.hpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Versioned binary cache of imported mesh data. The file is laid out as
+    header + vertex blob + index blob + submesh table so it can be memory
+    mapped and handed straight to buffer creation without any parsing.
+*/
+/****************************************************************************/
+#ifndef MESHCACHE_H
+#define MESHCACHE_H
+#pragma once
+
+#include "DX11PCH.hpp"
+#include "VertexFormat.hpp"
+
+namespace DX11
+{
+    struct Submesh;
+    struct Meshlet;
+
+    //! bump whenever the layout or the import pipeline output changes
+    static const uint32_t MESH_CACHE_MAGIC = 0x4853454D; // 'MESH'
+    static const uint32_t MESH_CACHE_VERSION = 9;
+
+    struct MeshCacheHeader
+    {
+        uint32_t magic = MESH_CACHE_MAGIC;
+        uint32_t version = MESH_CACHE_VERSION;
+        uint64_t sourceHash = 0;
+        uint32_t importFlags = 0;
+        uint32_t vertexFormat = 0;
+        uint32_t vertexStride = 0;
+        uint32_t vertexCount = 0;
+        uint32_t indexBytes = 0;
+        uint32_t submeshCount = 0;
+        uint32_t meshletCount = 0;
+        float boundsMin[3] = { 0, 0, 0 };
+        float boundsExtent[3] = { 0, 0, 0 };
+        uint64_t vertexOffset = 0;
+        uint64_t indexOffset = 0;
+        uint64_t submeshOffset = 0;
+        uint64_t meshletOffset = 0;
+    };
+
+    class MeshCache
+    {
+    public:
+        MeshCache() = default;
+        ~MeshCache();
+        MeshCache(const MeshCache&) = delete;
+        MeshCache& operator=(const MeshCache&) = delete;
+
+        bool Open(const std::string& path, uint64_t sourceHash, uint32_t importFlags, DX11::VertexFormat vertexFormat);
+        void Close();
+
+        static void Write(const std::string& path, const MeshCacheHeader& header, const void* vertices,
+            const void* indices, const DX11::Submesh* submeshes, const DX11::Meshlet* meshlets);
+
+        static uint64_t HashFile(const std::string& path);
+        static std::string CachePath(const std::string& path);
+
+        const MeshCacheHeader& Header() const;
+        const void* Vertices() const;
+        const void* Indices() const;
+        const DX11::Submesh* Submeshes() const;
+        const DX11::Meshlet* Meshlets() const;
+
+    private:
+        HANDLE mFile = INVALID_HANDLE_VALUE;
+        HANDLE mMapping = nullptr;
+        const uint8_t* mView = nullptr;
+        MeshCacheHeader mHeader;
+    };
+}
+
+#endif // MESHCACHE_H
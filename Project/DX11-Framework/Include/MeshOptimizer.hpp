@@ -0,0 +1,59 @@
+/****************************************************************************/
+/*!
+\file
+   MeshOptimizer.hpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Import time index / vertex optimization. Welds identical vertices,
+    reorders triangles for the post-transform cache (Forsyth) and then
+    reorders vertices for fetch locality. Vertices are treated as raw
+    bytes of a given stride so any layout can be passed in. Finally packs
+    the index lists of many submeshes into one 16 / 32 bit index buffer.
+*/
+/****************************************************************************/
+#ifndef MESHOPTIMIZER_H
+#define MESHOPTIMIZER_H
+#pragma once
+
+#include "DX11PCH.hpp"
+
+namespace DX11
+{
+    class WorkerPool;
+
+    namespace MeshOptimizer
+    {
+        struct VertexCacheStats
+        {
+            uint32_t transformed = 0;   //!< vertices the simulated cache had to shade
+            float acmr = 0.0f;          //!< average cache miss ratio, transformed / triangles
+            float atvr = 0.0f;          //!< average transform to vertex ratio, transformed / vertices
+        };
+
+        //! where PackIndices put one list, its indices are unchanged so stay local to its vertices
+        struct PackedRange
+        {
+            uint32_t indexFormat = DXGI_FORMAT_R32_UINT;
+            uint32_t indexOffset = 0;   //!< byte offset of the list's region
+            uint32_t firstIndex = 0;    //!< first index of the list inside the region
+        };
+
+        //! most vertices a list can index and still be packed as 16 bit
+        static const uint32_t MAX_NARROW_VERTICES = 0x10000;
+
+        size_t WeldVertices(void* vertices, size_t vertexCount, size_t stride, uint32_t* indices, size_t indexCount);
+        void OptimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount);
+        size_t OptimizeVertexFetch(void* vertices, size_t vertexCount, size_t stride, uint32_t* indices, size_t indexCount);
+
+        void PackIndices(const uint32_t* const* indices, const size_t* indexCounts, const uint32_t* vertexCounts, size_t count,
+            std::vector<uint8_t>& out, PackedRange* ranges, DX11::WorkerPool& pool);
+
+        VertexCacheStats AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize = 16);
+    }
+}
+
+#endif // MESHOPTIMIZER_H
@@ -0,0 +1,44 @@
+/****************************************************************************/
+/*!
+\file
+   MeshSimplifier.hpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Import time LOD generation. Quadric error edge collapse (Garland and
+    Heckbert) that only ever moves a vertex onto one of its neighbours, so
+    every level indexes the original vertices and can share their buffer.
+    Open borders only collapse along themselves and vertices on attribute
+    seams are never moved. Vertices are treated as raw bytes of a given
+    stride, the position is read from the first 3 floats.
+*/
+/****************************************************************************/
+#ifndef MESHSIMPLIFIER_H
+#define MESHSIMPLIFIER_H
+#pragma once
+
+#include "DX11PCH.hpp"
+
+namespace DX11
+{
+    namespace MeshSimplifier
+    {
+        //! one simplified index list
+        struct Level
+        {
+            std::vector<uint32_t> indices;
+            float error = 0.0f;         //!< furthest the level may stray from the original surface, in model units
+        };
+
+        size_t Simplify(const uint32_t* indices, size_t indexCount, const void* vertices, size_t vertexCount, size_t stride,
+            size_t targetIndexCount, float targetError, uint32_t* out, float* error = nullptr);
+
+        size_t BuildLevels(const uint32_t* indices, size_t indexCount, const void* vertices, size_t vertexCount, size_t stride,
+            float reduction, uint32_t maxLevels, std::vector<Level>& levels);
+    }
+}
+
+#endif // MESHSIMPLIFIER_H
@@ -0,0 +1,83 @@
+/****************************************************************************/
+/*!
+\file
+   Meshlets.hpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Meshlet clustering and culling. Import reorders a triangle list into
+    small clusters of neighbouring triangles, each a contiguous run of
+    indices with a bounding sphere and a cone around its triangle normals.
+    The culler drops clusters outside the frustum or facing away from the
+    camera and hands back the index ranges left to draw, runs of adjacent
+    survivors merged into one.
+*/
+/****************************************************************************/
+#ifndef MESHLETS_H
+#define MESHLETS_H
+#pragma once
+
+#include "DX11PCH.hpp"
+#include "VisibilitySet.hpp"
+
+namespace DX11
+{
+    //! a run of triangles in a submesh's index range, bounds are model space
+    struct Meshlet
+    {
+        DirectX::XMFLOAT3 center = { 0, 0, 0 };
+        float radius = 0;
+        DirectX::XMFLOAT3 coneAxis = { 0, 0, 0 };   //!< average facing of the triangles
+        float coneCutoff = 1;                       //!< sin of the cone's half angle, 1 when it can not be culled
+        uint32_t firstIndex = 0;
+        uint32_t indexCount = 0;
+    };
+
+    //! part of an index buffer to draw
+    struct IndexRange
+    {
+        uint32_t firstIndex = 0;
+        uint32_t indexCount = 0;
+    };
+
+    //! counts since the last ResetStats
+    struct MeshletStats
+    {
+        uint32_t tested = 0;
+        uint32_t frustumCulled = 0;
+        uint32_t backfaceCulled = 0;
+        uint32_t triangles = 0;         //!< in the tested meshlets
+        uint32_t trianglesCulled = 0;
+        uint32_t ranges = 0;            //!< draws handed back after merging
+    };
+
+    namespace Meshlets
+    {
+        static const uint32_t MAX_VERTICES = 64;
+        static const uint32_t MAX_TRIANGLES = 124;
+
+        size_t Build(uint32_t* indices, size_t indexCount, const void* vertices, size_t vertexCount, size_t stride,
+            std::vector<DX11::Meshlet>& meshlets, uint32_t maxVertices = MAX_VERTICES, uint32_t maxTriangles = MAX_TRIANGLES);
+        void OptimizeVertexCache(uint32_t* indices, size_t vertexCount, const std::vector<DX11::Meshlet>& meshlets);
+    }
+
+    class MeshletCuller
+    {
+    public:
+        MeshletCuller() = default;
+
+        size_t Cull(const DX11::Meshlet* meshlets, size_t count, const DX11::Frustum& frustum, const DirectX::XMFLOAT3& camera,
+            std::vector<DX11::IndexRange>& ranges);
+
+        void ResetStats();
+        const DX11::MeshletStats& Stats() const;
+
+    private:
+        DX11::MeshletStats mStats;
+    };
+}
+
+#endif // MESHLETS_H
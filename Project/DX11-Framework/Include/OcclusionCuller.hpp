@@ -0,0 +1,107 @@
+/****************************************************************************/
+/*!
+\file
+   OcclusionCuller.hpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    CPU occlusion culling. Occluder triangles are binned into screen tiles
+    and each tile is rasterized into a small depth buffer by one job, 4
+    pixels at a time with SSE coverage masks. A max depth mip chain is
+    built on top so an occludee box is tested against a few texels at the
+    level that fits it.
+*/
+/****************************************************************************/
+#ifndef OCCLUSIONCULLER_H
+#define OCCLUSIONCULLER_H
+#pragma once
+
+#include "DX11PCH.hpp"
+#include <atomic>
+
+namespace DX11
+{
+    class WorkerPool;
+
+    //! counts since the last Begin
+    struct OcclusionStats
+    {
+        uint32_t occluders = 0;
+        uint32_t triangles = 0;     //!< after near plane clipping and screen rejection
+        uint32_t tested = 0;
+        uint32_t occluded = 0;
+    };
+
+    class OcclusionCuller
+    {
+    public:
+        static const uint32_t TILE_WIDTH = 32;
+        static const uint32_t TILE_HEIGHT = 16;
+
+        //! rounded up to whole tiles
+        OcclusionCuller(uint32_t width = 320, uint32_t height = 192);
+
+        void Begin(DirectX::FXMMATRIX viewProjection);
+        void AddOccluder(const DirectX::XMFLOAT3* positions, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount, DirectX::FXMMATRIX world);
+        void Rasterize();
+        void Rasterize(DX11::WorkerPool& pool);
+
+        bool Visible(const DirectX::XMFLOAT3& boundsMin, const DirectX::XMFLOAT3& boundsMax, DirectX::FXMMATRIX world) const;
+        size_t Cull(const std::vector<DirectX::XMFLOAT3>& boundsMin, const std::vector<DirectX::XMFLOAT3>& boundsMax, std::vector<uint32_t>& visible) const;
+
+        DX11::OcclusionStats Stats() const;
+
+        // debugging
+        uint32_t Width() const;
+        uint32_t Height() const;
+        const std::vector<float>& Depth() const;
+        bool SaveDepthImage(const std::string& path) const;
+
+    private:
+        //! screen space edge and depth planes, inside when all 3 edges are >= 0
+        struct Triangle
+        {
+            float edgeA[3];
+            float edgeB[3];
+            float edgeC[3];
+            float depthX;           //!< depth = depthX * x + depthY * y + depthConstant
+            float depthY;
+            float depthConstant;
+            int32_t minX;
+            int32_t minY;
+            int32_t maxX;
+            int32_t maxY;
+        };
+
+        void AddTriangle(const DirectX::XMFLOAT4& a, const DirectX::XMFLOAT4& b, const DirectX::XMFLOAT4& c);
+        void SetupTriangle(const DirectX::XMFLOAT4& a, const DirectX::XMFLOAT4& b, const DirectX::XMFLOAT4& c);
+        void RasterizeTile(uint32_t tile);
+        void BuildHierarchy();
+        bool TestBox(const DirectX::XMFLOAT4X4& transform, const DirectX::XMFLOAT3& boundsMin, const DirectX::XMFLOAT3& boundsMax) const;
+
+        uint32_t mWidth;
+        uint32_t mHeight;
+        uint32_t mTilesX;
+        uint32_t mTilesY;
+
+        DirectX::XMMATRIX mViewProjection;
+
+        // level 0 is the depth buffer, each level after holds the max of 2x2 texels
+        std::vector<std::vector<float>> mLevels;
+        std::vector<uint32_t> mLevelWidths;
+        std::vector<uint32_t> mLevelHeights;
+
+        std::vector<Triangle> mTriangles;
+        std::vector<std::vector<uint32_t>> mBins;   //!< triangles touching each tile
+        std::vector<DirectX::XMFLOAT4> mClip;       //!< scratch for one occluder's vertices
+
+        uint32_t mOccluders = 0;
+        mutable std::atomic<uint32_t> mTested;
+        mutable std::atomic<uint32_t> mOccluded;
+    };
+}
+
+#endif // OCCLUSIONCULLER_H
@@ -0,0 +1,80 @@
+/****************************************************************************/
+/*!
+\file
+   PipelineStateCache.hpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Deduplicates rasterizer, depth stencil and blend states. Each desc is
+    hashed and looked up, only a desc never seen before creates a new D3D
+    object and every caller asking for the same desc shares it.
+*/
+/****************************************************************************/
+#ifndef PIPELINESTATECACHE_H
+#define PIPELINESTATECACHE_H
+#pragma once
+
+#include "DX11PCH.hpp"
+#include "Device.hpp"
+#include "PipelineStates.hpp"
+#include <unordered_map>
+
+namespace DX11
+{
+    struct PipelineStateCacheStats
+    {
+        uint32_t hits = 0;
+        uint32_t misses = 0;        //!< lookups that had to create a state
+        uint32_t prewarmed = 0;     //!< states created by Prewarm
+        size_t states = 0;          //!< distinct states held
+    };
+
+    class PipelineStateCache
+    {
+    public:
+        PipelineStateCache() = default;
+
+        DX11::RasterizerState Rasterizer(DX11::Device device, const D3D11_RASTERIZER_DESC& desc);
+        DX11::DepthStencilState DepthStencil(DX11::Device device, const D3D11_DEPTH_STENCIL_DESC& desc);
+        DX11::BlendState Blend(DX11::Device device, const D3D11_BLEND_DESC& desc);
+
+        void Prewarm(DX11::Device device,
+            const std::vector<D3D11_RASTERIZER_DESC>& rasterizers,
+            const std::vector<D3D11_DEPTH_STENCIL_DESC>& depthStencils,
+            const std::vector<D3D11_BLEND_DESC>& blends);
+
+        void Clear();
+        DX11::PipelineStateCacheStats Stats() const;
+
+    private:
+        //! hashes and compares the desc bytes, descs are normalized so padding is zero
+        template <typename Desc>
+        struct DescHash
+        {
+            size_t operator()(const Desc& desc) const;
+        };
+
+        template <typename Desc>
+        struct DescEqual
+        {
+            bool operator()(const Desc& a, const Desc& b) const;
+        };
+
+        template <typename Desc, typename State>
+        using Table = std::unordered_map<Desc, State, DescHash<Desc>, DescEqual<Desc>>;
+
+        template <typename Desc, typename State>
+        State Find(DX11::Device device, Table<Desc, State>& table, const Desc& desc, bool prewarm);
+
+        Table<D3D11_RASTERIZER_DESC, DX11::RasterizerState> mRasterizers;
+        Table<D3D11_DEPTH_STENCIL_DESC, DX11::DepthStencilState> mDepthStencils;
+        Table<D3D11_BLEND_DESC, DX11::BlendState> mBlends;
+
+        DX11::PipelineStateCacheStats mStats;
+    };
+}
+
+#endif // PIPELINESTATECACHE_H
@@ -28,6 +28,11 @@ namespace DX11
         RasterizerState() = default;
         RasterizerState(DX11::Device device, D3D11_RASTERIZER_DESC desc)
         {
+            if (device.Headless())
+            {
+                return;
+            }
+
             if (!SUCCEEDED(device->CreateRasterizerState(&desc, ReleaseAndGetAddressOf())))
             {
                 throw std::runtime_error("DX11: CreateRasterizerState() failed from RasterizerState!\n");
@@ -43,6 +48,11 @@ namespace DX11
         DepthStencilState() = default; 
         DepthStencilState(DX11::Device device, D3D11_DEPTH_STENCIL_DESC desc)
         {
+            if (device.Headless())
+            {
+                return;
+            }
+
             if (!SUCCEEDED(device->CreateDepthStencilState(&desc, ReleaseAndGetAddressOf())))
             {
                 throw std::runtime_error("DX11: CreateDepthStencilState() failed from RasterizerState!\n");
@@ -57,6 +67,11 @@ namespace DX11
         BlendState() = default; 
         BlendState(DX11::Device device, D3D11_BLEND_DESC desc)
         {
+            if (device.Headless())
+            {
+                return;
+            }
+
             if (!SUCCEEDED(device->CreateBlendState(&desc, ReleaseAndGetAddressOf())))
             {
                 throw std::runtime_error("DX11: CreateBlendState() failed from RasterizerState!\n");
@@ -0,0 +1,424 @@
+/****************************************************************************/
+/*!
+\file
+   HeadlessMath.hpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Scalar stand in for the DirectXMath functions the framework uses, for
+    builds without the Windows SDK. Same types, row vector convention and
+    results as DirectXMath built with _XM_NO_INTRINSICS_, so CPU side math
+    (culling, LOD, quantization) is tested exactly as it runs on Windows.
+*/
+/****************************************************************************/
+#ifndef HEADLESSMATH_H
+#define HEADLESSMATH_H
+#pragma once
+
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+
+namespace DirectX
+{
+    constexpr float XM_PI = 3.141592654f;
+    constexpr float XM_2PI = 6.283185307f;
+    constexpr float XM_PIDIV2 = 1.570796327f;
+    constexpr float XM_PIDIV4 = 0.785398163f;
+
+    struct __vector4
+    {
+        union
+        {
+            float vector4_f32[4];
+            uint32_t vector4_u32[4];
+        };
+    };
+
+    typedef __vector4 XMVECTOR;
+    typedef const XMVECTOR& FXMVECTOR;
+    typedef const XMVECTOR& GXMVECTOR;
+    typedef const XMVECTOR& HXMVECTOR;
+    typedef const XMVECTOR& CXMVECTOR;
+
+    struct XMMATRIX
+    {
+        XMVECTOR r[4];
+    };
+
+    typedef const XMMATRIX& FXMMATRIX;
+    typedef const XMMATRIX& CXMMATRIX;
+
+    struct XMVECTORF32
+    {
+        union
+        {
+            float f[4];
+            XMVECTOR v;
+        };
+
+        operator XMVECTOR() const { return v; }
+        operator const float*() const { return f; }
+    };
+
+    struct XMFLOAT3
+    {
+        float x;
+        float y;
+        float z;
+
+        XMFLOAT3() = default;
+        constexpr XMFLOAT3(float _x, float _y, float _z) : x(_x), y(_y), z(_z) {}
+    };
+
+    struct XMFLOAT4
+    {
+        float x;
+        float y;
+        float z;
+        float w;
+
+        XMFLOAT4() = default;
+        constexpr XMFLOAT4(float _x, float _y, float _z, float _w) : x(_x), y(_y), z(_z), w(_w) {}
+    };
+
+    struct XMFLOAT4X4
+    {
+        float m[4][4];
+
+        XMFLOAT4X4() = default;
+        constexpr XMFLOAT4X4(float m00, float m01, float m02, float m03,
+                             float m10, float m11, float m12, float m13,
+                             float m20, float m21, float m22, float m23,
+                             float m30, float m31, float m32, float m33) :
+            m{ { m00, m01, m02, m03 }, { m10, m11, m12, m13 }, { m20, m21, m22, m23 }, { m30, m31, m32, m33 } }
+        {
+        }
+    };
+
+/*============================================================================*\
+|| ------------------------------- VECTORS ---------------------------------- ||
+\*============================================================================*/
+
+    inline XMVECTOR XMVectorSet(float x, float y, float z, float w)
+    {
+        XMVECTOR v;
+        v.vector4_f32[0] = x;
+        v.vector4_f32[1] = y;
+        v.vector4_f32[2] = z;
+        v.vector4_f32[3] = w;
+        return v;
+    }
+
+    inline XMVECTOR XMVectorZero() { return XMVectorSet(0.0f, 0.0f, 0.0f, 0.0f); }
+    inline XMVECTOR XMVectorReplicate(float value) { return XMVectorSet(value, value, value, value); }
+
+    inline float XMVectorGetX(FXMVECTOR v) { return v.vector4_f32[0]; }
+    inline float XMVectorGetY(FXMVECTOR v) { return v.vector4_f32[1]; }
+    inline float XMVectorGetZ(FXMVECTOR v) { return v.vector4_f32[2]; }
+    inline float XMVectorGetW(FXMVECTOR v) { return v.vector4_f32[3]; }
+
+    inline XMVECTOR XMVectorAdd(FXMVECTOR a, FXMVECTOR b)
+    {
+        return XMVectorSet(a.vector4_f32[0] + b.vector4_f32[0], a.vector4_f32[1] + b.vector4_f32[1],
+            a.vector4_f32[2] + b.vector4_f32[2], a.vector4_f32[3] + b.vector4_f32[3]);
+    }
+
+    inline XMVECTOR XMVectorSubtract(FXMVECTOR a, FXMVECTOR b)
+    {
+        return XMVectorSet(a.vector4_f32[0] - b.vector4_f32[0], a.vector4_f32[1] - b.vector4_f32[1],
+            a.vector4_f32[2] - b.vector4_f32[2], a.vector4_f32[3] - b.vector4_f32[3]);
+    }
+
+    inline XMVECTOR XMVectorMultiply(FXMVECTOR a, FXMVECTOR b)
+    {
+        return XMVectorSet(a.vector4_f32[0] * b.vector4_f32[0], a.vector4_f32[1] * b.vector4_f32[1],
+            a.vector4_f32[2] * b.vector4_f32[2], a.vector4_f32[3] * b.vector4_f32[3]);
+    }
+
+    inline XMVECTOR XMVectorScale(FXMVECTOR v, float scale)
+    {
+        return XMVectorSet(v.vector4_f32[0] * scale, v.vector4_f32[1] * scale, v.vector4_f32[2] * scale, v.vector4_f32[3] * scale);
+    }
+
+    inline XMVECTOR XMVectorMin(FXMVECTOR a, FXMVECTOR b)
+    {
+        return XMVectorSet(a.vector4_f32[0] < b.vector4_f32[0] ? a.vector4_f32[0] : b.vector4_f32[0],
+            a.vector4_f32[1] < b.vector4_f32[1] ? a.vector4_f32[1] : b.vector4_f32[1],
+            a.vector4_f32[2] < b.vector4_f32[2] ? a.vector4_f32[2] : b.vector4_f32[2],
+            a.vector4_f32[3] < b.vector4_f32[3] ? a.vector4_f32[3] : b.vector4_f32[3]);
+    }
+
+    inline XMVECTOR XMVectorMax(FXMVECTOR a, FXMVECTOR b)
+    {
+        return XMVectorSet(a.vector4_f32[0] > b.vector4_f32[0] ? a.vector4_f32[0] : b.vector4_f32[0],
+            a.vector4_f32[1] > b.vector4_f32[1] ? a.vector4_f32[1] : b.vector4_f32[1],
+            a.vector4_f32[2] > b.vector4_f32[2] ? a.vector4_f32[2] : b.vector4_f32[2],
+            a.vector4_f32[3] > b.vector4_f32[3] ? a.vector4_f32[3] : b.vector4_f32[3]);
+    }
+
+    inline XMVECTOR XMVector3Dot(FXMVECTOR a, FXMVECTOR b)
+    {
+        return XMVectorReplicate(a.vector4_f32[0] * b.vector4_f32[0] + a.vector4_f32[1] * b.vector4_f32[1] + a.vector4_f32[2] * b.vector4_f32[2]);
+    }
+
+    inline XMVECTOR XMVector3Cross(FXMVECTOR a, FXMVECTOR b)
+    {
+        return XMVectorSet(a.vector4_f32[1] * b.vector4_f32[2] - a.vector4_f32[2] * b.vector4_f32[1],
+            a.vector4_f32[2] * b.vector4_f32[0] - a.vector4_f32[0] * b.vector4_f32[2],
+            a.vector4_f32[0] * b.vector4_f32[1] - a.vector4_f32[1] * b.vector4_f32[0], 0.0f);
+    }
+
+    inline XMVECTOR XMVector3LengthSq(FXMVECTOR v) { return XMVector3Dot(v, v); }
+    inline XMVECTOR XMVector3Length(FXMVECTOR v) { return XMVectorReplicate(std::sqrt(XMVectorGetX(XMVector3Dot(v, v)))); }
+
+    inline XMVECTOR XMVector3Normalize(FXMVECTOR v)
+    {
+        float length = XMVectorGetX(XMVector3Length(v));
+        return length > 0.0f ? XMVectorScale(v, 1.0f / length) : v;
+    }
+
+    inline XMVECTOR XMVector4Normalize(FXMVECTOR v)
+    {
+        float length = std::sqrt(v.vector4_f32[0] * v.vector4_f32[0] + v.vector4_f32[1] * v.vector4_f32[1]
+            + v.vector4_f32[2] * v.vector4_f32[2] + v.vector4_f32[3] * v.vector4_f32[3]);
+        return length > 0.0f ? XMVectorScale(v, 1.0f / length) : v;
+    }
+
+    inline XMVECTOR XMLoadFloat3(const XMFLOAT3* source) { return XMVectorSet(source->x, source->y, source->z, 0.0f); }
+    inline XMVECTOR XMLoadFloat4(const XMFLOAT4* source) { return XMVectorSet(source->x, source->y, source->z, source->w); }
+
+    inline void XMStoreFloat3(XMFLOAT3* destination, FXMVECTOR v)
+    {
+        destination->x = v.vector4_f32[0];
+        destination->y = v.vector4_f32[1];
+        destination->z = v.vector4_f32[2];
+    }
+
+    inline void XMStoreFloat4(XMFLOAT4* destination, FXMVECTOR v)
+    {
+        destination->x = v.vector4_f32[0];
+        destination->y = v.vector4_f32[1];
+        destination->z = v.vector4_f32[2];
+        destination->w = v.vector4_f32[3];
+    }
+
+    inline XMVECTOR operator+(FXMVECTOR a, FXMVECTOR b) { return XMVectorAdd(a, b); }
+    inline XMVECTOR operator-(FXMVECTOR a, FXMVECTOR b) { return XMVectorSubtract(a, b); }
+    inline XMVECTOR operator*(FXMVECTOR a, FXMVECTOR b) { return XMVectorMultiply(a, b); }
+    inline XMVECTOR operator*(FXMVECTOR v, float scale) { return XMVectorScale(v, scale); }
+    inline XMVECTOR operator*(float scale, FXMVECTOR v) { return XMVectorScale(v, scale); }
+
+/*============================================================================*\
+|| ------------------------------- MATRICES --------------------------------- ||
+\*============================================================================*/
+
+    inline XMMATRIX XMMatrixSet(float m00, float m01, float m02, float m03,
+                                float m10, float m11, float m12, float m13,
+                                float m20, float m21, float m22, float m23,
+                                float m30, float m31, float m32, float m33)
+    {
+        XMMATRIX m;
+        m.r[0] = XMVectorSet(m00, m01, m02, m03);
+        m.r[1] = XMVectorSet(m10, m11, m12, m13);
+        m.r[2] = XMVectorSet(m20, m21, m22, m23);
+        m.r[3] = XMVectorSet(m30, m31, m32, m33);
+        return m;
+    }
+
+    inline XMMATRIX XMMatrixIdentity()
+    {
+        return XMMatrixSet(1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f);
+    }
+
+    inline XMMATRIX XMMatrixScaling(float x, float y, float z)
+    {
+        return XMMatrixSet(x, 0.0f, 0.0f, 0.0f, 0.0f, y, 0.0f, 0.0f, 0.0f, 0.0f, z, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f);
+    }
+
+    inline XMMATRIX XMMatrixTranslation(float x, float y, float z)
+    {
+        return XMMatrixSet(1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, x, y, z, 1.0f);
+    }
+
+    inline XMMATRIX XMMatrixTranspose(FXMMATRIX m)
+    {
+        XMMATRIX t;
+        for (int i = 0; i < 4; ++i)
+        {
+            for (int j = 0; j < 4; ++j)
+            {
+                t.r[i].vector4_f32[j] = m.r[j].vector4_f32[i];
+            }
+        }
+        return t;
+    }
+
+    inline XMMATRIX XMMatrixMultiply(FXMMATRIX a, CXMMATRIX b)
+    {
+        XMMATRIX m;
+        for (int i = 0; i < 4; ++i)
+        {
+            for (int j = 0; j < 4; ++j)
+            {
+                m.r[i].vector4_f32[j] = a.r[i].vector4_f32[0] * b.r[0].vector4_f32[j] + a.r[i].vector4_f32[1] * b.r[1].vector4_f32[j]
+                    + a.r[i].vector4_f32[2] * b.r[2].vector4_f32[j] + a.r[i].vector4_f32[3] * b.r[3].vector4_f32[j];
+            }
+        }
+        return m;
+    }
+
+    inline XMMATRIX operator*(FXMMATRIX a, CXMMATRIX b) { return XMMatrixMultiply(a, b); }
+
+    //! general 4x4 inverse by cofactors, the determinant goes to determinant when given
+    inline XMMATRIX XMMatrixInverse(XMVECTOR* determinant, FXMMATRIX m)
+    {
+        float a[16];
+        for (int i = 0; i < 16; ++i)
+        {
+            a[i] = m.r[i / 4].vector4_f32[i % 4];
+        }
+
+        float inv[16];
+        inv[0] = a[5] * a[10] * a[15] - a[5] * a[11] * a[14] - a[9] * a[6] * a[15] + a[9] * a[7] * a[14] + a[13] * a[6] * a[11] - a[13] * a[7] * a[10];
+        inv[4] = -a[4] * a[10] * a[15] + a[4] * a[11] * a[14] + a[8] * a[6] * a[15] - a[8] * a[7] * a[14] - a[12] * a[6] * a[11] + a[12] * a[7] * a[10];
+        inv[8] = a[4] * a[9] * a[15] - a[4] * a[11] * a[13] - a[8] * a[5] * a[15] + a[8] * a[7] * a[13] + a[12] * a[5] * a[11] - a[12] * a[7] * a[9];
+        inv[12] = -a[4] * a[9] * a[14] + a[4] * a[10] * a[13] + a[8] * a[5] * a[14] - a[8] * a[6] * a[13] - a[12] * a[5] * a[10] + a[12] * a[6] * a[9];
+        inv[1] = -a[1] * a[10] * a[15] + a[1] * a[11] * a[14] + a[9] * a[2] * a[15] - a[9] * a[3] * a[14] - a[13] * a[2] * a[11] + a[13] * a[3] * a[10];
+        inv[5] = a[0] * a[10] * a[15] - a[0] * a[11] * a[14] - a[8] * a[2] * a[15] + a[8] * a[3] * a[14] + a[12] * a[2] * a[11] - a[12] * a[3] * a[10];
+        inv[9] = -a[0] * a[9] * a[15] + a[0] * a[11] * a[13] + a[8] * a[1] * a[15] - a[8] * a[3] * a[13] - a[12] * a[1] * a[11] + a[12] * a[3] * a[9];
+        inv[13] = a[0] * a[9] * a[14] - a[0] * a[10] * a[13] - a[8] * a[1] * a[14] + a[8] * a[2] * a[13] + a[12] * a[1] * a[10] - a[12] * a[2] * a[9];
+        inv[2] = a[1] * a[6] * a[15] - a[1] * a[7] * a[14] - a[5] * a[2] * a[15] + a[5] * a[3] * a[14] + a[13] * a[2] * a[7] - a[13] * a[3] * a[6];
+        inv[6] = -a[0] * a[6] * a[15] + a[0] * a[7] * a[14] + a[4] * a[2] * a[15] - a[4] * a[3] * a[14] - a[12] * a[2] * a[7] + a[12] * a[3] * a[6];
+        inv[10] = a[0] * a[5] * a[15] - a[0] * a[7] * a[13] - a[4] * a[1] * a[15] + a[4] * a[3] * a[13] + a[12] * a[1] * a[7] - a[12] * a[3] * a[5];
+        inv[14] = -a[0] * a[5] * a[14] + a[0] * a[6] * a[13] + a[4] * a[1] * a[14] - a[4] * a[2] * a[13] - a[12] * a[1] * a[6] + a[12] * a[2] * a[5];
+        inv[3] = -a[1] * a[6] * a[11] + a[1] * a[7] * a[10] + a[5] * a[2] * a[11] - a[5] * a[3] * a[10] - a[9] * a[2] * a[7] + a[9] * a[3] * a[6];
+        inv[7] = a[0] * a[6] * a[11] - a[0] * a[7] * a[10] - a[4] * a[2] * a[11] + a[4] * a[3] * a[10] + a[8] * a[2] * a[7] - a[8] * a[3] * a[6];
+        inv[11] = -a[0] * a[5] * a[11] + a[0] * a[7] * a[9] + a[4] * a[1] * a[11] - a[4] * a[3] * a[9] - a[8] * a[1] * a[7] + a[8] * a[3] * a[5];
+        inv[15] = a[0] * a[5] * a[10] - a[0] * a[6] * a[9] - a[4] * a[1] * a[10] + a[4] * a[2] * a[9] + a[8] * a[1] * a[6] - a[8] * a[2] * a[5];
+
+        const float det = a[0] * inv[0] + a[1] * inv[4] + a[2] * inv[8] + a[3] * inv[12];
+        if (determinant)
+        {
+            *determinant = XMVectorReplicate(det);
+        }
+
+        const float scale = det != 0.0f ? 1.0f / det : 0.0f;
+        XMMATRIX out;
+        for (int i = 0; i < 16; ++i)
+        {
+            out.r[i / 4].vector4_f32[i % 4] = inv[i] * scale;
+        }
+        return out;
+    }
+
+    inline XMVECTOR XMVector3Transform(FXMVECTOR v, FXMMATRIX m)
+    {
+        XMVECTOR result = m.r[3];
+        result = XMVectorAdd(result, XMVectorScale(m.r[0], v.vector4_f32[0]));
+        result = XMVectorAdd(result, XMVectorScale(m.r[1], v.vector4_f32[1]));
+        result = XMVectorAdd(result, XMVectorScale(m.r[2], v.vector4_f32[2]));
+        return result;
+    }
+
+    inline XMVECTOR XMVector4Transform(FXMVECTOR v, FXMMATRIX m)
+    {
+        XMVECTOR result = XMVectorScale(m.r[0], v.vector4_f32[0]);
+        result = XMVectorAdd(result, XMVectorScale(m.r[1], v.vector4_f32[1]));
+        result = XMVectorAdd(result, XMVectorScale(m.r[2], v.vector4_f32[2]));
+        result = XMVectorAdd(result, XMVectorScale(m.r[3], v.vector4_f32[3]));
+        return result;
+    }
+
+    inline XMMATRIX XMLoadFloat4x4(const XMFLOAT4X4* source)
+    {
+        XMMATRIX m;
+        for (int i = 0; i < 4; ++i)
+        {
+            m.r[i] = XMVectorSet(source->m[i][0], source->m[i][1], source->m[i][2], source->m[i][3]);
+        }
+        return m;
+    }
+
+    inline void XMStoreFloat4x4(XMFLOAT4X4* destination, FXMMATRIX m)
+    {
+        for (int i = 0; i < 4; ++i)
+        {
+            for (int j = 0; j < 4; ++j)
+            {
+                destination->m[i][j] = m.r[i].vector4_f32[j];
+            }
+        }
+    }
+
+    inline XMMATRIX XMMatrixLookAtLH(FXMVECTOR eye, FXMVECTOR focus, FXMVECTOR up)
+    {
+        const XMVECTOR z = XMVector3Normalize(XMVectorSubtract(focus, eye));
+        const XMVECTOR x = XMVector3Normalize(XMVector3Cross(up, z));
+        const XMVECTOR y = XMVector3Cross(z, x);
+        return XMMatrixSet(
+            XMVectorGetX(x), XMVectorGetX(y), XMVectorGetX(z), 0.0f,
+            XMVectorGetY(x), XMVectorGetY(y), XMVectorGetY(z), 0.0f,
+            XMVectorGetZ(x), XMVectorGetZ(y), XMVectorGetZ(z), 0.0f,
+            -XMVectorGetX(XMVector3Dot(x, eye)), -XMVectorGetX(XMVector3Dot(y, eye)), -XMVectorGetX(XMVector3Dot(z, eye)), 1.0f);
+    }
+
+    inline XMMATRIX XMMatrixPerspectiveFovLH(float fovAngleY, float aspectRatio, float nearZ, float farZ)
+    {
+        const float height = 1.0f / std::tan(0.5f * fovAngleY);
+        const float width = height / aspectRatio;
+        const float range = farZ / (farZ - nearZ);
+        return XMMatrixSet(
+            width, 0.0f, 0.0f, 0.0f,
+            0.0f, height, 0.0f, 0.0f,
+            0.0f, 0.0f, range, 1.0f,
+            0.0f, 0.0f, -range * nearZ, 0.0f);
+    }
+
+/*============================================================================*\
+|| ------------------------------ QUATERNIONS ------------------------------- ||
+\*============================================================================*/
+
+    inline XMVECTOR XMQuaternionRotationAxis(FXMVECTOR axis, float angle)
+    {
+        const XMVECTOR n = XMVector3Normalize(axis);
+        const float s = std::sin(0.5f * angle);
+        return XMVectorSet(XMVectorGetX(n) * s, XMVectorGetY(n) * s, XMVectorGetZ(n) * s, std::cos(0.5f * angle));
+    }
+
+    inline XMVECTOR XMQuaternionRotationRollPitchYaw(float pitch, float yaw, float roll)
+    {
+        const float cp = std::cos(0.5f * pitch), sp = std::sin(0.5f * pitch);
+        const float cy = std::cos(0.5f * yaw), sy = std::sin(0.5f * yaw);
+        const float cr = std::cos(0.5f * roll), sr = std::sin(0.5f * roll);
+        return XMVectorSet(
+            cr * sp * cy + sr * cp * sy,
+            cr * cp * sy - sr * sp * cy,
+            sr * cp * cy - cr * sp * sy,
+            cr * cp * cy + sr * sp * sy);
+    }
+
+    inline XMMATRIX XMMatrixRotationQuaternion(FXMVECTOR q)
+    {
+        const float x = XMVectorGetX(q), y = XMVectorGetY(q), z = XMVectorGetZ(q), w = XMVectorGetW(q);
+        return XMMatrixSet(
+            1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y + w * z), 2.0f * (x * z - w * y), 0.0f,
+            2.0f * (x * y - w * z), 1.0f - 2.0f * (x * x + z * z), 2.0f * (y * z + w * x), 0.0f,
+            2.0f * (x * z + w * y), 2.0f * (y * z - w * x), 1.0f - 2.0f * (x * x + y * y), 0.0f,
+            0.0f, 0.0f, 0.0f, 1.0f);
+    }
+
+/*============================================================================*\
+|| -------------------------------- COLORS ---------------------------------- ||
+\*============================================================================*/
+
+    namespace Colors
+    {
+        constexpr XMVECTORF32 DarkGray = { { { 0.662745118f, 0.662745118f, 0.662745118f, 1.000000000f } } };
+    }
+}
+
+#endif // HEADLESSMATH_H
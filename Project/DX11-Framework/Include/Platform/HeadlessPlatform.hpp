@@ -0,0 +1,730 @@
+/****************************************************************************/
+/*!
+\file
+   HeadlessPlatform.hpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Stand in for the Windows SDK when building without it. Declares the
+    subset of Win32, COM, DXGI, D3D11 and D3DCompiler the framework names so
+    the headless (RecordingCommandContext) backend, the benchmarks and the
+    tests build on any platform. Interfaces are declarations only, nothing
+    here can create a GPU object: D3D11CreateDevice and CreateDXGIFactory1
+    fail and the windowed path throws at startup.
+*/
+/****************************************************************************/
+#ifndef HEADLESSPLATFORM_H
+#define HEADLESSPLATFORM_H
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+/*============================================================================*\
+|| ------------------------------- WIN32 ------------------------------------ ||
+\*============================================================================*/
+
+typedef long HRESULT;
+typedef int BOOL;
+typedef int INT;
+typedef unsigned int UINT;
+typedef uint8_t UINT8;
+typedef uint32_t UINT32;
+typedef uint64_t UINT64;
+typedef int64_t INT64;
+typedef unsigned long DWORD;
+typedef float FLOAT;
+typedef wchar_t WCHAR;
+typedef const char* LPCSTR;
+typedef void* HANDLE;
+typedef void* HWND;
+typedef size_t SIZE_T;
+
+#define S_OK                        ((HRESULT)0)
+#define S_FALSE                     ((HRESULT)1)
+#define E_FAIL                      ((HRESULT)0x80004005L)
+#define E_NOTIMPL                   ((HRESULT)0x80004001L)
+#define SUCCEEDED(hr)               (((HRESULT)(hr)) >= 0)
+#define FAILED(hr)                  (((HRESULT)(hr)) < 0)
+
+#ifndef TRUE
+#define TRUE 1
+#endif
+#ifndef FALSE
+#define FALSE 0
+#endif
+
+#define CP_UTF8                     65001
+#define INVALID_HANDLE_VALUE        ((HANDLE)(intptr_t)-1)
+#define GENERIC_READ                0x80000000
+#define FILE_SHARE_READ             0x00000001
+#define OPEN_EXISTING               3
+#define FILE_ATTRIBUTE_NORMAL       0x00000080
+#define FILE_FLAG_SEQUENTIAL_SCAN   0x08000000
+#define PAGE_READONLY               0x02
+#define FILE_MAP_READ               0x0004
+#define MOVEFILE_REPLACE_EXISTING   0x00000001
+
+// MSVC only keywords
+#define __pragma(x)
+#define __debugbreak() ((void)0)
+
+union LARGE_INTEGER
+{
+    INT64 QuadPart;
+};
+
+int MultiByteToWideChar(UINT codePage, DWORD flags, const char* multiByte, int multiByteCount, WCHAR* wideChar, int wideCharCount);
+
+// files and read only mappings, backed by POSIX in HeadlessPlatform.cpp
+HANDLE CreateFileW(const WCHAR* fileName, DWORD access, DWORD shareMode, void* security, DWORD creation, DWORD flags, HANDLE templateFile);
+BOOL GetFileSizeEx(HANDLE file, LARGE_INTEGER* size);
+HANDLE CreateFileMappingW(HANDLE file, void* security, DWORD protect, DWORD sizeHigh, DWORD sizeLow, const WCHAR* name);
+void* MapViewOfFile(HANDLE mapping, DWORD access, DWORD offsetHigh, DWORD offsetLow, SIZE_T bytes);
+BOOL UnmapViewOfFile(const void* view);
+BOOL CloseHandle(HANDLE handle);
+BOOL MoveFileExW(const WCHAR* existing, const WCHAR* replacement, DWORD flags);
+BOOL DeleteFileW(const WCHAR* fileName);
+
+/*============================================================================*\
+|| -------------------------------- COM ------------------------------------- ||
+\*============================================================================*/
+
+//! interface id, the address of a per type tag is unique enough here
+struct IID
+{
+    const void* tag;
+    bool operator==(const IID& other) const { return tag == other.tag; }
+};
+typedef IID GUID;
+
+namespace HEADLESS
+{
+    template <typename T>
+    struct InterfaceTag
+    {
+        static const char tag;
+    };
+
+    template <typename T>
+    const char InterfaceTag<T>::tag = 0;
+
+    template <typename T>
+    constexpr IID Uuid()
+    {
+        return IID{ &InterfaceTag<T>::tag };
+    }
+}
+
+#define __uuidof(x) HEADLESS::Uuid<x>()
+
+struct IUnknown
+{
+    virtual HRESULT QueryInterface(const IID& riid, void** object) = 0;
+    virtual unsigned long AddRef() = 0;
+    virtual unsigned long Release() = 0;
+
+protected:
+    ~IUnknown() = default;
+};
+
+namespace Microsoft
+{
+    namespace WRL
+    {
+        //! reference counted interface pointer, the same contract as wrl/client.h
+        template <typename T>
+        class ComPtr
+        {
+        public:
+            typedef T InterfaceType;
+
+            ComPtr() = default;
+            ComPtr(std::nullptr_t) {}
+            ComPtr(T* other) : ptr(other) { InternalAddRef(); }
+            ComPtr(const ComPtr& other) : ptr(other.ptr) { InternalAddRef(); }
+            ComPtr(ComPtr&& other) noexcept : ptr(other.ptr) { other.ptr = nullptr; }
+            template <typename U>
+            ComPtr(const ComPtr<U>& other) : ptr(other.Get()) { InternalAddRef(); }
+            ~ComPtr() { InternalRelease(); }
+
+            ComPtr& operator=(std::nullptr_t) { InternalRelease(); return *this; }
+            ComPtr& operator=(T* other) { ComPtr(other).Swap(*this); return *this; }
+            ComPtr& operator=(const ComPtr& other) { ComPtr(other).Swap(*this); return *this; }
+            ComPtr& operator=(ComPtr&& other) noexcept { ComPtr(std::move(other)).Swap(*this); return *this; }
+
+            T* Get() const { return ptr; }
+            T* operator->() const { return ptr; }
+            explicit operator bool() const { return ptr != nullptr; }
+
+            T* const* GetAddressOf() const { return &ptr; }
+            T** GetAddressOf() { return &ptr; }
+            T** ReleaseAndGetAddressOf() { InternalRelease(); return &ptr; }
+
+            void Reset() { InternalRelease(); }
+            void Attach(T* other) { InternalRelease(); ptr = other; }
+            T* Detach() { T* out = ptr; ptr = nullptr; return out; }
+            void Swap(ComPtr& other) { T* temp = ptr; ptr = other.ptr; other.ptr = temp; }
+
+            template <typename U>
+            HRESULT As(ComPtr<U>* other) const
+            {
+                if (!ptr)
+                {
+                    return E_FAIL;
+                }
+                return ptr->QueryInterface(__uuidof(U), reinterpret_cast<void**>(other->ReleaseAndGetAddressOf()));
+            }
+
+        private:
+            void InternalAddRef() const { if (ptr) { ptr->AddRef(); } }
+            void InternalRelease() { T* temp = ptr; ptr = nullptr; if (temp) { temp->Release(); } }
+
+            T* ptr = nullptr;
+        };
+
+        template <typename T, typename U>
+        bool operator==(const ComPtr<T>& a, const ComPtr<U>& b) { return a.Get() == b.Get(); }
+        template <typename T>
+        bool operator==(const ComPtr<T>& a, std::nullptr_t) { return a.Get() == nullptr; }
+        template <typename T>
+        bool operator!=(const ComPtr<T>& a, std::nullptr_t) { return a.Get() != nullptr; }
+    }
+}
+
+/*============================================================================*\
+|| -------------------------------- DXGI ------------------------------------ ||
+\*============================================================================*/
+
+enum DXGI_FORMAT
+{
+    DXGI_FORMAT_UNKNOWN = 0,
+    DXGI_FORMAT_R32G32B32A32_FLOAT = 2,
+    DXGI_FORMAT_R32G32B32A32_UINT = 3,
+    DXGI_FORMAT_R32G32B32A32_SINT = 4,
+    DXGI_FORMAT_R32G32B32_FLOAT = 6,
+    DXGI_FORMAT_R32G32B32_UINT = 7,
+    DXGI_FORMAT_R32G32B32_SINT = 8,
+    DXGI_FORMAT_R16G16B16A16_UNORM = 11,
+    DXGI_FORMAT_R32G32_FLOAT = 16,
+    DXGI_FORMAT_R32G32_UINT = 17,
+    DXGI_FORMAT_R32G32_SINT = 18,
+    DXGI_FORMAT_D32_FLOAT = 40,
+    DXGI_FORMAT_R32_FLOAT = 41,
+    DXGI_FORMAT_R32_UINT = 42,
+    DXGI_FORMAT_R32_SINT = 43,
+    DXGI_FORMAT_R16G16_SNORM = 37,
+    DXGI_FORMAT_R16_UINT = 57,
+    DXGI_FORMAT_B8G8R8A8_UNORM = 87,
+};
+
+enum DXGI_SWAP_EFFECT
+{
+    DXGI_SWAP_EFFECT_DISCARD = 0,
+    DXGI_SWAP_EFFECT_FLIP_DISCARD = 4,
+};
+
+#define DXGI_MAX_SWAP_CHAIN_BUFFERS             16
+#define DXGI_USAGE_RENDER_TARGET_OUTPUT         0x00000020UL
+#define DXGI_SWAP_CHAIN_FLAG_ALLOW_MODE_SWITCH  2
+#define DXGI_MWA_NO_ALT_ENTER                   (1 << 1)
+
+struct DXGI_RATIONAL
+{
+    UINT Numerator;
+    UINT Denominator;
+};
+
+struct DXGI_SAMPLE_DESC
+{
+    UINT Count;
+    UINT Quality;
+};
+
+struct DXGI_MODE_DESC
+{
+    UINT Width;
+    UINT Height;
+    DXGI_RATIONAL RefreshRate;
+    DXGI_FORMAT Format;
+    UINT ScanlineOrdering;
+    UINT Scaling;
+};
+
+struct DXGI_SWAP_CHAIN_DESC
+{
+    DXGI_MODE_DESC BufferDesc;
+    DXGI_SAMPLE_DESC SampleDesc;
+    UINT BufferUsage;
+    UINT BufferCount;
+    HWND OutputWindow;
+    BOOL Windowed;
+    DXGI_SWAP_EFFECT SwapEffect;
+    UINT Flags;
+};
+
+struct DXGI_ADAPTER_DESC1
+{
+    WCHAR Description[128];
+    UINT VendorId;
+    UINT DeviceId;
+    UINT SubSysId;
+    UINT Revision;
+    SIZE_T DedicatedVideoMemory;
+    SIZE_T DedicatedSystemMemory;
+    SIZE_T SharedSystemMemory;
+    UINT Flags;
+};
+
+struct IDXGIAdapter1 : IUnknown
+{
+    virtual HRESULT GetDesc1(DXGI_ADAPTER_DESC1* desc) = 0;
+};
+
+struct IDXGISwapChain : IUnknown
+{
+    virtual HRESULT Present(UINT syncInterval, UINT flags) = 0;
+    virtual HRESULT GetBuffer(UINT buffer, const IID& riid, void** surface) = 0;
+};
+
+struct IDXGIFactory1 : IUnknown
+{
+    virtual HRESULT EnumAdapters1(UINT adapter, IDXGIAdapter1** out) = 0;
+    virtual HRESULT MakeWindowAssociation(HWND window, UINT flags) = 0;
+    virtual HRESULT CreateSwapChain(IUnknown* device, DXGI_SWAP_CHAIN_DESC* desc, IDXGISwapChain** swapChain) = 0;
+};
+
+HRESULT CreateDXGIFactory1(const IID& riid, void** factory);
+
+/*============================================================================*\
+|| -------------------------------- D3D11 ----------------------------------- ||
+\*============================================================================*/
+
+enum D3D_FEATURE_LEVEL
+{
+    D3D_FEATURE_LEVEL_11_0 = 0xb000,
+    D3D_FEATURE_LEVEL_11_1 = 0xb100,
+};
+
+enum D3D_DRIVER_TYPE
+{
+    D3D_DRIVER_TYPE_UNKNOWN = 0,
+    D3D_DRIVER_TYPE_HARDWARE = 1,
+};
+
+#define D3D11_SDK_VERSION                   7
+#define D3D11_CREATE_DEVICE_DEBUG           0x2
+#define D3D11_APPEND_ALIGNED_ELEMENT        0xffffffff
+#define D3D11_ASYNC_GETDATA_DONOTFLUSH      0x1
+#define D3D11_COLOR_WRITE_ENABLE_ALL        0xf
+
+enum D3D11_USAGE
+{
+    D3D11_USAGE_DEFAULT = 0,
+    D3D11_USAGE_IMMUTABLE = 1,
+    D3D11_USAGE_DYNAMIC = 2,
+    D3D11_USAGE_STAGING = 3,
+};
+
+enum D3D11_BIND_FLAG
+{
+    D3D11_BIND_VERTEX_BUFFER = 0x1,
+    D3D11_BIND_INDEX_BUFFER = 0x2,
+    D3D11_BIND_CONSTANT_BUFFER = 0x4,
+    D3D11_BIND_SHADER_RESOURCE = 0x8,
+    D3D11_BIND_RENDER_TARGET = 0x20,
+    D3D11_BIND_DEPTH_STENCIL = 0x40,
+};
+
+enum D3D11_CPU_ACCESS_FLAG
+{
+    D3D11_CPU_ACCESS_WRITE = 0x10000,
+    D3D11_CPU_ACCESS_READ = 0x20000,
+};
+
+enum D3D11_MAP
+{
+    D3D11_MAP_READ = 1,
+    D3D11_MAP_WRITE = 2,
+    D3D11_MAP_READ_WRITE = 3,
+    D3D11_MAP_WRITE_DISCARD = 4,
+    D3D11_MAP_WRITE_NO_OVERWRITE = 5,
+};
+
+enum D3D11_CLEAR_FLAG
+{
+    D3D11_CLEAR_DEPTH = 0x1,
+    D3D11_CLEAR_STENCIL = 0x2,
+};
+
+enum D3D11_PRIMITIVE_TOPOLOGY
+{
+    D3D11_PRIMITIVE_TOPOLOGY_UNDEFINED = 0,
+    D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST = 4,
+};
+
+enum D3D11_INPUT_CLASSIFICATION
+{
+    D3D11_INPUT_PER_VERTEX_DATA = 0,
+    D3D11_INPUT_PER_INSTANCE_DATA = 1,
+};
+
+enum D3D11_FILL_MODE
+{
+    D3D11_FILL_WIREFRAME = 2,
+    D3D11_FILL_SOLID = 3,
+};
+
+enum D3D11_CULL_MODE
+{
+    D3D11_CULL_NONE = 1,
+    D3D11_CULL_FRONT = 2,
+    D3D11_CULL_BACK = 3,
+};
+
+enum D3D11_DEPTH_WRITE_MASK
+{
+    D3D11_DEPTH_WRITE_MASK_ZERO = 0,
+    D3D11_DEPTH_WRITE_MASK_ALL = 1,
+};
+
+enum D3D11_COMPARISON_FUNC
+{
+    D3D11_COMPARISON_NEVER = 1,
+    D3D11_COMPARISON_LESS = 2,
+    D3D11_COMPARISON_EQUAL = 3,
+    D3D11_COMPARISON_LESS_EQUAL = 4,
+    D3D11_COMPARISON_ALWAYS = 8,
+};
+
+enum D3D11_STENCIL_OP
+{
+    D3D11_STENCIL_OP_KEEP = 1,
+};
+
+enum D3D11_BLEND
+{
+    D3D11_BLEND_ZERO = 1,
+    D3D11_BLEND_ONE = 2,
+};
+
+enum D3D11_BLEND_OP
+{
+    D3D11_BLEND_OP_ADD = 1,
+};
+
+enum D3D11_QUERY
+{
+    D3D11_QUERY_EVENT = 0,
+};
+
+enum D3D11_FEATURE
+{
+    D3D11_FEATURE_D3D11_OPTIONS = 7,
+};
+
+enum D3D11_RLDO_FLAGS
+{
+    D3D11_RLDO_SUMMARY = 0x1,
+    D3D11_RLDO_DETAIL = 0x2,
+};
+
+struct D3D11_BUFFER_DESC
+{
+    UINT ByteWidth;
+    D3D11_USAGE Usage;
+    UINT BindFlags;
+    UINT CPUAccessFlags;
+    UINT MiscFlags;
+    UINT StructureByteStride;
+};
+
+struct D3D11_TEXTURE2D_DESC
+{
+    UINT Width;
+    UINT Height;
+    UINT MipLevels;
+    UINT ArraySize;
+    DXGI_FORMAT Format;
+    DXGI_SAMPLE_DESC SampleDesc;
+    D3D11_USAGE Usage;
+    UINT BindFlags;
+    UINT CPUAccessFlags;
+    UINT MiscFlags;
+};
+
+struct D3D11_SUBRESOURCE_DATA
+{
+    const void* pSysMem;
+    UINT SysMemPitch;
+    UINT SysMemSlicePitch;
+};
+
+struct D3D11_MAPPED_SUBRESOURCE
+{
+    void* pData;
+    UINT RowPitch;
+    UINT DepthPitch;
+};
+
+struct D3D11_VIEWPORT
+{
+    FLOAT TopLeftX;
+    FLOAT TopLeftY;
+    FLOAT Width;
+    FLOAT Height;
+    FLOAT MinDepth;
+    FLOAT MaxDepth;
+};
+
+struct D3D11_BOX
+{
+    UINT left;
+    UINT top;
+    UINT front;
+    UINT right;
+    UINT bottom;
+    UINT back;
+};
+
+struct D3D11_INPUT_ELEMENT_DESC
+{
+    LPCSTR SemanticName;
+    UINT SemanticIndex;
+    DXGI_FORMAT Format;
+    UINT InputSlot;
+    UINT AlignedByteOffset;
+    D3D11_INPUT_CLASSIFICATION InputSlotClass;
+    UINT InstanceDataStepRate;
+};
+
+struct D3D11_RASTERIZER_DESC
+{
+    D3D11_FILL_MODE FillMode;
+    D3D11_CULL_MODE CullMode;
+    BOOL FrontCounterClockwise;
+    INT DepthBias;
+    FLOAT DepthBiasClamp;
+    FLOAT SlopeScaledDepthBias;
+    BOOL DepthClipEnable;
+    BOOL ScissorEnable;
+    BOOL MultisampleEnable;
+    BOOL AntialiasedLineEnable;
+};
+
+struct D3D11_DEPTH_STENCILOP_DESC
+{
+    D3D11_STENCIL_OP StencilFailOp;
+    D3D11_STENCIL_OP StencilDepthFailOp;
+    D3D11_STENCIL_OP StencilPassOp;
+    D3D11_COMPARISON_FUNC StencilFunc;
+};
+
+struct D3D11_DEPTH_STENCIL_DESC
+{
+    BOOL DepthEnable;
+    D3D11_DEPTH_WRITE_MASK DepthWriteMask;
+    D3D11_COMPARISON_FUNC DepthFunc;
+    BOOL StencilEnable;
+    UINT8 StencilReadMask;
+    UINT8 StencilWriteMask;
+    D3D11_DEPTH_STENCILOP_DESC FrontFace;
+    D3D11_DEPTH_STENCILOP_DESC BackFace;
+};
+
+struct D3D11_RENDER_TARGET_BLEND_DESC
+{
+    BOOL BlendEnable;
+    D3D11_BLEND SrcBlend;
+    D3D11_BLEND DestBlend;
+    D3D11_BLEND_OP BlendOp;
+    D3D11_BLEND SrcBlendAlpha;
+    D3D11_BLEND DestBlendAlpha;
+    D3D11_BLEND_OP BlendOpAlpha;
+    UINT8 RenderTargetWriteMask;
+};
+
+struct D3D11_BLEND_DESC
+{
+    BOOL AlphaToCoverageEnable;
+    BOOL IndependentBlendEnable;
+    D3D11_RENDER_TARGET_BLEND_DESC RenderTarget[8];
+};
+
+struct D3D11_QUERY_DESC
+{
+    D3D11_QUERY Query;
+    UINT MiscFlags;
+};
+
+struct D3D11_FEATURE_DATA_D3D11_OPTIONS
+{
+    BOOL OutputMergerLogicOp;
+    BOOL UAVOnlyRenderingForcedSampleCount;
+    BOOL DiscardAPIsSeenByDriver;
+    BOOL FlagsForUpdateAndCopySeenByDriver;
+    BOOL ClearView;
+    BOOL CopyWithOverlap;
+    BOOL ConstantBufferPartialUpdate;
+    BOOL ConstantBufferOffsetting;
+    BOOL MapNoOverwriteOnDynamicConstantBuffer;
+    BOOL MapNoOverwriteOnDynamicBufferSRV;
+    BOOL MultisampleRTVWithForcedSampleCountOne;
+    BOOL SAD4ShaderInstructions;
+    BOOL ExtendedDoublesShaderInstructions;
+    BOOL ExtendedResourceSharing;
+};
+
+struct ID3D11Device;
+
+struct ID3D11DeviceChild : IUnknown
+{
+    virtual void GetDevice(ID3D11Device** device) = 0;
+};
+
+struct ID3D11Resource : ID3D11DeviceChild {};
+struct ID3D11Buffer : ID3D11Resource {};
+struct ID3D11Texture2D : ID3D11Resource {};
+struct ID3D11InputLayout : ID3D11DeviceChild {};
+struct ID3D11VertexShader : ID3D11DeviceChild {};
+struct ID3D11PixelShader : ID3D11DeviceChild {};
+struct ID3D11ClassInstance : ID3D11DeviceChild {};
+struct ID3D11RasterizerState : ID3D11DeviceChild {};
+struct ID3D11DepthStencilState : ID3D11DeviceChild {};
+struct ID3D11BlendState : ID3D11DeviceChild {};
+struct ID3D11RenderTargetView : ID3D11DeviceChild {};
+struct ID3D11DepthStencilView : ID3D11DeviceChild {};
+struct ID3D11Asynchronous : ID3D11DeviceChild {};
+struct ID3D11Query : ID3D11Asynchronous {};
+struct ID3D11CommandList : ID3D11DeviceChild {};
+
+struct ID3D11DeviceContext : ID3D11DeviceChild
+{
+    virtual void IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology) = 0;
+    virtual void IASetInputLayout(ID3D11InputLayout* layout) = 0;
+    virtual void IASetVertexBuffers(UINT slot, UINT count, ID3D11Buffer* const* buffers, const UINT* strides, const UINT* offsets) = 0;
+    virtual void IASetIndexBuffer(ID3D11Buffer* buffer, DXGI_FORMAT format, UINT offset) = 0;
+    virtual void VSSetShader(ID3D11VertexShader* shader, ID3D11ClassInstance* const* instances, UINT count) = 0;
+    virtual void PSSetShader(ID3D11PixelShader* shader, ID3D11ClassInstance* const* instances, UINT count) = 0;
+    virtual void VSSetConstantBuffers(UINT slot, UINT count, ID3D11Buffer* const* buffers) = 0;
+    virtual void PSSetConstantBuffers(UINT slot, UINT count, ID3D11Buffer* const* buffers) = 0;
+    virtual void RSSetState(ID3D11RasterizerState* state) = 0;
+    virtual void RSSetViewports(UINT count, const D3D11_VIEWPORT* viewports) = 0;
+    virtual void OMSetBlendState(ID3D11BlendState* state, const FLOAT blendFactor[4], UINT sampleMask) = 0;
+    virtual void OMSetDepthStencilState(ID3D11DepthStencilState* state, UINT stencilRef) = 0;
+    virtual void OMSetRenderTargets(UINT count, ID3D11RenderTargetView* const* views, ID3D11DepthStencilView* depth) = 0;
+    virtual void ClearRenderTargetView(ID3D11RenderTargetView* view, const FLOAT color[4]) = 0;
+    virtual void ClearDepthStencilView(ID3D11DepthStencilView* view, UINT flags, FLOAT depth, UINT8 stencil) = 0;
+    virtual void DrawIndexed(UINT indexCount, UINT firstIndex, INT baseVertex) = 0;
+    virtual void DrawIndexedInstanced(UINT indexCount, UINT instanceCount, UINT firstIndex, INT baseVertex, UINT firstInstance) = 0;
+    virtual HRESULT Map(ID3D11Resource* resource, UINT subresource, D3D11_MAP type, UINT flags, D3D11_MAPPED_SUBRESOURCE* mapped) = 0;
+    virtual void Unmap(ID3D11Resource* resource, UINT subresource) = 0;
+    virtual void UpdateSubresource(ID3D11Resource* resource, UINT subresource, const D3D11_BOX* box, const void* data, UINT rowPitch, UINT depthPitch) = 0;
+    virtual void CopySubresourceRegion(ID3D11Resource* destination, UINT destinationSubresource, UINT x, UINT y, UINT z, ID3D11Resource* source, UINT sourceSubresource, const D3D11_BOX* box) = 0;
+    virtual void Begin(ID3D11Asynchronous* async) = 0;
+    virtual void End(ID3D11Asynchronous* async) = 0;
+    virtual HRESULT GetData(ID3D11Asynchronous* async, void* data, UINT size, UINT flags) = 0;
+    virtual void ExecuteCommandList(ID3D11CommandList* commandList, BOOL restoreState) = 0;
+    virtual HRESULT FinishCommandList(BOOL restoreState, ID3D11CommandList** commandList) = 0;
+    virtual void ClearState() = 0;
+    virtual void Flush() = 0;
+};
+
+struct ID3D11DeviceContext1 : ID3D11DeviceContext
+{
+    virtual void VSSetConstantBuffers1(UINT slot, UINT count, ID3D11Buffer* const* buffers, const UINT* firstConstant, const UINT* numConstants) = 0;
+    virtual void PSSetConstantBuffers1(UINT slot, UINT count, ID3D11Buffer* const* buffers, const UINT* firstConstant, const UINT* numConstants) = 0;
+};
+
+struct ID3D11Device : IUnknown
+{
+    virtual HRESULT CreateBuffer(const D3D11_BUFFER_DESC* desc, const D3D11_SUBRESOURCE_DATA* data, ID3D11Buffer** buffer) = 0;
+    virtual HRESULT CreateTexture2D(const D3D11_TEXTURE2D_DESC* desc, const D3D11_SUBRESOURCE_DATA* data, ID3D11Texture2D** texture) = 0;
+    virtual HRESULT CreateRenderTargetView(ID3D11Resource* resource, const void* desc, ID3D11RenderTargetView** view) = 0;
+    virtual HRESULT CreateDepthStencilView(ID3D11Resource* resource, const void* desc, ID3D11DepthStencilView** view) = 0;
+    virtual HRESULT CreateInputLayout(const D3D11_INPUT_ELEMENT_DESC* elements, UINT count, const void* bytecode, SIZE_T length, ID3D11InputLayout** layout) = 0;
+    virtual HRESULT CreateVertexShader(const void* bytecode, SIZE_T length, ID3D11ClassInstance* linkage, ID3D11VertexShader** shader) = 0;
+    virtual HRESULT CreatePixelShader(const void* bytecode, SIZE_T length, ID3D11ClassInstance* linkage, ID3D11PixelShader** shader) = 0;
+    virtual HRESULT CreateBlendState(const D3D11_BLEND_DESC* desc, ID3D11BlendState** state) = 0;
+    virtual HRESULT CreateDepthStencilState(const D3D11_DEPTH_STENCIL_DESC* desc, ID3D11DepthStencilState** state) = 0;
+    virtual HRESULT CreateRasterizerState(const D3D11_RASTERIZER_DESC* desc, ID3D11RasterizerState** state) = 0;
+    virtual HRESULT CreateQuery(const D3D11_QUERY_DESC* desc, ID3D11Query** query) = 0;
+    virtual HRESULT CreateDeferredContext(UINT flags, ID3D11DeviceContext** context) = 0;
+    virtual HRESULT CheckFeatureSupport(D3D11_FEATURE feature, void* data, UINT size) = 0;
+};
+
+struct ID3D11Debug : IUnknown
+{
+    virtual HRESULT ReportLiveDeviceObjects(D3D11_RLDO_FLAGS flags) = 0;
+};
+
+HRESULT D3D11CreateDevice(IDXGIAdapter1* adapter, D3D_DRIVER_TYPE driverType, void* software, UINT flags, const D3D_FEATURE_LEVEL* featureLevels,
+    UINT featureLevelCount, UINT sdkVersion, ID3D11Device** device, D3D_FEATURE_LEVEL* featureLevel, ID3D11DeviceContext** context);
+
+/*============================================================================*\
+|| ----------------------------- D3DCOMPILER -------------------------------- ||
+\*============================================================================*/
+
+enum D3D_REGISTER_COMPONENT_TYPE
+{
+    D3D_REGISTER_COMPONENT_UNKNOWN = 0,
+    D3D_REGISTER_COMPONENT_UINT32 = 1,
+    D3D_REGISTER_COMPONENT_SINT32 = 2,
+    D3D_REGISTER_COMPONENT_FLOAT32 = 3,
+};
+
+struct D3D11_SHADER_DESC
+{
+    UINT Version;
+    LPCSTR Creator;
+    UINT Flags;
+    UINT ConstantBuffers;
+    UINT BoundResources;
+    UINT InputParameters;
+    UINT OutputParameters;
+};
+
+struct D3D11_SIGNATURE_PARAMETER_DESC
+{
+    LPCSTR SemanticName;
+    UINT SemanticIndex;
+    UINT Register;
+    UINT SystemValueType;
+    D3D_REGISTER_COMPONENT_TYPE ComponentType;
+    UINT8 Mask;
+    UINT8 ReadWriteMask;
+    UINT Stream;
+    UINT MinPrecision;
+};
+
+struct ID3DBlob : IUnknown
+{
+    virtual void* GetBufferPointer() = 0;
+    virtual SIZE_T GetBufferSize() = 0;
+};
+
+struct ID3D11ShaderReflection : IUnknown
+{
+    virtual HRESULT GetDesc(D3D11_SHADER_DESC* desc) = 0;
+    virtual HRESULT GetInputParameterDesc(UINT index, D3D11_SIGNATURE_PARAMETER_DESC* desc) = 0;
+};
+
+#define IID_ID3D11ShaderReflection __uuidof(ID3D11ShaderReflection)
+
+HRESULT D3DReadFileToBlob(const WCHAR* fileName, ID3DBlob** contents);
+HRESULT D3DReflect(const void* data, SIZE_T size, const IID& riid, void** reflector);
+
+/*============================================================================*\
+|| -------------------------------- GLFW ------------------------------------ ||
+\*============================================================================*/
+
+struct GLFWwindow;
+
+//! glfw3native.h only declares this with the Win32 backend
+HWND glfwGetWin32Window(GLFWwindow* window);
+
+#endif // HEADLESSPLATFORM_H
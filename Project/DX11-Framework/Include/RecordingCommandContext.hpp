@@ -0,0 +1,149 @@
+/****************************************************************************/
+/*!
+\file
+   RecordingCommandContext.hpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    CommandContext that records every command into a flat log and counts
+    what a frame costs on the CPU. With no forward context it is the whole
+    backend, so the render path runs headless without a GPU. With one it
+    tees into the real context and the stats come from live frames.
+*/
+/****************************************************************************/
+#ifndef RECORDINGCOMMANDCONTEXT_H
+#define RECORDINGCOMMANDCONTEXT_H
+#pragma once
+
+#include "DX11PCH.hpp"
+#include "CommandContext.hpp"
+#include <memory>
+#include <unordered_map>
+#include <chrono>
+#include <mutex>
+
+namespace DX11
+{
+    enum class CommandType : uint32_t
+    {
+        SetPrimitiveTopology,
+        SetInputLayout,
+        SetVertexBuffers,
+        SetIndexBuffer,
+        SetVertexShader,
+        SetPixelShader,
+        SetVSConstantBuffer,
+        SetPSConstantBuffer,
+        SetRasterizerState,
+        SetViewports,
+        SetBlendState,
+        SetDepthStencilState,
+        SetRenderTargets,
+        ClearRenderTargetView,
+        ClearDepthStencilView,
+        DrawIndexed,
+        DrawIndexedInstanced,
+        Map,
+        Unmap,
+        CopyBufferRegion,
+        EndQuery,
+        GetQueryData,
+        ClearState,
+        Flush,
+        FinishCommandList,
+        ExecuteCommandList
+    };
+
+    //! one recorded command, object is the main thing it touched
+    struct Command
+    {
+        DX11::CommandType type;
+        const void* object;
+        uint32_t args[3];
+    };
+
+    //! what one frame asked of the backend
+    struct CommandStats
+    {
+        uint32_t commands = 0;
+        uint32_t draws = 0;
+        uint64_t instances = 0;         //!< drawn by DrawIndexedInstanced
+        uint64_t indices = 0;
+        uint32_t stateChanges = 0;      //!< every Set* call, redundant or not
+        uint32_t maps = 0;
+        uint64_t bytesMapped = 0;
+        uint32_t copies = 0;
+        double cpuMilliseconds = 0.0;   //!< BeginFrame to EndFrame
+    };
+
+    class RecordingCommandContext : public DX11::CommandContext
+    {
+    public:
+        explicit RecordingCommandContext(std::shared_ptr<DX11::CommandContext> forward = nullptr);
+
+        void BeginFrame();
+        void EndFrame();
+
+        const std::vector<DX11::Command>& Commands() const;
+        const DX11::CommandStats& Stats() const;
+
+        void SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology) override;
+        void SetInputLayout(ID3D11InputLayout* layout) override;
+        void SetVertexBuffers(uint32_t slot, uint32_t count, ID3D11Buffer* const* buffers, const uint32_t* strides, const uint32_t* offsets) override;
+        void SetIndexBuffer(ID3D11Buffer* buffer, DXGI_FORMAT format, uint32_t offset) override;
+
+        void SetVertexShader(ID3D11VertexShader* shader) override;
+        void SetPixelShader(ID3D11PixelShader* shader) override;
+        void SetVSConstantBuffer(uint32_t slot, ID3D11Buffer* buffer, uint32_t firstConstant, uint32_t constantCount) override;
+        void SetPSConstantBuffer(uint32_t slot, ID3D11Buffer* buffer, uint32_t firstConstant, uint32_t constantCount) override;
+
+        void SetRasterizerState(ID3D11RasterizerState* state) override;
+        void SetViewports(uint32_t count, const D3D11_VIEWPORT* viewports) override;
+        void SetBlendState(ID3D11BlendState* state, const float factors[4], uint32_t sampleMask) override;
+        void SetDepthStencilState(ID3D11DepthStencilState* state, uint32_t stencilRef) override;
+        void SetRenderTargets(uint32_t count, ID3D11RenderTargetView* const* views, ID3D11DepthStencilView* depth) override;
+        void ClearRenderTargetView(ID3D11RenderTargetView* view, const float color[4]) override;
+        void ClearDepthStencilView(ID3D11DepthStencilView* view, uint32_t flags, float depth, uint8_t stencil) override;
+
+        void DrawIndexed(uint32_t indexCount, uint32_t firstIndex, int32_t baseVertex) override;
+        void DrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t baseVertex, uint32_t firstInstance) override;
+
+        void* Map(ID3D11Resource* resource, D3D11_MAP mapType, uint32_t size) override;
+        void Unmap(ID3D11Resource* resource) override;
+        void CopyBufferRegion(ID3D11Buffer* destination, uint32_t destinationOffset, ID3D11Buffer* source, uint32_t sourceOffset, uint32_t size) override;
+
+        void EndQuery(ID3D11Query* query) override;
+        HRESULT GetQueryData(ID3D11Query* query, bool flush) override;
+
+        void ClearState() override;
+        void Flush() override;
+
+        std::shared_ptr<DX11::CommandContext> CreateDeferred() override;
+        DX11::CommandList FinishCommandList() override;
+        void ExecuteCommandList(ID3D11CommandList* list) override;
+
+    private:
+        void Record(DX11::CommandType type, const void* object, uint32_t a = 0, uint32_t b = 0, uint32_t c = 0);
+        void RecordState(DX11::CommandType type, const void* object, uint32_t a = 0, uint32_t b = 0, uint32_t c = 0);
+        void Defer(const DX11::CommandStats& stats);
+
+        std::shared_ptr<DX11::CommandContext> mForward;
+        std::vector<DX11::Command> mCommands;
+        DX11::CommandStats mStats;
+        std::chrono::steady_clock::time_point mFrameStart;
+
+        // deferred contexts hand their counts to the context that created them
+        DX11::RecordingCommandContext* mParent = nullptr;
+        std::mutex mDeferredMutex;
+        DX11::CommandStats mDeferred;       //!< finished, not yet executed
+        uint32_t mExecutedCommands = 0;     //!< recorded by deferred contexts this frame
+
+        // stands in for mapped GPU memory when there is no forward context
+        std::unordered_map<const void*, std::vector<uint8_t>> mScratch;
+    };
+}
+
+#endif // RECORDINGCOMMANDCONTEXT_H
@@ -0,0 +1,105 @@
+/****************************************************************************/
+/*!
+\file
+   RenderQueue.hpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Draws are submitted as a 64 bit sort key and a payload index instead of
+    being issued on the spot. Once a frame the keys are radix sorted and the
+    draws played back in key order, only binding what changed since the
+    previous draw. Runs of the same draw with an instanced shader are
+    merged into one DrawIndexedInstanced over their per-instance data.
+    Playback can be split into slices recorded on deferred contexts.
+
+    Key layout, most significant first:
+      layer 4 | pass 4 | shader 10 | material 14 | mesh 16 | depth 16
+*/
+/****************************************************************************/
+#ifndef RENDERQUEUE_H
+#define RENDERQUEUE_H
+#pragma once
+
+#include "DX11PCH.hpp"
+#include "Device.hpp"
+#include "ConstantRing.hpp"
+#include "InstanceBuffer.hpp"
+#include "DeferredRecorder.hpp"
+#include "CommandScheduler.hpp"
+#include <functional>
+
+namespace DX11
+{
+    //! everything one draw binds, handles are not owned
+    struct DrawItem
+    {
+        ID3D11InputLayout* inputLayout = nullptr;
+        ID3D11VertexShader* vertexShader = nullptr;
+        ID3D11PixelShader* pixelShader = nullptr;
+
+        ID3D11Buffer* vertexBuffer = nullptr;
+        uint32_t stride = 0;
+        ID3D11Buffer* indexBuffer = nullptr;
+        DXGI_FORMAT indexFormat = DXGI_FORMAT_R32_UINT;
+        uint32_t indexOffset = 0;
+
+        uint32_t indexCount = 0;
+        uint32_t firstIndex = 0;
+        int32_t baseVertex = 0;
+
+        //! bound to VS slot 0, a constantCount of 0 binds nothing
+        DX11::ConstantRing::Slice constants;
+
+        //! the vertex shader reads DX11::InstanceData, identical draws may be merged
+        bool instanced = false;
+    };
+
+    class RenderQueue
+    {
+    public:
+        static const uint32_t LAYER_BITS = 4;
+        static const uint32_t PASS_BITS = 4;
+        static const uint32_t SHADER_BITS = 10;
+        static const uint32_t MATERIAL_BITS = 14;
+        static const uint32_t MESH_BITS = 16;
+        static const uint32_t DEPTH_BITS = 16;
+
+        static uint64_t Key(uint32_t layer, uint32_t pass, uint32_t shader, uint32_t material, uint32_t mesh, float depth);
+
+        RenderQueue() = default;
+
+        uint32_t Submit(uint64_t key, const DX11::DrawItem& item, const DX11::InstanceData& instance = DX11::InstanceData());
+        void Sort();
+        void Execute(const DX11::Device& device, DX11::ConstantRing& constants, DX11::InstanceBuffer& instances) const;
+        void Execute(const DX11::Device& device, DX11::ConstantRing& constants, DX11::InstanceBuffer& instances,
+            DX11::DeferredRecorder& recorder, DX11::CommandScheduler& scheduler,
+            const std::function<void(DX11::CommandContext&)>& setup) const;
+        void Clear();
+
+        size_t Size() const;
+
+    private:
+        size_t SliceBegin(uint32_t slice, uint32_t sliceCount) const;
+        uint32_t WriteInstances(const DX11::Device& device, DX11::InstanceBuffer& instances, uint32_t sliceCount, uint32_t* firstInstances) const;
+        void ExecuteRange(const DX11::Device& device, DX11::CommandContext& context, DX11::ConstantRing& constants,
+            size_t begin, size_t end, uint32_t firstInstance) const;
+
+        //! what gets sorted, the payload is an index into mItems
+        struct Entry
+        {
+            uint64_t key;
+            uint32_t payload;
+        };
+
+        std::vector<DX11::DrawItem> mItems;
+        std::vector<DX11::InstanceData> mInstances;     //!< per payload, read by instanced draws only
+        std::vector<Entry> mEntries;
+        std::vector<Entry> mScratch;    //!< radix sort ping-pong, kept between frames
+        mutable std::vector<uint32_t> mFirstInstances;  //!< per slice of the last Execute, kept between frames
+    };
+}
+
+#endif // RENDERQUEUE_H
@@ -20,9 +20,23 @@
 #include "SwapChain.hpp"
 #include "Shader.hpp"
 #include "PipelineStates.hpp"
+#include "PipelineStateCache.hpp"
 #include "DepthStencilView.hpp"
 #include "Buffer.hpp"
 #include "Mesh.hpp"
+#include "AssetLoader.hpp"
+#include "ConstantRing.hpp"
+#include "InstanceBuffer.hpp"
+#include "StagingPool.hpp"
+#include "RenderQueue.hpp"
+#include "VisibilitySet.hpp"
+#include "SceneGraph.hpp"
+#include "Meshlets.hpp"
+#include "OcclusionCuller.hpp"
+#include "DeferredRecorder.hpp"
+#include "CommandScheduler.hpp"
+#include "RecordingCommandContext.hpp"
+#include "FramePipeline.hpp"
 
 struct GLFWwindow;
 typedef GLFWwindow* WindowPtr;
@@ -35,15 +49,22 @@ namespace DX11
 
     public:
 
-        Renderer();
+        explicit Renderer(bool headless = false);
         ~Renderer();
         void Draw(float dt);
+        void Prepare(float dt, DX11::FramePacket& packet);
+        void Submit(const DX11::FramePacket& packet);
+        void PumpEvents();
         WindowPtr Window() const;
+        DX11::CommandStats FrameStats() const;
+        DX11::StateCacheStats StateStats() const;
+        DX11::MeshletStats MeshletCullStats() const;
+        DX11::OcclusionStats OcclusionCullStats() const;
 
 
     private:
         /* friends */
-        friend static void FramebufferResizeCallback(WindowPtr window, int width, int height);
+        friend void FramebufferResizeCallback(WindowPtr window, int width, int height);
 
         /* Functions */
         void InitGLFW();
@@ -58,6 +79,7 @@ namespace DX11
         void InitDepthResouces();
         void ShutdownDX11();
 
+        void BindPassState(DX11::CommandContext& context) const;
         void Present();
 
         // window
@@ -66,11 +88,63 @@ namespace DX11
         int mWindowHeight = 800;
         int mVSync = 1;
 
-        // Core DX11
+        // Core DX11, the swapchain belongs to the thread calling Submit. Present can send
+        // messages to the window and wait for them, so the window's thread has to keep
+        // pumping them for as long as Submit may run, see FramePipeline.
         DX11::SwapChain mSwapChain;
         DX11::Device mDevice;
         bool mFramebufferResized = false;
 
+        // No window or GPU, commands only go to the recorder
+        bool mHeadless = false;
+        std::shared_ptr<DX11::RecordingCommandContext> mRecorder;
+
+        // Streaming
+        DX11::AssetLoader mLoader;
+        uint32_t mUploadsPerFrame = 1;
+
+        // Per draw constants, fenced per frame
+        DX11::ConstantRing mConstantRing;
+
+        // Per instance transforms, one map per frame
+        DX11::InstanceBuffer mInstanceBuffer;
+
+        // Updates to GPU only buffers
+        DX11::StagingPool mStagingPool;
+
+        // Draws for this frame, sorted by key before playback
+        DX11::RenderQueue mRenderQueue;
+
+        // Draw prepares and submits on the calling thread through this one
+        DX11::FramePacket mPacket;
+
+        // Transforms, the display mesh and one child per submesh
+        DX11::SceneGraph mScene;
+        uint32_t mModelNode = DX11::SceneGraph::INVALID_NODE;
+        std::vector<uint32_t> mNodeObjects;     // visibility set index of each node, if it has one
+
+        // Bounds culled against the camera before anything is queued
+        DX11::VisibilitySet mVisibilitySet;
+        std::vector<uint32_t> mVisible;
+
+        // What survived the frustum, tested against the coarsest levels of itself
+        DX11::OcclusionCuller mOcclusionCuller;
+
+        // Meshlets of full detail submeshes culled before they are queued
+        DX11::MeshletCuller mMeshletCuller;
+        std::vector<DX11::IndexRange> mRanges;
+
+        // Level of detail drawn last frame per submesh, and pixels per unit at distance 1
+        std::vector<uint32_t> mLods;
+        float mLodScale = 1.0f;
+
+        // Deferred contexts the queue is recorded on, and who decides the split
+        DX11::DeferredRecorder mDeferredRecorder;
+        std::unique_ptr<DX11::CommandScheduler> mScheduler;
+
+        // Shared rasterizer / depth stencil / blend objects
+        DX11::PipelineStateCache mPipelineStates;
+
         // This stuff should probably get put in classes
         DX11::RasterizerState mRasterizerState;
         DX11::BlendState mBlendState;
@@ -86,10 +160,11 @@ namespace DX11
 
         // Test Display Data
         DX11::Shader mShader;
-        DX11::Buffer mMatrixBuffer;
-        DX11::Mesh mDisplayMesh;
+        std::shared_ptr<DX11::Mesh> mDisplayMesh;
         DirectX::XMMATRIX mViewMatrix;
         DirectX::XMMATRIX mProjectionMatrix;
+        DirectX::XMVECTOR mCameraPosition;
+        float mNearPlane = 0.1f;
         float mAngle = 0;
 
     };
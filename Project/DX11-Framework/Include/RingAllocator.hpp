@@ -0,0 +1,57 @@
+/****************************************************************************/
+/*!
+\file
+   RingAllocator.hpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Offset bookkeeping for a ring of GPU visible memory. Hands out aligned
+    ranges and frees them a whole frame at a time once that frame's fence
+    has passed. Knows nothing about D3D so it can be exercised headless.
+*/
+/****************************************************************************/
+#ifndef RINGALLOCATOR_H
+#define RINGALLOCATOR_H
+#pragma once
+
+#include "DX11PCH.hpp"
+
+namespace DX11
+{
+    class RingAllocator
+    {
+    public:
+        //! most frames that can be waiting on a fence
+        static const uint32_t MAX_FRAMES = 8;
+
+        RingAllocator() = default;
+        RingAllocator(size_t capacity, size_t alignment);
+
+        bool Allocate(size_t size, size_t& offset);
+
+        bool EndFrame();
+        bool RetireFrame();
+
+        size_t Used() const;
+        size_t Capacity() const;
+        uint32_t PendingFrames() const;
+
+    private:
+        size_t mCapacity = 0;
+        size_t mAlignment = 1;
+
+        // positions only ever grow, the offset is position % capacity
+        size_t mHead = 0;   //!< next free byte
+        size_t mTail = 0;   //!< oldest byte the GPU may still read
+
+        // head at the end of each frame not yet retired, oldest first
+        size_t mFrameEnds[MAX_FRAMES] = {};
+        uint32_t mFirstFrame = 0;
+        uint32_t mFrameCount = 0;
+    };
+}
+
+#endif // RINGALLOCATOR_H
@@ -0,0 +1,178 @@
+/****************************************************************************/
+/*!
+\file
+   RingQueue.hpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Bounded lock-free multi producer / multi consumer queue (Dmitry Vyukov's
+    sequence numbered ring). Push and pop never block, they fail when the
+    queue is full or empty and the caller decides what to do.
+*/
+/****************************************************************************/
+#ifndef RINGQUEUE_H
+#define RINGQUEUE_H
+#pragma once
+
+#include "DX11PCH.hpp"
+#include <atomic>
+#include <memory>
+
+namespace DX11
+{
+    template <typename T>
+    class RingQueue
+    {
+    public:
+/****************************************************************************/
+/*!
+\brief
+  Constructor
+
+\param capacity
+  Number of slots, rounded up to a power of two
+*/
+/****************************************************************************/
+        explicit RingQueue(size_t capacity)
+        {
+            size_t size = 2;
+            while (size < capacity)
+            {
+                size <<= 1;
+            }
+
+            mCells = std::make_unique<Cell[]>(size);
+            mMask = size - 1;
+            for (size_t i = 0; i < size; ++i)
+            {
+                mCells[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        RingQueue(const RingQueue&) = delete;
+        RingQueue& operator=(const RingQueue&) = delete;
+
+/****************************************************************************/
+/*!
+\brief
+  Add a value to the back of the queue
+
+\param value
+  The value, only moved from on success
+
+\return
+  False if the queue is full
+*/
+/****************************************************************************/
+        bool TryPush(T& value)
+        {
+            size_t position = mTail.load(std::memory_order_relaxed);
+            Cell* cell;
+
+            while (true)
+            {
+                cell = &mCells[position & mMask];
+                size_t sequence = cell->sequence.load(std::memory_order_acquire);
+                intptr_t diff = intptr_t(sequence) - intptr_t(position);
+
+                if (diff == 0)
+                {
+                    // slot is free for this lap, claim it
+                    if (mTail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                    {
+                        break;
+                    }
+                }
+                else if (diff < 0)
+                {
+                    return false;
+                }
+                else
+                {
+                    position = mTail.load(std::memory_order_relaxed);
+                }
+            }
+
+            cell->value = std::move(value);
+            cell->sequence.store(position + 1, std::memory_order_release);
+            return true;
+        }
+
+/****************************************************************************/
+/*!
+\brief
+  Take the value at the front of the queue
+
+\param value
+  Receives the value on success
+
+\return
+  False if the queue is empty
+*/
+/****************************************************************************/
+        bool TryPop(T& value)
+        {
+            size_t position = mHead.load(std::memory_order_relaxed);
+            Cell* cell;
+
+            while (true)
+            {
+                cell = &mCells[position & mMask];
+                size_t sequence = cell->sequence.load(std::memory_order_acquire);
+                intptr_t diff = intptr_t(sequence) - intptr_t(position + 1);
+
+                if (diff == 0)
+                {
+                    // slot was published for this lap, claim it
+                    if (mHead.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                    {
+                        break;
+                    }
+                }
+                else if (diff < 0)
+                {
+                    return false;
+                }
+                else
+                {
+                    position = mHead.load(std::memory_order_relaxed);
+                }
+            }
+
+            value = std::move(cell->value);
+            cell->value = T();
+            cell->sequence.store(position + mMask + 1, std::memory_order_release);
+            return true;
+        }
+
+/****************************************************************************/
+/*!
+\brief
+  Number of slots
+*/
+/****************************************************************************/
+        size_t Capacity() const
+        {
+            return mMask + 1;
+        }
+
+    private:
+        struct Cell
+        {
+            std::atomic<size_t> sequence;
+            T value;
+        };
+
+        std::unique_ptr<Cell[]> mCells;
+        size_t mMask = 0;
+
+        // producers and consumers each hammer their own cache line
+        alignas(64) std::atomic<size_t> mTail = 0;
+        alignas(64) std::atomic<size_t> mHead = 0;
+    };
+}
+
+#endif // RINGQUEUE_H
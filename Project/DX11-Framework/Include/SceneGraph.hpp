@@ -0,0 +1,103 @@
+/****************************************************************************/
+/*!
+\file
+   SceneGraph.hpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Transform hierarchy stored as structure of arrays. Nodes are kept in
+    breadth first order so each depth is one contiguous run with every
+    parent ahead of its children. Changing a node's local transform marks
+    it dirty and Update recomputes only the dirty nodes and everything
+    below them, one depth at a time and 4 nodes per SSE iteration, along
+    with their world space bounds.
+*/
+/****************************************************************************/
+#ifndef SCENEGRAPH_H
+#define SCENEGRAPH_H
+#pragma once
+
+#include "DX11PCH.hpp"
+
+namespace DX11
+{
+    class WorkerPool;
+
+    class SceneGraph
+    {
+    public:
+        static const uint32_t INVALID_NODE = 0xffffffff;
+
+        //! nodes of one depth per thread, shallower depths update on the calling thread
+        static const uint32_t CHUNK_SIZE = 8192;
+
+        SceneGraph();
+
+        uint32_t Create(uint32_t parent = INVALID_NODE);
+        void Reserve(size_t count);
+        void Clear();
+        size_t Size() const;
+        uint32_t Depth() const;
+        uint32_t Parent(uint32_t node) const;
+
+        void SetTranslation(uint32_t node, const DirectX::XMFLOAT3& translation);
+        void SetRotation(uint32_t node, const DirectX::XMFLOAT4& rotation);
+        void SetScale(uint32_t node, const DirectX::XMFLOAT3& scale);
+        void SetBounds(uint32_t node, const DirectX::XMFLOAT3& boundsMin, const DirectX::XMFLOAT3& boundsMax, float radius);
+
+        size_t Update();
+        size_t Update(DX11::WorkerPool& pool);
+        const std::vector<uint32_t>& Changed() const;
+
+        DirectX::XMMATRIX World(uint32_t node) const;
+        void WorldBounds(uint32_t node, DirectX::XMFLOAT3& center, DirectX::XMFLOAT3& extent, float& radius) const;
+
+    private:
+        //! per node local values, mLocal[field][slot]
+        enum Local
+        {
+            TranslationX, TranslationY, TranslationZ,
+            RotationX, RotationY, RotationZ, RotationW,
+            ScaleX, ScaleY, ScaleZ,
+            CenterX, CenterY, CenterZ,
+            ExtentX, ExtentY, ExtentZ,
+            Radius,
+            LOCAL_COUNT
+        };
+
+        //! per node world values, the first 12 are the affine matrix row by row without its last column
+        enum World
+        {
+            MATRIX_COUNT = 12,
+            WorldCenterX = MATRIX_COUNT, WorldCenterY, WorldCenterZ,
+            WorldExtentX, WorldExtentY, WorldExtentZ,
+            WorldRadius,
+            WORLD_COUNT
+        };
+
+        void MarkDirty(uint32_t slot);
+        void Sort();
+        void UpdateRange(size_t begin, size_t end);
+        void UpdateGroup(size_t slot);
+        void UpdateSlot(size_t slot);
+
+        // one entry per slot, slot 0 is a hidden identity root every top level node hangs from
+        std::vector<float> mLocal[LOCAL_COUNT];
+        std::vector<float> mWorld[WORLD_COUNT];
+        std::vector<uint32_t> mParent;      //!< slot of the parent
+        std::vector<uint32_t> mNode;        //!< node handle of each slot
+        std::vector<uint8_t> mDirty;
+
+        std::vector<uint32_t> mSlot;        //!< slot of each node handle
+        std::vector<uint32_t> mLevels;      //!< first slot of each depth, then the slot count
+        std::vector<uint32_t> mLevelDirty;  //!< dirty slots per depth, filled by Update
+        std::vector<uint32_t> mChanged;
+        bool mSorted = true;
+        bool mAnyDirty = false;
+    };
+}
+
+#endif // SCENEGRAPH_H
@@ -18,6 +18,7 @@
 #include "DX11PCH.hpp"
 #include "Device.hpp"
 #include "InputLayout.hpp"
+#include "RenderQueue.hpp"
 
 namespace DX11
 {
@@ -25,6 +26,7 @@ namespace DX11
     {
         std::string vertex = "?";
         std::string pixel = "?";
+        DX11::VertexFormat vertexFormat = DX11::VertexFormat::Full;
     };
 
     class Shader
@@ -32,8 +34,9 @@ namespace DX11
     public:
         Shader() = default;
         Shader(DX11::Device device, DX11::ShaderInfo paths);
-        void Bind(DX11::DeviceContext context);
-        void Unbind(DX11::DeviceContext context);
+        void Bind(DX11::CommandContext& context);
+        void Unbind(DX11::CommandContext& context);
+        void FillItem(DX11::DrawItem& item) const;
 
         DX11::InputLayout InputLayout() const;
 
@@ -0,0 +1,78 @@
+/****************************************************************************/
+/*!
+\file
+   StagingPool.hpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Recycled staging buffers for updating GPU only (BufferUsage::Default)
+    buffers. Every upload of a frame is packed into the same mapped
+    staging blocks, the copies are issued together by Flush and blocks go
+    back to the pool once the frame that used them has been fenced as
+    done on the GPU.
+*/
+/****************************************************************************/
+#ifndef STAGINGPOOL_H
+#define STAGINGPOOL_H
+#pragma once
+
+#include "DX11PCH.hpp"
+#include "Device.hpp"
+#include "Buffer.hpp"
+#include <deque>
+
+namespace DX11
+{
+    class StagingPool
+    {
+    public:
+        //! every block is this big, uploads are packed into them and split across them
+        static const uint32_t BLOCK_SIZE = 1024 * 1024;
+
+        //! start of each upload within a block
+        static const uint32_t COPY_ALIGNMENT = 16;
+
+        StagingPool() = default;
+
+        void Upload(const DX11::Device& device, DX11::Buffer& destination, uint32_t offset, const void* data, uint32_t size);
+        void Flush(const DX11::Device& device);
+        void EndFrame(const DX11::Device& device);
+
+        size_t Allocated() const;
+
+    private:
+        //! a copy waiting for its block to be unmapped
+        struct Copy
+        {
+            ID3D11Buffer* destination = nullptr;
+            uint32_t destinationOffset = 0;
+            uint32_t block = 0;             //!< into mFrameBlocks
+            uint32_t sourceOffset = 0;
+            uint32_t size = 0;
+        };
+
+        struct Batch
+        {
+            DX11::DXPtr<ID3D11Query> fence;
+            std::vector<DX11::Buffer> blocks;
+        };
+
+        void Open(const DX11::Device& device);
+        DX11::Buffer Acquire(const DX11::Device& device);
+        void Retire(const DX11::Device& device);
+
+        std::vector<DX11::Buffer> mFree;            //!< ready for reuse
+        std::vector<DX11::Buffer> mFrameBlocks;     //!< written this frame, the ones from mFlushedBlocks on are mapped
+        std::vector<Copy> mCopies;                  //!< not issued yet
+        size_t mFlushedBlocks = 0;
+        uint32_t mCursor = BLOCK_SIZE;              //!< next free byte of the last block, BLOCK_SIZE when none is open
+        std::deque<Batch> mInFlight;                //!< oldest first
+        std::vector<DX11::DXPtr<ID3D11Query>> mFences;
+        size_t mAllocated = 0;
+    };
+}
+
+#endif // STAGINGPOOL_H
@@ -0,0 +1,182 @@
+/****************************************************************************/
+/*!
+\file
+   StateCacheCommandContext.hpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    CommandContext that shadows the bound pipeline state and drops Set*
+    calls that would bind what is already bound, then forwards the rest.
+    Objects are compared by pointer, so anything that binds state behind
+    its back or frees a bound object must call Invalidate.
+*/
+/****************************************************************************/
+#ifndef STATECACHECOMMANDCONTEXT_H
+#define STATECACHECOMMANDCONTEXT_H
+#pragma once
+
+#include "DX11PCH.hpp"
+#include "CommandContext.hpp"
+#include <memory>
+
+namespace DX11
+{
+    //! Set* calls seen since the last ResetStats and how many were dropped
+    struct StateCacheStats
+    {
+        uint32_t submitted = 0;
+        uint32_t filtered = 0;
+    };
+
+    class StateCacheCommandContext : public DX11::CommandContext
+    {
+    public:
+        //! slots shadowed, calls past these always go through
+        static const uint32_t VERTEX_BUFFER_SLOTS = 16;
+        static const uint32_t CONSTANT_BUFFER_SLOTS = 14;
+        static const uint32_t VIEWPORT_SLOTS = 16;
+        static const uint32_t RENDER_TARGET_SLOTS = 8;
+
+        explicit StateCacheCommandContext(std::shared_ptr<DX11::CommandContext> forward);
+
+        void Invalidate();
+        void InvalidateRenderTargets();
+        void ResetStats();
+        const DX11::StateCacheStats& Stats() const;
+
+        void SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology) override;
+        void SetInputLayout(ID3D11InputLayout* layout) override;
+        void SetVertexBuffers(uint32_t slot, uint32_t count, ID3D11Buffer* const* buffers, const uint32_t* strides, const uint32_t* offsets) override;
+        void SetIndexBuffer(ID3D11Buffer* buffer, DXGI_FORMAT format, uint32_t offset) override;
+
+        void SetVertexShader(ID3D11VertexShader* shader) override;
+        void SetPixelShader(ID3D11PixelShader* shader) override;
+        void SetVSConstantBuffer(uint32_t slot, ID3D11Buffer* buffer, uint32_t firstConstant, uint32_t constantCount) override;
+        void SetPSConstantBuffer(uint32_t slot, ID3D11Buffer* buffer, uint32_t firstConstant, uint32_t constantCount) override;
+
+        void SetRasterizerState(ID3D11RasterizerState* state) override;
+        void SetViewports(uint32_t count, const D3D11_VIEWPORT* viewports) override;
+        void SetBlendState(ID3D11BlendState* state, const float factors[4], uint32_t sampleMask) override;
+        void SetDepthStencilState(ID3D11DepthStencilState* state, uint32_t stencilRef) override;
+        void SetRenderTargets(uint32_t count, ID3D11RenderTargetView* const* views, ID3D11DepthStencilView* depth) override;
+        void ClearRenderTargetView(ID3D11RenderTargetView* view, const float color[4]) override;
+        void ClearDepthStencilView(ID3D11DepthStencilView* view, uint32_t flags, float depth, uint8_t stencil) override;
+
+        void DrawIndexed(uint32_t indexCount, uint32_t firstIndex, int32_t baseVertex) override;
+        void DrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t baseVertex, uint32_t firstInstance) override;
+
+        void* Map(ID3D11Resource* resource, D3D11_MAP mapType, uint32_t size) override;
+        void Unmap(ID3D11Resource* resource) override;
+        void CopyBufferRegion(ID3D11Buffer* destination, uint32_t destinationOffset, ID3D11Buffer* source, uint32_t sourceOffset, uint32_t size) override;
+
+        void EndQuery(ID3D11Query* query) override;
+        HRESULT GetQueryData(ID3D11Query* query, bool flush) override;
+
+        void ClearState() override;
+        void Flush() override;
+
+        std::shared_ptr<DX11::CommandContext> CreateDeferred() override;
+        DX11::CommandList FinishCommandList() override;
+        void ExecuteCommandList(ID3D11CommandList* list) override;
+
+    private:
+        //! last value bound, unknown until the first bind after Invalidate
+        template <typename T>
+        struct Shadow
+        {
+            T value = T();
+            bool known = false;
+        };
+
+        struct VertexBinding
+        {
+            ID3D11Buffer* buffer = nullptr;
+            uint32_t stride = 0;
+            uint32_t offset = 0;
+
+            bool operator==(const VertexBinding& other) const;
+        };
+
+        struct IndexBinding
+        {
+            ID3D11Buffer* buffer = nullptr;
+            DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+            uint32_t offset = 0;
+
+            bool operator==(const IndexBinding& other) const;
+        };
+
+        struct ConstantBinding
+        {
+            ID3D11Buffer* buffer = nullptr;
+            uint32_t firstConstant = 0;
+            uint32_t constantCount = 0;
+
+            bool operator==(const ConstantBinding& other) const;
+        };
+
+        struct BlendBinding
+        {
+            ID3D11BlendState* state = nullptr;
+            float factors[4] = { 1, 1, 1, 1 };
+            uint32_t sampleMask = 0xffffffff;
+
+            bool operator==(const BlendBinding& other) const;
+        };
+
+        struct DepthStencilBinding
+        {
+            ID3D11DepthStencilState* state = nullptr;
+            uint32_t stencilRef = 0;
+
+            bool operator==(const DepthStencilBinding& other) const;
+        };
+
+        struct ViewportBinding
+        {
+            uint32_t count = 0;
+            D3D11_VIEWPORT viewports[VIEWPORT_SLOTS] = {};
+
+            bool operator==(const ViewportBinding& other) const;
+        };
+
+        struct RenderTargetBinding
+        {
+            uint32_t count = 0;
+            ID3D11RenderTargetView* views[RENDER_TARGET_SLOTS] = {};
+            ID3D11DepthStencilView* depth = nullptr;
+
+            bool operator==(const RenderTargetBinding& other) const;
+        };
+
+        template <typename T>
+        bool Changed(Shadow<T>& shadow, const T& value);
+
+        void SetConstantBuffer(Shadow<ConstantBinding>* slots, uint32_t slot, ID3D11Buffer* buffer, uint32_t firstConstant, uint32_t constantCount, bool pixel);
+        void Reset(bool known);
+
+        std::shared_ptr<DX11::CommandContext> mForward;
+        DX11::StateCacheStats mStats;
+
+        Shadow<D3D11_PRIMITIVE_TOPOLOGY> mTopology;
+        Shadow<ID3D11InputLayout*> mInputLayout;
+        Shadow<VertexBinding> mVertexBuffers[VERTEX_BUFFER_SLOTS];
+        Shadow<IndexBinding> mIndexBuffer;
+
+        Shadow<ID3D11VertexShader*> mVertexShader;
+        Shadow<ID3D11PixelShader*> mPixelShader;
+        Shadow<ConstantBinding> mVSConstants[CONSTANT_BUFFER_SLOTS];
+        Shadow<ConstantBinding> mPSConstants[CONSTANT_BUFFER_SLOTS];
+
+        Shadow<ID3D11RasterizerState*> mRasterizerState;
+        Shadow<ViewportBinding> mViewports;
+        Shadow<BlendBinding> mBlendState;
+        Shadow<DepthStencilBinding> mDepthStencilState;
+        Shadow<RenderTargetBinding> mRenderTargets;
+    };
+}
+
+#endif // STATECACHECOMMANDCONTEXT_H
@@ -0,0 +1,321 @@
+/****************************************************************************/
+/*!
+\file
+   VertexFormat.hpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Vertex layouts a mesh can be stored in, and the CPU side encoders for
+    the compact ones. The encoders are plain math so they can be checked
+    without a device.
+*/
+/****************************************************************************/
+#ifndef VERTEXFORMAT_H
+#define VERTEXFORMAT_H
+#pragma once
+
+#include "DX11PCH.hpp"
+#include <cstring>
+
+namespace DX11
+{
+    enum class VertexFormat : uint32_t
+    {
+        Full,       //!< float4 position, float4 normal          (32 bytes)
+        Compact,    //!< float3 position, octahedral snorm16 normal (16 bytes)
+        Quantized,  //!< unorm16 position in mesh bounds, octahedral snorm16 normal (12 bytes)
+    };
+
+    struct VertexCompact
+    {
+        float position[3];
+        int16_t normal[2];
+    };
+
+    struct VertexQuantized
+    {
+        uint16_t position[4];
+        int16_t normal[2];
+    };
+
+    /****************************************************************************/
+    /*!
+    \brief
+      Size of one vertex in the given format
+    */
+    /****************************************************************************/
+    inline uint32_t VertexStride(VertexFormat format)
+    {
+        switch (format)
+        {
+        case VertexFormat::Compact:   return uint32_t(sizeof(VertexCompact));
+        case VertexFormat::Quantized: return uint32_t(sizeof(VertexQuantized));
+        default:                      return uint32_t(sizeof(float) * 8);
+        }
+    }
+
+    /****************************************************************************/
+    /*!
+    \brief
+      The DXGI format an input semantic is stored as, DXGI_FORMAT_UNKNOWN
+      if the format does not override what the shader reflects
+    */
+    /****************************************************************************/
+    inline DXGI_FORMAT VertexElementFormat(VertexFormat format, const std::string& semantic)
+    {
+        if (format == VertexFormat::Full)
+        {
+            return DXGI_FORMAT_UNKNOWN;
+        }
+
+        if (semantic == "POSITION")
+        {
+            return format == VertexFormat::Quantized ? DXGI_FORMAT_R16G16B16A16_UNORM : DXGI_FORMAT_R32G32B32_FLOAT;
+        }
+
+        if (semantic == "NORMAL")
+        {
+            return DXGI_FORMAT_R16G16_SNORM;
+        }
+
+        return DXGI_FORMAT_UNKNOWN;
+    }
+
+    /****************************************************************************/
+    /*!
+    \brief
+      float in [-1, 1] to snorm16
+    */
+    /****************************************************************************/
+    inline int16_t EncodeSnorm16(float value)
+    {
+        value = std::min(std::max(value, -1.0f), 1.0f);
+        return int16_t(std::lround(value * 32767.0f));
+    }
+
+    /****************************************************************************/
+    /*!
+    \brief
+      snorm16 to float in [-1, 1], matches the D3D conversion rules
+    */
+    /****************************************************************************/
+    inline float DecodeSnorm16(int16_t value)
+    {
+        return std::max(float(value) / 32767.0f, -1.0f);
+    }
+
+    /****************************************************************************/
+    /*!
+    \brief
+      Quantize a coordinate to unorm16 inside [min, min + extent]
+    */
+    /****************************************************************************/
+    inline uint16_t QuantizeUnorm16(float value, float min, float extent)
+    {
+        if (extent <= 0.0f)
+        {
+            return 0;
+        }
+
+        float t = std::min(std::max((value - min) / extent, 0.0f), 1.0f);
+        return uint16_t(std::lround(t * 65535.0f));
+    }
+
+    /****************************************************************************/
+    /*!
+    \brief
+      Inverse of QuantizeUnorm16
+    */
+    /****************************************************************************/
+    inline float DequantizeUnorm16(uint16_t value, float min, float extent)
+    {
+        return min + (float(value) / 65535.0f) * extent;
+    }
+
+    /****************************************************************************/
+    /*!
+    \brief
+      Octahedral encode a unit normal into two snorm16s
+      http://jcgt.org/published/0003/02/01/
+
+    \param normal
+      xyz of a unit length normal
+
+    \param out
+      the two encoded components
+    */
+    /****************************************************************************/
+    inline void EncodeOctahedral(const float normal[3], int16_t out[2])
+    {
+        float sum = std::abs(normal[0]) + std::abs(normal[1]) + std::abs(normal[2]);
+        if (sum <= 0.0f)
+        {
+            out[0] = 0;
+            out[1] = 0;
+            return;
+        }
+
+        float x = normal[0] / sum;
+        float y = normal[1] / sum;
+
+        // fold the lower hemisphere over the diagonals
+        if (normal[2] < 0.0f)
+        {
+            float foldX = (1.0f - std::abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+            float foldY = (1.0f - std::abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+            x = foldX;
+            y = foldY;
+        }
+
+        out[0] = EncodeSnorm16(x);
+        out[1] = EncodeSnorm16(y);
+    }
+
+    /****************************************************************************/
+    /*!
+    \brief
+      Inverse of EncodeOctahedral, same math as the vertex shader
+
+    \param encoded
+      the two encoded components
+
+    \param normal
+      the decoded unit normal
+    */
+    /****************************************************************************/
+    inline void DecodeOctahedral(const int16_t encoded[2], float normal[3])
+    {
+        float x = DecodeSnorm16(encoded[0]);
+        float y = DecodeSnorm16(encoded[1]);
+        float z = 1.0f - std::abs(x) - std::abs(y);
+
+        float t = std::max(-z, 0.0f);
+        x += x >= 0.0f ? -t : t;
+        y += y >= 0.0f ? -t : t;
+
+        float length = std::sqrt(x * x + y * y + z * z);
+        normal[0] = x / length;
+        normal[1] = y / length;
+        normal[2] = z / length;
+    }
+
+    /****************************************************************************/
+    /*!
+    \brief
+      Encode one vertex, what a mesh does for every vertex it stores
+
+    \param format
+      Layout to write
+
+    \param position
+      Model space position
+
+    \param normal
+      Unit length normal
+
+    \param boundsMin
+      Minimum of the mesh bounds, only read for Quantized
+
+    \param boundsExtent
+      Size of the mesh bounds, only read for Quantized
+
+    \param out
+      VertexStride(format) bytes to write to
+    */
+    /****************************************************************************/
+    inline void EncodeVertex(VertexFormat format, const float position[3], const float normal[3],
+        const float boundsMin[3], const float boundsExtent[3], void* out)
+    {
+        if (format == VertexFormat::Compact)
+        {
+            VertexCompact* vertex = static_cast<VertexCompact*>(out);
+            std::copy(position, position + 3, vertex->position);
+            EncodeOctahedral(normal, vertex->normal);
+        }
+        else if (format == VertexFormat::Quantized)
+        {
+            VertexQuantized* vertex = static_cast<VertexQuantized*>(out);
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                vertex->position[axis] = QuantizeUnorm16(position[axis], boundsMin[axis], boundsExtent[axis]);
+            }
+            vertex->position[3] = 0xffff;
+            EncodeOctahedral(normal, vertex->normal);
+        }
+        else
+        {
+            const float full[8] = { position[0], position[1], position[2], 1.0f, normal[0], normal[1], normal[2], 0.0f };
+            std::memcpy(out, full, sizeof(full));
+        }
+    }
+
+    /****************************************************************************/
+    /*!
+    \brief
+      Decode one vertex back to model space, what the vertex shader sees
+      once the dequantize matrix is applied
+
+    \param format
+      Layout to read
+
+    \param vertex
+      VertexStride(format) bytes to read
+
+    \param boundsMin
+      Minimum of the mesh bounds, only read for Quantized
+
+    \param boundsExtent
+      Size of the mesh bounds, only read for Quantized
+
+    \param position
+      Receives the position
+
+    \param normal
+      Receives the unit normal, may be null
+    */
+    /****************************************************************************/
+    inline void DecodeVertex(VertexFormat format, const void* vertex, const float boundsMin[3], const float boundsExtent[3],
+        float position[3], float normal[3])
+    {
+        if (format == VertexFormat::Compact)
+        {
+            const VertexCompact* compact = static_cast<const VertexCompact*>(vertex);
+            std::copy(compact->position, compact->position + 3, position);
+            if (normal)
+            {
+                DecodeOctahedral(compact->normal, normal);
+            }
+        }
+        else if (format == VertexFormat::Quantized)
+        {
+            const VertexQuantized* quantized = static_cast<const VertexQuantized*>(vertex);
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                position[axis] = DequantizeUnorm16(quantized->position[axis], boundsMin[axis], boundsExtent[axis]);
+            }
+            if (normal)
+            {
+                DecodeOctahedral(quantized->normal, normal);
+            }
+        }
+        else
+        {
+            float full[8];
+            std::memcpy(full, vertex, sizeof(full));
+            std::copy(full, full + 3, position);
+            if (normal)
+            {
+                const float length = std::sqrt(full[4] * full[4] + full[5] * full[5] + full[6] * full[6]);
+                for (int axis = 0; axis < 3; ++axis)
+                {
+                    normal[axis] = length > 0.0f ? full[4 + axis] / length : 0.0f;
+                }
+            }
+        }
+    }
+}
+
+#endif // VERTEXFORMAT_H
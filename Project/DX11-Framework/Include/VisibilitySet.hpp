@@ -0,0 +1,88 @@
+/****************************************************************************/
+/*!
+\file
+   VisibilitySet.hpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    World space bounds of everything that might be drawn, stored as
+    structure of arrays so the frustum test runs on 4 (SSE) or 8 (AVX2)
+    objects at once. Each object is a box and a sphere sharing a center,
+    it is culled when either lies fully outside one of the 6 planes.
+*/
+/****************************************************************************/
+#ifndef VISIBILITYSET_H
+#define VISIBILITYSET_H
+#pragma once
+
+#include "DX11PCH.hpp"
+
+namespace DX11
+{
+    class WorkerPool;
+
+    //! 6 planes facing inwards, a point p is inside a plane when dot(p, xyz) + w >= 0
+    struct Frustum
+    {
+        enum Plane { Left, Right, Bottom, Top, Near, Far, PLANE_COUNT };
+
+        DirectX::XMFLOAT4 planes[PLANE_COUNT];
+
+        static DX11::Frustum FromMatrix(DirectX::FXMMATRIX viewProjection);
+    };
+
+    //! which kernel tests the objects
+    enum class CullKernel : uint32_t
+    {
+        Scalar,
+        SSE,        //!< 4 objects per iteration
+        AVX2        //!< 8 objects per iteration, only if the CPU has it
+    };
+
+    class VisibilitySet
+    {
+    public:
+        //! objects per thread, smaller sets are culled on the calling thread
+        static const uint32_t CHUNK_SIZE = 16384;
+
+        VisibilitySet();
+
+        uint32_t Add(const DirectX::XMFLOAT3& center, const DirectX::XMFLOAT3& extent, float radius);
+        uint32_t Add(const DirectX::XMFLOAT3& boundsMin, const DirectX::XMFLOAT3& boundsMax, float radius, DirectX::FXMMATRIX world);
+        void Set(uint32_t index, const DirectX::XMFLOAT3& center, const DirectX::XMFLOAT3& extent, float radius);
+        void Reserve(size_t count);
+        void Clear();
+        size_t Size() const;
+
+        bool SetKernel(DX11::CullKernel kernel);
+        DX11::CullKernel Kernel() const;
+
+        size_t Cull(const DX11::Frustum& frustum, std::vector<uint32_t>& visible) const;
+        size_t Cull(const DX11::Frustum& frustum, std::vector<uint32_t>& visible, DX11::WorkerPool& pool) const;
+
+        static bool SupportsAVX2();
+
+    private:
+        size_t CullRange(const DX11::Frustum& frustum, size_t begin, size_t end, uint32_t* visible) const;
+
+        // one entry per object
+        std::vector<float> mCenterX;
+        std::vector<float> mCenterY;
+        std::vector<float> mCenterZ;
+        std::vector<float> mExtentX;
+        std::vector<float> mExtentY;
+        std::vector<float> mExtentZ;
+        std::vector<float> mRadius;
+
+        DX11::CullKernel mKernel = DX11::CullKernel::SSE;
+
+        // per chunk results before they are packed, reused between calls
+        mutable std::vector<uint32_t> mScratch;
+        mutable std::vector<size_t> mChunkCounts;
+    };
+}
+
+#endif // VISIBILITYSET_H
@@ -0,0 +1,166 @@
+/****************************************************************************/
+/*!
+\file
+   WorkStealingDeque.hpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Bounded lock-free work stealing deque (Chase and Lev, with the memory
+    orderings of Le et al. 2013). The owning thread pushes and pops at the
+    bottom, newest first, any other thread steals the oldest from the top.
+    Push fails when the deque is full and the caller decides what to do.
+*/
+/****************************************************************************/
+#ifndef WORKSTEALINGDEQUE_H
+#define WORKSTEALINGDEQUE_H
+#pragma once
+
+#include "DX11PCH.hpp"
+#include <atomic>
+#include <memory>
+
+namespace DX11
+{
+    template <typename T>
+    class WorkStealingDeque
+    {
+    public:
+/****************************************************************************/
+/*!
+\brief
+  Constructor
+
+\param capacity
+  Number of slots, rounded up to a power of two
+*/
+/****************************************************************************/
+        explicit WorkStealingDeque(size_t capacity)
+        {
+            size_t size = 2;
+            while (size < capacity)
+            {
+                size <<= 1;
+            }
+
+            mSlots = std::make_unique<std::atomic<T>[]>(size);
+            mMask = size - 1;
+        }
+
+        WorkStealingDeque(const WorkStealingDeque&) = delete;
+        WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+/****************************************************************************/
+/*!
+\brief
+  Add a value at the bottom, owner only
+
+\param value
+  The value
+
+\return
+  False if the deque is full
+*/
+/****************************************************************************/
+        bool Push(T value)
+        {
+            const int64_t bottom = mBottom.load(std::memory_order_relaxed);
+            const int64_t top = mTop.load(std::memory_order_acquire);
+            if (bottom - top > int64_t(mMask))
+            {
+                return false;
+            }
+
+            mSlots[bottom & mMask].store(value, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            mBottom.store(bottom + 1, std::memory_order_relaxed);
+            return true;
+        }
+
+/****************************************************************************/
+/*!
+\brief
+  Take the newest value, owner only
+
+\param value
+  Receives the value on success
+
+\return
+  False if the deque is empty or a thief took the last value
+*/
+/****************************************************************************/
+        bool Pop(T& value)
+        {
+            const int64_t bottom = mBottom.load(std::memory_order_relaxed) - 1;
+            mBottom.store(bottom, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t top = mTop.load(std::memory_order_relaxed);
+
+            if (top > bottom)
+            {
+                mBottom.store(bottom + 1, std::memory_order_relaxed);
+                return false;
+            }
+
+            value = mSlots[bottom & mMask].load(std::memory_order_relaxed);
+            if (top < bottom)
+            {
+                return true;
+            }
+
+            // last value, race the thieves for it
+            const bool won = mTop.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+            mBottom.store(bottom + 1, std::memory_order_relaxed);
+            return won;
+        }
+
+/****************************************************************************/
+/*!
+\brief
+  Take the oldest value, any thread
+
+\param value
+  Receives the value on success
+
+\return
+  False if the deque is empty or another thread got there first
+*/
+/****************************************************************************/
+        bool Steal(T& value)
+        {
+            int64_t top = mTop.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            const int64_t bottom = mBottom.load(std::memory_order_acquire);
+            if (top >= bottom)
+            {
+                return false;
+            }
+
+            value = mSlots[top & mMask].load(std::memory_order_relaxed);
+            return mTop.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+        }
+
+/****************************************************************************/
+/*!
+\brief
+  Number of slots
+*/
+/****************************************************************************/
+        size_t Capacity() const
+        {
+            return mMask + 1;
+        }
+
+    private:
+        std::unique_ptr<std::atomic<T>[]> mSlots;
+        size_t mMask = 0;
+
+        // the owner hammers the bottom, thieves the top
+        alignas(64) std::atomic<int64_t> mTop = 0;
+        alignas(64) std::atomic<int64_t> mBottom = 0;
+    };
+}
+
+#endif // WORKSTEALINGDEQUE_H
@@ -0,0 +1,164 @@
+/****************************************************************************/
+/*!
+\file
+   WorkerPool.hpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Fixed set of worker threads running jobs. Each worker keeps its own
+    work stealing deque, jobs scheduled from a worker go on its deque and
+    idle workers steal from the others, jobs from outside the pool go
+    through a shared queue. A job can count down a JobCounter when it
+    finishes and can be held back until another counter reaches zero.
+    Waiting on a counter runs jobs instead of blocking, so loops and waits
+    nest freely. Jobs live in a fixed set of slots, scheduling one does not
+    touch the heap.
+*/
+/****************************************************************************/
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+#pragma once
+
+#include "DX11PCH.hpp"
+#include "RingQueue.hpp"
+#include "WorkStealingDeque.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+
+namespace DX11
+{
+    class JobCounter;
+
+    //! a scheduled callable stored in place, jobs come from the pool's fixed set so scheduling never allocates
+    struct alignas(64) Job
+    {
+        static const uint32_t STORAGE = 96;
+
+        void (*run)(DX11::Job& job) = nullptr;  //!< calls the callable then destroys it
+        DX11::JobCounter* counter = nullptr;
+        DX11::Job* next = nullptr;              //!< next job waiting on the same counter
+        alignas(16) unsigned char storage[STORAGE];
+    };
+
+    //! jobs left to finish, must outlive them and be waited on before it goes away. The count
+    //! can reach zero while jobs are still being added, so schedule a whole stage before
+    //! anything is scheduled after it.
+    class JobCounter
+    {
+    public:
+        JobCounter() = default;
+        JobCounter(const JobCounter&) = delete;
+        JobCounter& operator=(const JobCounter&) = delete;
+
+        bool Done() const;
+
+    private:
+        friend class WorkerPool;
+
+        std::atomic<uint32_t> mCount = 0;
+        std::mutex mMutex;
+        DX11::Job* mWaiting = nullptr;      //!< jobs held back until the count reaches zero, linked through Job::next
+    };
+
+    class WorkerPool
+    {
+    public:
+        //! jobs each worker's deque holds, a job that finds it full runs on the spot
+        static const uint32_t DEQUE_SIZE = 4096;
+
+        //! jobs per thread a loop is split into, enough for stealing to even out uneven items
+        static const uint32_t JOBS_PER_THREAD = 4;
+
+        //! jobs that can be queued or held back at once, scheduling past that runs the job on the spot
+        static const uint32_t JOB_CAPACITY = 8192;
+
+        explicit WorkerPool(uint32_t threadCount = 0);
+        ~WorkerPool();
+        WorkerPool(const WorkerPool&) = delete;
+        WorkerPool& operator=(const WorkerPool&) = delete;
+
+/****************************************************************************/
+/*!
+\brief
+  Queue a job. From a worker it goes on that worker's deque, from any
+  other thread on the shared queue. A pool without workers only runs jobs
+  while some thread waits on their counter. The callable is stored in the
+  job itself, capture pointers to anything bigger than Job::STORAGE.
+
+\param function
+  The job, must be safe to run on any thread
+
+\param counter
+  Counted up now and down once the job has run, may be null
+
+\param after
+  The job is held back until this counter reaches zero, may be null
+*/
+/****************************************************************************/
+        template <typename Function>
+        void Schedule(Function&& function, DX11::JobCounter* counter = nullptr, DX11::JobCounter* after = nullptr)
+        {
+            typedef typename std::decay<Function>::type Callable;
+            static_assert(sizeof(Callable) <= DX11::Job::STORAGE, "WorkerPool: job captures too much, capture a pointer instead");
+            static_assert(alignof(Callable) <= 16, "WorkerPool: job is over aligned");
+
+            DX11::Job* job = Allocate(after);
+            if (job == nullptr)
+            {
+                // every slot is taken and nothing holds this one back, it may as well run now
+                function();
+                return;
+            }
+
+            new (job->storage) Callable(std::forward<Function>(function));
+            job->run = [](DX11::Job& self)
+            {
+                Callable* callable = reinterpret_cast<Callable*>(self.storage);
+                (*callable)();
+                callable->~Callable();
+            };
+            Submit(job, counter, after);
+        }
+
+        void Wait(DX11::JobCounter& counter);
+
+        void ParallelFor(size_t count, const std::function<void(size_t)>& function);
+        void ParallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& function);
+        uint32_t ThreadCount() const;
+
+        static WorkerPool& Global();
+
+    private:
+        DX11::Job* Allocate(DX11::JobCounter* after);
+        void Submit(DX11::Job* job, DX11::JobCounter* counter, DX11::JobCounter* after);
+        void WorkerLoop(uint32_t worker);
+        DX11::Job* Find(uint32_t worker);
+        void Push(DX11::Job* job, bool runIfFull = true);
+        void Execute(DX11::Job* job);
+        void Finish(DX11::JobCounter& counter);
+        uint32_t CurrentWorker() const;
+
+        std::vector<std::thread> mThreads;
+        std::unique_ptr<DX11::Job[]> mJobs;                                         //!< JOB_CAPACITY slots
+        DX11::RingQueue<uint32_t> mFreeJobs;                                        //!< indices of unused slots
+        std::vector<std::unique_ptr<DX11::WorkStealingDeque<DX11::Job*>>> mDeques;  //!< one per worker thread
+        DX11::RingQueue<DX11::Job*> mInjected;                                      //!< jobs from threads outside the pool
+
+        // idle workers sleep until something is queued
+        std::mutex mMutex;
+        std::condition_variable mWake;
+        std::atomic<uint32_t> mQueued = 0;
+        std::atomic<uint32_t> mSleeping = 0;
+        bool mQuit = false;
+    };
+}
+
+#endif // WORKERPOOL_H
@@ -0,0 +1,213 @@
+/****************************************************************************/
+/*!
+\file
+   AssetLoader.cpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Streams meshes in the background. File reads and imports run on loader
+    threads, finished meshes go onto a lock-free ready queue and the render
+    thread creates a bounded number of GPU buffers per frame.
+*/
+/****************************************************************************/
+
+/*============================================================================*\
+|| ------------------------------ INCLUDES ---------------------------------- ||
+\*============================================================================*/
+
+#include "DX11PCH.hpp"
+#include "AssetLoader.hpp"
+
+/*============================================================================*\
+|| --------------------------- GLOBAL VARIABLES ----------------------------- ||
+\*============================================================================*/
+
+/*============================================================================*\
+|| -------------------------- STATIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/*============================================================================*\
+|| -------------------------- PUBLIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Start the loader threads
+
+\param threadCount
+  Number of loader threads, imports already spread over the worker pool so
+  one is usually enough
+
+\param readyCapacity
+  Number of loaded meshes that can wait for upload before loaders stall
+*/
+/****************************************************************************/
+DX11::AssetLoader::AssetLoader(uint32_t threadCount, size_t readyCapacity) :
+    mReady(readyCapacity)
+{
+    for (uint32_t i = 0; i < std::max(1u, threadCount); ++i)
+    {
+        mThreads.emplace_back(&AssetLoader::LoaderLoop, this);
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Drop queued requests and join the loader threads. Meshes still being
+  imported finish first.
+*/
+/****************************************************************************/
+DX11::AssetLoader::~AssetLoader()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mQuit = true;
+        mRequests.clear();
+    }
+    mWake.notify_all();
+
+    for (std::thread& thread : mThreads)
+    {
+        thread.join();
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Queue a mesh for loading. Returns immediately, the mesh is drawable once
+  it reports Ready.
+
+\param path
+  Path of the file to load
+
+\param format
+  The vertex layout to store the mesh in
+
+\return
+  The mesh, in the Loading state
+*/
+/****************************************************************************/
+std::shared_ptr<DX11::Mesh> DX11::AssetLoader::LoadMesh(const std::string& path, DX11::VertexFormat format)
+{
+    std::shared_ptr<DX11::Mesh> mesh = std::make_shared<DX11::Mesh>();
+    mesh->LoadState = DX11::MeshState::Loading;
+    ++mPending;
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mRequests.push_back({ mesh, path, format });
+    }
+    mWake.notify_one();
+
+    return mesh;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Create the buffers for meshes that finished loading. Call once a frame
+  from the render thread, the budget keeps big batches from stalling it.
+
+\param device
+  The ID3D11Device
+
+\param staging
+  Streams the buffers in, flush it before drawing them
+
+\param maxUploads
+  Most meshes to upload this call
+
+\return
+  Number of meshes uploaded
+*/
+/****************************************************************************/
+uint32_t DX11::AssetLoader::Upload(DX11::Device device, DX11::StagingPool& staging, uint32_t maxUploads)
+{
+    uint32_t uploaded = 0;
+    Loaded loaded;
+
+    while (uploaded < maxUploads && mReady.TryPop(loaded))
+    {
+        --mPending;
+
+        if (!loaded.error.empty())
+        {
+            DEBUG::log.Error("AssetLoader:", loaded.path, loaded.error);
+            continue;
+        }
+
+        loaded.mesh->Upload(device, &staging);
+        DEBUG::log.Info("AssetLoader: uploaded", loaded.path);
+        ++uploaded;
+    }
+
+    return uploaded;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Number of requested meshes that have not been uploaded yet
+*/
+/****************************************************************************/
+uint32_t DX11::AssetLoader::Pending() const
+{
+    return mPending;
+}
+
+/*============================================================================*\
+|| ------------------------- PRIVATE FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Loader thread body, loads requests until told to quit
+*/
+/****************************************************************************/
+void DX11::AssetLoader::LoaderLoop()
+{
+    while (true)
+    {
+        Request request;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mWake.wait(lock, [this]() { return mQuit || !mRequests.empty(); });
+            if (mQuit)
+            {
+                return;
+            }
+            request = std::move(mRequests.front());
+            mRequests.pop_front();
+        }
+
+        Loaded loaded;
+        loaded.mesh = request.mesh;
+        loaded.path = request.path;
+        try
+        {
+            request.mesh->Load(request.path, request.format);
+        }
+        catch (const std::exception& e)
+        {
+            request.mesh->LoadState = DX11::MeshState::Failed;
+            loaded.error = e.what();
+        }
+
+        // the render thread is behind, wait for it to drain
+        while (!mReady.TryPush(loaded))
+        {
+            if (mQuit)
+            {
+                return;
+            }
+            std::this_thread::yield();
+        }
+    }
+}
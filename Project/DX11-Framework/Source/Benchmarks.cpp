@@ -0,0 +1,2529 @@
+/****************************************************************************/
+/*!
+\file
+   Benchmarks.cpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    CPU benchmarks for the renderer's systems. They run on a headless
+    device so they need no window or GPU, see "--bench" in Main.cpp.
+*/
+/****************************************************************************/
+
+/*============================================================================*\
+|| ------------------------------ INCLUDES ---------------------------------- ||
+\*============================================================================*/
+
+#include "DX11PCH.hpp"
+#include "Benchmarks.hpp"
+#include "RecordingCommandContext.hpp"
+#include "RingAllocator.hpp"
+#include "VertexFormat.hpp"
+#include "RenderQueue.hpp"
+#include "VisibilitySet.hpp"
+#include "Bvh.hpp"
+#include "OcclusionCuller.hpp"
+#include "MeshSimplifier.hpp"
+#include "MeshOptimizer.hpp"
+#include "Meshlets.hpp"
+#include "Mesh.hpp"
+#include "SceneGraph.hpp"
+#include "WorkerPool.hpp"
+#include "FramePipeline.hpp"
+#include <thread>
+#include <chrono>
+#include <random>
+#include <iterator>
+#include <array>
+#include <cstdlib>
+#include <new>
+
+/*============================================================================*\
+|| --------------------------- GLOBAL VARIABLES ----------------------------- ||
+\*============================================================================*/
+
+#ifdef COUNT_ALLOCATIONS
+
+// only builds that ask for it replace operator new, the shipping app keeps the CRT's
+
+namespace
+{
+    //! operator new calls so far, counts the whole process
+    std::atomic<uint64_t> gAllocations = 0;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Counting replacement of the global operator new, one relaxed increment
+  on top of malloc. The array and nothrow forms end up here too.
+
+\param size
+  Bytes to allocate
+*/
+/****************************************************************************/
+void* operator new(size_t size)
+{
+    gAllocations.fetch_add(1, std::memory_order_relaxed);
+    void* memory = std::malloc(size ? size : 1);
+    if (memory == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Free what the counting operator new allocated
+
+\param memory
+  The allocation, may be null
+*/
+/****************************************************************************/
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Sized form of the above
+
+\param memory
+  The allocation, may be null
+*/
+/****************************************************************************/
+void operator delete(void* memory, size_t) noexcept
+{
+    std::free(memory);
+}
+
+#endif // COUNT_ALLOCATIONS
+
+/*============================================================================*\
+|| -------------------------- STATIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+namespace
+{
+    typedef std::chrono::steady_clock Clock;
+
+    /****************************************************************************/
+    /*!
+    \brief
+      Milliseconds since start
+
+    \param start
+      When the measurement began
+    */
+    /****************************************************************************/
+    static double Milliseconds(Clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    /****************************************************************************/
+    /*!
+    \brief
+      Some arithmetic that the compiler can't skip, stands in for real work
+
+    \param seed
+      Start value
+
+    \param steps
+      How long to keep at it
+
+    \return
+      Something that depends on every step
+    */
+    /****************************************************************************/
+    static float Busy(float seed, uint32_t steps)
+    {
+        float value = seed;
+        for (uint32_t i = 0; i < steps; ++i)
+        {
+            value = std::sqrt(value * value + 1.0f) - 0.5f;
+        }
+        return value;
+    }
+
+    /****************************************************************************/
+    /*!
+    \brief
+      Sum [begin, end) by splitting it in half until it is small, one job
+      per half and a wait on both, so most work is found by stealing
+
+    \param pool
+      Pool to split across
+
+    \param begin
+      First value
+
+    \param end
+      One past the last value
+
+    \return
+      Sum of the values
+    */
+    /****************************************************************************/
+    static uint64_t SplitSum(DX11::WorkerPool& pool, uint64_t begin, uint64_t end)
+    {
+        if (end - begin <= 1024)
+        {
+            uint64_t sum = 0;
+            for (uint64_t value = begin; value < end; ++value)
+            {
+                sum += value;
+            }
+            return sum;
+        }
+
+        const uint64_t middle = begin + (end - begin) / 2;
+        uint64_t left = 0;
+        DX11::JobCounter counter;
+        pool.Schedule([&pool, &left, begin, middle]() { left = SplitSum(pool, begin, middle); }, &counter);
+        const uint64_t right = SplitSum(pool, middle, end);
+        pool.Wait(counter);
+        return left + right;
+    }
+
+    /****************************************************************************/
+    /*!
+    \brief
+      A distinct made up handle for id. Headless nothing is ever created and
+      the recorder only compares pointers, it never dereferences them.
+
+    \param id
+      Which object
+
+    \return
+      A non null pointer unique to id
+    */
+    /****************************************************************************/
+    template <typename T>
+    static T* FakeHandle(uint32_t id)
+    {
+        return reinterpret_cast<T*>(uintptr_t(id + 1) * 64);
+    }
+
+    /****************************************************************************/
+    /*!
+    \brief
+      Make count random draws with fake handles, the same ones every call
+
+    \param count
+      Number of draws
+
+    \param shaders
+      Distinct shaders to pick from
+
+    \param meshes
+      Distinct meshes to pick from
+
+    \param materials
+      One constant slice per material
+
+    \param keys
+      Receives each draw's sort key
+
+    \param items
+      Receives the draws
+    */
+    /****************************************************************************/
+    static void RandomDraws(uint32_t count, uint32_t shaders, uint32_t meshes,
+        const std::vector<DX11::ConstantRing::Slice>& materials,
+        std::vector<uint64_t>& keys, std::vector<DX11::DrawItem>& items)
+    {
+        std::mt19937 random(1234);
+        keys.resize(count);
+        items.resize(count);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            uint32_t shader = random() % shaders;
+            uint32_t material = random() % uint32_t(materials.size());
+            uint32_t mesh = random() % meshes;
+            float depth = float(random() % 10000) / 10000.0f;
+
+            DX11::DrawItem& item = items[i];
+            item.inputLayout = FakeHandle<ID3D11InputLayout>(shader);
+            item.vertexShader = FakeHandle<ID3D11VertexShader>(shader);
+            item.pixelShader = FakeHandle<ID3D11PixelShader>(shader);
+            item.vertexBuffer = FakeHandle<ID3D11Buffer>(mesh * 2);
+            item.stride = 16;
+            item.indexBuffer = FakeHandle<ID3D11Buffer>(mesh * 2 + 1);
+            item.indexCount = 3 * (1 + mesh % 500);
+            item.constants = materials[material];
+
+            keys[i] = DX11::RenderQueue::Key(0, 0, shader, material, mesh, depth);
+        }
+    }
+
+    /****************************************************************************/
+    /*!
+    \brief
+      Print one playback's counts
+
+    \param label
+      What was played back
+
+    \param stats
+      The recorder's counts for it
+    */
+    /****************************************************************************/
+    static void PrintStats(const char* label, const DX11::CommandStats& stats)
+    {
+        std::cout << "  " << label << ": " << stats.draws << " draws, "
+            << stats.instances << " instances, "
+            << stats.stateChanges << " state changes, "
+            << stats.commands << " commands, "
+            << stats.cpuMilliseconds << " ms" << std::endl;
+    }
+
+    /****************************************************************************/
+    /*!
+    \brief
+      Nearest box along a ray by testing every box, to check the BVH against
+
+    \param boxes
+      Every object's box
+
+    \param ray
+      Ray to trace
+
+    \return
+      The nearest hit
+    */
+    /****************************************************************************/
+    static DX11::RayHit BruteForceRaycast(const std::vector<DX11::Aabb>& boxes, const DX11::Ray& ray)
+    {
+        const float origin[3] = { ray.origin.x, ray.origin.y, ray.origin.z };
+        const float inverse[3] = { 1.0f / ray.direction.x, 1.0f / ray.direction.y, 1.0f / ray.direction.z };
+
+        DX11::RayHit hit;
+        float best = ray.maxDistance;
+        for (uint32_t object = 0; object < uint32_t(boxes.size()); ++object)
+        {
+            float nearest = 0.0f;
+            float farthest = best;
+            for (uint32_t axis = 0; axis < 3; ++axis)
+            {
+                float t0 = (boxes[object].min[axis] - origin[axis]) * inverse[axis];
+                float t1 = (boxes[object].max[axis] - origin[axis]) * inverse[axis];
+                if (t0 > t1)
+                {
+                    std::swap(t0, t1);
+                }
+                nearest = std::max(nearest, t0);
+                farthest = std::min(farthest, t1);
+            }
+            if (nearest <= farthest && (nearest < best || hit.object == 0xffffffff))
+            {
+                best = nearest;
+                hit.object = object;
+                hit.distance = nearest;
+            }
+        }
+        return hit;
+    }
+
+    /****************************************************************************/
+    /*!
+    \brief
+      Distance from a point to the closest point of a triangle, after
+      Ericson's Real-Time Collision Detection 5.1.5
+
+    \param p
+      The point
+
+    \param a, b, c
+      The triangle
+
+    \return
+      The distance
+    */
+    /****************************************************************************/
+    static float PointTriangleDistance(DirectX::FXMVECTOR p, DirectX::FXMVECTOR a, DirectX::FXMVECTOR b, DirectX::GXMVECTOR c)
+    {
+        using namespace DirectX;
+
+        const XMVECTOR ab = XMVectorSubtract(b, a);
+        const XMVECTOR ac = XMVectorSubtract(c, a);
+        const XMVECTOR ap = XMVectorSubtract(p, a);
+        const float d1 = XMVectorGetX(XMVector3Dot(ab, ap));
+        const float d2 = XMVectorGetX(XMVector3Dot(ac, ap));
+
+        XMVECTOR closest;
+        const XMVECTOR bp = XMVectorSubtract(p, b);
+        const float d3 = XMVectorGetX(XMVector3Dot(ab, bp));
+        const float d4 = XMVectorGetX(XMVector3Dot(ac, bp));
+        const XMVECTOR cp = XMVectorSubtract(p, c);
+        const float d5 = XMVectorGetX(XMVector3Dot(ab, cp));
+        const float d6 = XMVectorGetX(XMVector3Dot(ac, cp));
+        const float va = d3 * d6 - d5 * d4;
+        const float vb = d5 * d2 - d1 * d6;
+        const float vc = d1 * d4 - d3 * d2;
+
+        if (d1 <= 0.0f && d2 <= 0.0f)
+        {
+            closest = a;
+        }
+        else if (d3 >= 0.0f && d4 <= d3)
+        {
+            closest = b;
+        }
+        else if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+        {
+            closest = XMVectorAdd(a, XMVectorScale(ab, d1 / (d1 - d3)));
+        }
+        else if (d6 >= 0.0f && d5 <= d6)
+        {
+            closest = c;
+        }
+        else if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+        {
+            closest = XMVectorAdd(a, XMVectorScale(ac, d2 / (d2 - d6)));
+        }
+        else if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f)
+        {
+            closest = XMVectorAdd(b, XMVectorScale(XMVectorSubtract(c, b), (d4 - d3) / ((d4 - d3) + (d5 - d6))));
+        }
+        else
+        {
+            const float denominator = 1.0f / (va + vb + vc);
+            closest = XMVectorAdd(a, XMVectorAdd(XMVectorScale(ab, vb * denominator), XMVectorScale(ac, vc * denominator)));
+        }
+
+        return XMVectorGetX(XMVector3Length(XMVectorSubtract(p, closest)));
+    }
+
+    /****************************************************************************/
+    /*!
+    \brief
+      Closed sphere with bumps on it, or an open heightfield with the same
+      bumps when open is set. Rows wrap around the sphere and end in a
+      single vertex at each pole so it has no seams.
+
+    \param segments
+      Columns, there are half as many rows
+
+    \param open
+      Build the heightfield instead
+
+    \param positions
+      Receives the vertices
+
+    \param indices
+      Receives the triangle list
+    */
+    /****************************************************************************/
+    static void BumpySurface(uint32_t segments, bool open, std::vector<DirectX::XMFLOAT3>& positions, std::vector<uint32_t>& indices)
+    {
+        const uint32_t rows = segments / 2;
+        const uint32_t columns = open ? segments + 1 : segments;
+        positions.clear();
+        indices.clear();
+
+        const auto bump = [](float u, float v)
+        {
+            return 0.03f * std::sin(u * 40.0f) * std::sin(v * 23.0f) + 0.01f * std::sin(u * 131.0f + v * 97.0f);
+        };
+
+        // the sphere skips the pole rows, they are the first and last vertex instead
+        const uint32_t firstRow = open ? 0 : 1;
+        const uint32_t lastRow = open ? rows : rows - 1;
+        if (!open)
+        {
+            positions.push_back(DirectX::XMFLOAT3(0.0f, 1.0f, 0.0f));
+        }
+        for (uint32_t row = firstRow; row <= lastRow; ++row)
+        {
+            const float v = float(row) / rows;
+            for (uint32_t column = 0; column < columns; ++column)
+            {
+                const float u = float(column) / segments;
+                if (open)
+                {
+                    positions.push_back(DirectX::XMFLOAT3(u * 2.0f - 1.0f, bump(u, v) * 4.0f, v - 0.5f));
+                }
+                else
+                {
+                    const float theta = v * DirectX::XM_PI;
+                    const float phi = u * 2.0f * DirectX::XM_PI;
+                    const float radius = 1.0f + bump(u, v);
+                    positions.push_back(DirectX::XMFLOAT3(radius * std::sin(theta) * std::cos(phi), radius * std::cos(theta), radius * std::sin(theta) * std::sin(phi)));
+                }
+            }
+        }
+        if (!open)
+        {
+            positions.push_back(DirectX::XMFLOAT3(0.0f, -1.0f, 0.0f));
+        }
+
+        const uint32_t ringStart = open ? 0 : 1;
+        const uint32_t cells = open ? columns - 1 : columns;
+        for (uint32_t row = 0; row < lastRow - firstRow; ++row)
+        {
+            for (uint32_t column = 0; column < cells; ++column)
+            {
+                const uint32_t a = ringStart + row * columns + column;
+                const uint32_t b = ringStart + row * columns + (column + 1) % columns;
+                const uint32_t c = a + columns;
+                const uint32_t d = b + columns;
+                indices.insert(indices.end(), { a, b, c, b, d, c });
+            }
+        }
+
+        // fans around the poles, wound like the quads
+        if (!open)
+        {
+            const uint32_t south = uint32_t(positions.size()) - 1;
+            const uint32_t lastRing = south - columns;
+            for (uint32_t column = 0; column < columns; ++column)
+            {
+                const uint32_t next = (column + 1) % columns;
+                indices.insert(indices.end(), { 0, 1 + next, 1 + column });
+                indices.insert(indices.end(), { lastRing + column, lastRing + next, south });
+            }
+        }
+    }
+}
+
+/*============================================================================*\
+|| -------------------------- PUBLIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Run a benchmark by name
+
+\param name
+  Which benchmark, "queue", "instancing", "deferred", "cull", "bvh",
+  "occlusion", "lod", "meshlets", "scene", "jobs", "frames",
+  "allocations", "ring", "vertices", "indices", "import" or "log"
+
+\param count
+  Problem size, 0 for the benchmark's default
+
+\return
+  False if there is no benchmark with that name
+*/
+/****************************************************************************/
+bool DX11::Benchmark::Run(const std::string& name, uint32_t count)
+{
+    if (name == "queue")
+    {
+        DX11::Benchmark::RenderQueue(count ? count : 100000);
+        return true;
+    }
+    if (name == "instancing")
+    {
+        DX11::Benchmark::Instancing(count ? count : 100000);
+        return true;
+    }
+    if (name == "deferred")
+    {
+        DX11::Benchmark::DeferredRecording(count ? count : 100000);
+        return true;
+    }
+    if (name == "cull")
+    {
+        DX11::Benchmark::Culling(count);
+        return true;
+    }
+    if (name == "bvh")
+    {
+        DX11::Benchmark::Hierarchy(count ? count : 100000);
+        return true;
+    }
+    if (name == "occlusion")
+    {
+        DX11::Benchmark::Occlusion(count ? count : 100000);
+        return true;
+    }
+    if (name == "lod")
+    {
+        DX11::Benchmark::Simplification(count ? count : 256);
+        return true;
+    }
+    if (name == "meshlets")
+    {
+        DX11::Benchmark::Clustering(count ? count : 512);
+        return true;
+    }
+    if (name == "scene")
+    {
+        DX11::Benchmark::Transforms(count ? count : 100000);
+        return true;
+    }
+    if (name == "jobs")
+    {
+        DX11::Benchmark::Jobs(count ? count : 100000);
+        return true;
+    }
+    if (name == "frames")
+    {
+        DX11::Benchmark::Pipelining(count ? count : 200);
+        return true;
+    }
+    if (name == "allocations")
+    {
+        DX11::Benchmark::Allocations(count ? count : 600);
+        return true;
+    }
+    if (name == "ring")
+    {
+        DX11::Benchmark::RingAllocation(count ? count : 5000);
+        return true;
+    }
+    if (name == "vertices")
+    {
+        DX11::Benchmark::VertexEncoding(count ? count : 1000000);
+        return true;
+    }
+    if (name == "indices")
+    {
+        DX11::Benchmark::IndexPacking(count ? count : 1000000);
+        return true;
+    }
+    if (name == "import")
+    {
+        DX11::Benchmark::Import(count ? count : 10000000);
+        return true;
+    }
+    if (name == "log")
+    {
+        DX11::Benchmark::Logging(count ? count : 1000000);
+        return true;
+    }
+
+    return false;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Submit count random draws spread over 16 shaders, 256 materials and
+  1024 meshes, then play them back in submit order and in key order
+  against a recording context and compare the binds.
+
+\param count
+  Number of draws
+*/
+/****************************************************************************/
+void DX11::Benchmark::RenderQueue(uint32_t count)
+{
+    const uint32_t SHADERS = 16;
+    const uint32_t MATERIALS = 256;
+    const uint32_t MESHES = 1024;
+    const uint32_t ITERATIONS = 10;
+
+    std::shared_ptr<DX11::RecordingCommandContext> recorder = std::make_shared<DX11::RecordingCommandContext>();
+    DX11::Device device(recorder);
+
+    // one constant slice per material, like a material's parameters
+    DX11::ConstantRing ring(device, MATERIALS * DX11::ConstantRing::SLICE_ALIGNMENT);
+    std::vector<DX11::ConstantRing::Slice> materials(MATERIALS);
+    ring.Begin(device);
+    for (DX11::ConstantRing::Slice& slice : materials)
+    {
+        slice = ring.Allocate(device, 64);
+    }
+    ring.End(device);
+
+    // the same draws every iteration
+    std::vector<uint64_t> keys;
+    std::vector<DX11::DrawItem> items;
+    RandomDraws(count, SHADERS, MESHES, materials, keys, items);
+
+    DX11::InstanceBuffer instances(device);
+    DX11::RenderQueue queue;
+    double submitMs = 0.0;
+    double sortMs = 0.0;
+    DX11::CommandStats unsorted;
+    DX11::CommandStats sorted;
+
+    for (uint32_t iteration = 0; iteration < ITERATIONS; ++iteration)
+    {
+        Clock::time_point start = Clock::now();
+        queue.Clear();
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            queue.Submit(keys[i], items[i]);
+        }
+        submitMs += Milliseconds(start);
+
+        recorder->BeginFrame();
+        queue.Execute(device, ring, instances);
+        recorder->EndFrame();
+        unsorted = recorder->Stats();
+
+        start = Clock::now();
+        queue.Sort();
+        sortMs += Milliseconds(start);
+
+        recorder->BeginFrame();
+        queue.Execute(device, ring, instances);
+        recorder->EndFrame();
+        sorted = recorder->Stats();
+    }
+
+    std::cout << "RenderQueue: " << count << " draws, " << SHADERS << " shaders, "
+        << MATERIALS << " materials, " << MESHES << " meshes" << std::endl;
+    std::cout << "  submit " << submitMs / ITERATIONS << " ms, sort " << sortMs / ITERATIONS << " ms" << std::endl;
+    PrintStats("submit order", unsorted);
+    PrintStats("key order", sorted);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Submit count copies of 64 meshes under 16 materials, each with its own
+  transform, and play them back sorted once with per-draw world constants
+  and once through an instanced shader that merges the copies.
+
+\param count
+  Number of objects
+*/
+/****************************************************************************/
+void DX11::Benchmark::Instancing(uint32_t count)
+{
+    const uint32_t MATERIALS = 16;
+    const uint32_t MESHES = 64;
+    const uint32_t ITERATIONS = 10;
+
+    std::shared_ptr<DX11::RecordingCommandContext> recorder = std::make_shared<DX11::RecordingCommandContext>();
+    DX11::Device device(recorder);
+    DX11::InstanceBuffer instances(device);
+    DX11::RenderQueue queue;
+
+    // the same objects every iteration
+    std::mt19937 random(1234);
+    std::vector<uint32_t> materialOf(count);
+    std::vector<uint32_t> meshOf(count);
+    std::vector<DX11::InstanceData> transforms(count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        materialOf[i] = random() % MATERIALS;
+        meshOf[i] = random() % MESHES;
+        DirectX::XMMATRIX world = DirectX::XMMatrixTranslation(float(random() % 1000), 0.0f, float(random() % 1000));
+        DirectX::XMStoreFloat4x4(&transforms[i].world, world);
+    }
+
+    DX11::CommandStats results[2];
+    double executeMs[2] = { 0.0, 0.0 };
+
+    for (uint32_t instanced = 0; instanced < 2; ++instanced)
+    {
+        // per draw constants need a slice per object, instanced only per material
+        uint32_t slices = instanced ? MATERIALS : count;
+        DX11::ConstantRing ring(device, 2 * slices * DX11::ConstantRing::SLICE_ALIGNMENT);
+
+        for (uint32_t iteration = 0; iteration < ITERATIONS; ++iteration)
+        {
+            recorder->BeginFrame();
+
+            ring.Begin(device);
+            std::vector<DX11::ConstantRing::Slice> constants(slices);
+            for (uint32_t i = 0; i < slices; ++i)
+            {
+                constants[i] = ring.Allocate(device, uint32_t(sizeof(DirectX::XMMATRIX) * (instanced ? 2 : 3)));
+            }
+            ring.End(device);
+
+            queue.Clear();
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                DX11::DrawItem item;
+                item.inputLayout = FakeHandle<ID3D11InputLayout>(instanced);
+                item.vertexShader = FakeHandle<ID3D11VertexShader>(instanced);
+                item.pixelShader = FakeHandle<ID3D11PixelShader>(0);
+                item.vertexBuffer = FakeHandle<ID3D11Buffer>(meshOf[i] * 2);
+                item.stride = 16;
+                item.indexBuffer = FakeHandle<ID3D11Buffer>(meshOf[i] * 2 + 1);
+                item.indexCount = 3 * (100 + meshOf[i]);
+                item.constants = constants[instanced ? materialOf[i] : i];
+                item.instanced = instanced != 0;
+
+                queue.Submit(DX11::RenderQueue::Key(0, 0, instanced, materialOf[i], meshOf[i], 0.0f), item, transforms[i]);
+            }
+            queue.Sort();
+
+            Clock::time_point start = Clock::now();
+            queue.Execute(device, ring, instances);
+            executeMs[instanced] += Milliseconds(start);
+
+            ring.EndFrame(device);
+            recorder->EndFrame();
+        }
+        results[instanced] = recorder->Stats();
+    }
+
+    std::cout << "Instancing: " << count << " objects, " << MATERIALS << " materials, " << MESHES << " meshes" << std::endl;
+    std::cout << "  execute " << executeMs[0] / ITERATIONS << " ms per draw, "
+        << executeMs[1] / ITERATIONS << " ms instanced" << std::endl;
+    PrintStats("per draw", results[0]);
+    PrintStats("instanced", results[1]);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Record count sorted random draws on deferred contexts with 1, 2, 4...
+  threads up to the hardware thread count (at least 4), one slice per
+  thread, and compare the recording time against one thread on the
+  immediate context.
+
+\param count
+  Number of draws
+*/
+/****************************************************************************/
+void DX11::Benchmark::DeferredRecording(uint32_t count)
+{
+    const uint32_t SHADERS = 16;
+    const uint32_t MATERIALS = 256;
+    const uint32_t MESHES = 1024;
+    const uint32_t ITERATIONS = 20;
+
+    std::shared_ptr<DX11::RecordingCommandContext> recorder = std::make_shared<DX11::RecordingCommandContext>();
+    DX11::Device device(recorder);
+    DX11::InstanceBuffer instances(device);
+
+    DX11::ConstantRing ring(device, MATERIALS * DX11::ConstantRing::SLICE_ALIGNMENT);
+    std::vector<DX11::ConstantRing::Slice> materials(MATERIALS);
+    ring.Begin(device);
+    for (DX11::ConstantRing::Slice& slice : materials)
+    {
+        slice = ring.Allocate(device, 64);
+    }
+    ring.End(device);
+
+    std::vector<uint64_t> keys;
+    std::vector<DX11::DrawItem> items;
+    RandomDraws(count, SHADERS, MESHES, materials, keys, items);
+
+    DX11::RenderQueue queue;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        queue.Submit(keys[i], items[i]);
+    }
+    queue.Sort();
+
+    // what the renderer binds per pass, with made up handles
+    D3D11_VIEWPORT viewport = { 0.0f, 0.0f, 800.0f, 800.0f, 0.0f, 1.0f };
+    const float blendFactors[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+    std::function<void(DX11::CommandContext&)> setup = [&](DX11::CommandContext& context)
+    {
+        ID3D11RenderTargetView* target = FakeHandle<ID3D11RenderTargetView>(0);
+        context.SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+        context.SetRasterizerState(FakeHandle<ID3D11RasterizerState>(0));
+        context.SetViewports(1, &viewport);
+        context.SetBlendState(FakeHandle<ID3D11BlendState>(0), blendFactors, 0xffffffff);
+        context.SetDepthStencilState(FakeHandle<ID3D11DepthStencilState>(0), 1);
+        context.SetRenderTargets(1, &target, FakeHandle<ID3D11DepthStencilView>(0));
+    };
+
+    std::cout << "DeferredRecording: " << count << " draws, " << SHADERS << " shaders, "
+        << MATERIALS << " materials, " << MESHES << " meshes" << std::endl;
+
+    // at least 4 so the deferred path runs on small machines, oversubscribed there
+    const uint32_t maxThreads = std::max(4u, std::thread::hardware_concurrency());
+    double baseline = 0.0;
+    for (uint32_t threads = 1; threads <= maxThreads; threads *= 2)
+    {
+        DX11::WorkerPool pool(threads);
+        DX11::WorkerPoolScheduler scheduler(pool, 256);
+        DX11::DeferredRecorder deferred;
+
+        double milliseconds = 0.0;
+        for (uint32_t iteration = 0; iteration < ITERATIONS; ++iteration)
+        {
+            recorder->BeginFrame();
+            Clock::time_point start = Clock::now();
+            queue.Execute(device, ring, instances, deferred, scheduler, setup);
+            milliseconds += Milliseconds(start);
+            recorder->EndFrame();
+        }
+        milliseconds /= ITERATIONS;
+        if (threads == 1)
+        {
+            baseline = milliseconds;
+        }
+
+        const DX11::CommandStats& stats = recorder->Stats();
+        std::cout << "  " << threads << " threads, " << scheduler.Partition(count) << " slices: "
+            << milliseconds << " ms, " << baseline / milliseconds << "x, "
+            << stats.draws << " draws, " << stats.stateChanges << " state changes" << std::endl;
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Frustum cull random boxes scattered around a camera with each kernel on
+  one thread, then with the widest kernel across threads. Every run has
+  to find the same visible set as the scalar kernel.
+
+\param count
+  Number of objects, 0 for 10k, 100k and 1M
+*/
+/****************************************************************************/
+void DX11::Benchmark::Culling(uint32_t count)
+{
+    const uint32_t ITERATIONS = 20;
+    const DX11::CullKernel KERNELS[] = { DX11::CullKernel::Scalar, DX11::CullKernel::SSE, DX11::CullKernel::AVX2 };
+    const char* KERNEL_NAMES[] = { "scalar", "SSE", "AVX2" };
+
+    std::vector<uint32_t> sizes;
+    if (count)
+    {
+        sizes.push_back(count);
+    }
+    else
+    {
+        sizes = { 10000, 100000, 1000000 };
+    }
+
+    // camera at the origin looking down +z, about a sixth of the objects are in view
+    const DX11::Frustum frustum = DX11::Frustum::FromMatrix(DirectX::XMMatrixPerspectiveFovLH(DirectX::XM_PIDIV2, 1.0f, 0.1f, 1000.0f));
+
+    const uint32_t maxThreads = std::max(4u, std::thread::hardware_concurrency());
+    DX11::WorkerPool serial(1);
+    DX11::WorkerPool parallel(maxThreads);
+
+    for (uint32_t size : sizes)
+    {
+        std::mt19937 random(size);
+        std::uniform_real_distribution<float> position(-1000.0f, 1000.0f);
+        std::uniform_real_distribution<float> half(0.5f, 10.0f);
+
+        DX11::VisibilitySet set;
+        set.Reserve(size);
+        for (uint32_t i = 0; i < size; ++i)
+        {
+            const DirectX::XMFLOAT3 extent(half(random), half(random), half(random));
+            const float radius = std::sqrt(extent.x * extent.x + extent.y * extent.y + extent.z * extent.z);
+            set.Add(DirectX::XMFLOAT3(position(random), position(random), position(random)), extent, radius);
+        }
+
+        std::vector<uint32_t> expected;
+        set.SetKernel(DX11::CullKernel::Scalar);
+        set.Cull(frustum, expected, serial);
+
+        std::cout << "Culling: " << size << " objects, " << expected.size() << " visible" << std::endl;
+
+        // 1 thread per kernel, then the last supported kernel on every thread
+        std::vector<uint32_t> visible;
+        for (uint32_t run = 0; run <= 3; ++run)
+        {
+            DX11::WorkerPool& pool = run < 3 ? serial : parallel;
+            if (run < 3 && !set.SetKernel(KERNELS[run]))
+            {
+                std::cout << "  " << KERNEL_NAMES[run] << ": not supported" << std::endl;
+                continue;
+            }
+
+            double milliseconds = 0.0;
+            for (uint32_t iteration = 0; iteration < ITERATIONS; ++iteration)
+            {
+                Clock::time_point start = Clock::now();
+                set.Cull(frustum, visible, pool);
+                milliseconds += Milliseconds(start);
+            }
+            milliseconds /= ITERATIONS;
+
+            std::cout << "  " << KERNEL_NAMES[uint32_t(set.Kernel())] << ", " << pool.ThreadCount() << " threads: "
+                << milliseconds << " ms, " << size / milliseconds / 1000.0 << " M objects/s"
+                << (visible == expected ? "" : ", MISMATCH") << std::endl;
+        }
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Build a BVH over count random boxes on 1 thread and across threads,
+  refit it after small and large moves, then cull a narrow frustum through
+  it against the flat VisibilitySet and trace rays against a brute force
+  search.
+
+\param count
+  Number of objects
+*/
+/****************************************************************************/
+void DX11::Benchmark::Hierarchy(uint32_t count)
+{
+    const uint32_t ITERATIONS = 10;
+    const uint32_t RAYS = 10000;
+    const uint32_t CHECKED_RAYS = 100;
+
+    std::mt19937 random(count);
+    std::uniform_real_distribution<float> position(-1000.0f, 1000.0f);
+    std::uniform_real_distribution<float> half(0.5f, 10.0f);
+    std::uniform_real_distribution<float> jitter(-5.0f, 5.0f);
+
+    std::vector<DX11::Aabb> boxes(count);
+    for (DX11::Aabb& box : boxes)
+    {
+        const float center[3] = { position(random), position(random), position(random) };
+        for (uint32_t axis = 0; axis < 3; ++axis)
+        {
+            const float extent = half(random);
+            box.min[axis] = center[axis] - extent;
+            box.max[axis] = center[axis] + extent;
+        }
+    }
+
+    const uint32_t maxThreads = std::max(4u, std::thread::hardware_concurrency());
+    DX11::WorkerPool serial(1);
+    DX11::WorkerPool parallel(maxThreads);
+
+    std::cout << "Hierarchy: " << count << " objects" << std::endl;
+
+    DX11::Bvh bvh;
+    for (DX11::WorkerPool* pool : { &serial, &parallel })
+    {
+        double milliseconds = 0.0;
+        for (uint32_t iteration = 0; iteration < ITERATIONS; ++iteration)
+        {
+            Clock::time_point start = Clock::now();
+            bvh.Build(boxes, *pool);
+            milliseconds += Milliseconds(start);
+        }
+        std::cout << "  build, " << pool->ThreadCount() << " threads: " << milliseconds / ITERATIONS << " ms, "
+            << bvh.NodeCount() << " nodes, depth " << bvh.Depth() << ", SAH cost " << bvh.Cost() << std::endl;
+    }
+
+    // small moves every frame, refitting keeps up
+    std::vector<DX11::Aabb> moved = boxes;
+    double refitMilliseconds = 0.0;
+    uint32_t rebuilds = 0;
+    for (uint32_t iteration = 0; iteration < ITERATIONS; ++iteration)
+    {
+        for (DX11::Aabb& box : moved)
+        {
+            const float offset[3] = { jitter(random), jitter(random), jitter(random) };
+            for (uint32_t axis = 0; axis < 3; ++axis)
+            {
+                box.min[axis] += offset[axis];
+                box.max[axis] += offset[axis];
+            }
+        }
+
+        Clock::time_point start = Clock::now();
+        rebuilds += bvh.Update(moved, parallel) ? 1 : 0;
+        refitMilliseconds += Milliseconds(start);
+    }
+    std::cout << "  update after small moves: " << refitMilliseconds / ITERATIONS << " ms, cost "
+        << bvh.Cost() << " / " << bvh.BuildCost() << " at build, " << rebuilds << " rebuilds" << std::endl;
+
+    // everything jumps somewhere else, refitting leaves a bad tree
+    moved = boxes;
+    std::shuffle(moved.begin(), moved.end(), random);
+    {
+        Clock::time_point start = Clock::now();
+        bvh.Refit(moved);
+        const double milliseconds = Milliseconds(start);
+        std::cout << "  refit after shuffling: " << milliseconds << " ms, cost " << bvh.Cost() << " / " << bvh.BuildCost() << " at build" << std::endl;
+
+        bvh.Build(boxes, parallel);
+        start = Clock::now();
+        const bool rebuilt = bvh.Update(moved, parallel);
+        std::cout << "  update after shuffling: " << Milliseconds(start) << " ms, " << (rebuilt ? "rebuilt" : "refit only")
+            << ", cost " << bvh.Cost() << std::endl;
+    }
+    bvh.Build(boxes, parallel);
+
+    // same boxes in the flat set, an infinite radius so only the box counts
+    DX11::VisibilitySet set;
+    set.Reserve(count);
+    for (const DX11::Aabb& box : boxes)
+    {
+        set.Add(DirectX::XMFLOAT3((box.min[0] + box.max[0]) * 0.5f, (box.min[1] + box.max[1]) * 0.5f, (box.min[2] + box.max[2]) * 0.5f),
+            DirectX::XMFLOAT3((box.max[0] - box.min[0]) * 0.5f, (box.max[1] - box.min[1]) * 0.5f, (box.max[2] - box.min[2]) * 0.5f),
+            FLT_MAX);
+    }
+
+    const DX11::Frustum frustum = DX11::Frustum::FromMatrix(DirectX::XMMatrixPerspectiveFovLH(DirectX::XM_PIDIV4, 1.0f, 0.1f, 1000.0f));
+    std::vector<uint32_t> flatVisible;
+    std::vector<uint32_t> treeVisible;
+    double flatMilliseconds = 0.0;
+    double treeMilliseconds = 0.0;
+    for (uint32_t iteration = 0; iteration < ITERATIONS; ++iteration)
+    {
+        Clock::time_point start = Clock::now();
+        set.Cull(frustum, flatVisible, serial);
+        flatMilliseconds += Milliseconds(start);
+
+        start = Clock::now();
+        bvh.Cull(frustum, treeVisible);
+        treeMilliseconds += Milliseconds(start);
+    }
+    std::sort(treeVisible.begin(), treeVisible.end());
+    std::cout << "  cull " << treeVisible.size() << " visible: flat " << flatMilliseconds / ITERATIONS << " ms, bvh "
+        << treeMilliseconds / ITERATIONS << " ms" << (treeVisible == flatVisible ? "" : ", MISMATCH") << std::endl;
+
+    // rays from the middle of the scene in every direction
+    std::uniform_real_distribution<float> direction(-1.0f, 1.0f);
+    std::vector<DX11::Ray> rays(RAYS);
+    for (DX11::Ray& ray : rays)
+    {
+        ray.direction = DirectX::XMFLOAT3(direction(random), direction(random), direction(random));
+    }
+
+    uint32_t hits = 0;
+    uint32_t mismatches = 0;
+    Clock::time_point start = Clock::now();
+    for (const DX11::Ray& ray : rays)
+    {
+        DX11::RayHit hit;
+        hits += bvh.Raycast(ray, hit) ? 1 : 0;
+    }
+    const double rayMilliseconds = Milliseconds(start);
+    for (uint32_t i = 0; i < CHECKED_RAYS; ++i)
+    {
+        DX11::RayHit hit;
+        bvh.Raycast(rays[i], hit);
+        const DX11::RayHit expected = BruteForceRaycast(boxes, rays[i]);
+        mismatches += (hit.object == expected.object || hit.distance == expected.distance) ? 0 : 1;
+    }
+    std::cout << "  raycast: " << RAYS << " rays in " << rayMilliseconds << " ms, " << RAYS / rayMilliseconds / 1000.0
+        << " M rays/s, " << hits << " hits, " << mismatches << " of " << CHECKED_RAYS << " differ from brute force" << std::endl;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  A dense field of wall boxes in front of the camera with count small
+  objects scattered behind and between them. Frustum cull, rasterize the
+  walls on 1 thread and across threads, then test the survivors. Every
+  rejected object's center has to be behind a wall. The depth buffer is
+  written to occlusion_depth.pgm.
+
+\param count
+  Number of objects
+*/
+/****************************************************************************/
+void DX11::Benchmark::Occlusion(uint32_t count)
+{
+    const uint32_t WALLS = 256;
+    const uint32_t ITERATIONS = 20;
+
+    std::mt19937 random(count);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::uniform_real_distribution<float> side(-1.0f, 1.0f);
+
+    // camera at the origin looking down +z
+    const DirectX::XMMATRIX viewProjection = DirectX::XMMatrixPerspectiveFovLH(DirectX::XM_PIDIV4, 320.0f / 192.0f, 0.1f, 1000.0f);
+    const DX11::Frustum frustum = DX11::Frustum::FromMatrix(viewProjection);
+
+    // one unit cube, scaled into each wall
+    const DirectX::XMFLOAT3 cube[8] =
+    {
+        { 0, 0, 0 }, { 1, 0, 0 }, { 0, 1, 0 }, { 1, 1, 0 },
+        { 0, 0, 1 }, { 1, 0, 1 }, { 0, 1, 1 }, { 1, 1, 1 }
+    };
+    const uint32_t cubeIndices[36] =
+    {
+        0, 2, 1, 1, 2, 3,   4, 5, 6, 5, 7, 6,   0, 1, 4, 1, 5, 4,
+        2, 6, 3, 3, 6, 7,   0, 4, 2, 2, 4, 6,   1, 3, 5, 3, 7, 5
+    };
+
+    std::vector<DX11::Aabb> walls(WALLS);
+    std::vector<DirectX::XMFLOAT3> wallVertices(WALLS * 8);
+    for (uint32_t i = 0; i < WALLS; ++i)
+    {
+        const float z = 100.0f + 600.0f * unit(random);
+        const float width = 10.0f + 40.0f * unit(random);
+        const float height = 10.0f + 40.0f * unit(random);
+        const float x = side(random) * z * 0.6f;
+        const float y = side(random) * z * 0.35f;
+        walls[i] = DX11::Aabb(DirectX::XMFLOAT3(x - width * 0.5f, y - height * 0.5f, z), DirectX::XMFLOAT3(x + width * 0.5f, y + height * 0.5f, z + 2.0f));
+        for (uint32_t corner = 0; corner < 8; ++corner)
+        {
+            wallVertices[i * 8 + corner] = DirectX::XMFLOAT3(
+                walls[i].min[0] + cube[corner].x * (walls[i].max[0] - walls[i].min[0]),
+                walls[i].min[1] + cube[corner].y * (walls[i].max[1] - walls[i].min[1]),
+                walls[i].min[2] + cube[corner].z * (walls[i].max[2] - walls[i].min[2]));
+        }
+    }
+
+    std::vector<DirectX::XMFLOAT3> boundsMin(count);
+    std::vector<DirectX::XMFLOAT3> boundsMax(count);
+    DX11::VisibilitySet set;
+    set.Reserve(count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        const float z = 10.0f + 990.0f * unit(random);
+        const DirectX::XMFLOAT3 center(side(random) * z * 0.7f, side(random) * z * 0.45f, z);
+        const DirectX::XMFLOAT3 extent(0.5f + 2.5f * unit(random), 0.5f + 2.5f * unit(random), 0.5f + 2.5f * unit(random));
+        boundsMin[i] = DirectX::XMFLOAT3(center.x - extent.x, center.y - extent.y, center.z - extent.z);
+        boundsMax[i] = DirectX::XMFLOAT3(center.x + extent.x, center.y + extent.y, center.z + extent.z);
+        set.Add(center, extent, FLT_MAX);
+    }
+
+    const uint32_t maxThreads = std::max(4u, std::thread::hardware_concurrency());
+    DX11::WorkerPool serial(1);
+    DX11::WorkerPool parallel(maxThreads);
+    DX11::OcclusionCuller culler;
+
+    std::vector<uint32_t> inFrustum;
+    set.Cull(frustum, inFrustum, serial);
+
+    std::cout << "Occlusion: " << count << " objects, " << WALLS << " walls, " << culler.Width() << "x" << culler.Height()
+        << " depth, " << inFrustum.size() << " in the frustum" << std::endl;
+
+    const DirectX::XMMATRIX identity = DirectX::XMMatrixIdentity();
+    std::vector<uint32_t> visible;
+    for (DX11::WorkerPool* pool : { &serial, &parallel })
+    {
+        double addMilliseconds = 0.0;
+        double rasterMilliseconds = 0.0;
+        double testMilliseconds = 0.0;
+        for (uint32_t iteration = 0; iteration < ITERATIONS; ++iteration)
+        {
+            Clock::time_point start = Clock::now();
+            culler.Begin(viewProjection);
+            for (uint32_t i = 0; i < WALLS; ++i)
+            {
+                culler.AddOccluder(wallVertices.data() + i * 8, 8, cubeIndices, 36, identity);
+            }
+            addMilliseconds += Milliseconds(start);
+
+            start = Clock::now();
+            culler.Rasterize(*pool);
+            rasterMilliseconds += Milliseconds(start);
+
+            visible = inFrustum;
+            start = Clock::now();
+            culler.Cull(boundsMin, boundsMax, visible);
+            testMilliseconds += Milliseconds(start);
+        }
+
+        const DX11::OcclusionStats stats = culler.Stats();
+        std::cout << "  " << pool->ThreadCount() << " threads: setup " << addMilliseconds / ITERATIONS << " ms, raster "
+            << rasterMilliseconds / ITERATIONS << " ms, test " << testMilliseconds / ITERATIONS << " ms, "
+            << stats.triangles << " triangles, " << stats.occluded << " of " << stats.tested << " rejected" << std::endl;
+    }
+
+    // a rejected object's center must be behind some wall, when it is on screen at all
+    uint32_t checked = 0;
+    uint32_t unhidden = 0;
+    std::vector<uint32_t> rejected;
+    std::set_difference(inFrustum.begin(), inFrustum.end(), visible.begin(), visible.end(), std::back_inserter(rejected));
+    for (uint32_t object : rejected)
+    {
+        DX11::Ray ray;
+        ray.direction = DirectX::XMFLOAT3((boundsMin[object].x + boundsMax[object].x) * 0.5f,
+            (boundsMin[object].y + boundsMax[object].y) * 0.5f, (boundsMin[object].z + boundsMax[object].z) * 0.5f);
+        ray.maxDistance = 1.0f;
+
+        bool onScreen = true;
+        for (const DirectX::XMFLOAT4& plane : frustum.planes)
+        {
+            onScreen = onScreen && ray.direction.x * plane.x + ray.direction.y * plane.y + ray.direction.z * plane.z + plane.w >= 0.0f;
+        }
+        if (onScreen)
+        {
+            ++checked;
+            unhidden += BruteForceRaycast(walls, ray).object == 0xffffffff ? 1 : 0;
+        }
+    }
+    std::cout << "  " << unhidden << " of " << checked << " rejected objects have their center in view" << std::endl;
+
+    if (culler.SaveDepthImage("occlusion_depth.pgm"))
+    {
+        std::cout << "  depth buffer written to occlusion_depth.pgm" << std::endl;
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Build the LOD chain of a bumpy sphere and of an open heightfield, then
+  measure how far a sample of the original vertices ends up from each
+  level against the error the level reports. Finally build the chains of
+  several surfaces at once on 1 thread and across threads, the way the
+  mesh import does one per submesh.
+
+\param count
+  Columns of the surfaces, triangles are about count * count
+*/
+/****************************************************************************/
+void DX11::Benchmark::Simplification(uint32_t count)
+{
+    const uint32_t LEVELS = 3;
+    const uint32_t SAMPLES = 500;
+    const uint32_t PARTS = 8;
+
+    std::vector<DirectX::XMFLOAT3> positions;
+    std::vector<uint32_t> indices;
+    std::vector<DX11::MeshSimplifier::Level> levels;
+
+    for (bool open : { false, true })
+    {
+        BumpySurface(count, open, positions, indices);
+
+        Clock::time_point start = Clock::now();
+        DX11::MeshSimplifier::BuildLevels(indices.data(), indices.size(), positions.data(), positions.size(), sizeof(DirectX::XMFLOAT3), 0.5f, LEVELS, levels);
+        const double milliseconds = Milliseconds(start);
+
+        std::cout << "Simplification: " << (open ? "heightfield" : "sphere") << ", " << indices.size() / 3 << " triangles, "
+            << levels.size() << " levels in " << milliseconds << " ms" << std::endl;
+
+        for (size_t l = 0; l < levels.size(); ++l)
+        {
+            const std::vector<uint32_t>& level = levels[l].indices;
+
+            // every level only moves vertices onto others, so it has to stay in range
+            bool inRange = std::all_of(level.begin(), level.end(), [&](uint32_t index) { return index < positions.size(); });
+
+            float worst = 0.0f;
+            for (uint32_t sample = 0; sample < SAMPLES; ++sample)
+            {
+                const DirectX::XMVECTOR p = DirectX::XMLoadFloat3(&positions[size_t(sample) * positions.size() / SAMPLES]);
+                float nearest = FLT_MAX;
+                for (size_t i = 0; i < level.size(); i += 3)
+                {
+                    nearest = std::min(nearest, PointTriangleDistance(p, DirectX::XMLoadFloat3(&positions[level[i]]),
+                        DirectX::XMLoadFloat3(&positions[level[i + 1]]), DirectX::XMLoadFloat3(&positions[level[i + 2]])));
+                }
+                worst = std::max(worst, nearest);
+            }
+
+            std::cout << "  LOD " << l + 1 << ": " << level.size() / 3 << " triangles, error " << levels[l].error
+                << ", furthest sampled vertex " << worst << (inRange ? "" : ", INDEX OUT OF RANGE") << std::endl;
+        }
+    }
+
+    // one chain per part, like the import does per submesh
+    std::vector<std::vector<DirectX::XMFLOAT3>> partPositions(PARTS);
+    std::vector<std::vector<uint32_t>> partIndices(PARTS);
+    std::vector<std::vector<DX11::MeshSimplifier::Level>> partLevels(PARTS);
+    for (uint32_t part = 0; part < PARTS; ++part)
+    {
+        BumpySurface(count, part % 2 == 1, partPositions[part], partIndices[part]);
+    }
+
+    const uint32_t maxThreads = std::max(4u, std::thread::hardware_concurrency());
+    DX11::WorkerPool serial(1);
+    DX11::WorkerPool parallel(maxThreads);
+    for (DX11::WorkerPool* pool : { &serial, &parallel })
+    {
+        Clock::time_point start = Clock::now();
+        pool->ParallelFor(PARTS, [&](size_t part)
+        {
+            DX11::MeshSimplifier::BuildLevels(partIndices[part].data(), partIndices[part].size(), partPositions[part].data(), partPositions[part].size(),
+                sizeof(DirectX::XMFLOAT3), 0.5f, LEVELS, partLevels[part]);
+        });
+        std::cout << "  " << PARTS << " parts, " << pool->ThreadCount() << " threads: " << Milliseconds(start) << " ms" << std::endl;
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Cluster a dense bumpy sphere into meshlets the way the mesh import does,
+  then orbit a camera around it and cull the meshlets from every view.
+  Each view is also culled with an infinite frustum so every rejected
+  meshlet was rejected for facing away, and each of those has to have
+  all of its triangles facing away too.
+
+\param count
+  Columns of the sphere, triangles are about count * count
+*/
+/****************************************************************************/
+void DX11::Benchmark::Clustering(uint32_t count)
+{
+    const uint32_t ITERATIONS = 5;
+    const uint32_t VIEWS = 64;
+
+    std::vector<DirectX::XMFLOAT3> positions;
+    std::vector<uint32_t> indices;
+    BumpySurface(count, false, positions, indices);
+    DX11::MeshOptimizer::OptimizeVertexCache(indices.data(), indices.size(), positions.size());
+    const DX11::MeshOptimizer::VertexCacheStats before = DX11::MeshOptimizer::AnalyzeVertexCache(indices.data(), indices.size(), positions.size());
+
+    // clustering reorders in place, start every run from the same order
+    std::vector<uint32_t> clustered;
+    std::vector<DX11::Meshlet> meshlets;
+    double milliseconds = 0.0;
+    for (uint32_t iteration = 0; iteration < ITERATIONS; ++iteration)
+    {
+        clustered = indices;
+        Clock::time_point start = Clock::now();
+        DX11::Meshlets::Build(clustered.data(), clustered.size(), positions.data(), positions.size(), sizeof(DirectX::XMFLOAT3), meshlets);
+        milliseconds += Milliseconds(start);
+    }
+    milliseconds /= ITERATIONS;
+
+    // what clustering alone leaves of the cache order, then reordered inside each meshlet as the importer does
+    const DX11::MeshOptimizer::VertexCacheStats clusteredCache = DX11::MeshOptimizer::AnalyzeVertexCache(clustered.data(), clustered.size(), positions.size());
+    Clock::time_point reorderStart = Clock::now();
+    DX11::Meshlets::OptimizeVertexCache(clustered.data(), positions.size(), meshlets);
+    const double reorderMilliseconds = Milliseconds(reorderStart);
+
+    // how full the meshlets are and how tight their cones
+    std::vector<uint32_t> seen(positions.size(), ~0u);
+    size_t vertices = 0;
+    uint32_t cullable = 0;
+    for (uint32_t m = 0; m < uint32_t(meshlets.size()); ++m)
+    {
+        for (uint32_t i = meshlets[m].firstIndex; i < meshlets[m].firstIndex + meshlets[m].indexCount; ++i)
+        {
+            vertices += seen[clustered[i]] != m ? 1 : 0;
+            seen[clustered[i]] = m;
+        }
+        cullable += meshlets[m].coneCutoff < 1.0f ? 1 : 0;
+    }
+    const DX11::MeshOptimizer::VertexCacheStats after = DX11::MeshOptimizer::AnalyzeVertexCache(clustered.data(), clustered.size(), positions.size());
+
+    std::cout << "Clustering: " << indices.size() / 3 << " triangles into " << meshlets.size() << " meshlets in " << milliseconds << " ms, "
+        << indices.size() / 3 / milliseconds / 1000.0 << " M triangles/s" << std::endl;
+    std::cout << "  " << double(vertices) / meshlets.size() << " vertices and " << double(indices.size() / 3) / meshlets.size()
+        << " triangles per meshlet, " << cullable << " with a cone under 90 degrees, ACMR " << before.acmr << " -> " << clusteredCache.acmr
+        << " clustered -> " << after.acmr << " reordered per meshlet in " << reorderMilliseconds << " ms" << std::endl;
+
+    // orbit close in, looking off to the side so much of the sphere is off screen
+    const DirectX::XMMATRIX projection = DirectX::XMMatrixPerspectiveFovLH(DirectX::XM_PIDIV4, 16.0f / 9.0f, 0.1f, 100.0f);
+    DX11::Frustum everywhere;
+    for (DirectX::XMFLOAT4& plane : everywhere.planes)
+    {
+        plane = DirectX::XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f);
+    }
+
+    DX11::MeshletCuller culler;
+    DX11::MeshletCuller backfaceCuller;
+    std::vector<DX11::IndexRange> ranges;
+    std::vector<uint8_t> drawn(clustered.size() / 3);
+    uint32_t wrong = 0;
+    double cullMilliseconds = 0.0;
+    for (uint32_t view = 0; view < VIEWS; ++view)
+    {
+        const float angle = 2.0f * DirectX::XM_PI * float(view) / VIEWS;
+        const DirectX::XMFLOAT3 camera(1.5f * std::cos(angle), 0.4f * std::sin(angle * 3.0f), 1.5f * std::sin(angle));
+        const DirectX::XMFLOAT3 target(0.5f * std::sin(angle), 0.0f, -0.5f * std::cos(angle));
+        const DirectX::XMVECTOR eye = DirectX::XMLoadFloat3(&camera);
+        const DirectX::XMMATRIX viewMatrix = DirectX::XMMatrixLookAtLH(eye, DirectX::XMLoadFloat3(&target), DirectX::XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+        const DX11::Frustum frustum = DX11::Frustum::FromMatrix(viewMatrix * projection);
+
+        Clock::time_point start = Clock::now();
+        culler.Cull(meshlets.data(), meshlets.size(), frustum, camera, ranges);
+        cullMilliseconds += Milliseconds(start);
+
+        // facing only, whatever is not drawn must face away triangle by triangle
+        backfaceCuller.Cull(meshlets.data(), meshlets.size(), everywhere, camera, ranges);
+        std::fill(drawn.begin(), drawn.end(), 0);
+        for (const DX11::IndexRange& range : ranges)
+        {
+            std::fill(drawn.begin() + range.firstIndex / 3, drawn.begin() + (range.firstIndex + range.indexCount) / 3, 1);
+        }
+        for (size_t t = 0; t < drawn.size(); ++t)
+        {
+            if (drawn[t])
+            {
+                continue;
+            }
+            const DirectX::XMVECTOR a = DirectX::XMLoadFloat3(&positions[clustered[t * 3]]);
+            const DirectX::XMVECTOR b = DirectX::XMLoadFloat3(&positions[clustered[t * 3 + 1]]);
+            const DirectX::XMVECTOR c = DirectX::XMLoadFloat3(&positions[clustered[t * 3 + 2]]);
+            const DirectX::XMVECTOR normal = DirectX::XMVector3Cross(DirectX::XMVectorSubtract(b, a), DirectX::XMVectorSubtract(c, a));
+            wrong += DirectX::XMVectorGetX(DirectX::XMVector3Dot(normal, DirectX::XMVectorSubtract(a, eye))) < 0.0f ? 1 : 0;
+        }
+    }
+
+    const DX11::MeshletStats& stats = culler.Stats();
+    const DX11::MeshletStats& backface = backfaceCuller.Stats();
+    std::cout << "  culling " << VIEWS << " views: " << cullMilliseconds / VIEWS * 1000.0 << " us per view, per view "
+        << stats.frustumCulled / VIEWS << " outside, " << stats.backfaceCulled / VIEWS << " facing away of " << stats.tested / VIEWS
+        << ", " << 100.0 * stats.trianglesCulled / stats.triangles << "% of triangles culled in " << stats.ranges / VIEWS << " draws" << std::endl;
+    std::cout << "  facing only: " << 100.0 * backface.trianglesCulled / backface.triangles << "% of triangles culled, "
+        << wrong << " culled triangles face the camera" << std::endl;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Build a random hierarchy of count nodes, then update it with every node
+  dirty and with 1% of the nodes dirty, on 1 thread and across threads.
+  Every result is checked against a plain XMMATRIX walk of the whole tree,
+  which is also timed as the cost of recomputing everything every frame.
+
+\param count
+  Number of nodes
+*/
+/****************************************************************************/
+void DX11::Benchmark::Transforms(uint32_t count)
+{
+    const uint32_t ITERATIONS = 10;
+    const uint32_t ROOTS = 16;
+
+    std::mt19937 random(count);
+    std::uniform_real_distribution<float> offset(-10.0f, 10.0f);
+    std::uniform_real_distribution<float> angle(-DirectX::XM_PI, DirectX::XM_PI);
+    std::uniform_real_distribution<float> size(0.5f, 1.5f);
+
+    // created in order, so every parent comes before its children
+    std::vector<uint32_t> parents(count, uint32_t(DX11::SceneGraph::INVALID_NODE));
+    std::vector<DirectX::XMFLOAT3> translations(count);
+    std::vector<DirectX::XMFLOAT4> rotations(count);
+    std::vector<DirectX::XMFLOAT3> scales(count);
+    const DirectX::XMFLOAT3 boundsMin(-1.0f, -1.0f, -1.0f);
+    const DirectX::XMFLOAT3 boundsMax(1.0f, 1.0f, 1.0f);
+
+    DX11::SceneGraph scene;
+    scene.Reserve(count);
+    Clock::time_point start = Clock::now();
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        parents[i] = i < ROOTS ? DX11::SceneGraph::INVALID_NODE : uint32_t(random() % i);
+        translations[i] = DirectX::XMFLOAT3(offset(random), offset(random), offset(random));
+        DirectX::XMStoreFloat4(&rotations[i], DirectX::XMQuaternionRotationRollPitchYaw(angle(random), angle(random), angle(random)));
+        scales[i] = DirectX::XMFLOAT3(size(random), size(random), size(random));
+
+        const uint32_t node = scene.Create(parents[i]);
+        scene.SetTranslation(node, translations[i]);
+        scene.SetRotation(node, rotations[i]);
+        scene.SetScale(node, scales[i]);
+        scene.SetBounds(node, boundsMin, boundsMax, 1.7320508f);
+    }
+    scene.Update();
+    std::cout << "Transforms: " << count << " nodes, depth " << scene.Depth() << ", created and sorted in " << Milliseconds(start) << " ms" << std::endl;
+
+    // the whole tree, one matrix at a time
+    std::vector<DirectX::XMMATRIX> reference(count);
+    auto walk = [&]()
+    {
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            const DirectX::XMMATRIX local = DirectX::XMMatrixScaling(scales[i].x, scales[i].y, scales[i].z)
+                * DirectX::XMMatrixRotationQuaternion(DirectX::XMLoadFloat4(&rotations[i]))
+                * DirectX::XMMatrixTranslation(translations[i].x, translations[i].y, translations[i].z);
+            reference[i] = parents[i] == DX11::SceneGraph::INVALID_NODE ? local : local * reference[parents[i]];
+        }
+    };
+
+    start = Clock::now();
+    for (uint32_t iteration = 0; iteration < ITERATIONS; ++iteration)
+    {
+        walk();
+    }
+    std::cout << "  full walk, one XMMATRIX per node: " << Milliseconds(start) / ITERATIONS << " ms" << std::endl;
+
+    const uint32_t maxThreads = std::max(4u, std::thread::hardware_concurrency());
+    DX11::WorkerPool serial(1);
+    DX11::WorkerPool parallel(maxThreads);
+    for (float rate : { 1.0f, 0.01f })
+    {
+        const uint32_t dirty = std::max(1u, uint32_t(float(count) * rate));
+        for (DX11::WorkerPool* pool : { &serial, &parallel })
+        {
+            double milliseconds = 0.0;
+            size_t changed = 0;
+            for (uint32_t iteration = 0; iteration < ITERATIONS; ++iteration)
+            {
+                for (uint32_t d = 0; d < dirty; ++d)
+                {
+                    const uint32_t node = dirty == count ? d : uint32_t(random() % count);
+                    translations[node].y += 0.01f;
+                    scene.SetTranslation(node, translations[node]);
+                }
+
+                start = Clock::now();
+                changed += scene.Update(*pool);
+                milliseconds += Milliseconds(start);
+            }
+            std::cout << "  " << 100.0f * rate << "% dirty, " << pool->ThreadCount() << " threads: " << milliseconds / ITERATIONS << " ms, "
+                << changed / ITERATIONS << " nodes recomputed, " << 1e6 * milliseconds / double(changed) << " ns per node" << std::endl;
+        }
+    }
+
+    // everything has to match the plain walk
+    walk();
+    float worstMatrix = 0.0f;
+    float worstCenter = 0.0f;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        DirectX::XMFLOAT4X4 expected;
+        DirectX::XMFLOAT4X4 actual;
+        DirectX::XMStoreFloat4x4(&expected, reference[i]);
+        DirectX::XMStoreFloat4x4(&actual, scene.World(i));
+        for (uint32_t row = 0; row < 4; ++row)
+        {
+            for (uint32_t column = 0; column < 4; ++column)
+            {
+                worstMatrix = std::max(worstMatrix, std::fabs(expected.m[row][column] - actual.m[row][column]));
+            }
+        }
+
+        DirectX::XMFLOAT3 center;
+        DirectX::XMFLOAT3 extent;
+        float radius;
+        scene.WorldBounds(i, center, extent, radius);
+        worstCenter = std::max(worstCenter, std::fabs(center.x - expected.m[3][0]) + std::fabs(center.y - expected.m[3][1]) + std::fabs(center.z - expected.m[3][2]));
+    }
+    std::cout << "  largest difference from the walk: " << worstMatrix << " in a matrix, " << worstCenter << " in a bounds center" << std::endl;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Exercise the job system on pools of 1, 2, 4 and 8 threads: count items
+  of fixed work through ParallelFor, count empty jobs scheduled from
+  outside the pool and from inside a job, a recursive split that leans on
+  stealing, three stages chained by counters that check they ran in
+  order, and whether a wait picks up a long job another thread scheduled.
+
+\param count
+  Items and jobs per measurement
+*/
+/****************************************************************************/
+void DX11::Benchmark::Jobs(uint32_t count)
+{
+    const uint32_t STEPS = 256;
+    const uint64_t SUM_RANGE = 1ull << 24;
+
+    std::vector<float> results(count);
+    std::cout << "Jobs: " << count << " items, " << std::thread::hardware_concurrency() << " hardware threads" << std::endl;
+
+    double single = 0.0;
+    for (uint32_t threads : { 1u, 2u, 4u, 8u })
+    {
+        DX11::WorkerPool pool(threads);
+
+        // even items, the loop helper
+        Clock::time_point start = Clock::now();
+        pool.ParallelFor(count, [&](size_t i) { results[i] = Busy(float(i), STEPS); });
+        const double loop = Milliseconds(start);
+        single = threads == 1 ? loop : single;
+
+        // scheduling cost, from outside the pool then from a worker onto its own deque
+        DX11::JobCounter counter;
+        start = Clock::now();
+        for (uint32_t i = 0; i < count; i += 1024)
+        {
+            for (uint32_t j = i; j < std::min(i + 1024, count); ++j)
+            {
+                pool.Schedule([&results, j]() { results[j] += 1.0f; }, &counter);
+            }
+            pool.Wait(counter);
+        }
+        const double outside = Milliseconds(start);
+
+        DX11::JobCounter outer;
+        start = Clock::now();
+        pool.Schedule([&]()
+        {
+            DX11::JobCounter inner;
+            for (uint32_t i = 0; i < count; i += 1024)
+            {
+                for (uint32_t j = i; j < std::min(i + 1024, count); ++j)
+                {
+                    pool.Schedule([&results, j]() { results[j] += 1.0f; }, &inner);
+                }
+                pool.Wait(inner);
+            }
+        }, &outer);
+        pool.Wait(outer);
+        const double inside = Milliseconds(start);
+
+        // fork join all the way down
+        start = Clock::now();
+        const uint64_t sum = SplitSum(pool, 0, SUM_RANGE);
+        const double split = Milliseconds(start);
+
+        // each stage reads what the whole stage before it wrote, mirrored so it crosses slices
+        std::vector<uint32_t> stages(count, 0);
+        std::atomic<uint32_t> outOfOrder = 0;
+        DX11::JobCounter first;
+        DX11::JobCounter second;
+        DX11::JobCounter third;
+        const uint32_t slices = 64;
+        auto slice = [count, slices](uint32_t index) { return size_t(count) * index / slices; };
+        start = Clock::now();
+        for (uint32_t i = 0; i < slices; ++i)
+        {
+            pool.Schedule([&, begin = slice(i), end = slice(i + 1)]()
+            {
+                std::fill(stages.begin() + begin, stages.begin() + end, 1u);
+            }, &first);
+        }
+        for (uint32_t i = 0; i < slices; ++i)
+        {
+            pool.Schedule([&, begin = slice(i), end = slice(i + 1)]()
+            {
+                for (size_t j = begin; j < end; ++j)
+                {
+                    outOfOrder += stages[count - 1 - j] >= 1 ? 0 : 1;
+                }
+                std::fill(stages.begin() + begin, stages.begin() + end, 2u);
+            }, &second, &first);
+        }
+        for (uint32_t i = 0; i < slices; ++i)
+        {
+            pool.Schedule([&, begin = slice(i), end = slice(i + 1)]()
+            {
+                for (size_t j = begin; j < end; ++j)
+                {
+                    outOfOrder += stages[count - 1 - j] == 2 ? 0 : 1;
+                }
+            }, &third, &second);
+        }
+        pool.Wait(third);
+        const double chained = Milliseconds(start);
+
+        // a long job from another thread sits on the shared queue while this thread waits on its own
+        const uint32_t FOREIGN_STEPS = 4000000;
+        std::thread::id foreignRanOn;
+        std::thread foreign([&]()
+        {
+            DX11::JobCounter mine;
+            pool.Schedule([&]() { results[0] += Busy(1.0f, FOREIGN_STEPS); foreignRanOn = std::this_thread::get_id(); }, &mine);
+            pool.Wait(mine);
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        DX11::JobCounter own;
+        for (uint32_t i = 0; i < 64; ++i)
+        {
+            pool.Schedule([&results, i]() { results[i] += 1.0f; }, &own);
+        }
+        pool.Wait(own);
+        foreign.join();
+        const bool stolen = foreignRanOn == std::this_thread::get_id();
+
+        std::cout << "  " << threads << " threads: loop " << loop << " ms (" << single / loop << "x), schedule "
+            << 1e6 * outside / count << " ns per job from outside, " << 1e6 * inside / count << " ns from a worker, split sum "
+            << split << " ms" << (sum == SUM_RANGE * (SUM_RANGE - 1) / 2 ? "" : " WRONG") << ", 3 chained stages " << chained << " ms, "
+            << outOfOrder << " reads out of order, " << (stolen ? "ran" : "left") << " another thread's job while waiting" << std::endl;
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Run count frames with about 2 ms of preparing on the main thread and a
+  submit of about 1 ms of work plus a 2 ms blocking present, first all on
+  one thread and then through a FramePipeline with 1 to 4 frames in
+  flight, counting how often the main thread pumps while it waits.
+  Every packet carries 1024 draws tagged with its frame number, the
+  render side checks they arrive whole and in order.
+
+\param count
+  Number of frames
+*/
+/****************************************************************************/
+void DX11::Benchmark::Pipelining(uint32_t count)
+{
+    const uint32_t PREPARE_STEPS = 200000;
+    const uint32_t SUBMIT_STEPS = 100000;
+    const uint32_t DRAWS = 1024;
+    const std::chrono::milliseconds PRESENT(2);
+
+    std::atomic<float> sink = 0.0f;
+    auto prepare = [&](DX11::FramePacket& packet)
+    {
+        const float value = Busy(float(packet.frame), PREPARE_STEPS);
+        packet.draws.resize(DRAWS);
+        for (uint32_t i = 0; i < DRAWS; ++i)
+        {
+            packet.draws[i].key = (packet.frame << 32) | i;
+        }
+        sink = sink + value;
+    };
+
+    uint64_t expected = 0;
+    uint64_t broken = 0;
+    auto submit = [&](const DX11::FramePacket& packet)
+    {
+        broken += packet.frame == expected ? 0 : 1;
+        expected = packet.frame + 1;
+        for (uint32_t i = 0; i < DRAWS; ++i)
+        {
+            broken += packet.draws.size() == DRAWS && packet.draws[i].key == ((packet.frame << 32) | i) ? 0 : 1;
+        }
+        sink = sink + Busy(float(packet.frame), SUBMIT_STEPS);
+        std::this_thread::sleep_for(PRESENT);
+    };
+
+    std::cout << "Frames: " << count << " frames, " << std::thread::hardware_concurrency() << " hardware threads" << std::endl;
+
+    DX11::FramePacket serial;
+    Clock::time_point start = Clock::now();
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        serial.frame = i;
+        serial.draws.clear();
+        prepare(serial);
+        submit(serial);
+    }
+    const double single = Milliseconds(start);
+    std::cout << "  serial: " << single / count << " ms per frame, " << broken << " packets broken" << std::endl;
+
+    for (uint32_t framesInFlight = 1; framesInFlight <= DX11::FramePipeline::MAX_FRAMES_IN_FLIGHT; ++framesInFlight)
+    {
+        expected = 0;
+        broken = 0;
+        uint32_t pumps = 0;
+        DX11::FramePipeline pipeline(framesInFlight, submit, [&pumps]() { ++pumps; });
+
+        start = Clock::now();
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            DX11::FramePacket& packet = pipeline.Begin();
+            prepare(packet);
+            pipeline.End(packet);
+        }
+        pipeline.Flush();
+        const double pipelined = Milliseconds(start);
+
+        const DX11::FramePipelineStats stats = pipeline.Stats();
+        const double frames = double(std::max<uint64_t>(stats.frames, 1));
+        std::cout << "  " << framesInFlight << " in flight: " << pipelined / count << " ms per frame (" << single / pipelined
+            << "x), latency " << stats.latencyMilliseconds / frames << " ms average " << stats.maxLatencyMilliseconds << " ms max, queued "
+            << stats.queuedMilliseconds / frames << " ms, main stalled " << stats.stallMilliseconds / frames << " ms, render idle "
+            << stats.idleMilliseconds / frames << " ms, " << pumps << " pumps while waiting, " << broken << " packets broken" << std::endl;
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Run the renderer's per frame path on a headless device: a rotating scene
+  of spheres is updated, frustum and occlusion culled, its meshlets culled
+  into a packet and the packet queued, sorted and recorded across threads.
+  After a warm up orbit every list has reached its size, then count more
+  frames must not call operator new at all. The calls are only counted
+  in builds with COUNT_ALLOCATIONS defined.
+
+\param count
+  Number of frames counted after the warm up
+*/
+/****************************************************************************/
+void DX11::Benchmark::Allocations(uint32_t count)
+{
+    const uint32_t GRID = 16;
+    const uint32_t LAYERS = 2;
+    const uint32_t WARMUP = 120;
+    const float SPACING = 3.0f;
+
+    std::shared_ptr<DX11::RecordingCommandContext> recorder = std::make_shared<DX11::RecordingCommandContext>();
+    DX11::Device device(recorder);
+    DX11::ConstantRing ring(device);
+    DX11::InstanceBuffer instances(device);
+    DX11::DeferredRecorder deferred;
+    DX11::WorkerPool pool(std::max(4u, std::thread::hardware_concurrency()));
+    DX11::WorkerPoolScheduler scheduler(pool, 256);
+    const D3D11_VIEWPORT viewport = { 0.0f, 0.0f, 800.0f, 800.0f, 0.0f, 1.0f };
+    std::function<void(DX11::CommandContext&)> setup = [&](DX11::CommandContext& context)
+    {
+        context.SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+        context.SetViewports(1, &viewport);
+    };
+
+    // one clustered sphere drawn everywhere, a coarse one occludes for it
+    std::vector<DirectX::XMFLOAT3> positions;
+    std::vector<uint32_t> indices;
+    std::vector<DX11::Meshlet> meshlets;
+    BumpySurface(64, false, positions, indices);
+    DX11::Meshlets::Build(indices.data(), indices.size(), positions.data(), positions.size(), sizeof(DirectX::XMFLOAT3), meshlets);
+    std::vector<DirectX::XMFLOAT3> occluderPositions;
+    std::vector<uint32_t> occluderIndices;
+    BumpySurface(8, false, occluderPositions, occluderIndices);
+
+    DirectX::XMFLOAT3 boundsMin(FLT_MAX, FLT_MAX, FLT_MAX);
+    DirectX::XMFLOAT3 boundsMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+    for (const DirectX::XMFLOAT3& p : positions)
+    {
+        boundsMin = DirectX::XMFLOAT3(std::min(boundsMin.x, p.x), std::min(boundsMin.y, p.y), std::min(boundsMin.z, p.z));
+        boundsMax = DirectX::XMFLOAT3(std::max(boundsMax.x, p.x), std::max(boundsMax.y, p.y), std::max(boundsMax.z, p.z));
+    }
+    const float radius = DirectX::XMVectorGetX(DirectX::XMVector3Length(DirectX::XMVectorScale(
+        DirectX::XMVectorSubtract(DirectX::XMLoadFloat3(&boundsMax), DirectX::XMLoadFloat3(&boundsMin)), 0.5f)));
+
+    DX11::DrawItem item;
+    item.vertexBuffer = FakeHandle<ID3D11Buffer>(0);
+    item.indexBuffer = FakeHandle<ID3D11Buffer>(1);
+    item.stride = sizeof(DirectX::XMFLOAT3);
+
+    // a block of spheres under a spinning root, one visibility object per sphere
+    DX11::SceneGraph scene;
+    DX11::VisibilitySet set;
+    std::vector<uint32_t> objects;
+    const uint32_t root = scene.Create();
+    for (uint32_t i = 0; i < GRID * GRID * LAYERS; ++i)
+    {
+        const uint32_t node = scene.Create(root);
+        const float half = float(GRID - 1) * 0.5f;
+        scene.SetTranslation(node, DirectX::XMFLOAT3((float(i % GRID) - half) * SPACING, float(i / (GRID * GRID)) * SPACING, (float(i / GRID % GRID) - half) * SPACING));
+        scene.SetBounds(node, boundsMin, boundsMax, radius);
+        objects.resize(node + 1, uint32_t(DX11::SceneGraph::INVALID_NODE));
+        objects[node] = set.Add(DirectX::XMFLOAT3(0, 0, 0), DirectX::XMFLOAT3(0, 0, 0), 0.0f);
+    }
+    std::vector<uint32_t> nodes(set.Size());
+    for (uint32_t node = 0; node < uint32_t(objects.size()); ++node)
+    {
+        if (objects[node] != DX11::SceneGraph::INVALID_NODE)
+        {
+            nodes[objects[node]] = node;
+        }
+    }
+
+    const DirectX::XMMATRIX projection = DirectX::XMMatrixPerspectiveFovLH(DirectX::XM_PIDIV4, 1.0f, 0.1f, 200.0f);
+    DX11::OcclusionCuller occlusion;
+    DX11::MeshletCuller meshletCuller;
+    std::vector<uint32_t> visible;
+    std::vector<DX11::IndexRange> ranges;
+    DX11::FramePacket packet;
+    DX11::RenderQueue queue;
+
+    // Prepare then Submit, as the renderer does them
+    auto frame = [&](uint32_t index)
+    {
+        // the camera orbits and the scene turns once per warm up, so the warm up sees every frame to come
+        const float angle = 2.0f * DirectX::XM_PI * float(index % WARMUP) / WARMUP;
+        const DirectX::XMVECTOR eye = DirectX::XMVectorSet(40.0f * std::cos(angle), 12.0f, 40.0f * std::sin(angle), 1.0f);
+        const DirectX::XMMATRIX view = DirectX::XMMatrixLookAtLH(eye, DirectX::XMVectorZero(), DirectX::XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+        const DirectX::XMMATRIX viewProjection = view * projection;
+
+        DirectX::XMFLOAT4 rotation;
+        DirectX::XMStoreFloat4(&rotation, DirectX::XMQuaternionRotationAxis(DirectX::XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f), -angle));
+        scene.SetRotation(root, rotation);
+        scene.Update(pool);
+        for (uint32_t node : scene.Changed())
+        {
+            if (node < objects.size() && objects[node] != DX11::SceneGraph::INVALID_NODE)
+            {
+                DirectX::XMFLOAT3 center;
+                DirectX::XMFLOAT3 extent;
+                float nodeRadius;
+                scene.WorldBounds(node, center, extent, nodeRadius);
+                set.Set(objects[node], center, extent, nodeRadius);
+            }
+        }
+
+        set.Cull(DX11::Frustum::FromMatrix(viewProjection), visible);
+        occlusion.Begin(viewProjection);
+        for (uint32_t i : visible)
+        {
+            occlusion.AddOccluder(occluderPositions.data(), uint32_t(occluderPositions.size()),
+                occluderIndices.data(), uint32_t(occluderIndices.size()), scene.World(nodes[i]));
+        }
+        occlusion.Rasterize(pool);
+        visible.erase(std::remove_if(visible.begin(), visible.end(), [&](uint32_t i)
+        {
+            return !occlusion.Visible(boundsMin, boundsMax, scene.World(nodes[i]));
+        }), visible.end());
+
+        packet.projection = projection;
+        packet.view = view;
+        packet.draws.clear();
+        for (uint32_t i : visible)
+        {
+            const DirectX::XMMATRIX world = scene.World(nodes[i]);
+            DX11::InstanceData instance;
+            DirectX::XMStoreFloat4x4(&instance.world, world);
+            DirectX::XMFLOAT3 camera;
+            DirectX::XMStoreFloat3(&camera, DirectX::XMVector3Transform(eye, DirectX::XMMatrixInverse(nullptr, world)));
+
+            meshletCuller.Cull(meshlets.data(), meshlets.size(), DX11::Frustum::FromMatrix(world * viewProjection), camera, ranges);
+            for (const DX11::IndexRange& range : ranges)
+            {
+                item.firstIndex = range.firstIndex;
+                item.indexCount = range.indexCount;
+                packet.draws.push_back({ DX11::RenderQueue::Key(0, 0, 0, 0, i, 0.0f), item, instance });
+            }
+        }
+
+        recorder->BeginFrame();
+        ring.Begin(device);
+        DX11::ConstantRing::Slice constants = ring.Allocate(device, uint32_t(sizeof(DirectX::XMMATRIX) * 2));
+        DirectX::XMMATRIX* data = static_cast<DirectX::XMMATRIX*>(constants.data);
+        data[0] = packet.projection;
+        data[1] = packet.view;
+        ring.End(device);
+
+        queue.Clear();
+        for (const DX11::FrameDraw& draw : packet.draws)
+        {
+            DX11::DrawItem queued = draw.item;
+            queued.constants = constants;
+            queue.Submit(draw.key, queued, draw.instance);
+        }
+        queue.Sort();
+        queue.Execute(device, ring, instances, deferred, scheduler, setup);
+        ring.EndFrame(device);
+        recorder->EndFrame();
+    };
+
+    for (uint32_t i = 0; i < WARMUP; ++i)
+    {
+        frame(i);
+    }
+
+#ifdef COUNT_ALLOCATIONS
+    const uint64_t before = gAllocations.load();
+#endif
+    uint64_t draws = 0;
+    uint64_t occluded = 0;
+    Clock::time_point start = Clock::now();
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        frame(WARMUP + i);
+        draws += packet.draws.size();
+        occluded += occlusion.Stats().occluded;
+    }
+    const double milliseconds = Milliseconds(start);
+
+    std::cout << "Allocations: " << count << " frames of " << set.Size() << " objects after a " << WARMUP << " frame warm up, "
+        << pool.ThreadCount() << " threads" << std::endl;
+    std::cout << "  " << milliseconds / count << " ms per frame, " << draws / count << " draws, " << occluded / count << " objects occluded, ";
+#ifdef COUNT_ALLOCATIONS
+    const uint64_t allocations = gAllocations.load() - before;
+    std::cout << allocations << " operator new calls (" << double(allocations) / count << " per frame)" << std::endl;
+#else
+    std::cout << "operator new calls not counted, build with COUNT_ALLOCATIONS (the DX11-Bench target)" << std::endl;
+#endif
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Drive a RingAllocator through count frames of random allocations with 1
+  to 3 frames waiting on their fence, retiring early when the ring fills
+  like a map that has to wait for the GPU. Every range is checked for
+  alignment and bounds, and against a map of which frame owns each
+  aligned block so no range overlaps one that is still alive.
+
+\param count
+  Number of frames
+*/
+/****************************************************************************/
+void DX11::Benchmark::RingAllocation(uint32_t count)
+{
+    const size_t CAPACITY = 64 * 1024;
+    const size_t ALIGNMENT = 256;
+    const uint32_t MAX_ALLOCATIONS = 48;
+    const uint32_t MAX_SIZE = 2048;
+    const uint32_t MAX_LATENCY = 3;
+    const uint32_t FREE = UINT32_MAX;
+
+    DX11::RingAllocator ring(CAPACITY, ALIGNMENT);
+    std::mt19937 random(count);
+
+    // owning frame of every aligned block, and the blocks each live frame owns
+    std::vector<uint32_t> owners(CAPACITY / ALIGNMENT, FREE);
+    std::vector<std::vector<std::pair<size_t, size_t>>> frames(MAX_LATENCY + 1);
+
+    uint64_t allocations = 0;
+    uint64_t refused = 0;
+    uint64_t stalls = 0;
+    uint64_t misaligned = 0;
+    uint64_t outside = 0;
+    uint64_t overlaps = 0;
+    uint64_t accounting = 0;
+    size_t peak = 0;
+
+    auto retire = [&](uint32_t frame)
+    {
+        accounting += ring.RetireFrame() ? 0 : 1;
+        for (const std::pair<size_t, size_t>& range : frames[frame % frames.size()])
+        {
+            for (size_t block = range.first / ALIGNMENT; block < (range.first + range.second) / ALIGNMENT; ++block)
+            {
+                owners[block] = FREE;
+            }
+        }
+        frames[frame % frames.size()].clear();
+    };
+
+    uint32_t oldest = 0;
+    for (uint32_t frame = 0; frame < count; ++frame)
+    {
+        const uint32_t latency = 1 + random() % MAX_LATENCY;
+        const uint32_t wanted = random() % (MAX_ALLOCATIONS + 1);
+        for (uint32_t a = 0; a < wanted; ++a)
+        {
+            const size_t size = 1 + random() % MAX_SIZE;
+            size_t offset = 0;
+            bool allocated = ring.Allocate(size, offset);
+
+            // full, wait for the oldest frame's fence and try again
+            while (!allocated && oldest < frame)
+            {
+                retire(oldest++);
+                ++stalls;
+                allocated = ring.Allocate(size, offset);
+            }
+            if (!allocated)
+            {
+                // only this frame is left in the ring, it may not refuse while empty
+                accounting += ring.Used() == 0 ? 1 : 0;
+                ++refused;
+                continue;
+            }
+            ++allocations;
+
+            const size_t aligned = (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+            misaligned += offset % ALIGNMENT == 0 ? 0 : 1;
+            if (offset + aligned > CAPACITY)
+            {
+                ++outside;
+                continue;
+            }
+            for (size_t block = offset / ALIGNMENT; block < (offset + aligned) / ALIGNMENT; ++block)
+            {
+                overlaps += owners[block] == FREE ? 0 : 1;
+                owners[block] = frame;
+            }
+            frames[frame % frames.size()].push_back({ offset, aligned });
+        }
+
+        peak = std::max(peak, ring.Used());
+        accounting += ring.Used() <= CAPACITY ? 0 : 1;
+        accounting += ring.EndFrame() ? 0 : 1;
+
+        // this frame's fence is issued, the GPU catches up to within latency frames
+        while (frame + 1 - oldest > latency)
+        {
+            retire(oldest++);
+        }
+        accounting += ring.PendingFrames() == frame + 1 - oldest ? 0 : 1;
+    }
+
+    // the same frames again without the checks, for the cost of the bookkeeping alone
+    DX11::RingAllocator timed(CAPACITY, ALIGNMENT);
+    random.seed(count);
+    uint64_t calls = 0;
+    Clock::time_point start = Clock::now();
+    for (uint32_t frame = 0, retired = 0; frame < count; ++frame)
+    {
+        const uint32_t latency = 1 + random() % MAX_LATENCY;
+        const uint32_t wanted = random() % (MAX_ALLOCATIONS + 1);
+        for (uint32_t a = 0; a < wanted; ++a)
+        {
+            const size_t size = 1 + random() % MAX_SIZE;
+            size_t offset = 0;
+            ++calls;
+            while (!timed.Allocate(size, offset) && timed.RetireFrame())
+            {
+                ++retired;
+                ++calls;
+            }
+        }
+        timed.EndFrame();
+        while (frame + 1 - retired > latency)
+        {
+            timed.RetireFrame();
+            ++retired;
+        }
+    }
+    const double milliseconds = Milliseconds(start);
+
+    std::cout << "Ring: " << count << " frames, " << CAPACITY / 1024 << " KB aligned to " << ALIGNMENT << ", "
+        << allocations << " allocations, " << 1e6 * milliseconds / double(std::max<uint64_t>(calls, 1)) << " ns per call including the random sizes, "
+        << stalls << " waits for a fence, " << refused << " refused, peak " << peak << " bytes" << std::endl;
+    std::cout << "  " << misaligned << " misaligned, " << outside << " out of bounds, " << overlaps << " overlapping a live range, "
+        << accounting << " bookkeeping errors" << std::endl;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Round trip count vertices through every vertex format with the encoders
+  the mesh import stores them with. Positions come from 16 meshes with
+  random bounds, one of them flat, and are checked against the unorm16
+  bound of half a step, extent / 65535 / 2 per axis. Normals are random
+  plus the axes, the equator diagonals and points next to the poles where
+  the octahedral fold meets itself, and are checked against an angle.
+
+\param count
+  Number of vertices
+*/
+/****************************************************************************/
+void DX11::Benchmark::VertexEncoding(uint32_t count)
+{
+    const uint32_t MESHES = 16;
+    const float MAX_NORMAL_DEGREES = 0.01f;
+
+    std::mt19937 random(count);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::uniform_real_distribution<float> corner(-1000.0f, 1000.0f);
+    std::uniform_real_distribution<float> size(0.01f, 2000.0f);
+
+    // positions per mesh, with the bounds the importer would measure for them
+    std::vector<DirectX::XMFLOAT3> positions(count);
+    std::vector<DirectX::XMFLOAT3> normals(count);
+    std::vector<uint32_t> meshes(count);
+    std::vector<std::array<float, 3>> boundsMin(MESHES, { FLT_MAX, FLT_MAX, FLT_MAX });
+    std::vector<std::array<float, 3>> boundsExtent(MESHES);
+    std::vector<std::array<float, 6>> boxes(MESHES);
+    for (uint32_t m = 0; m < MESHES; ++m)
+    {
+        for (uint32_t axis = 0; axis < 3; ++axis)
+        {
+            boxes[m][axis] = corner(random);
+            boxes[m][3 + axis] = m == 0 && axis == 1 ? 0.0f : size(random);
+        }
+    }
+
+    const DirectX::XMFLOAT3 special[] = {
+        { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 },
+        { 1, 1, 0 }, { -1, 1, 0 }, { 1, -1, 0 }, { -1, -1, 0 },
+        { 1e-4f, 1e-4f, -1 }, { -1e-4f, 1e-4f, -1 }, { 1e-4f, -1e-4f, 1 }, { 1e-3f, 0, -1 } };
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        const uint32_t m = i % MESHES;
+        meshes[i] = m;
+        float* p = &positions[i].x;
+        for (uint32_t axis = 0; axis < 3; ++axis)
+        {
+            p[axis] = boxes[m][axis] + boxes[m][3 + axis] * (unit(random) * 0.5f + 0.5f);
+            boundsMin[m][axis] = std::min(boundsMin[m][axis], p[axis]);
+        }
+
+        DirectX::XMVECTOR normal;
+        if (i < std::size(special))
+        {
+            normal = DirectX::XMLoadFloat3(&special[i]);
+        }
+        else
+        {
+            do
+            {
+                normal = DirectX::XMVectorSet(unit(random), unit(random), unit(random), 0.0f);
+            } while (DirectX::XMVectorGetX(DirectX::XMVector3LengthSq(normal)) < 1e-4f);
+        }
+        DirectX::XMStoreFloat3(&normals[i], DirectX::XMVector3Normalize(normal));
+    }
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        const float* p = &positions[i].x;
+        for (uint32_t axis = 0; axis < 3; ++axis)
+        {
+            boundsExtent[meshes[i]][axis] = std::max(boundsExtent[meshes[i]][axis], p[axis] - boundsMin[meshes[i]][axis]);
+        }
+    }
+
+    std::cout << "VertexEncoding: " << count << " vertices in " << MESHES << " meshes, normals within " << MAX_NORMAL_DEGREES << " degrees" << std::endl;
+
+    for (DX11::VertexFormat format : { DX11::VertexFormat::Full, DX11::VertexFormat::Compact, DX11::VertexFormat::Quantized })
+    {
+        const uint32_t stride = DX11::VertexStride(format);
+        std::vector<uint8_t> encoded(size_t(count) * stride);
+
+        Clock::time_point start = Clock::now();
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            DX11::EncodeVertex(format, &positions[i].x, &normals[i].x, boundsMin[meshes[i]].data(), boundsExtent[meshes[i]].data(), &encoded[size_t(i) * stride]);
+        }
+        const double encodeMilliseconds = Milliseconds(start);
+
+        std::vector<DirectX::XMFLOAT3> decodedPositions(count);
+        std::vector<DirectX::XMFLOAT3> decodedNormals(count);
+        start = Clock::now();
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            DX11::DecodeVertex(format, &encoded[size_t(i) * stride], boundsMin[meshes[i]].data(), boundsExtent[meshes[i]].data(),
+                &decodedPositions[i].x, &decodedNormals[i].x);
+        }
+        const double decodeMilliseconds = Milliseconds(start);
+
+        // worst error as a share of what each axis allows, plus float rounding of the decode
+        float worstPosition = 0.0f;
+        float worstDegrees = 0.0f;
+        uint32_t failed = 0;
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            const float* p = &positions[i].x;
+            const float* q = &decodedPositions[i].x;
+            bool bad = false;
+            for (uint32_t axis = 0; axis < 3; ++axis)
+            {
+                const float extent = boundsExtent[meshes[i]][axis];
+                const float rounding = 4.0f * FLT_EPSILON * (std::fabs(boundsMin[meshes[i]][axis]) + extent);
+                const float allowed = format == DX11::VertexFormat::Quantized ? extent / 65535.0f / 2.0f + rounding : 0.0f;
+                const float error = std::fabs(p[axis] - q[axis]);
+                bad |= error > allowed;
+                worstPosition = std::max(worstPosition, allowed > 0.0f ? error / allowed : error);
+            }
+
+            // atan2 keeps small angles exact where acos of a float dot can not go under about 0.02 degrees
+            const DirectX::XMVECTOR a = DirectX::XMLoadFloat3(&normals[i]);
+            const DirectX::XMVECTOR b = DirectX::XMLoadFloat3(&decodedNormals[i]);
+            const float sine = DirectX::XMVectorGetX(DirectX::XMVector3Length(DirectX::XMVector3Cross(a, b)));
+            const float degrees = std::atan2(sine, DirectX::XMVectorGetX(DirectX::XMVector3Dot(a, b))) * 180.0f / DirectX::XM_PI;
+            bad |= degrees > MAX_NORMAL_DEGREES;
+            worstDegrees = std::max(worstDegrees, degrees);
+            failed += bad ? 1 : 0;
+        }
+
+        const char* name = format == DX11::VertexFormat::Full ? "full" : format == DX11::VertexFormat::Compact ? "compact" : "quantized";
+        std::cout << "  " << name << ", " << stride << " bytes: encode " << 1e6 * encodeMilliseconds / count << " ns, decode "
+            << 1e6 * decodeMilliseconds / count << " ns per vertex, worst position error " << worstPosition
+            << (format == DX11::VertexFormat::Quantized ? " of the bound" : "") << ", worst normal " << worstDegrees
+            << " degrees, " << failed << " vertices out of bounds" << std::endl;
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Pack submeshes of 3, 17 and 1000 vertices, of exactly 0x10000 vertices
+  (the most a 16 bit list can index) and of one more, plus larger ones,
+  the way the mesh import packs them. Every list is widened back out of
+  the packed buffer and compared triangle by triangle with the list that
+  went in, and the regions are checked for width, alignment and overlap.
+
+\param count
+  Triangles spread over the submeshes, each gets at least enough to use
+  every one of its vertices
+*/
+/****************************************************************************/
+void DX11::Benchmark::IndexPacking(uint32_t count)
+{
+    const uint32_t ITERATIONS = 10;
+    const uint32_t VERTEX_COUNTS[] = { 3, 0xffff, 0x10000, 1000, 0x10001, 17, 200000, 0x10000 };
+    const size_t SUBMESHES = std::size(VERTEX_COUNTS);
+    const uint32_t limit = DX11::MeshOptimizer::MAX_NARROW_VERTICES;
+
+    // a strip over every vertex so the last one is indexed, then random triangles
+    std::mt19937 random(count);
+    std::vector<std::vector<uint32_t>> lists(SUBMESHES);
+    std::vector<const uint32_t*> pointers(SUBMESHES);
+    std::vector<size_t> indexCounts(SUBMESHES);
+    size_t triangles = 0;
+    for (size_t s = 0; s < SUBMESHES; ++s)
+    {
+        const uint32_t vertices = VERTEX_COUNTS[s];
+        std::vector<uint32_t>& list = lists[s];
+        for (uint32_t v = 0; v + 2 < vertices; ++v)
+        {
+            list.insert(list.end(), { v, v + 1, v + 2 });
+        }
+        while (list.size() / 3 < count / SUBMESHES)
+        {
+            list.insert(list.end(), { uint32_t(random() % vertices), uint32_t(random() % vertices), uint32_t(random() % vertices) });
+        }
+        pointers[s] = list.data();
+        indexCounts[s] = list.size();
+        triangles += list.size() / 3;
+    }
+
+    std::vector<uint8_t> packed;
+    std::vector<DX11::MeshOptimizer::PackedRange> ranges(SUBMESHES);
+    Clock::time_point start = Clock::now();
+    for (uint32_t iteration = 0; iteration < ITERATIONS; ++iteration)
+    {
+        DX11::MeshOptimizer::PackIndices(pointers.data(), indexCounts.data(), VERTEX_COUNTS, SUBMESHES, packed, ranges.data(), DX11::WorkerPool::Global());
+    }
+    const double milliseconds = Milliseconds(start) / ITERATIONS;
+
+    uint32_t narrow = 0;
+    uint32_t wrongFormat = 0;
+    uint32_t misaligned = 0;
+    uint32_t outside = 0;
+    uint32_t overlapping = 0;
+    uint64_t wrongTriangles = 0;
+    std::vector<std::pair<size_t, size_t>> spans;
+    for (size_t s = 0; s < SUBMESHES; ++s)
+    {
+        const DX11::MeshOptimizer::PackedRange& range = ranges[s];
+        const bool isNarrow = range.indexFormat == DXGI_FORMAT_R16_UINT;
+        narrow += isNarrow ? 1 : 0;
+        wrongFormat += isNarrow == (VERTEX_COUNTS[s] <= limit) ? 0 : 1;
+
+        const size_t width = isNarrow ? sizeof(uint16_t) : sizeof(uint32_t);
+        const size_t begin = range.indexOffset + size_t(range.firstIndex) * width;
+        const size_t end = begin + indexCounts[s] * width;
+        misaligned += begin % width == 0 ? 0 : 1;
+        if (end > packed.size())
+        {
+            ++outside;
+            continue;
+        }
+        spans.push_back({ begin, end });
+
+        // widen back to 32 bits as the input assembler would and compare whole triangles
+        const uint8_t* data = packed.data() + begin;
+        for (size_t t = 0; t < indexCounts[s] / 3; ++t)
+        {
+            bool same = true;
+            for (size_t corner = 0; corner < 3; ++corner)
+            {
+                const size_t i = t * 3 + corner;
+                uint32_t index;
+                if (isNarrow)
+                {
+                    uint16_t value;
+                    std::memcpy(&value, data + i * width, sizeof(value));
+                    index = value;
+                }
+                else
+                {
+                    std::memcpy(&index, data + i * width, sizeof(index));
+                }
+                same &= index == lists[s][i];
+            }
+            wrongTriangles += same ? 0 : 1;
+        }
+    }
+    std::sort(spans.begin(), spans.end());
+    for (size_t i = 1; i < spans.size(); ++i)
+    {
+        overlapping += spans[i].first < spans[i - 1].second ? 1 : 0;
+    }
+
+    std::cout << "IndexPacking: " << SUBMESHES << " submeshes, " << triangles << " triangles into " << packed.size() << " bytes ("
+        << 100.0 * packed.size() / (triangles * 3 * sizeof(uint32_t)) << "% of 32 bit) in " << milliseconds << " ms, "
+        << triangles * 3 * sizeof(uint32_t) / milliseconds / 1e6 << " GB/s read" << std::endl;
+    std::cout << "  " << narrow << " packed 16 bit, " << wrongFormat << " in the wrong width, " << misaligned << " misaligned, "
+        << outside << " out of bounds, " << overlapping << " overlapping, " << wrongTriangles << " triangles changed" << std::endl;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Convert a synthetic scene of bumpy spheres through the same path Load
+  runs after assimp has parsed a file (weld, vertex cache order, meshlets,
+  LOD chain, vertex encoding, index packing and occluders), once on pools
+  of 1, 2, 4 and so on up to the hardware threads, and compare the times.
+
+\param count
+  Triangles in the scene, spread over the submeshes
+*/
+/****************************************************************************/
+void DX11::Benchmark::Import(uint32_t count)
+{
+    const uint32_t SUBMESHES = 200;
+
+    // one sphere, copied into every submesh at its own spot so none of them weld together
+    std::vector<DirectX::XMFLOAT3> positions;
+    std::vector<uint32_t> indices;
+    BumpySurface(std::max(8u, uint32_t(std::sqrt(double(count) / SUBMESHES))), false, positions, indices);
+
+    std::vector<aiMesh*> meshes(SUBMESHES);
+    size_t triangles = 0;
+    for (uint32_t m = 0; m < SUBMESHES; ++m)
+    {
+        aiMesh* mesh = new aiMesh();
+        const aiVector3D offset(float(m % 16) * 3.0f, float(m / 16) * 3.0f, 0.0f);
+        mesh->mName = aiString("Sphere" + std::to_string(m));
+        mesh->mPrimitiveTypes = aiPrimitiveType_TRIANGLE;
+        mesh->mNumVertices = uint32_t(positions.size());
+        mesh->mVertices = new aiVector3D[positions.size()];
+        mesh->mNormals = new aiVector3D[positions.size()];
+        for (size_t v = 0; v < positions.size(); ++v)
+        {
+            const aiVector3D p(positions[v].x, positions[v].y, positions[v].z);
+            mesh->mVertices[v] = p + offset;
+            mesh->mNormals[v] = aiVector3D(p).Normalize();
+        }
+        mesh->mNumFaces = uint32_t(indices.size() / 3);
+        mesh->mFaces = new aiFace[mesh->mNumFaces];
+        for (uint32_t f = 0; f < mesh->mNumFaces; ++f)
+        {
+            mesh->mFaces[f].mNumIndices = 3;
+            mesh->mFaces[f].mIndices = new unsigned int[3] { indices[f * 3], indices[f * 3 + 1], indices[f * 3 + 2] };
+        }
+        meshes[m] = mesh;
+        triangles += mesh->mNumFaces;
+    }
+
+    std::cout << "Import: " << SUBMESHES << " submeshes, " << triangles << " triangles, "
+        << std::thread::hardware_concurrency() << " hardware threads" << std::endl;
+
+    const uint32_t maxThreads = std::max(4u, std::thread::hardware_concurrency());
+    std::vector<uint32_t> threadCounts;
+    for (uint32_t threads = 1; threads < maxThreads; threads *= 2)
+    {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(maxThreads);
+
+    double single = 0.0;
+    for (uint32_t threads : threadCounts)
+    {
+        DX11::WorkerPool pool(threads);
+        DX11::Mesh mesh;
+
+        Clock::time_point start = Clock::now();
+        mesh.Convert(meshes.data(), meshes.size(), DX11::VertexFormat::Quantized, pool);
+        const double milliseconds = Milliseconds(start);
+        single = threads == 1 ? milliseconds : single;
+
+        std::cout << "  " << threads << " threads: " << milliseconds << " ms (" << single / milliseconds << "x), "
+            << triangles / milliseconds / 1e3 << " million triangles/s, " << mesh.Submeshes().size() << " submeshes, "
+            << mesh.Meshlets().size() << " meshlets" << std::endl;
+    }
+
+    for (aiMesh* mesh : meshes)
+    {
+        delete mesh;
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Time DEBUG::log.Info over count messages of the shape the renderer logs
+  (text, integers and floats) from 1, 2, 4 and 8 threads at once, each
+  with its own ring. Reports the cost per message on the logging thread,
+  how many were dropped because a ring filled before the writer got to
+  it, and how long the writer then takes to get the rest onto disk.
+
+\param count
+  Messages per measurement, split over the threads
+*/
+/****************************************************************************/
+void DX11::Benchmark::Logging(uint32_t count)
+{
+#if LOG_LEVEL < LOG_LEVEL_INFO
+    std::cout << "Logging: Info compiles to nothing at this LOG_LEVEL, build with LOG_LEVEL_INFO to measure it" << std::endl;
+#endif
+
+    std::cout << "Logging: " << count << " messages per run" << std::endl;
+    for (uint32_t threads : { 1u, 2u, 4u, 8u })
+    {
+        DEBUG::log.Flush();
+        const uint64_t droppedBefore = DEBUG::log.Dropped();
+        std::atomic<uint64_t> written = 0;
+
+        // each thread logs its share, the first message of a thread also registers its ring
+        auto work = [&](uint32_t thread)
+        {
+            uint64_t mine = 0;
+            for (uint32_t i = thread; i < count; i += threads)
+            {
+                mine += DEBUG::log.Info("Benchmark: message", i, "thread", thread, "value", float(i) * 0.5f) ? 1 : 0;
+            }
+            written += mine;
+        };
+
+        Clock::time_point start = Clock::now();
+        std::vector<std::thread> workers;
+        for (uint32_t thread = 1; thread < threads; ++thread)
+        {
+            workers.emplace_back(work, thread);
+        }
+        work(0);
+        for (std::thread& worker : workers)
+        {
+            worker.join();
+        }
+        const double milliseconds = Milliseconds(start);
+
+        start = Clock::now();
+        DEBUG::log.Flush();
+        const double flush = Milliseconds(start);
+
+        std::cout << "  " << threads << " threads: " << 1e6 * milliseconds * threads / count << " ns per message per thread, "
+            << 1e6 * milliseconds / count << " ns per message overall, " << written << " written, "
+            << DEBUG::log.Dropped() - droppedBefore << " dropped, flush " << flush << " ms" << std::endl;
+    }
+}
@@ -17,6 +17,7 @@
 
 #include "DX11PCH.hpp"
 #include "Buffer.hpp"
+#include <atomic>
 
 /*============================================================================*\
 || --------------------------- GLOBAL VARIABLES ----------------------------- ||
@@ -26,6 +27,26 @@
 || -------------------------- STATIC FUNCTIONS ------------------------------ ||
 \*============================================================================*/
 
+namespace
+{
+    /****************************************************************************/
+    /*!
+    \brief
+      A unique handle for a buffer created on a headless device, so the
+      recorder's scratch memory and the state caches can tell buffers
+      apart. The handles are odd, so they can never be a real object.
+
+    \return
+      The handle, only ever compared and recorded
+    */
+    /****************************************************************************/
+    static ID3D11Buffer* HeadlessHandle()
+    {
+        static std::atomic<uintptr_t> next(1);
+        return reinterpret_cast<ID3D11Buffer*>(next.fetch_add(1) << 1 | 1);
+    }
+}
+
 /*============================================================================*\
 || -------------------------- PUBLIC FUNCTIONS ------------------------------ ||
 \*============================================================================*/
@@ -48,6 +69,12 @@
 DX11::Buffer::Buffer(DX11::Device device, D3D11_BUFFER_DESC desc, D3D11_SUBRESOURCE_DATA data)
 {
     pSize = desc.ByteWidth;
+    if (device.Headless())
+    {
+        pHeadless = HeadlessHandle();
+        return;
+    }
+
     if (!SUCCEEDED(device->CreateBuffer(&desc, &data, ReleaseAndGetAddressOf())))
     {
         throw std::runtime_error("DX11: CreateBuffer() failed from Buffer!\n");
@@ -75,9 +102,25 @@ DX11::Buffer::Buffer(DX11::Device device, uint32_t size, D3D11_USAGE usage)
     D3D11_BUFFER_DESC bufferDesc = {};
     bufferDesc.ByteWidth = size;
     bufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-    bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
     bufferDesc.Usage = usage;
 
+    // only dynamic buffers may be mapped for writing, staging buffers cannot be bound
+    if (usage == D3D11_USAGE_DYNAMIC)
+    {
+        bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+    }
+    else if (usage == D3D11_USAGE_STAGING)
+    {
+        bufferDesc.BindFlags = 0;
+        bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ | D3D11_CPU_ACCESS_WRITE;
+    }
+
+    if (device.Headless())
+    {
+        pHeadless = HeadlessHandle();
+        return;
+    }
+
     HRESULT result = device->CreateBuffer(&bufferDesc, nullptr, ReleaseAndGetAddressOf());
     if (!SUCCEEDED(result))
     {
@@ -85,6 +128,78 @@ DX11::Buffer::Buffer(DX11::Device device, uint32_t size, D3D11_USAGE usage)
     }
 }
 
+/****************************************************************************/
+/*!
+\brief
+  Constructor, creates a buffer with the D3D11 usage and CPU access that
+  match how often it is updated
+
+\param device
+  The ID3D11Device
+
+\param size
+  The size of the buffer
+
+\param bindFlags
+  D3D11_BIND_FLAG bits, must be 0 for Readback and Upload
+
+\param usage
+  How the contents get updated
+
+\param data
+  Initial contents, required for Immutable
+*/
+/****************************************************************************/
+DX11::Buffer::Buffer(DX11::Device device, uint32_t size, uint32_t bindFlags, DX11::BufferUsage usage, const void* data)
+{
+    pSize = size;
+    D3D11_BUFFER_DESC bufferDesc = {};
+    bufferDesc.ByteWidth = size;
+    bufferDesc.BindFlags = bindFlags;
+
+    switch (usage)
+    {
+    case DX11::BufferUsage::Immutable:
+        bufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
+        break;
+    case DX11::BufferUsage::Default:
+        bufferDesc.Usage = D3D11_USAGE_DEFAULT;
+        break;
+    case DX11::BufferUsage::Dynamic:
+        bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+        bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+        break;
+    case DX11::BufferUsage::Readback:
+        bufferDesc.Usage = D3D11_USAGE_STAGING;
+        bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+        break;
+    case DX11::BufferUsage::Upload:
+        bufferDesc.Usage = D3D11_USAGE_STAGING;
+        bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+        break;
+    }
+
+    const bool staging = usage == DX11::BufferUsage::Readback || usage == DX11::BufferUsage::Upload;
+    if ((usage == DX11::BufferUsage::Immutable && data == nullptr) || (staging && bindFlags != 0))
+    {
+        throw std::runtime_error("DX11: invalid usage from Buffer!\n");
+    }
+
+    if (device.Headless())
+    {
+        pHeadless = HeadlessHandle();
+        return;
+    }
+
+    D3D11_SUBRESOURCE_DATA resourceData = {};
+    resourceData.pSysMem = data;
+
+    if (!SUCCEEDED(device->CreateBuffer(&bufferDesc, data ? &resourceData : nullptr, ReleaseAndGetAddressOf())))
+    {
+        throw std::runtime_error("DX11: CreateBuffer() failed from Buffer!\n");
+    }
+}
+
 /****************************************************************************/
 /*!
 \brief
@@ -106,7 +221,7 @@ DX11::Buffer::Buffer(DX11::Device device, uint32_t size, D3D11_USAGE usage)
   D3D11_MAP, specifies the read and write permissions.
 */
 /****************************************************************************/
-void DX11::Buffer::Update(DX11::Device device, void* data, uint32_t offset, uint32_t size, D3D11_MAP mapType)
+void DX11::Buffer::Update(const DX11::Device& device, const void* data, uint32_t offset, uint32_t size, D3D11_MAP mapType)
 {
     Map(device, mapType);
     std::memcpy(static_cast<char*>(pData) + offset, data, size);
@@ -125,17 +240,9 @@ void DX11::Buffer::Update(DX11::Device device, void* data, uint32_t offset, uint
   D3D11_MAP, specifies the read and write permissions.
 */
 /****************************************************************************/
-void DX11::Buffer::Map(DX11::Device device, D3D11_MAP mapType)
+void DX11::Buffer::Map(const DX11::Device& device, D3D11_MAP mapType)
 {
-    D3D11_MAPPED_SUBRESOURCE mappedResource = {};
-
-    HRESULT result = device.Context()->Map(Get(), 0, mapType, 0, &mappedResource);
-    if (!SUCCEEDED(result) || mappedResource.pData == nullptr)
-    {
-        throw std::runtime_error("DX11: Map() failed from Buffer::Map!\n");
-    }
-
-    pData = mappedResource.pData;
+    pData = device.Commands().Map(Get(), mapType, pSize);
 }
 
 /****************************************************************************/
@@ -147,12 +254,27 @@ void DX11::Buffer::Map(DX11::Device device, D3D11_MAP mapType)
   The ID3D11Device
 */
 /****************************************************************************/
-void DX11::Buffer::Unmap(DX11::Device device)
+void DX11::Buffer::Unmap(const DX11::Device& device)
 {;
-    device.Context()->Unmap(Get(), 0);
+    device.Commands().Unmap(Get());
     pData = nullptr;
 }
 
+/****************************************************************************/
+/*!
+\brief
+  Get the buffer to bind, a handle that only identifies it when the
+  device is headless
+
+\return
+  The ID3D11Buffer
+*/
+/****************************************************************************/
+ID3D11Buffer* DX11::Buffer::Get() const
+{
+    return pHeadless ? pHeadless : DX11::DXPtr<ID3D11Buffer>::Get();
+}
+
 /****************************************************************************/
 /*!
 \brief
@@ -163,3 +285,14 @@ void* DX11::Buffer::Data() const
 {
 	return pData;
 }
+
+/****************************************************************************/
+/*!
+\brief
+  Get the size of the buffer in bytes
+*/
+/****************************************************************************/
+uint32_t DX11::Buffer::Size() const
+{
+    return pSize;
+}
@@ -0,0 +1,933 @@
+/****************************************************************************/
+/*!
+\file
+   Bvh.cpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Bounding volume hierarchy over world space object boxes. Built top down
+    with binned SAH, the big nodes near the root bin across the worker pool
+    and the subtrees below them build one per thread. Moving objects only
+    refit the boxes, the tree is rebuilt once refitting has made it too
+    much worse than it was when built.
+*/
+/****************************************************************************/
+
+/*============================================================================*\
+|| ------------------------------ INCLUDES ---------------------------------- ||
+\*============================================================================*/
+
+#include "DX11PCH.hpp"
+#include "Bvh.hpp"
+#include "WorkerPool.hpp"
+#include <numeric>
+
+/*============================================================================*\
+|| --------------------------- GLOBAL VARIABLES ----------------------------- ||
+\*============================================================================*/
+
+namespace
+{
+    //! SAH cost of visiting a node relative to testing one object
+    static const float TRAVERSAL_COST = 1.0f;
+
+    static const uint32_t ALL_PLANES = (1u << DX11::Frustum::PLANE_COUNT) - 1;
+    static const uint32_t NO_OBJECT = 0xffffffff;
+}
+
+/*============================================================================*\
+|| -------------------------- STATIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+namespace
+{
+    //! per axis bins of object centroids
+    struct Bins
+    {
+        DX11::Aabb bounds[3][DX11::Bvh::BIN_COUNT];
+        uint32_t counts[3][DX11::Bvh::BIN_COUNT] = {};
+    };
+
+    /****************************************************************************/
+    /*!
+    \brief
+      Grow a box to hold another box
+    */
+    /****************************************************************************/
+    static void Grow(DX11::Aabb& box, const DX11::Aabb& other)
+    {
+        for (uint32_t axis = 0; axis < 3; ++axis)
+        {
+            box.min[axis] = std::min(box.min[axis], other.min[axis]);
+            box.max[axis] = std::max(box.max[axis], other.max[axis]);
+        }
+    }
+
+    /****************************************************************************/
+    /*!
+    \brief
+      Half the surface area of a box, 0 for an empty box
+    */
+    /****************************************************************************/
+    static float HalfArea(const DX11::Aabb& box)
+    {
+        if (box.max[0] < box.min[0])
+        {
+            return 0.0f;
+        }
+
+        const float x = box.max[0] - box.min[0];
+        const float y = box.max[1] - box.min[1];
+        const float z = box.max[2] - box.min[2];
+        return x * y + y * z + z * x;
+    }
+
+    /****************************************************************************/
+    /*!
+    \brief
+      Center of a box on one axis
+    */
+    /****************************************************************************/
+    static float Centroid(const DX11::Aabb& box, uint32_t axis)
+    {
+        return (box.min[axis] + box.max[axis]) * 0.5f;
+    }
+
+    /****************************************************************************/
+    /*!
+    \brief
+      Which bin a centroid falls in
+
+    \param centroid
+      Centroid on the binned axis
+
+    \param low
+      Lowest centroid of the node on that axis
+
+    \param scale
+      BIN_COUNT over the centroid extent, 0 if they are all equal
+    */
+    /****************************************************************************/
+    static uint32_t BinIndex(float centroid, float low, float scale)
+    {
+        const float bin = (centroid - low) * scale;
+        return uint32_t(std::min(bin, float(DX11::Bvh::BIN_COUNT - 1)));
+    }
+
+    /****************************************************************************/
+    /*!
+    \brief
+      Bounds of a run of objects and of their centroids
+
+    \param objects
+      Every object's box
+
+    \param order
+      First object index of the run
+
+    \param count
+      Length of the run
+
+    \param bounds
+      Grown to hold the objects
+
+    \param centroids
+      Grown to hold their centroids
+    */
+    /****************************************************************************/
+    static void Measure(const DX11::Aabb* objects, const uint32_t* order, size_t count, DX11::Aabb& bounds, DX11::Aabb& centroids)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            const DX11::Aabb& box = objects[order[i]];
+            Grow(bounds, box);
+            for (uint32_t axis = 0; axis < 3; ++axis)
+            {
+                const float centroid = Centroid(box, axis);
+                centroids.min[axis] = std::min(centroids.min[axis], centroid);
+                centroids.max[axis] = std::max(centroids.max[axis], centroid);
+            }
+        }
+    }
+
+    /****************************************************************************/
+    /*!
+    \brief
+      Drop a run of objects into the bins of all 3 axes
+
+    \param objects
+      Every object's box
+
+    \param order
+      First object index of the run
+
+    \param count
+      Length of the run
+
+    \param centroids
+      Centroid bounds of the node being split
+
+    \param bins
+      Grown and counted
+    */
+    /****************************************************************************/
+    static void Fill(const DX11::Aabb* objects, const uint32_t* order, size_t count, const DX11::Aabb& centroids, Bins& bins)
+    {
+        float scale[3];
+        for (uint32_t axis = 0; axis < 3; ++axis)
+        {
+            const float extent = centroids.max[axis] - centroids.min[axis];
+            scale[axis] = extent > 0.0f ? float(DX11::Bvh::BIN_COUNT) / extent : 0.0f;
+        }
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            const DX11::Aabb& box = objects[order[i]];
+            for (uint32_t axis = 0; axis < 3; ++axis)
+            {
+                const uint32_t bin = BinIndex(Centroid(box, axis), centroids.min[axis], scale[axis]);
+                Grow(bins.bounds[axis][bin], box);
+                ++bins.counts[axis][bin];
+            }
+        }
+    }
+
+    /****************************************************************************/
+    /*!
+    \brief
+      Test a box against the planes still marked, clearing the planes the
+      box is fully inside so children skip them
+
+    \param frustum
+      Planes to test against
+
+    \param box
+      Box to test
+
+    \param planes
+      In: planes to test, out: planes the box crosses
+
+    \return
+      False if the box is fully outside one plane
+    */
+    /****************************************************************************/
+    static bool Overlaps(const DX11::Frustum& frustum, const DX11::Aabb& box, uint32_t& planes)
+    {
+        const float centerX = (box.min[0] + box.max[0]) * 0.5f;
+        const float centerY = (box.min[1] + box.max[1]) * 0.5f;
+        const float centerZ = (box.min[2] + box.max[2]) * 0.5f;
+        const float extentX = (box.max[0] - box.min[0]) * 0.5f;
+        const float extentY = (box.max[1] - box.min[1]) * 0.5f;
+        const float extentZ = (box.max[2] - box.min[2]) * 0.5f;
+
+        for (uint32_t p = 0; p < DX11::Frustum::PLANE_COUNT; ++p)
+        {
+            if ((planes & (1u << p)) == 0)
+            {
+                continue;
+            }
+
+            // same math as the VisibilitySet kernels
+            const DirectX::XMFLOAT4& plane = frustum.planes[p];
+            const float distance = centerX * plane.x + centerY * plane.y + centerZ * plane.z + plane.w;
+            const float reach = extentX * std::fabs(plane.x) + extentY * std::fabs(plane.y) + extentZ * std::fabs(plane.z);
+            if (distance + reach < 0.0f)
+            {
+                return false;
+            }
+            if (distance - reach >= 0.0f)
+            {
+                planes &= ~(1u << p);
+            }
+        }
+        return true;
+    }
+
+    /****************************************************************************/
+    /*!
+    \brief
+      Slab test a ray against a box
+
+    \param box
+      Box to test
+
+    \param origin
+      Ray origin
+
+    \param inverse
+      1 / ray direction per axis
+
+    \param maxDistance
+      Hits past this are ignored
+
+    \param entry
+      Distance the ray enters the box, 0 if it starts inside
+
+    \return
+      True if the ray hits the box before maxDistance
+    */
+    /****************************************************************************/
+    static bool Intersect(const DX11::Aabb& box, const float origin[3], const float inverse[3], float maxDistance, float& entry)
+    {
+        float nearest = 0.0f;
+        float farthest = maxDistance;
+        for (uint32_t axis = 0; axis < 3; ++axis)
+        {
+            float t0 = (box.min[axis] - origin[axis]) * inverse[axis];
+            float t1 = (box.max[axis] - origin[axis]) * inverse[axis];
+            if (t0 > t1)
+            {
+                std::swap(t0, t1);
+            }
+            nearest = std::max(nearest, t0);
+            farthest = std::min(farthest, t1);
+        }
+
+        entry = nearest;
+        return nearest <= farthest;
+    }
+}
+
+/*============================================================================*\
+|| -------------------------- PUBLIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Make a box from its corners
+
+\param boundsMin
+  Minimum corner
+
+\param boundsMax
+  Maximum corner
+*/
+/****************************************************************************/
+DX11::Aabb::Aabb(const DirectX::XMFLOAT3& boundsMin, const DirectX::XMFLOAT3& boundsMax)
+    : min{ boundsMin.x, boundsMin.y, boundsMin.z }, max{ boundsMax.x, boundsMax.y, boundsMax.z }
+{
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Build the tree on the global worker pool
+
+\param bounds
+  World space box of every object, the index is the object id
+*/
+/****************************************************************************/
+void DX11::Bvh::Build(const std::vector<DX11::Aabb>& bounds)
+{
+    Build(bounds, DX11::WorkerPool::Global());
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Build the tree. Nodes bigger than SUBTREE_SIZE are split one at a time
+  with their binning spread over the pool, what is left under them is
+  built as independent subtrees across the pool. The result does not
+  depend on the thread count, only the node numbering does.
+
+\param bounds
+  World space box of every object, the index is the object id
+
+\param pool
+  Threads to build on
+*/
+/****************************************************************************/
+void DX11::Bvh::Build(const std::vector<DX11::Aabb>& bounds, DX11::WorkerPool& pool)
+{
+    const uint32_t count = uint32_t(bounds.size());
+    mObjects = bounds;
+    mOrder.resize(count);
+    std::iota(mOrder.begin(), mOrder.end(), 0u);
+    mNodes.clear();
+    mDepth = 0;
+    mCost = mBuildCost = 0.0f;
+    if (count == 0)
+    {
+        return;
+    }
+
+    // a binary tree with at least one object per leaf never needs more
+    mNodes.resize(2 * size_t(count) - 1);
+    std::atomic<uint32_t> allocated(1);
+
+    std::vector<DX11::Bvh::Task> large;
+    std::vector<DX11::Bvh::Task> small;
+    const DX11::Bvh::Task root = { 0, 0, count, 0 };
+    (count > SUBTREE_SIZE ? large : small).push_back(root);
+
+    while (!large.empty())
+    {
+        std::vector<DX11::Bvh::Task> next;
+        for (const DX11::Bvh::Task& task : large)
+        {
+            DX11::Bvh::Task children[2];
+            if (Split(task, allocated, &pool, children))
+            {
+                for (const DX11::Bvh::Task& child : children)
+                {
+                    (child.count > SUBTREE_SIZE ? next : small).push_back(child);
+                }
+            }
+        }
+        large.swap(next);
+    }
+
+    pool.ParallelFor(small.size(), [&](size_t i)
+    {
+        BuildSubtree(small[i], allocated);
+    });
+    mNodes.resize(allocated);
+
+    // children are always allocated after their parent
+    std::vector<uint32_t> depths(mNodes.size(), 0);
+    for (size_t i = 0; i < mNodes.size(); ++i)
+    {
+        const uint32_t left = mNodes[i].left;
+        if (left)
+        {
+            depths[left] = depths[left + 1] = depths[i] + 1;
+            mDepth = std::max(mDepth, depths[i] + 1);
+        }
+    }
+
+    mCost = mBuildCost = ComputeCost();
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Move the objects without changing the tree, every node box is recomputed
+  from the bottom up
+
+\param bounds
+  New world space box of every object, same count as the last build
+*/
+/****************************************************************************/
+void DX11::Bvh::Refit(const std::vector<DX11::Aabb>& bounds)
+{
+    if (bounds.size() != mObjects.size())
+    {
+        throw std::runtime_error("DX11: Bvh::Refit() failed from a changed object count!\n");
+    }
+
+    mObjects = bounds;
+    for (size_t i = mNodes.size(); i-- > 0;)
+    {
+        DX11::Bvh::Node& node = mNodes[i];
+        node.bounds = DX11::Aabb();
+        if (node.left)
+        {
+            Grow(node.bounds, mNodes[node.left].bounds);
+            Grow(node.bounds, mNodes[node.left + 1].bounds);
+        }
+        else
+        {
+            for (uint32_t j = node.first; j < node.first + node.count; ++j)
+            {
+                Grow(node.bounds, mObjects[mOrder[j]]);
+            }
+        }
+    }
+
+    mCost = ComputeCost();
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Refit to the new bounds, or rebuild if the SAH cost grew past the
+  rebuild threshold or the object count changed
+
+\param bounds
+  New world space box of every object
+
+\param pool
+  Threads to rebuild on
+
+\return
+  True if the tree was rebuilt
+*/
+/****************************************************************************/
+bool DX11::Bvh::Update(const std::vector<DX11::Aabb>& bounds, DX11::WorkerPool& pool)
+{
+    if (mNodes.empty() || bounds.size() != mObjects.size())
+    {
+        Build(bounds, pool);
+        return true;
+    }
+
+    Refit(bounds);
+    if (mCost <= mBuildCost * mRebuildThreshold)
+    {
+        return false;
+    }
+
+    Build(bounds, pool);
+    return true;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Set how much worse than at build time the tree may get before Update
+  rebuilds it
+
+\param ratio
+  Refitted cost over build cost, 1.5 by default
+*/
+/****************************************************************************/
+void DX11::Bvh::SetRebuildThreshold(float ratio)
+{
+    mRebuildThreshold = ratio;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Find the objects whose box is not fully outside the frustum. A node
+  fully inside a plane stops testing that plane for everything under it,
+  a node fully inside all of them adds its objects untested.
+
+\param frustum
+  Planes to test against
+
+\param visible
+  Replaced with the ids of visible objects, in tree order
+
+\return
+  Number of visible objects
+*/
+/****************************************************************************/
+size_t DX11::Bvh::Cull(const DX11::Frustum& frustum, std::vector<uint32_t>& visible) const
+{
+    visible.clear();
+    if (mNodes.empty())
+    {
+        return 0;
+    }
+
+    struct Entry
+    {
+        uint32_t node;
+        uint32_t planes;
+    };
+
+    Entry stack[MAX_DEPTH + 1];
+    uint32_t size = 0;
+    stack[size++] = { 0, ALL_PLANES };
+    while (size)
+    {
+        const Entry entry = stack[--size];
+        const DX11::Bvh::Node& node = mNodes[entry.node];
+        uint32_t planes = entry.planes;
+        if (!Overlaps(frustum, node.bounds, planes))
+        {
+            continue;
+        }
+
+        if (planes == 0)
+        {
+            visible.insert(visible.end(), mOrder.begin() + node.first, mOrder.begin() + node.first + node.count);
+        }
+        else if (node.left)
+        {
+            stack[size++] = { node.left + 1, planes };
+            stack[size++] = { node.left, planes };
+        }
+        else
+        {
+            for (uint32_t i = node.first; i < node.first + node.count; ++i)
+            {
+                uint32_t objectPlanes = planes;
+                if (Overlaps(frustum, mObjects[mOrder[i]], objectPlanes))
+                {
+                    visible.push_back(mOrder[i]);
+                }
+            }
+        }
+    }
+    return visible.size();
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Find the nearest object along a ray, nearer children first
+
+\param ray
+  Ray to trace, the direction need not be normalized
+
+\param hit
+  The nearest object and the distance along the ray in direction lengths
+
+\param test
+  Optional exact test, called for each object whose box is hit with the
+  box entry distance. Return false to reject the object or set the exact
+  distance. Without it the box is the hit.
+
+\return
+  True if anything was hit
+*/
+/****************************************************************************/
+bool DX11::Bvh::Raycast(const DX11::Ray& ray, DX11::RayHit& hit, const std::function<bool(uint32_t, float&)>& test) const
+{
+    hit = DX11::RayHit();
+    if (mNodes.empty())
+    {
+        return false;
+    }
+
+    const float origin[3] = { ray.origin.x, ray.origin.y, ray.origin.z };
+    const float inverse[3] = { 1.0f / ray.direction.x, 1.0f / ray.direction.y, 1.0f / ray.direction.z };
+    float best = ray.maxDistance;
+
+    struct Entry
+    {
+        uint32_t node;
+        float distance;
+    };
+
+    Entry stack[MAX_DEPTH + 1];
+    uint32_t size = 0;
+    float entry = 0.0f;
+    if (!Intersect(mNodes[0].bounds, origin, inverse, best, entry))
+    {
+        return false;
+    }
+    stack[size++] = { 0, entry };
+
+    while (size)
+    {
+        const Entry current = stack[--size];
+        if (current.distance > best)
+        {
+            continue;
+        }
+
+        const DX11::Bvh::Node& node = mNodes[current.node];
+        if (node.left)
+        {
+            float nearLeft = 0.0f;
+            float nearRight = 0.0f;
+            const bool hitLeft = Intersect(mNodes[node.left].bounds, origin, inverse, best, nearLeft);
+            const bool hitRight = Intersect(mNodes[node.left + 1].bounds, origin, inverse, best, nearRight);
+
+            // push the far child first so the near one is visited first
+            if (hitLeft && hitRight)
+            {
+                if (nearLeft <= nearRight)
+                {
+                    stack[size++] = { node.left + 1, nearRight };
+                    stack[size++] = { node.left, nearLeft };
+                }
+                else
+                {
+                    stack[size++] = { node.left, nearLeft };
+                    stack[size++] = { node.left + 1, nearRight };
+                }
+            }
+            else if (hitLeft)
+            {
+                stack[size++] = { node.left, nearLeft };
+            }
+            else if (hitRight)
+            {
+                stack[size++] = { node.left + 1, nearRight };
+            }
+            continue;
+        }
+
+        for (uint32_t i = node.first; i < node.first + node.count; ++i)
+        {
+            const uint32_t object = mOrder[i];
+            float distance = 0.0f;
+            if (!Intersect(mObjects[object], origin, inverse, best, distance))
+            {
+                continue;
+            }
+            if (test && !test(object, distance))
+            {
+                continue;
+            }
+            if (distance < best || hit.object == NO_OBJECT)
+            {
+                best = distance;
+                hit.object = object;
+                hit.distance = distance;
+            }
+        }
+    }
+    return hit.object != NO_OBJECT;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the number of objects in the tree
+*/
+/****************************************************************************/
+size_t DX11::Bvh::ObjectCount() const
+{
+    return mObjects.size();
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the number of nodes, leaves included
+*/
+/****************************************************************************/
+size_t DX11::Bvh::NodeCount() const
+{
+    return mNodes.size();
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the number of levels under the root
+*/
+/****************************************************************************/
+uint32_t DX11::Bvh::Depth() const
+{
+    return mDepth;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the SAH cost of the tree as it is now, relative to the root area
+*/
+/****************************************************************************/
+float DX11::Bvh::Cost() const
+{
+    return mCost;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the SAH cost of the tree when it was last built
+*/
+/****************************************************************************/
+float DX11::Bvh::BuildCost() const
+{
+    return mBuildCost;
+}
+
+/*============================================================================*\
+|| ------------------------- PRIVATE FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Fill in a node and split its objects in two at the cheapest of the
+  BIN_COUNT candidate planes on each axis
+
+\param task
+  The node and its run of mOrder
+
+\param allocated
+  Node allocator shared by every thread building
+
+\param pool
+  Threads to bin on, null to bin on this thread
+
+\param children
+  The two halves, if split
+
+\return
+  False if the node became a leaf
+*/
+/****************************************************************************/
+bool DX11::Bvh::Split(const DX11::Bvh::Task& task, std::atomic<uint32_t>& allocated, DX11::WorkerPool* pool, DX11::Bvh::Task children[2])
+{
+    DX11::Bvh::Node& node = mNodes[task.node];
+    node.first = task.first;
+    node.count = task.count;
+    node.left = 0;
+
+    uint32_t* order = mOrder.data() + task.first;
+    const DX11::Aabb* objects = mObjects.data();
+    const size_t chunks = pool ? (size_t(task.count) + SUBTREE_SIZE - 1) / SUBTREE_SIZE : 1;
+
+    DX11::Aabb bounds;
+    DX11::Aabb centroids;
+    if (chunks > 1)
+    {
+        std::vector<DX11::Aabb> chunkBounds(chunks);
+        std::vector<DX11::Aabb> chunkCentroids(chunks);
+        pool->ParallelFor(chunks, [&](size_t chunk)
+        {
+            const size_t begin = chunk * SUBTREE_SIZE;
+            const size_t end = std::min(begin + SUBTREE_SIZE, size_t(task.count));
+            Measure(objects, order + begin, end - begin, chunkBounds[chunk], chunkCentroids[chunk]);
+        });
+        for (size_t chunk = 0; chunk < chunks; ++chunk)
+        {
+            Grow(bounds, chunkBounds[chunk]);
+            Grow(centroids, chunkCentroids[chunk]);
+        }
+    }
+    else
+    {
+        Measure(objects, order, task.count, bounds, centroids);
+    }
+    node.bounds = bounds;
+
+    if (task.count <= MAX_LEAF_SIZE || task.depth >= MAX_DEPTH)
+    {
+        return false;
+    }
+
+    Bins bins;
+    if (chunks > 1)
+    {
+        std::vector<Bins> chunkBins(chunks);
+        pool->ParallelFor(chunks, [&](size_t chunk)
+        {
+            const size_t begin = chunk * SUBTREE_SIZE;
+            const size_t end = std::min(begin + SUBTREE_SIZE, size_t(task.count));
+            Fill(objects, order + begin, end - begin, centroids, chunkBins[chunk]);
+        });
+        for (const Bins& partial : chunkBins)
+        {
+            for (uint32_t axis = 0; axis < 3; ++axis)
+            {
+                for (uint32_t bin = 0; bin < BIN_COUNT; ++bin)
+                {
+                    Grow(bins.bounds[axis][bin], partial.bounds[axis][bin]);
+                    bins.counts[axis][bin] += partial.counts[axis][bin];
+                }
+            }
+        }
+    }
+    else
+    {
+        Fill(objects, order, task.count, centroids, bins);
+    }
+
+    // sweep each axis from both ends, cost = area * objects on each side
+    float bestCost = FLT_MAX;
+    uint32_t bestAxis = 3;
+    uint32_t bestBin = 0;
+    for (uint32_t axis = 0; axis < 3; ++axis)
+    {
+        if (centroids.max[axis] <= centroids.min[axis])
+        {
+            continue;
+        }
+
+        float rightArea[BIN_COUNT];
+        uint32_t rightCount[BIN_COUNT];
+        DX11::Aabb side;
+        uint32_t sideCount = 0;
+        for (uint32_t bin = BIN_COUNT - 1; bin > 0; --bin)
+        {
+            Grow(side, bins.bounds[axis][bin]);
+            sideCount += bins.counts[axis][bin];
+            rightArea[bin] = HalfArea(side);
+            rightCount[bin] = sideCount;
+        }
+
+        side = DX11::Aabb();
+        sideCount = 0;
+        for (uint32_t bin = 0; bin + 1 < BIN_COUNT; ++bin)
+        {
+            Grow(side, bins.bounds[axis][bin]);
+            sideCount += bins.counts[axis][bin];
+            if (sideCount == 0 || rightCount[bin + 1] == 0)
+            {
+                continue;
+            }
+
+            const float cost = HalfArea(side) * float(sideCount) + rightArea[bin + 1] * float(rightCount[bin + 1]);
+            if (cost < bestCost)
+            {
+                bestCost = cost;
+                bestAxis = axis;
+                bestBin = bin;
+            }
+        }
+    }
+
+    // every centroid in one spot, any split is as good as another
+    uint32_t leftCount = task.count / 2;
+    if (bestAxis < 3)
+    {
+        const float low = centroids.min[bestAxis];
+        const float scale = float(BIN_COUNT) / (centroids.max[bestAxis] - low);
+        uint32_t* middle = std::partition(order, order + task.count, [&](uint32_t object)
+        {
+            return BinIndex(Centroid(objects[object], bestAxis), low, scale) <= bestBin;
+        });
+        leftCount = uint32_t(middle - order);
+    }
+
+    const uint32_t left = allocated.fetch_add(2);
+    node.left = left;
+    children[0] = { left, task.first, leftCount, task.depth + 1 };
+    children[1] = { left + 1, task.first + leftCount, task.count - leftCount, task.depth + 1 };
+    return true;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Build everything under a node on this thread
+
+\param task
+  Root of the subtree
+
+\param allocated
+  Node allocator shared by every thread building
+*/
+/****************************************************************************/
+void DX11::Bvh::BuildSubtree(const DX11::Bvh::Task& task, std::atomic<uint32_t>& allocated)
+{
+    std::vector<DX11::Bvh::Task> stack(1, task);
+    while (!stack.empty())
+    {
+        const DX11::Bvh::Task current = stack.back();
+        stack.pop_back();
+
+        DX11::Bvh::Task children[2];
+        if (Split(current, allocated, nullptr, children))
+        {
+            stack.push_back(children[1]);
+            stack.push_back(children[0]);
+        }
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  SAH cost of the whole tree: the area of every node times what visiting
+  it costs, over the root area
+*/
+/****************************************************************************/
+float DX11::Bvh::ComputeCost() const
+{
+    if (mNodes.empty() || HalfArea(mNodes[0].bounds) <= 0.0f)
+    {
+        return 0.0f;
+    }
+
+    double cost = 0.0;
+    for (const DX11::Bvh::Node& node : mNodes)
+    {
+        cost += double(HalfArea(node.bounds)) * (node.left ? TRAVERSAL_COST : float(node.count));
+    }
+    return float(cost / HalfArea(mNodes[0].bounds));
+}
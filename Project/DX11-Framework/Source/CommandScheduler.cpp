@@ -0,0 +1,139 @@
+/****************************************************************************/
+/*!
+\file
+   CommandScheduler.cpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Decides how a frame's draws are cut into slices for deferred recording
+    and which threads record them. Kept behind an interface so the split
+    can be stubbed out and measured without a GPU.
+*/
+/****************************************************************************/
+
+/*============================================================================*\
+|| ------------------------------ INCLUDES ---------------------------------- ||
+\*============================================================================*/
+
+#include "DX11PCH.hpp"
+#include "CommandScheduler.hpp"
+#include "WorkerPool.hpp"
+
+/*============================================================================*\
+|| --------------------------- GLOBAL VARIABLES ----------------------------- ||
+\*============================================================================*/
+
+/*============================================================================*\
+|| -------------------------- STATIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/*============================================================================*\
+|| -------------------------- PUBLIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Constructor
+
+\param slices
+  Slices to cut every frame into
+*/
+/****************************************************************************/
+DX11::InlineScheduler::InlineScheduler(uint32_t slices) :
+    mSlices(std::max(slices, 1u))
+{
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Always the slice count given at construction, never more than there
+  are draws
+
+\param drawCount
+  Draws queued this frame
+*/
+/****************************************************************************/
+uint32_t DX11::InlineScheduler::Partition(size_t drawCount) const
+{
+    return uint32_t(std::max<size_t>(1, std::min<size_t>(mSlices, drawCount)));
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Record the slices one after another on the calling thread
+
+\param sliceCount
+  Number of slices
+
+\param record
+  Records one slice
+*/
+/****************************************************************************/
+void DX11::InlineScheduler::Run(uint32_t sliceCount, const std::function<void(uint32_t)>& record)
+{
+    for (uint32_t slice = 0; slice < sliceCount; ++slice)
+    {
+        record(slice);
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Constructor
+
+\param pool
+  Threads to record on, must outlive the scheduler
+
+\param minDraws
+  Fewest draws worth a slice, below that the cost of a command list
+  outweighs what another thread saves
+*/
+/****************************************************************************/
+DX11::WorkerPoolScheduler::WorkerPoolScheduler(DX11::WorkerPool& pool, uint32_t minDraws) :
+    mPool(&pool),
+    mMinDraws(std::max(minDraws, 1u))
+{
+}
+
+/****************************************************************************/
+/*!
+\brief
+  One slice per pool thread, fewer when there are not enough draws to
+  give each at least minDraws
+
+\param drawCount
+  Draws queued this frame
+*/
+/****************************************************************************/
+uint32_t DX11::WorkerPoolScheduler::Partition(size_t drawCount) const
+{
+    size_t slices = std::min<size_t>(mPool->ThreadCount(), drawCount / mMinDraws);
+    return uint32_t(std::max<size_t>(slices, 1));
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Record the slices across the pool, the calling thread helps
+
+\param sliceCount
+  Number of slices
+
+\param record
+  Records one slice, called from any pool thread
+*/
+/****************************************************************************/
+void DX11::WorkerPoolScheduler::Run(uint32_t sliceCount, const std::function<void(uint32_t)>& record)
+{
+    mPool->ParallelFor(sliceCount, [&record](size_t slice)
+    {
+        record(uint32_t(slice));
+    });
+}
@@ -0,0 +1,403 @@
+/****************************************************************************/
+/*!
+\file
+   ConstantRing.cpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    One large dynamic constant buffer shared by every draw. Constants are
+    written into 256 byte aligned slices between Begin and End (one map,
+    NO_OVERWRITE after the first DISCARD) and bound by offset with
+    VSSetConstantBuffers1. Event queries fence each frame so the ring only
+    wraps over memory the GPU is done with.
+*/
+/****************************************************************************/
+
+/*============================================================================*\
+|| ------------------------------ INCLUDES ---------------------------------- ||
+\*============================================================================*/
+
+#include "DX11PCH.hpp"
+#include "ConstantRing.hpp"
+#include <thread>
+
+/*============================================================================*\
+|| --------------------------- GLOBAL VARIABLES ----------------------------- ||
+\*============================================================================*/
+
+/*============================================================================*\
+|| -------------------------- STATIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/*============================================================================*\
+|| -------------------------- PUBLIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Constructor, creates the ring buffer and the frame fences. Without
+  D3D11.1 offset binding the ring falls back to copying each slice into
+  a small buffer at bind time.
+
+\param device
+  The ID3D11Device
+
+\param size
+  Size of the ring, rounded up to SLICE_ALIGNMENT
+*/
+/****************************************************************************/
+DX11::ConstantRing::ConstantRing(DX11::Device device, uint32_t size)
+{
+    size = (size + SLICE_ALIGNMENT - 1) & ~(SLICE_ALIGNMENT - 1);
+    mAllocator = DX11::RingAllocator(size, SLICE_ALIGNMENT);
+
+    // headless there is no driver to ask, record the offset path
+    D3D11_FEATURE_DATA_D3D11_OPTIONS options = {};
+    if (device.Headless())
+    {
+        mOffsetting = true;
+    }
+    else if (SUCCEEDED(device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options))))
+    {
+        mOffsetting = options.ConstantBufferOffsetting && options.MapNoOverwriteOnDynamicConstantBuffer;
+    }
+
+    if (mOffsetting)
+    {
+        mBuffer = DX11::Buffer(device, size, D3D11_USAGE_DYNAMIC);
+    }
+    else
+    {
+        DEBUG::log.Info("ConstantRing: no constant buffer offsetting, copying slices at bind");
+        mShadow.resize(size);
+        mFallback = DX11::Buffer(device, MAX_SLICE_SIZE, D3D11_USAGE_DYNAMIC);
+    }
+
+    if (device.Headless())
+    {
+        return;
+    }
+
+    D3D11_QUERY_DESC queryDesc = {};
+    queryDesc.Query = D3D11_QUERY_EVENT;
+    for (DX11::Query& fence : mFences)
+    {
+        if (!SUCCEEDED(device->CreateQuery(&queryDesc, fence.ReleaseAndGetAddressOf())))
+        {
+            throw std::runtime_error("DX11: CreateQuery() failed from ConstantRing!\n");
+        }
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Map the ring for writing. The first map discards, every one after that
+  is NO_OVERWRITE and relies on the fences.
+
+\param device
+  The ID3D11Device
+*/
+/****************************************************************************/
+void DX11::ConstantRing::Begin(const DX11::Device& device)
+{
+    if (!mOffsetting)
+    {
+        mMapped = mShadow.data();
+        return;
+    }
+
+    mBuffer.Map(device, mDiscarded ? D3D11_MAP_WRITE_NO_OVERWRITE : D3D11_MAP_WRITE_DISCARD);
+    mMapped = static_cast<uint8_t*>(mBuffer.Data());
+    mDiscarded = true;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Take a slice of the ring, blocks on the oldest frame's fence if the ring
+  is full. Only valid between Begin and End.
+
+\param device
+  The ID3D11Device
+
+\param size
+  Bytes of constants, at most MAX_SLICE_SIZE
+
+\return
+  Where to write the constants and what to bind
+*/
+/****************************************************************************/
+DX11::ConstantRing::Slice DX11::ConstantRing::Allocate(const DX11::Device& device, uint32_t size)
+{
+    if (mMapped == nullptr || size > MAX_SLICE_SIZE)
+    {
+        throw std::runtime_error("DX11: invalid slice request from ConstantRing::Allocate!\n");
+    }
+
+    size_t offset = 0;
+    while (!mAllocator.Allocate(size, offset))
+    {
+        if (mAllocator.PendingFrames() == 0)
+        {
+            throw std::runtime_error("DX11: ConstantRing out of memory from Allocate!\n");
+        }
+        Retire(device, true);
+    }
+
+    Slice slice;
+    slice.data = mMapped + offset;
+    slice.firstConstant = uint32_t(offset / 16);
+    slice.constantCount = ((size + SLICE_ALIGNMENT - 1) & ~(SLICE_ALIGNMENT - 1)) / 16;
+    return slice;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Unmap the ring, slices can be bound and drawn with from here on
+
+\param device
+  The ID3D11Device
+*/
+/****************************************************************************/
+void DX11::ConstantRing::End(const DX11::Device& device)
+{
+    if (mOffsetting && mMapped != nullptr)
+    {
+        mBuffer.Unmap(device);
+    }
+    mMapped = nullptr;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Bind a slice to a vertex shader constant buffer slot
+
+\param device
+  The ID3D11Device
+
+\param slot
+  Constant buffer register
+
+\param slice
+  A slice written this frame
+*/
+/****************************************************************************/
+void DX11::ConstantRing::BindVS(const DX11::Device& device, uint32_t slot, const Slice& slice)
+{
+    Bind(device, device.Commands(), slot, slice, false);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Bind a slice to a pixel shader constant buffer slot
+
+\param device
+  The ID3D11Device
+
+\param slot
+  Constant buffer register
+
+\param slice
+  A slice written this frame
+*/
+/****************************************************************************/
+void DX11::ConstantRing::BindPS(const DX11::Device& device, uint32_t slot, const Slice& slice)
+{
+    Bind(device, device.Commands(), slot, slice, true);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Bind a slice to a vertex shader constant buffer slot on a given
+  context. Only deferred contexts when Offsetting(), the copying
+  fallback maps on the immediate context.
+
+\param device
+  The ID3D11Device
+
+\param context
+  Where to bind
+
+\param slot
+  Constant buffer register
+
+\param slice
+  A slice written this frame
+*/
+/****************************************************************************/
+void DX11::ConstantRing::BindVS(const DX11::Device& device, DX11::CommandContext& context, uint32_t slot, const Slice& slice)
+{
+    Bind(device, context, slot, slice, false);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Bind a slice to a pixel shader constant buffer slot on a given
+  context. Only deferred contexts when Offsetting(), the copying
+  fallback maps on the immediate context.
+
+\param device
+  The ID3D11Device
+
+\param context
+  Where to bind
+
+\param slot
+  Constant buffer register
+
+\param slice
+  A slice written this frame
+*/
+/****************************************************************************/
+void DX11::ConstantRing::BindPS(const DX11::Device& device, DX11::CommandContext& context, uint32_t slot, const Slice& slice)
+{
+    Bind(device, context, slot, slice, true);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Fence everything allocated this frame and free frames the GPU finished.
+  Call once a frame after Present.
+
+\param device
+  The ID3D11Device
+*/
+/****************************************************************************/
+void DX11::ConstantRing::EndFrame(const DX11::Device& device)
+{
+    Retire(device, false);
+    if (mAllocator.PendingFrames() == DX11::RingAllocator::MAX_FRAMES)
+    {
+        Retire(device, true);
+    }
+
+    uint32_t fence = (mOldestFence + mAllocator.PendingFrames()) % DX11::RingAllocator::MAX_FRAMES;
+    device.Commands().EndQuery(mFences[fence].Get());
+    mAllocator.EndFrame();
+}
+
+/****************************************************************************/
+/*!
+\brief
+  True when slices are bound by offset, false for the copying fallback
+*/
+/****************************************************************************/
+bool DX11::ConstantRing::Offsetting() const
+{
+    return mOffsetting;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Bytes of the ring in use by frames in flight and the current frame
+*/
+/****************************************************************************/
+size_t DX11::ConstantRing::Used() const
+{
+    return mAllocator.Used();
+}
+
+/*============================================================================*\
+|| ------------------------- PRIVATE FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Free every frame whose fence has passed
+
+\param device
+  The ID3D11Device
+
+\param wait
+  Block until at least the oldest frame is free
+*/
+/****************************************************************************/
+void DX11::ConstantRing::Retire(const DX11::Device& device, bool wait)
+{
+    while (mAllocator.PendingFrames() > 0)
+    {
+        ID3D11Query* fence = mFences[mOldestFence].Get();
+        HRESULT result = device.Commands().GetQueryData(fence, wait);
+
+        if (result == S_FALSE)
+        {
+            if (!wait)
+            {
+                return;
+            }
+            std::this_thread::yield();
+            continue;
+        }
+
+        if (!SUCCEEDED(result))
+        {
+            throw std::runtime_error("DX11: GetData() failed from ConstantRing::Retire!\n");
+        }
+
+        mAllocator.RetireFrame();
+        mOldestFence = (mOldestFence + 1) % DX11::RingAllocator::MAX_FRAMES;
+        wait = false;
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Bind a slice to a shader stage
+
+\param device
+  The ID3D11Device
+
+\param commands
+  Where to bind
+
+\param slot
+  Constant buffer register
+
+\param slice
+  A slice written this frame
+
+\param pixel
+  Pixel shader if true, vertex shader otherwise
+*/
+/****************************************************************************/
+void DX11::ConstantRing::Bind(const DX11::Device& device, DX11::CommandContext& commands, uint32_t slot, const Slice& slice, bool pixel)
+{
+    if (mOffsetting)
+    {
+        if (pixel)
+        {
+            commands.SetPSConstantBuffer(slot, mBuffer.Get(), slice.firstConstant, slice.constantCount);
+        }
+        else
+        {
+            commands.SetVSConstantBuffer(slot, mBuffer.Get(), slice.firstConstant, slice.constantCount);
+        }
+        return;
+    }
+
+    // same bytes every bind costs a discard, as before the ring existed
+    mFallback.Update(device, slice.data, 0, slice.constantCount * 16);
+
+    if (pixel)
+    {
+        commands.SetPSConstantBuffer(slot, mFallback.Get());
+    }
+    else
+    {
+        commands.SetVSConstantBuffer(slot, mFallback.Get());
+    }
+}
@@ -0,0 +1,387 @@
+/****************************************************************************/
+/*!
+\file
+   D3D11CommandContext.cpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    CommandContext that forwards straight to an ID3D11DeviceContext
+*/
+/****************************************************************************/
+
+/*============================================================================*\
+|| ------------------------------ INCLUDES ---------------------------------- ||
+\*============================================================================*/
+
+#include "DX11PCH.hpp"
+#include "D3D11CommandContext.hpp"
+
+/*============================================================================*\
+|| --------------------------- GLOBAL VARIABLES ----------------------------- ||
+\*============================================================================*/
+
+/*============================================================================*\
+|| -------------------------- STATIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/*============================================================================*\
+|| -------------------------- PUBLIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Constructor, picks up the D3D11.1 interface for ranged constant buffers
+
+\param context
+  The immediate or a deferred context
+*/
+/****************************************************************************/
+DX11::D3D11CommandContext::D3D11CommandContext(DX11::DXPtr<ID3D11DeviceContext> context) :
+    mContext(context)
+{
+    if (!SUCCEEDED(mContext.As(&mContext1)))
+    {
+        mContext1.Reset();
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  IASetPrimitiveTopology
+*/
+/****************************************************************************/
+void DX11::D3D11CommandContext::SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology)
+{
+    mContext->IASetPrimitiveTopology(topology);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  IASetInputLayout
+*/
+/****************************************************************************/
+void DX11::D3D11CommandContext::SetInputLayout(ID3D11InputLayout* layout)
+{
+    mContext->IASetInputLayout(layout);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  IASetVertexBuffers
+*/
+/****************************************************************************/
+void DX11::D3D11CommandContext::SetVertexBuffers(uint32_t slot, uint32_t count, ID3D11Buffer* const* buffers, const uint32_t* strides, const uint32_t* offsets)
+{
+    mContext->IASetVertexBuffers(slot, count, buffers, strides, offsets);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  IASetIndexBuffer
+*/
+/****************************************************************************/
+void DX11::D3D11CommandContext::SetIndexBuffer(ID3D11Buffer* buffer, DXGI_FORMAT format, uint32_t offset)
+{
+    mContext->IASetIndexBuffer(buffer, format, offset);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  VSSetShader
+*/
+/****************************************************************************/
+void DX11::D3D11CommandContext::SetVertexShader(ID3D11VertexShader* shader)
+{
+    mContext->VSSetShader(shader, nullptr, 0);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  PSSetShader
+*/
+/****************************************************************************/
+void DX11::D3D11CommandContext::SetPixelShader(ID3D11PixelShader* shader)
+{
+    mContext->PSSetShader(shader, nullptr, 0);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  VSSetConstantBuffers, or VSSetConstantBuffers1 when binding a range
+*/
+/****************************************************************************/
+void DX11::D3D11CommandContext::SetVSConstantBuffer(uint32_t slot, ID3D11Buffer* buffer, uint32_t firstConstant, uint32_t constantCount)
+{
+    if (constantCount != 0 && mContext1)
+    {
+        mContext1->VSSetConstantBuffers1(slot, 1, &buffer, &firstConstant, &constantCount);
+        return;
+    }
+    mContext->VSSetConstantBuffers(slot, 1, &buffer);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  PSSetConstantBuffers, or PSSetConstantBuffers1 when binding a range
+*/
+/****************************************************************************/
+void DX11::D3D11CommandContext::SetPSConstantBuffer(uint32_t slot, ID3D11Buffer* buffer, uint32_t firstConstant, uint32_t constantCount)
+{
+    if (constantCount != 0 && mContext1)
+    {
+        mContext1->PSSetConstantBuffers1(slot, 1, &buffer, &firstConstant, &constantCount);
+        return;
+    }
+    mContext->PSSetConstantBuffers(slot, 1, &buffer);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  RSSetState
+*/
+/****************************************************************************/
+void DX11::D3D11CommandContext::SetRasterizerState(ID3D11RasterizerState* state)
+{
+    mContext->RSSetState(state);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  RSSetViewports
+*/
+/****************************************************************************/
+void DX11::D3D11CommandContext::SetViewports(uint32_t count, const D3D11_VIEWPORT* viewports)
+{
+    mContext->RSSetViewports(count, viewports);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  OMSetBlendState
+*/
+/****************************************************************************/
+void DX11::D3D11CommandContext::SetBlendState(ID3D11BlendState* state, const float factors[4], uint32_t sampleMask)
+{
+    mContext->OMSetBlendState(state, factors, sampleMask);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  OMSetDepthStencilState
+*/
+/****************************************************************************/
+void DX11::D3D11CommandContext::SetDepthStencilState(ID3D11DepthStencilState* state, uint32_t stencilRef)
+{
+    mContext->OMSetDepthStencilState(state, stencilRef);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  OMSetRenderTargets
+*/
+/****************************************************************************/
+void DX11::D3D11CommandContext::SetRenderTargets(uint32_t count, ID3D11RenderTargetView* const* views, ID3D11DepthStencilView* depth)
+{
+    mContext->OMSetRenderTargets(count, views, depth);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  ClearRenderTargetView
+*/
+/****************************************************************************/
+void DX11::D3D11CommandContext::ClearRenderTargetView(ID3D11RenderTargetView* view, const float color[4])
+{
+    mContext->ClearRenderTargetView(view, color);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  ClearDepthStencilView
+*/
+/****************************************************************************/
+void DX11::D3D11CommandContext::ClearDepthStencilView(ID3D11DepthStencilView* view, uint32_t flags, float depth, uint8_t stencil)
+{
+    mContext->ClearDepthStencilView(view, flags, depth, stencil);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  DrawIndexed
+*/
+/****************************************************************************/
+void DX11::D3D11CommandContext::DrawIndexed(uint32_t indexCount, uint32_t firstIndex, int32_t baseVertex)
+{
+    mContext->DrawIndexed(indexCount, firstIndex, baseVertex);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  DrawIndexedInstanced
+*/
+/****************************************************************************/
+void DX11::D3D11CommandContext::DrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t baseVertex, uint32_t firstInstance)
+{
+    mContext->DrawIndexedInstanced(indexCount, instanceCount, firstIndex, baseVertex, firstInstance);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Map, throws on failure
+*/
+/****************************************************************************/
+void* DX11::D3D11CommandContext::Map(ID3D11Resource* resource, D3D11_MAP mapType, uint32_t size)
+{
+    UNUSED(size);
+    D3D11_MAPPED_SUBRESOURCE mappedResource = {};
+
+    HRESULT result = mContext->Map(resource, 0, mapType, 0, &mappedResource);
+    if (!SUCCEEDED(result) || mappedResource.pData == nullptr)
+    {
+        throw std::runtime_error("DX11: Map() failed from D3D11CommandContext::Map!\n");
+    }
+
+    return mappedResource.pData;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Unmap
+*/
+/****************************************************************************/
+void DX11::D3D11CommandContext::Unmap(ID3D11Resource* resource)
+{
+    mContext->Unmap(resource, 0);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  CopySubresourceRegion for a byte range of a buffer
+*/
+/****************************************************************************/
+void DX11::D3D11CommandContext::CopyBufferRegion(ID3D11Buffer* destination, uint32_t destinationOffset, ID3D11Buffer* source, uint32_t sourceOffset, uint32_t size)
+{
+    D3D11_BOX box = {};
+    box.left = sourceOffset;
+    box.right = sourceOffset + size;
+    box.bottom = 1;
+    box.back = 1;
+    mContext->CopySubresourceRegion(destination, 0, destinationOffset, 0, 0, source, 0, &box);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  End
+*/
+/****************************************************************************/
+void DX11::D3D11CommandContext::EndQuery(ID3D11Query* query)
+{
+    mContext->End(query);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  GetData, S_FALSE while the GPU has not reached the query
+*/
+/****************************************************************************/
+HRESULT DX11::D3D11CommandContext::GetQueryData(ID3D11Query* query, bool flush)
+{
+    return mContext->GetData(query, nullptr, 0, flush ? 0 : D3D11_ASYNC_GETDATA_DONOTFLUSH);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  ClearState
+*/
+/****************************************************************************/
+void DX11::D3D11CommandContext::ClearState()
+{
+    mContext->ClearState();
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Flush
+*/
+/****************************************************************************/
+void DX11::D3D11CommandContext::Flush()
+{
+    mContext->Flush();
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Create a deferred context on the same device, throws on failure
+
+\return
+  A context for recording on another thread
+*/
+/****************************************************************************/
+std::shared_ptr<DX11::CommandContext> DX11::D3D11CommandContext::CreateDeferred()
+{
+    DX11::DXPtr<ID3D11Device> device;
+    mContext->GetDevice(device.ReleaseAndGetAddressOf());
+
+    DX11::DXPtr<ID3D11DeviceContext> deferred;
+    if (!SUCCEEDED(device->CreateDeferredContext(0, deferred.ReleaseAndGetAddressOf())))
+    {
+        throw std::runtime_error("DX11: CreateDeferredContext() failed from D3D11CommandContext!\n");
+    }
+    return std::make_shared<DX11::D3D11CommandContext>(deferred);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  FinishCommandList, throws on failure
+*/
+/****************************************************************************/
+DX11::CommandList DX11::D3D11CommandContext::FinishCommandList()
+{
+    DX11::CommandList list;
+    if (!SUCCEEDED(mContext->FinishCommandList(FALSE, list.ReleaseAndGetAddressOf())))
+    {
+        throw std::runtime_error("DX11: FinishCommandList() failed from D3D11CommandContext!\n");
+    }
+    return list;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  ExecuteCommandList
+*/
+/****************************************************************************/
+void DX11::D3D11CommandContext::ExecuteCommandList(ID3D11CommandList* list)
+{
+    mContext->ExecuteCommandList(list, FALSE);
+}
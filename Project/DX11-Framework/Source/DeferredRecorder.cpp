@@ -0,0 +1,111 @@
+/****************************************************************************/
+/*!
+\file
+   DeferredRecorder.cpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Records a frame's slices on deferred contexts across threads and plays
+    the resulting command lists back on the immediate context in slice
+    order. The deferred contexts are created once and reused.
+*/
+/****************************************************************************/
+
+/*============================================================================*\
+|| ------------------------------ INCLUDES ---------------------------------- ||
+\*============================================================================*/
+
+#include "DX11PCH.hpp"
+#include "DeferredRecorder.hpp"
+
+/*============================================================================*\
+|| --------------------------- GLOBAL VARIABLES ----------------------------- ||
+\*============================================================================*/
+
+/*============================================================================*\
+|| -------------------------- STATIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/*============================================================================*\
+|| -------------------------- PUBLIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Record sliceCount slices and execute them in order. A single slice is
+  recorded straight on the immediate context, there is nothing to split.
+  Deferred contexts start from the default state, record has to bind
+  everything its slice needs. The immediate context is left in the
+  default state afterwards.
+
+\param device
+  The ID3D11Device
+
+\param scheduler
+  Runs the slices, possibly on other threads
+
+\param sliceCount
+  Number of slices
+
+\param record
+  Records one slice onto the given context, must be safe to call from
+  any thread
+*/
+/****************************************************************************/
+void DX11::DeferredRecorder::Record(const DX11::Device& device, DX11::CommandScheduler& scheduler, uint32_t sliceCount,
+    const std::function<void(DX11::CommandContext&, uint32_t)>& record)
+{
+    DX11::CommandContext& immediate = device.Commands();
+    if (sliceCount <= 1)
+    {
+        record(immediate, 0);
+        return;
+    }
+
+    // contexts are made on this thread, the workers only record
+    while (mContexts.size() < sliceCount)
+    {
+        mContexts.push_back(immediate.CreateDeferred());
+    }
+    mLists.resize(mContexts.size());
+
+    scheduler.Run(sliceCount, [this, &record](uint32_t slice)
+    {
+        DX11::CommandContext& context = *mContexts[slice];
+        record(context, slice);
+        mLists[slice] = context.FinishCommandList();
+    });
+
+    for (uint32_t slice = 0; slice < sliceCount; ++slice)
+    {
+        immediate.ExecuteCommandList(mLists[slice].Get());
+        mLists[slice].Reset();
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Drop the deferred contexts, needed when the device is recreated
+*/
+/****************************************************************************/
+void DX11::DeferredRecorder::Clear()
+{
+    mContexts.clear();
+    mLists.clear();
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Number of deferred contexts created so far
+*/
+/****************************************************************************/
+size_t DX11::DeferredRecorder::Contexts() const
+{
+    return mContexts.size();
+}
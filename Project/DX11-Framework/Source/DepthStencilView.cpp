@@ -44,6 +44,11 @@
 /****************************************************************************/
 DX11::DepthStencilView::DepthStencilView(DX11::Device device, DX11::Texture2D buffer)
 {
+    if (device.Headless())
+    {
+        return;
+    }
+
     if (!SUCCEEDED(device->CreateDepthStencilView(buffer.Get(), nullptr, ReleaseAndGetAddressOf())))
     {
         throw std::runtime_error("DX11: CreateDepthStencilView() failed from DepthStencilView!\n");
@@ -18,6 +18,7 @@
 
 #include "DX11PCH.hpp"
 #include "Device.hpp"
+#include "D3D11CommandContext.hpp"
 
 /*============================================================================*\
 || --------------------------- GLOBAL VARIABLES ----------------------------- ||
@@ -60,6 +61,8 @@ DX11::Device::Device(DX11::Adaptor adaptor)
         throw std::runtime_error("DX11: D3D11CreateDevice() failed!\n");
     }
 
+    mCommands = std::make_shared<DX11::StateCacheCommandContext>(std::make_shared<DX11::D3D11CommandContext>(mContext));
+
     //initialize debug device
 #ifdef USE_DEBUG_DEVICE
     if (!SUCCEEDED(As(&mDebug)))
@@ -69,6 +72,21 @@ DX11::Device::Device(DX11::Adaptor adaptor)
 #endif // USE_DEBUG_DEVICE
 }
 
+/****************************************************************************/
+/*!
+\brief
+  Constructor for a headless device. There is no ID3D11Device, resources
+  are not created and every command goes to the given context.
+
+\param commands
+  Backend that receives the commands, usually a RecordingCommandContext
+*/
+/****************************************************************************/
+DX11::Device::Device(std::shared_ptr<DX11::CommandContext> commands) :
+    mCommands(std::make_shared<DX11::StateCacheCommandContext>(commands))
+{
+}
+
 /****************************************************************************/
 /*!
 \brief
@@ -83,6 +101,46 @@ DX11::DeviceContext DX11::Device::Context() const
     return mContext;
 }
 
+/****************************************************************************/
+/*!
+\brief
+  Get the command backend every wrapper records through
+
+\return
+  Returns the CommandContext for this device
+*/
+/****************************************************************************/
+DX11::CommandContext& DX11::Device::Commands() const
+{
+    return *mCommands;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the redundant state filter in front of the backend, for its counters
+  and for Invalidate after binding on Context() directly
+
+\return
+  Returns the StateCacheCommandContext for this device
+*/
+/****************************************************************************/
+DX11::StateCacheCommandContext& DX11::Device::StateCache() const
+{
+    return *mCommands;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  True when there is no GPU behind this device
+*/
+/****************************************************************************/
+bool DX11::Device::Headless() const
+{
+    return Get() == nullptr && mCommands != nullptr;
+}
+
 #ifdef USE_DEBUG_DEVICE
 /****************************************************************************/
 /*!
@@ -34,10 +34,19 @@
 /*!
 \brief
   Create the engine
+
+\param headless
+  Render without a window or GPU, see RunHeadless
+
+\param framesInFlight
+  Frames the main thread may prepare ahead of the render thread, 0 runs
+  everything on the main thread
 */
 /****************************************************************************/
-DX11::Engine::Engine() :
-    pPreviousTime(glfwGetTime()),
+DX11::Engine::Engine(bool headless, uint32_t framesInFlight) :
+    mRenderer(headless),
+    mFramesInFlight(framesInFlight),
+    pPreviousTime(headless ? 0.0 : glfwGetTime()),
     pStartTime(float(pPreviousTime)),
     pGameLoopIterations(0),
     pFPSCalcInterval(1),
@@ -58,15 +67,151 @@ void DX11::Engine::Init()
 /****************************************************************************/
 /*!
 \brief
-  Update the engine
+  Update the engine, the main thread prepares frames and the render thread
+  submits them
 */
 /****************************************************************************/
 void DX11::Engine::Run()
 {
+    if (mFramesInFlight == 0)
+    {
+        while (!glfwWindowShouldClose(mWindow))
+        {
+            float dt = UpdateDT();
+            mRenderer.Draw(dt);
+        }
+        return;
+    }
+
+    // the main thread keeps pumping messages while it waits, Present on the render thread may need them
+    DX11::FramePipeline pipeline(mFramesInFlight, [this](const DX11::FramePacket& packet) { mRenderer.Submit(packet); },
+        [this]() { mRenderer.PumpEvents(); });
     while (!glfwWindowShouldClose(mWindow))
     {
         float dt = UpdateDT();
-        mRenderer.Draw(dt);
+        DX11::FramePacket& packet = pipeline.Begin();
+        mRenderer.Prepare(dt, packet);
+        pipeline.End(packet);
+    }
+
+    pipeline.Flush();
+    LogPipeline(pipeline.Stats());
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Run a fixed number of frames on the headless renderer at a fixed dt and
+  log what the CPU side of a frame costs on average
+
+\param frames
+  How many frames to render
+*/
+/****************************************************************************/
+void DX11::Engine::RunHeadless(uint32_t frames)
+{
+    const float dt = 1.0f / 60.0f;
+
+    // the render side counts on the render thread, it only reads what Submit wrote
+    DX11::CommandStats total;
+    DX11::StateCacheStats state;
+    auto submit = [this, &total, &state](const DX11::FramePacket& packet)
+    {
+        mRenderer.Submit(packet);
+
+        DX11::StateCacheStats frameState = mRenderer.StateStats();
+        state.submitted += frameState.submitted;
+        state.filtered += frameState.filtered;
+
+        DX11::CommandStats stats = mRenderer.FrameStats();
+        total.commands += stats.commands;
+        total.draws += stats.draws;
+        total.instances += stats.instances;
+        total.indices += stats.indices;
+        total.stateChanges += stats.stateChanges;
+        total.maps += stats.maps;
+        total.bytesMapped += stats.bytesMapped;
+        total.copies += stats.copies;
+        total.cpuMilliseconds += stats.cpuMilliseconds;
+    };
+
+    std::unique_ptr<DX11::FramePipeline> pipeline;
+    if (mFramesInFlight != 0)
+    {
+        pipeline = std::make_unique<DX11::FramePipeline>(mFramesInFlight, submit);
+    }
+
+    DX11::FramePacket serial;
+    DX11::MeshletStats meshlets;
+    DX11::OcclusionStats occlusion;
+    for (uint32_t i = 0; i < frames; ++i)
+    {
+        DX11::FramePacket& packet = pipeline ? pipeline->Begin() : serial;
+        mRenderer.Prepare(dt, packet);
+
+        DX11::MeshletStats frameMeshlets = mRenderer.MeshletCullStats();
+        meshlets.tested += frameMeshlets.tested;
+        meshlets.frustumCulled += frameMeshlets.frustumCulled;
+        meshlets.backfaceCulled += frameMeshlets.backfaceCulled;
+        meshlets.triangles += frameMeshlets.triangles;
+        meshlets.trianglesCulled += frameMeshlets.trianglesCulled;
+        meshlets.ranges += frameMeshlets.ranges;
+
+        DX11::OcclusionStats frameOcclusion = mRenderer.OcclusionCullStats();
+        occlusion.occluders += frameOcclusion.occluders;
+        occlusion.triangles += frameOcclusion.triangles;
+        occlusion.tested += frameOcclusion.tested;
+        occlusion.occluded += frameOcclusion.occluded;
+
+        if (pipeline)
+        {
+            pipeline->End(packet);
+        }
+        else
+        {
+            submit(packet);
+        }
+    }
+
+    if (pipeline)
+    {
+        pipeline->Flush();
+    }
+
+    if (frames == 0)
+    {
+        return;
+    }
+
+    double count = double(frames);
+    std::cout << "Headless: " << frames << " frames, per frame "
+        << total.cpuMilliseconds / count << " ms cpu, "
+        << total.commands / count << " commands, "
+        << total.draws / count << " draws, "
+        << total.instances / count << " instances, "
+        << total.indices / count << " indices, "
+        << total.stateChanges / count << " state changes, "
+        << total.maps / count << " maps, "
+        << total.bytesMapped / count << " bytes mapped, "
+        << total.copies / count << " copies, "
+        << state.filtered / count << " of " << state.submitted / count << " Set calls filtered" << std::endl;
+    std::cout << "Meshlets: per frame " << meshlets.tested / count << " tested, "
+        << meshlets.frustumCulled / count << " outside the frustum, "
+        << meshlets.backfaceCulled / count << " facing away, "
+        << meshlets.trianglesCulled / count << " of " << meshlets.triangles / count << " triangles culled, "
+        << meshlets.ranges / count << " draws" << std::endl;
+    std::cout << "Occlusion: per frame " << occlusion.occluders / count << " occluders, "
+        << occlusion.triangles / count << " triangles rasterized, "
+        << occlusion.occluded / count << " of " << occlusion.tested / count << " submeshes occluded" << std::endl;
+
+    if (pipeline)
+    {
+        DX11::FramePipelineStats stats = pipeline->Stats();
+        std::cout << "Pipeline: " << pipeline->FramesInFlight() << " frames in flight, per frame "
+            << stats.latencyMilliseconds / count << " ms latency (" << stats.maxLatencyMilliseconds << " max), "
+            << stats.queuedMilliseconds / count << " ms queued, "
+            << stats.stallMilliseconds / count << " ms main thread stalled, "
+            << stats.idleMilliseconds / count << " ms render thread idle" << std::endl;
     }
 }
 
@@ -113,3 +258,26 @@ float DX11::Engine::UpdateDT()
     //return dt
     return float(deltaTime_);
 }
+
+/****************************************************************************/
+/*!
+\brief
+  Log how long frames took from Begin to submitted and who waited on whom
+
+\param stats
+  The pipeline's totals
+*/
+/****************************************************************************/
+void DX11::Engine::LogPipeline(const DX11::FramePipelineStats& stats) const
+{
+    if (stats.frames == 0)
+    {
+        return;
+    }
+
+    double count = double(stats.frames);
+    DEBUG::log.Info("FramePipeline:", stats.frames, "frames,", mFramesInFlight, "in flight, latency",
+        stats.latencyMilliseconds / count, "ms average", stats.maxLatencyMilliseconds, "ms max, queued",
+        stats.queuedMilliseconds / count, "ms, main thread stalled", stats.stallMilliseconds / count,
+        "ms, render thread idle", stats.idleMilliseconds / count, "ms, arena high water", stats.arenaHighWater, "bytes");
+}
@@ -0,0 +1,151 @@
+/****************************************************************************/
+/*!
+\file
+   FrameArena.cpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Linear allocator for data that only lives for a frame. Allocations bump
+    a pointer through a list of blocks and Reset rewinds to the first one,
+    the blocks are kept so once a scene has been seen a frame never touches
+    the general heap. Every FramePacket owns one, it belongs to whichever
+    thread holds the packet and is reset when the packet is recycled.
+*/
+/****************************************************************************/
+
+/*============================================================================*\
+|| ------------------------------ INCLUDES ---------------------------------- ||
+\*============================================================================*/
+
+#include "DX11PCH.hpp"
+#include "FrameArena.hpp"
+
+/*============================================================================*\
+|| --------------------------- GLOBAL VARIABLES ----------------------------- ||
+\*============================================================================*/
+
+/*============================================================================*\
+|| -------------------------- STATIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/*============================================================================*\
+|| -------------------------- PUBLIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Constructor, no memory is taken until the first allocation
+
+\param blockSize
+  Smallest block the arena grows by
+*/
+/****************************************************************************/
+DX11::FrameArena::FrameArena(size_t blockSize) :
+    mBlockSize(std::max(blockSize, size_t(1)))
+{
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Bump allocate from the current block, moving on to the next one or
+  adding a block when it doesn't fit
+
+\param size
+  Bytes to allocate
+
+\param alignment
+  Power of two alignment
+
+\return
+  The memory, valid until the next Reset
+*/
+/****************************************************************************/
+void* DX11::FrameArena::Allocate(size_t size, size_t alignment)
+{
+    while (true)
+    {
+        for (; mBlock < mBlocks.size(); ++mBlock)
+        {
+            Block& block = mBlocks[mBlock];
+            uint8_t* base = block.memory.get();
+            uintptr_t address = (uintptr_t(base) + mOffset + alignment - 1) & ~uintptr_t(alignment - 1);
+            size_t offset = size_t(address - uintptr_t(base));
+
+            if (offset + size <= block.size)
+            {
+                mOffset = offset + size;
+                mHighWater = std::max(mHighWater, mBefore + mOffset);
+                return base + offset;
+            }
+
+            // the rest of this block is skipped until the next Reset
+            mBefore += block.size;
+            mOffset = 0;
+        }
+
+        // only a frame bigger than any before gets here, the block is kept from then on
+        Block block;
+        block.size = std::max(mBlockSize, size + alignment);
+        block.memory.reset(new uint8_t[block.size]);
+        mBlocks.push_back(std::move(block));
+        mBlock = mBlocks.size() - 1;
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Rewind to the first block, everything allocated since the last Reset
+  is invalid after this. Only the thread holding the arena may call it.
+*/
+/****************************************************************************/
+void DX11::FrameArena::Reset()
+{
+    mBlock = 0;
+    mOffset = 0;
+    mBefore = 0;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Bytes used since the last Reset, counting what was skipped to align
+  or to fit in the next block
+*/
+/****************************************************************************/
+size_t DX11::FrameArena::Used() const
+{
+    return mBefore + mOffset;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Bytes in every block the arena holds
+*/
+/****************************************************************************/
+size_t DX11::FrameArena::Capacity() const
+{
+    size_t capacity = 0;
+    for (const Block& block : mBlocks)
+    {
+        capacity += block.size;
+    }
+    return capacity;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Most bytes used between two resets
+*/
+/****************************************************************************/
+size_t DX11::FrameArena::HighWater() const
+{
+    return mHighWater;
+}
@@ -0,0 +1,365 @@
+/****************************************************************************/
+/*!
+\file
+   FramePipeline.cpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Hands frames from the main thread to a render thread
+*/
+/****************************************************************************/
+/*============================================================================*\
+|| ------------------------------ INCLUDES ---------------------------------- ||
+\*============================================================================*/
+
+#include "DX11PCH.hpp"
+#include "FramePipeline.hpp"
+
+/*============================================================================*\
+|| --------------------------- GLOBAL VARIABLES ----------------------------- ||
+\*============================================================================*/
+
+/*============================================================================*\
+|| -------------------------- STATIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+namespace
+{
+    typedef std::chrono::steady_clock Clock;
+
+    /****************************************************************************/
+    /*!
+    \brief
+      Milliseconds between two points in time
+
+    \param start
+      The earlier one
+
+    \param end
+      The later one
+    */
+    /****************************************************************************/
+    static double Milliseconds(Clock::time_point start, Clock::time_point end)
+    {
+        return std::chrono::duration<double, std::milli>(end - start).count();
+    }
+
+    /****************************************************************************/
+    /*!
+    \brief
+      Keep the packet count in the supported range
+
+    \param framesInFlight
+      What was asked for
+    */
+    /****************************************************************************/
+    static uint32_t ClampFrames(uint32_t framesInFlight)
+    {
+        return std::max(1u, std::min(framesInFlight, uint32_t(DX11::FramePipeline::MAX_FRAMES_IN_FLIGHT)));
+    }
+}
+
+/*============================================================================*\
+|| -------------------------- PUBLIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Create the packets and start the render thread
+
+\param framesInFlight
+  Packets in circulation, clamped to 1 - MAX_FRAMES_IN_FLIGHT. With 1 the
+  main thread waits for every frame to be submitted before starting the
+  next, 2 lets it prepare one frame while the previous is submitted.
+
+\param submit
+  Called on the render thread for each published packet, in order
+
+\param pump
+  Called on the main thread while it waits for the render thread, pumps
+  the window's messages so a Present that sends it one can't deadlock
+*/
+/****************************************************************************/
+DX11::FramePipeline::FramePipeline(uint32_t framesInFlight, std::function<void(const DX11::FramePacket&)> submit,
+    std::function<void()> pump) :
+    mSubmit(std::move(submit)),
+    mPump(std::move(pump)),
+    mFree(ClampFrames(framesInFlight)),
+    mPublished(ClampFrames(framesInFlight))
+{
+    for (uint32_t i = 0; i < ClampFrames(framesInFlight); ++i)
+    {
+        mPackets.push_back(std::make_unique<DX11::FramePacket>());
+        DX11::FramePacket* packet = mPackets.back().get();
+        mFree.TryPush(packet);
+    }
+
+    mThread = std::thread(&FramePipeline::RenderLoop, this);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Submit whatever was published and join the render thread
+*/
+/****************************************************************************/
+DX11::FramePipeline::~FramePipeline()
+{
+    // drain with the pump running rather than block in join while the render thread presents
+    for (size_t i = 0; i < mPackets.size(); ++i)
+    {
+        double waited = 0.0;
+        if (Take(mFree, waited, true) == nullptr)
+        {
+            break;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mQuit = true;
+    }
+    mWake.notify_all();
+
+    mThread.join();
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get a packet to fill for the next frame, waits while every packet is
+  still queued or being submitted. Main thread only.
+
+\return
+  The packet, empty apart from its frame number, its arena reset
+*/
+/****************************************************************************/
+DX11::FramePacket& DX11::FramePipeline::Begin()
+{
+    double stalled = 0.0;
+    DX11::FramePacket* packet = Take(mFree, stalled, true);
+    if (packet == nullptr)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        std::rethrow_exception(mError);
+    }
+
+    // the render thread is done with everything in the arena, start over with room for last time's draws
+    const size_t drawCount = packet->draws.size();
+    packet->arena.Reset();
+    packet->draws = DX11::FrameVector<DX11::FrameDraw>(DX11::FrameAllocator<DX11::FrameDraw>(packet->arena));
+    packet->draws.reserve(drawCount);
+
+    packet->frame = mFrame++;
+    packet->begun = Clock::now();
+
+    std::lock_guard<std::mutex> lock(mStatsMutex);
+    mStats.stallMilliseconds += stalled;
+    return *packet;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Publish a filled packet to the render thread. Main thread only.
+
+\param packet
+  The packet from Begin, not to be touched again
+*/
+/****************************************************************************/
+void DX11::FramePipeline::End(DX11::FramePacket& packet)
+{
+    packet.published = Clock::now();
+    Give(mPublished, &packet);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Wait until every published frame has been submitted. Main thread only,
+  rethrows what the submit function threw.
+*/
+/****************************************************************************/
+void DX11::FramePipeline::Flush()
+{
+    std::vector<DX11::FramePacket*> held;
+    for (size_t i = 0; i < mPackets.size(); ++i)
+    {
+        double waited = 0.0;
+        DX11::FramePacket* packet = Take(mFree, waited, true);
+        if (packet == nullptr)
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            std::rethrow_exception(mError);
+        }
+        held.push_back(packet);
+    }
+
+    for (DX11::FramePacket* packet : held)
+    {
+        Give(mFree, packet);
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get how many packets circulate
+*/
+/****************************************************************************/
+uint32_t DX11::FramePipeline::FramesInFlight() const
+{
+    return uint32_t(mPackets.size());
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the timings so far, complete after Flush
+*/
+/****************************************************************************/
+DX11::FramePipelineStats DX11::FramePipeline::Stats() const
+{
+    std::lock_guard<std::mutex> lock(mStatsMutex);
+    return mStats;
+}
+
+/*============================================================================*\
+|| ------------------------- PRIVATE FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Render thread, submits published packets in order and hands them back.
+  Stops once told to quit and nothing is left to submit, or when submit
+  throws.
+*/
+/****************************************************************************/
+void DX11::FramePipeline::RenderLoop()
+{
+    while (true)
+    {
+        double idle = 0.0;
+        DX11::FramePacket* packet = Take(mPublished, idle, false);
+        if (packet == nullptr)
+        {
+            return;
+        }
+
+        const Clock::time_point picked = Clock::now();
+        try
+        {
+            mSubmit(*packet);
+        }
+        catch (...)
+        {
+            // the packet is never handed back, the main thread runs dry and rethrows
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                mError = std::current_exception();
+            }
+            mWake.notify_all();
+            return;
+        }
+
+        const double latency = Milliseconds(packet->begun, Clock::now());
+        {
+            std::lock_guard<std::mutex> lock(mStatsMutex);
+            ++mStats.frames;
+            mStats.idleMilliseconds += idle;
+            mStats.queuedMilliseconds += Milliseconds(packet->published, picked);
+            mStats.latencyMilliseconds += latency;
+            mStats.maxLatencyMilliseconds = std::max(mStats.maxLatencyMilliseconds, latency);
+            mStats.arenaHighWater = std::max(mStats.arenaHighWater, packet->arena.HighWater());
+        }
+
+        Give(mFree, packet);
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Pop a packet, sleeping until the other side pushes one
+
+\param queue
+  Where to pop from
+
+\param waited
+  Receives how long it slept, in milliseconds
+
+\param pump
+  Call the pump function every PUMP_INTERVAL while asleep, main thread only
+
+\return
+  The packet, or nullptr if the pipeline is shutting down or failed
+*/
+/****************************************************************************/
+DX11::FramePacket* DX11::FramePipeline::Take(DX11::RingQueue<DX11::FramePacket*>& queue, double& waited, bool pump)
+{
+    DX11::FramePacket* packet = nullptr;
+    if (queue.TryPop(packet))
+    {
+        return packet;
+    }
+
+    const Clock::time_point start = Clock::now();
+    ++mSleeping;
+
+    // the push is only a release store, without this both sides can miss each other, see Give
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    {
+        auto ready = [&]() { return queue.TryPop(packet) || mQuit || mError; };
+        std::unique_lock<std::mutex> lock(mMutex);
+        if (!pump || !mPump)
+        {
+            mWake.wait(lock, ready);
+        }
+        else
+        {
+            // Present on the render thread can send messages to the window and wait for them
+            while (!mWake.wait_for(lock, std::chrono::milliseconds(uint32_t(PUMP_INTERVAL)), ready))
+            {
+                lock.unlock();
+                mPump();
+                lock.lock();
+            }
+        }
+    }
+    --mSleeping;
+    waited = Milliseconds(start, Clock::now());
+
+    return packet;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Push a packet and wake the other side if it sleeps
+
+\param queue
+  Where to push, never full as it has room for every packet
+
+\param packet
+  The packet
+*/
+/****************************************************************************/
+void DX11::FramePipeline::Give(DX11::RingQueue<DX11::FramePacket*>& queue, DX11::FramePacket* packet)
+{
+    queue.TryPush(packet);
+
+    // pairs with the fence in Take, a sleeper either sees the packet in its predicate or is counted here
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (mSleeping.load() > 0)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+        }
+        mWake.notify_all();
+    }
+}
@@ -18,6 +18,7 @@
 
 #include "DX11PCH.hpp"
 #include "InputLayout.hpp"
+#include <cstring>
 
 /*============================================================================*\
 || --------------------------- GLOBAL VARIABLES ----------------------------- ||
@@ -27,6 +28,23 @@
 || -------------------------- STATIC FUNCTIONS ------------------------------ ||
 \*============================================================================*/
 
+namespace
+{
+    /****************************************************************************/
+    /*!
+    \brief
+      Whether a reflected input is per-instance data, INSTANCE0, INSTANCE1...
+
+    \param semantic
+      The semantic name without its index
+    */
+    /****************************************************************************/
+    static bool IsInstanceSemantic(const char* semantic)
+    {
+        return std::strncmp(semantic, "INSTANCE", 8) == 0;
+    }
+}
+
 /*============================================================================*\
 || -------------------------- PUBLIC FUNCTIONS ------------------------------ ||
 \*============================================================================*/
@@ -36,9 +54,22 @@
 \brief
   Create an ID3D11InputLayout
   https://gist.github.com/mobius/b678970c61a93c81fffef1936734909f
+
+\param device
+  The ID3D11Device
+
+\param blob
+  The vertex shader to reflect the inputs from
+
+\param format
+  The vertex layout the bound meshes are stored in, compact layouts
+  override the reflected 32 bit formats
+
+  Inputs with an INSTANCE semantic are read per instance from
+  INSTANCE_SLOT, everything else per vertex from slot 0.
 */
 /****************************************************************************/
-DX11::InputLayout::InputLayout(DX11::Device device, DX11::ShaderStage blob)
+DX11::InputLayout::InputLayout(DX11::Device device, DX11::ShaderStage blob, DX11::VertexFormat format)
 {
     ShaderReflection reflection;
     if (!SUCCEEDED(D3DReflect(blob->GetBufferPointer(), blob->GetBufferSize(), IID_ID3D11ShaderReflection, reinterpret_cast<void**>(reflection.ReleaseAndGetAddressOf()))))
@@ -58,10 +89,23 @@ DX11::InputLayout::InputLayout(DX11::Device device, DX11::ShaderStage blob)
         D3D11_INPUT_ELEMENT_DESC elementDesc = {};
         elementDesc.SemanticName = paramDesc.SemanticName;
         elementDesc.SemanticIndex = paramDesc.SemanticIndex;
-        elementDesc.InputSlot = 0;
         elementDesc.AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT;
-        elementDesc.InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
-        elementDesc.InstanceDataStepRate = 0;
+
+        // INSTANCE semantics step once per instance from their own stream
+        const bool instance = IsInstanceSemantic(paramDesc.SemanticName);
+        if (instance)
+        {
+            elementDesc.InputSlot = INSTANCE_SLOT;
+            elementDesc.InputSlotClass = D3D11_INPUT_PER_INSTANCE_DATA;
+            elementDesc.InstanceDataStepRate = 1;
+            mInstanced = true;
+        }
+        else
+        {
+            elementDesc.InputSlot = 0;
+            elementDesc.InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
+            elementDesc.InstanceDataStepRate = 0;
+        }
 
         if (paramDesc.Mask == 1)
         {
@@ -100,6 +144,13 @@ DX11::InputLayout::InputLayout(DX11::Device device, DX11::ShaderStage blob)
                 elementDesc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
         }
 
+        // the instance stream is always full precision, only the mesh is compacted
+        DXGI_FORMAT storedFormat = instance ? DXGI_FORMAT_UNKNOWN : DX11::VertexElementFormat(format, paramDesc.SemanticName);
+        if (storedFormat != DXGI_FORMAT_UNKNOWN)
+        {
+            elementDesc.Format = storedFormat;
+        }
+
         inputLayoutDesc.push_back(elementDesc);
     }
 
@@ -107,5 +158,15 @@ DX11::InputLayout::InputLayout(DX11::Device device, DX11::ShaderStage blob)
     {
         throw std::runtime_error("DX11: CreateInputLayout() failed from InputLayout!\n");
     }
+}
 
+/****************************************************************************/
+/*!
+\brief
+  Whether the shader reads a per-instance stream from INSTANCE_SLOT
+*/
+/****************************************************************************/
+bool DX11::InputLayout::Instanced() const
+{
+    return mInstanced;
 }
@@ -0,0 +1,156 @@
+/****************************************************************************/
+/*!
+\file
+   InstanceBuffer.cpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Dynamic vertex buffer holding one frame's per-instance data. It is
+    written with a single map per frame and bound to the input layout's
+    instance slot, where INSTANCE0..3 read each instance's transform.
+*/
+/****************************************************************************/
+
+/*============================================================================*\
+|| ------------------------------ INCLUDES ---------------------------------- ||
+\*============================================================================*/
+
+#include "DX11PCH.hpp"
+#include "InstanceBuffer.hpp"
+#include "InputLayout.hpp"
+
+/*============================================================================*\
+|| --------------------------- GLOBAL VARIABLES ----------------------------- ||
+\*============================================================================*/
+
+/*============================================================================*\
+|| -------------------------- STATIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/*============================================================================*\
+|| -------------------------- PUBLIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Constructor, creates the buffer
+
+\param device
+  The ID3D11Device
+
+\param capacity
+  Instances the buffer holds before it has to grow
+*/
+/****************************************************************************/
+DX11::InstanceBuffer::InstanceBuffer(DX11::Device device, uint32_t capacity)
+{
+    Create(device, capacity);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Map the buffer for this frame's instances. Discards last frame's data
+  and doubles the buffer first if count does not fit.
+
+\param device
+  The ID3D11Device
+
+\param count
+  Instances that will be written
+
+\return
+  Where to write count instances, valid until End
+*/
+/****************************************************************************/
+DX11::InstanceData* DX11::InstanceBuffer::Begin(const DX11::Device& device, uint32_t count)
+{
+    if (count > mCapacity)
+    {
+        uint32_t capacity = std::max(mCapacity, 64u);
+        while (capacity < count)
+        {
+            capacity *= 2;
+        }
+        Create(device, capacity);
+
+        // the old buffer may still be shadowed as bound, and its address reused
+        device.StateCache().Invalidate();
+    }
+
+    mBuffer.Map(device, D3D11_MAP_WRITE_DISCARD);
+    mMapped = true;
+    return static_cast<DX11::InstanceData*>(mBuffer.Data());
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Unmap the buffer, the instances written since Begin are ready to draw
+
+\param device
+  The ID3D11Device
+*/
+/****************************************************************************/
+void DX11::InstanceBuffer::End(const DX11::Device& device)
+{
+    if (mMapped)
+    {
+        mBuffer.Unmap(device);
+        mMapped = false;
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Bind the buffer to InputLayout::INSTANCE_SLOT
+
+\param context
+  Where to bind, the immediate or a deferred context
+*/
+/****************************************************************************/
+void DX11::InstanceBuffer::Bind(DX11::CommandContext& context) const
+{
+    ID3D11Buffer* buffer = mBuffer.Get();
+    uint32_t stride = uint32_t(sizeof(DX11::InstanceData));
+    uint32_t offset = 0;
+    context.SetVertexBuffers(DX11::InputLayout::INSTANCE_SLOT, 1, &buffer, &stride, &offset);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Instances the buffer holds before it has to grow
+*/
+/****************************************************************************/
+uint32_t DX11::InstanceBuffer::Capacity() const
+{
+    return mCapacity;
+}
+
+/*============================================================================*\
+|| ------------------------- PRIVATE FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  (Re)create the buffer
+
+\param device
+  The ID3D11Device
+
+\param capacity
+  Instances it holds
+*/
+/****************************************************************************/
+void DX11::InstanceBuffer::Create(DX11::Device device, uint32_t capacity)
+{
+    mCapacity = capacity;
+    mBuffer = DX11::Buffer(device, capacity * uint32_t(sizeof(DX11::InstanceData)), D3D11_BIND_VERTEX_BUFFER, DX11::BufferUsage::Dynamic);
+}
@@ -0,0 +1,369 @@
+/****************************************************************************/
+/*!
+\file
+   Log.cpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Master global Log class. Messages are formatted on the caller's stack
+    and copied into a ring buffer owned by the calling thread, a single
+    writer thread batches them out to the file. Nothing allocates or
+    touches the disk on the logging thread.
+*/
+/****************************************************************************/
+
+/*============================================================================*\
+|| ------------------------------ INCLUDES ---------------------------------- ||
+\*============================================================================*/
+
+#include "DX11PCH.hpp"
+#include "Log.hpp"
+#include <chrono>
+#include <cstring>
+#include <ctime>
+
+/*============================================================================*\
+|| --------------------------- GLOBAL VARIABLES ----------------------------- ||
+\*============================================================================*/
+
+namespace DEBUG
+{
+    //! bytes of unwritten messages each thread can hold, power of two
+    static const size_t LOG_RING_SIZE = 64 * 1024;
+
+    //! how long the writer sleeps when nobody wakes it
+    static const std::chrono::milliseconds LOG_WRITE_INTERVAL(50);
+
+    //! single producer (the owning thread) / single consumer (the writer) byte ring
+    struct Log::ThreadBuffer
+    {
+        alignas(64) std::atomic<size_t> head = 0;   //!< writer position
+        alignas(64) std::atomic<size_t> tail = 0;   //!< owner position
+        std::atomic<bool> retired = false;          //!< owner thread exited
+        char data[LOG_RING_SIZE];
+    };
+
+    //! thread_local owner of a buffer, retires it when the thread exits
+    struct Log::ThreadHandle
+    {
+        std::shared_ptr<ThreadBuffer> buffer;
+
+        ~ThreadHandle()
+        {
+            if (buffer)
+            {
+                buffer->retired = true;
+            }
+        }
+    };
+}
+
+/*============================================================================*\
+|| -------------------------- STATIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/*============================================================================*\
+|| -------------------------- PUBLIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Append raw text, truncates when full. Leaves room for the newline.
+
+\param text
+  The text to add
+*/
+/****************************************************************************/
+void DEBUG::LogRecord::Write(std::string_view text)
+{
+    size_t count = std::min(text.size(), CAPACITY - 1 - mSize);
+    std::memcpy(mData + mSize, text.data(), count);
+    mSize += count;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Terminate the message with a newline
+*/
+/****************************************************************************/
+void DEBUG::LogRecord::End()
+{
+    mData[mSize++] = '\n';
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the formatted bytes
+*/
+/****************************************************************************/
+const char* DEBUG::LogRecord::Data() const
+{
+    return mData;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the number of formatted bytes
+*/
+/****************************************************************************/
+size_t DEBUG::LogRecord::Size() const
+{
+    return mSize;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Create a fresh, empty log and start the writer
+*/
+/****************************************************************************/
+DEBUG::Log::Log()
+{
+#if LOG_LEVEL > LOG_LEVEL_NONE
+    std::string fname = std::string("Errors_") + PROJECT_NAME;
+
+    // create a new log file or overwrite the existing file
+    mFile = std::fopen(fname.c_str(), "w");
+    if (!mFile)
+    {
+        std::cerr << "ERROR: could not open log file " << fname << " for writing" << std::endl;
+        return;
+    }
+
+    // output time to the top of the debug log
+    std::fprintf(mFile, "%s File local time: %lld\n", fname.c_str(), (long long)std::time(nullptr));
+    std::fprintf(mFile, "Build version: %s %s\n\n", __DATE__, __TIME__);
+    std::fflush(mFile);
+
+    mBatch.reserve(LOG_RING_SIZE);
+    mWriter = std::thread(&Log::WriterLoop, this);
+#endif
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Write out everything still queued and close the file
+*/
+/****************************************************************************/
+DEBUG::Log::~Log()
+{
+    if (mWriter.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mQuit = true;
+        }
+        mWake.notify_all();
+        mWriter.join();
+    }
+
+    if (mFile)
+    {
+        std::fclose(mFile);
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Block until everything logged so far is on disk. Use before breaking
+  into the debugger or crashing on purpose.
+*/
+/****************************************************************************/
+void DEBUG::Log::Flush()
+{
+    if (!mWriter.joinable())
+    {
+        return;
+    }
+
+    // a pass already running may have missed our messages, wait out two
+    std::unique_lock<std::mutex> lock(mMutex);
+    uint64_t target = mPass + 2;
+    mWake.notify_all();
+    mFlushed.wait(lock, [this, target]() { return mPass >= target || mQuit; });
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Number of messages thrown away because a thread's ring was full
+*/
+/****************************************************************************/
+uint64_t DEBUG::Log::Dropped() const
+{
+    return mDropped;
+}
+
+/*============================================================================*\
+|| ------------------------- PRIVATE FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Copy a formatted message into this thread's ring. Never blocks, drops the
+  message if the writer has fallen a whole ring behind.
+
+\param record
+  The message
+
+\param urgent
+  Wake the writer now instead of waiting for its next pass
+
+\return
+  False if the message was dropped
+*/
+/****************************************************************************/
+bool DEBUG::Log::Push(const LogRecord& record, bool urgent)
+{
+    if (!mWriter.joinable())
+    {
+        return false;
+    }
+
+    ThreadBuffer& buffer = LocalBuffer();
+    const size_t size = record.Size();
+    const size_t tail = buffer.tail.load(std::memory_order_relaxed);
+    const size_t head = buffer.head.load(std::memory_order_acquire);
+
+    if (LOG_RING_SIZE - (tail - head) < size)
+    {
+        ++mDropped;
+        mWake.notify_one();
+        return false;
+    }
+
+    // copy, wrapping around the end of the ring
+    const size_t start = tail & (LOG_RING_SIZE - 1);
+    const size_t first = std::min(size, LOG_RING_SIZE - start);
+    std::memcpy(buffer.data + start, record.Data(), first);
+    std::memcpy(buffer.data, record.Data() + first, size - first);
+    buffer.tail.store(tail + size, std::memory_order_release);
+
+    // wake the writer early rather than let the ring fill up
+    if (urgent || tail - head + size > LOG_RING_SIZE / 2)
+    {
+        mWake.notify_one();
+    }
+
+    return true;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the calling thread's ring, registering it on first use
+*/
+/****************************************************************************/
+DEBUG::Log::ThreadBuffer& DEBUG::Log::LocalBuffer()
+{
+    thread_local ThreadHandle handle;
+
+    if (!handle.buffer)
+    {
+        handle.buffer = std::make_shared<ThreadBuffer>();
+        std::lock_guard<std::mutex> lock(mMutex);
+        mBuffers.push_back(handle.buffer);
+    }
+
+    return *handle.buffer;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Writer thread body, drains every ring and writes them out in one go
+*/
+/****************************************************************************/
+void DEBUG::Log::WriterLoop()
+{
+    bool quit = false;
+
+    while (!quit)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mWake.wait_for(lock, LOG_WRITE_INTERVAL);
+            quit = mQuit;
+        }
+
+        // after quit, keep going until the rings are empty
+        while (Drain() && quit)
+        {
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            ++mPass;
+        }
+        mFlushed.notify_all();
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Move every ring's contents into one batch and write it
+
+\return
+  True if anything was written
+*/
+/****************************************************************************/
+bool DEBUG::Log::Drain()
+{
+    mBatch.clear();
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        for (size_t i = 0; i < mBuffers.size();)
+        {
+            ThreadBuffer& buffer = *mBuffers[i];
+            const bool retired = buffer.retired;
+            const size_t head = buffer.head.load(std::memory_order_relaxed);
+            const size_t tail = buffer.tail.load(std::memory_order_acquire);
+
+            const size_t start = head & (LOG_RING_SIZE - 1);
+            const size_t first = std::min(tail - head, LOG_RING_SIZE - start);
+            mBatch.insert(mBatch.end(), buffer.data + start, buffer.data + start + first);
+            mBatch.insert(mBatch.end(), buffer.data, buffer.data + (tail - head - first));
+            buffer.head.store(tail, std::memory_order_release);
+
+            // the owner is gone and everything it wrote is in the batch
+            if (retired)
+            {
+                mBuffers[i] = std::move(mBuffers.back());
+                mBuffers.pop_back();
+            }
+            else
+            {
+                ++i;
+            }
+        }
+    }
+
+    uint64_t dropped = mDropped;
+    if (dropped != mReportedDrops)
+    {
+        std::fprintf(mFile, "Log: dropped %llu messages\n", (unsigned long long)(dropped - mReportedDrops));
+        mReportedDrops = dropped;
+    }
+
+    if (mBatch.empty())
+    {
+        return false;
+    }
+
+    std::fwrite(mBatch.data(), 1, mBatch.size(), mFile);
+    std::fflush(mFile);
+    return true;
+}
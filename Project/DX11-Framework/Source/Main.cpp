@@ -18,6 +18,9 @@
 
 #include "DX11PCH.hpp"
 #include "Engine.hpp"
+#include "Benchmarks.hpp"
+#include <cstring>
+#include <cctype>
 
 /*============================================================================*\
 || --------------------------- GLOBAL VARIABLES ----------------------------- ||
@@ -31,23 +34,67 @@
 || -------------------------- PUBLIC FUNCTIONS ------------------------------ ||
 \*============================================================================*/
 
-int main(char** argv, int argc)
+int main(int argc, char** argv)
 {
-    UNUSED(argv);
-    UNUSED(argc);
+    // --headless [frames] renders without a window or GPU and prints frame stats
+    // --bench <name> [count] runs one of the CPU benchmarks and exits
+    // --frames-in-flight <count> how far the main thread runs ahead of the render thread, 0 for none
+    bool headless = false;
+    uint32_t frames = 1000;
+    uint32_t framesInFlight = 2;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--headless") == 0)
+        {
+            headless = true;
+            if (i + 1 < argc && std::isdigit(static_cast<unsigned char>(argv[i + 1][0])))
+            {
+                frames = uint32_t(std::strtoul(argv[++i], nullptr, 10));
+            }
+        }
+        else if (std::strcmp(argv[i], "--frames-in-flight") == 0 && i + 1 < argc)
+        {
+            framesInFlight = uint32_t(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--bench") == 0 && i + 1 < argc)
+        {
+            std::string name = argv[++i];
+            uint32_t count = 0;
+            if (i + 1 < argc && std::isdigit(static_cast<unsigned char>(argv[i + 1][0])))
+            {
+                count = uint32_t(std::strtoul(argv[++i], nullptr, 10));
+            }
+
+            if (!DX11::Benchmark::Run(name, count))
+            {
+                std::cerr << "Unknown benchmark " << name << std::endl;
+                return EXIT_FAILURE;
+            }
+            DEBUG::log.Flush();
+            return 0;
+        }
+    }
 
-    DX11::Engine engine;
+    DX11::Engine engine(headless, framesInFlight);
     engine.Init();
 
     try
     {
-        engine.Run();
+        if (headless)
+        {
+            engine.RunHeadless(frames);
+        }
+        else
+        {
+            engine.Run();
+        }
     }
     catch (const std::exception& e)
     {
         // should be handled better
         std::cerr << e.what() << std::endl;
         DEBUG::log.Error(e.what());
+        DEBUG::log.Flush();
         __debugbreak();
         return EXIT_FAILURE;
     }
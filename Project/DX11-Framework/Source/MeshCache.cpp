@@ -0,0 +1,448 @@
+/****************************************************************************/
+/*!
+\file
+   MeshCache.cpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Versioned binary cache of imported mesh data. The file is laid out as
+    header + vertex blob + index blob + submesh table so it can be memory
+    mapped and handed straight to buffer creation without any parsing.
+*/
+/****************************************************************************/
+
+/*============================================================================*\
+|| ------------------------------ INCLUDES ---------------------------------- ||
+\*============================================================================*/
+
+#include "DX11PCH.hpp"
+#include "MeshCache.hpp"
+#include "Mesh.hpp"
+#include <filesystem>
+#include <fstream>
+
+/*============================================================================*\
+|| --------------------------- GLOBAL VARIABLES ----------------------------- ||
+\*============================================================================*/
+
+/*============================================================================*\
+|| -------------------------- STATIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+namespace DX11
+{
+    /****************************************************************************/
+    /*!
+    \brief
+      Round a byte offset up so every blob starts 16 byte aligned
+
+    \param offset
+      The offset to align
+    */
+    /****************************************************************************/
+    static uint64_t AlignBlob(uint64_t offset)
+    {
+        return (offset + 15) & ~uint64_t(15);
+    }
+
+    /****************************************************************************/
+    /*!
+    \brief
+      Check a blob described by the header actually fits inside the file
+
+    \param offset
+      Byte offset of the blob
+
+    \param size
+      Byte size of the blob
+
+    \param fileSize
+      Size of the mapped file
+    */
+    /****************************************************************************/
+    static bool BlobInFile(uint64_t offset, uint64_t size, uint64_t fileSize)
+    {
+        return offset <= fileSize && size <= fileSize - offset;
+    }
+
+    /****************************************************************************/
+    /*!
+    \brief
+      Check a run of indices of a submesh lies inside the index blob
+
+    \param submesh
+      The submesh, its offset and format give the index region
+
+    \param firstIndex
+      First index inside the region
+
+    \param indexCount
+      Number of indices
+
+    \param indexBytes
+      Size of the index blob
+    */
+    /****************************************************************************/
+    static bool IndicesInBlob(const DX11::Submesh& submesh, uint32_t firstIndex, uint32_t indexCount, uint64_t indexBytes)
+    {
+        const uint64_t width = submesh.indexFormat == DXGI_FORMAT_R16_UINT ? sizeof(uint16_t) : sizeof(uint32_t);
+        return BlobInFile(submesh.indexOffset + firstIndex * width, indexCount * width, indexBytes);
+    }
+
+    /****************************************************************************/
+    /*!
+    \brief
+      Check every submesh and meshlet record only points at data inside the
+      vertex and index blobs, so a corrupt cache can't make the occluder
+      build or a draw read past them
+
+    \param header
+      The validated header
+
+    \param submeshes
+      header.submeshCount submeshes
+
+    \param meshlets
+      header.meshletCount meshlets
+    */
+    /****************************************************************************/
+    static bool RecordsInBlobs(const DX11::MeshCacheHeader& header, const DX11::Submesh* submeshes, const DX11::Meshlet* meshlets)
+    {
+        for (uint32_t i = 0; i < header.submeshCount; ++i)
+        {
+            const DX11::Submesh& submesh = submeshes[i];
+            const uint64_t width = submesh.indexFormat == DXGI_FORMAT_R16_UINT ? sizeof(uint16_t) : sizeof(uint32_t);
+            bool valid = (submesh.indexFormat == DXGI_FORMAT_R16_UINT || submesh.indexFormat == DXGI_FORMAT_R32_UINT)
+                && submesh.indexOffset % width == 0
+                && uint64_t(submesh.baseVertex) + submesh.vertexCount <= header.vertexCount
+                && submesh.lodCount >= 1 && submesh.lodCount <= DX11::MESH_LOD_COUNT
+                && IndicesInBlob(submesh, submesh.firstIndex, submesh.indexCount, header.indexBytes)
+                && uint64_t(submesh.firstMeshlet) + submesh.meshletCount <= header.meshletCount;
+
+            for (uint32_t lod = 0; valid && lod < submesh.lodCount; ++lod)
+            {
+                valid = IndicesInBlob(submesh, submesh.lods[lod].firstIndex, submesh.lods[lod].indexCount, header.indexBytes);
+            }
+
+            for (uint32_t m = 0; valid && m < submesh.meshletCount; ++m)
+            {
+                const DX11::Meshlet& meshlet = meshlets[submesh.firstMeshlet + m];
+                valid = IndicesInBlob(submesh, meshlet.firstIndex, meshlet.indexCount, header.indexBytes);
+            }
+
+            if (!valid)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+}
+
+/*============================================================================*\
+|| -------------------------- PUBLIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Unmap the cache file
+*/
+/****************************************************************************/
+DX11::MeshCache::~MeshCache()
+{
+    Close();
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Map a cache file and validate it against the source it was built from
+
+\param path
+  Path of the cache file
+
+\param sourceHash
+  Hash of the source model the cache must have been built from
+
+\param importFlags
+  The assimp post process flags the cache must have been built with
+
+\param vertexFormat
+  The vertex layout the cache must have been built with
+
+\return
+  True if the cache was mapped and is up to date
+*/
+/****************************************************************************/
+bool DX11::MeshCache::Open(const std::string& path, uint64_t sourceHash, uint32_t importFlags, DX11::VertexFormat vertexFormat)
+{
+    Close();
+
+    mFile = CreateFileW(utf8ToUtf16(path).c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (mFile == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    LARGE_INTEGER fileSize = {};
+    if (!GetFileSizeEx(mFile, &fileSize) || uint64_t(fileSize.QuadPart) < sizeof(MeshCacheHeader))
+    {
+        Close();
+        return false;
+    }
+
+    mMapping = CreateFileMappingW(mFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mMapping == nullptr)
+    {
+        Close();
+        return false;
+    }
+
+    mView = static_cast<const uint8_t*>(MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0));
+    if (mView == nullptr)
+    {
+        Close();
+        return false;
+    }
+
+    // reject anything stale or truncated
+    std::memcpy(&mHeader, mView, sizeof(MeshCacheHeader));
+    uint64_t size = uint64_t(fileSize.QuadPart);
+    bool valid = mHeader.magic == MESH_CACHE_MAGIC
+        && mHeader.version == MESH_CACHE_VERSION
+        && mHeader.sourceHash == sourceHash
+        && mHeader.importFlags == importFlags
+        && mHeader.vertexFormat == uint32_t(vertexFormat)
+        && mHeader.vertexStride == DX11::VertexStride(vertexFormat)
+        && BlobInFile(mHeader.vertexOffset, uint64_t(mHeader.vertexCount) * mHeader.vertexStride, size)
+        && BlobInFile(mHeader.indexOffset, mHeader.indexBytes, size)
+        && BlobInFile(mHeader.submeshOffset, uint64_t(mHeader.submeshCount) * sizeof(DX11::Submesh), size)
+        && BlobInFile(mHeader.meshletOffset, uint64_t(mHeader.meshletCount) * sizeof(DX11::Meshlet), size)
+        && RecordsInBlobs(mHeader, Submeshes(), Meshlets());
+
+    if (!valid)
+    {
+        Close();
+        return false;
+    }
+
+    return true;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Release the file mapping
+*/
+/****************************************************************************/
+void DX11::MeshCache::Close()
+{
+    if (mView != nullptr)
+    {
+        UnmapViewOfFile(mView);
+        mView = nullptr;
+    }
+
+    if (mMapping != nullptr)
+    {
+        CloseHandle(mMapping);
+        mMapping = nullptr;
+    }
+
+    if (mFile != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(mFile);
+        mFile = INVALID_HANDLE_VALUE;
+    }
+
+    mHeader = MeshCacheHeader();
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Write a cache file. The data is written to a temporary file first and
+  then moved over the old cache so a crash never leaves a half written file.
+
+\param path
+  Path of the cache file
+
+\param header
+  Filled out header, the offsets are computed here
+
+\param vertices
+  header.vertexCount * header.vertexStride bytes of vertex data
+
+\param indices
+  header.indexBytes bytes of packed 16 / 32 bit index data
+
+\param submeshes
+  header.submeshCount submesh ranges
+
+\param meshlets
+  header.meshletCount meshlets
+*/
+/****************************************************************************/
+void DX11::MeshCache::Write(const std::string& path, const MeshCacheHeader& header, const void* vertices,
+    const void* indices, const DX11::Submesh* submeshes, const DX11::Meshlet* meshlets)
+{
+    MeshCacheHeader out = header;
+    out.magic = MESH_CACHE_MAGIC;
+    out.version = MESH_CACHE_VERSION;
+    out.vertexOffset = AlignBlob(sizeof(MeshCacheHeader));
+    out.indexOffset = AlignBlob(out.vertexOffset + uint64_t(out.vertexCount) * out.vertexStride);
+    out.submeshOffset = AlignBlob(out.indexOffset + out.indexBytes);
+    out.meshletOffset = AlignBlob(out.submeshOffset + uint64_t(out.submeshCount) * sizeof(DX11::Submesh));
+
+    std::string tempPath = path + ".tmp";
+    {
+        std::ofstream ofs(tempPath, std::ofstream::binary | std::ofstream::trunc);
+        if (!ofs)
+        {
+            throw std::runtime_error("DX11: Could not open mesh cache for writing! Path:\n" + tempPath + "\n");
+        }
+
+        static const char padding[16] = {};
+        auto writeBlob = [&ofs](uint64_t offset, const void* data, uint64_t size)
+        {
+            uint64_t position = uint64_t(ofs.tellp());
+            ofs.write(padding, std::streamsize(offset - position));
+            ofs.write(static_cast<const char*>(data), std::streamsize(size));
+        };
+
+        ofs.write(reinterpret_cast<const char*>(&out), sizeof(MeshCacheHeader));
+        writeBlob(out.vertexOffset, vertices, uint64_t(out.vertexCount) * out.vertexStride);
+        writeBlob(out.indexOffset, indices, out.indexBytes);
+        writeBlob(out.submeshOffset, submeshes, uint64_t(out.submeshCount) * sizeof(DX11::Submesh));
+        writeBlob(out.meshletOffset, meshlets, uint64_t(out.meshletCount) * sizeof(DX11::Meshlet));
+
+        if (!ofs)
+        {
+            throw std::runtime_error("DX11: Failed writing mesh cache! Path:\n" + tempPath + "\n");
+        }
+    }
+
+    if (!MoveFileExW(utf8ToUtf16(tempPath).c_str(), utf8ToUtf16(path).c_str(), MOVEFILE_REPLACE_EXISTING))
+    {
+        DeleteFileW(utf8ToUtf16(tempPath).c_str());
+        throw std::runtime_error("DX11: Failed to replace mesh cache! Path:\n" + path + "\n");
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  64 bit FNV-1a hash of a file's size and last write time. Cheap enough
+  for every warm load, reading the whole model would cost as much as the
+  cache saves. Any save of the source changes its write time.
+
+\param path
+  The file to stamp
+
+\return
+  The hash, or 0 if the file could not be read
+*/
+/****************************************************************************/
+uint64_t DX11::MeshCache::HashFile(const std::string& path)
+{
+    const std::filesystem::path source = std::filesystem::u8path(path);
+    std::error_code error;
+    const uint64_t size = std::filesystem::file_size(source, error);
+    if (error)
+    {
+        return 0;
+    }
+
+    const std::filesystem::file_time_type written = std::filesystem::last_write_time(source, error);
+    if (error)
+    {
+        return 0;
+    }
+
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (uint64_t word : { size, uint64_t(written.time_since_epoch().count()) })
+    {
+        for (uint32_t byte = 0; byte < sizeof(word); ++byte)
+        {
+            hash ^= (word >> (byte * 8)) & 0xff;
+            hash *= 0x100000001b3ull;
+        }
+    }
+
+    return hash;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Where the cache for a model lives
+
+\param path
+  Path of the source model
+*/
+/****************************************************************************/
+std::string DX11::MeshCache::CachePath(const std::string& path)
+{
+    return path + ".meshcache";
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the validated header
+*/
+/****************************************************************************/
+const DX11::MeshCacheHeader& DX11::MeshCache::Header() const
+{
+    return mHeader;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the mapped vertex blob
+*/
+/****************************************************************************/
+const void* DX11::MeshCache::Vertices() const
+{
+    return mView + mHeader.vertexOffset;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the mapped index blob
+*/
+/****************************************************************************/
+const void* DX11::MeshCache::Indices() const
+{
+    return mView + mHeader.indexOffset;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the mapped submesh table
+*/
+/****************************************************************************/
+const DX11::Submesh* DX11::MeshCache::Submeshes() const
+{
+    return reinterpret_cast<const DX11::Submesh*>(mView + mHeader.submeshOffset);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the mapped meshlet table
+*/
+/****************************************************************************/
+const DX11::Meshlet* DX11::MeshCache::Meshlets() const
+{
+    return reinterpret_cast<const DX11::Meshlet*>(mView + mHeader.meshletOffset);
+}
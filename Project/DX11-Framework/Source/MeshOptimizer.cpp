@@ -0,0 +1,516 @@
+/****************************************************************************/
+/*!
+\file
+   MeshOptimizer.cpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Import time index / vertex optimization. Welds identical vertices,
+    reorders triangles for the post-transform cache (Forsyth) and then
+    reorders vertices for fetch locality. Vertices are treated as raw
+    bytes of a given stride so any layout can be passed in.
+*/
+/****************************************************************************/
+
+/*============================================================================*\
+|| ------------------------------ INCLUDES ---------------------------------- ||
+\*============================================================================*/
+
+#include "DX11PCH.hpp"
+#include "MeshOptimizer.hpp"
+#include "WorkerPool.hpp"
+#include <cfloat>
+
+/*============================================================================*\
+|| --------------------------- GLOBAL VARIABLES ----------------------------- ||
+\*============================================================================*/
+
+namespace DX11
+{
+    namespace MeshOptimizer
+    {
+        //! size of the LRU cache the Forsyth scoring models
+        static const uint32_t FORSYTH_CACHE_SIZE = 32;
+        static const uint32_t INVALID_INDEX = ~0u;
+    }
+}
+
+/*============================================================================*\
+|| -------------------------- STATIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+namespace DX11
+{
+    namespace MeshOptimizer
+    {
+        /****************************************************************************/
+        /*!
+        \brief
+          FNV-1a hash of a vertex
+
+        \param vertex
+          Pointer to the vertex bytes
+
+        \param stride
+          Size of the vertex
+        */
+        /****************************************************************************/
+        static uint32_t HashVertex(const uint8_t* vertex, size_t stride)
+        {
+            uint32_t hash = 2166136261u;
+            for (size_t i = 0; i < stride; ++i)
+            {
+                hash ^= vertex[i];
+                hash *= 16777619u;
+            }
+            return hash;
+        }
+
+        /****************************************************************************/
+        /*!
+        \brief
+          Forsyth vertex score
+          https://tomforsyth1000.github.io/papers/fast_vert_cache_opt.html
+
+        \param cachePosition
+          Position in the simulated LRU, -1 if not cached
+
+        \param remaining
+          Number of triangles still to be emitted that use this vertex
+        */
+        /****************************************************************************/
+        static float VertexScore(int cachePosition, uint32_t remaining)
+        {
+            if (remaining == 0)
+            {
+                return -1.0f;
+            }
+
+            float score = 0.0f;
+            if (cachePosition >= 0)
+            {
+                // the last triangle's vertices score the same, so we do not
+                // favour a particular winding
+                if (cachePosition < 3)
+                {
+                    score = 0.75f;
+                }
+                else
+                {
+                    float scale = 1.0f - float(cachePosition - 3) / float(FORSYTH_CACHE_SIZE - 3);
+                    score = std::pow(scale, 1.5f);
+                }
+            }
+
+            // boost vertices with few triangles left so we do not strand them
+            score += 2.0f / std::sqrt(float(remaining));
+            return score;
+        }
+    }
+}
+
+/*============================================================================*\
+|| -------------------------- PUBLIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Merge bitwise identical vertices. Vertices are compacted in place and the
+  indices remapped.
+
+\param vertices
+  vertexCount * stride bytes of vertex data
+
+\param vertexCount
+  Number of vertices
+
+\param stride
+  Size of a vertex
+
+\param indices
+  The index list to remap
+
+\param indexCount
+  Number of indices
+
+\return
+  The number of unique vertices left at the front of vertices
+*/
+/****************************************************************************/
+size_t DX11::MeshOptimizer::WeldVertices(void* vertices, size_t vertexCount, size_t stride, uint32_t* indices, size_t indexCount)
+{
+    uint8_t* data = static_cast<uint8_t*>(vertices);
+
+    size_t tableSize = 1;
+    while (tableSize < vertexCount * 2)
+    {
+        tableSize <<= 1;
+    }
+
+    std::vector<uint32_t> table(tableSize, INVALID_INDEX);
+    std::vector<uint32_t> remap(vertexCount);
+    size_t unique = 0;
+
+    for (size_t i = 0; i < vertexCount; ++i)
+    {
+        const uint8_t* vertex = data + i * stride;
+        size_t slot = HashVertex(vertex, stride) & (tableSize - 1);
+
+        // linear probe, entries refer to already compacted vertices
+        while (table[slot] != INVALID_INDEX && std::memcmp(data + table[slot] * stride, vertex, stride) != 0)
+        {
+            slot = (slot + 1) & (tableSize - 1);
+        }
+
+        if (table[slot] == INVALID_INDEX)
+        {
+            if (unique != i)
+            {
+                std::memmove(data + unique * stride, vertex, stride);
+            }
+            table[slot] = uint32_t(unique++);
+        }
+
+        remap[i] = table[slot];
+    }
+
+    for (size_t i = 0; i < indexCount; ++i)
+    {
+        indices[i] = remap[indices[i]];
+    }
+
+    return unique;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Reorder triangles for the post-transform vertex cache using Tom Forsyth's
+  linear speed algorithm.
+
+\param indices
+  Triangle list to reorder in place
+
+\param indexCount
+  Number of indices
+
+\param vertexCount
+  Number of vertices the indices reference
+*/
+/****************************************************************************/
+void DX11::MeshOptimizer::OptimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount)
+{
+    const size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0)
+    {
+        return;
+    }
+
+    // vertex -> triangle adjacency
+    std::vector<uint32_t> remaining(vertexCount, 0);
+    for (size_t i = 0; i < triangleCount * 3; ++i)
+    {
+        ++remaining[indices[i]];
+    }
+
+    std::vector<uint32_t> offsets(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; ++v)
+    {
+        offsets[v + 1] = offsets[v] + remaining[v];
+    }
+
+    std::vector<uint32_t> adjacency(triangleCount * 3);
+    std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+    for (size_t t = 0; t < triangleCount; ++t)
+    {
+        for (size_t k = 0; k < 3; ++k)
+        {
+            adjacency[cursor[indices[t * 3 + k]]++] = uint32_t(t);
+        }
+    }
+
+    // initial scores
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> vertexScore(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v)
+    {
+        vertexScore[v] = VertexScore(-1, remaining[v]);
+    }
+
+    std::vector<float> triangleScore(triangleCount);
+    std::vector<uint8_t> emitted(triangleCount, 0);
+    uint32_t best = 0;
+    for (size_t t = 0; t < triangleCount; ++t)
+    {
+        const uint32_t* triangle = indices + t * 3;
+        triangleScore[t] = vertexScore[triangle[0]] + vertexScore[triangle[1]] + vertexScore[triangle[2]];
+        if (triangleScore[t] > triangleScore[best])
+        {
+            best = uint32_t(t);
+        }
+    }
+
+    std::vector<uint32_t> output;
+    output.reserve(triangleCount * 3);
+
+    uint32_t cache[FORSYTH_CACHE_SIZE + 3];
+    size_t cacheCount = 0;
+    size_t scan = 0;
+
+    while (output.size() < triangleCount * 3)
+    {
+        // dead end, take the next triangle in input order
+        if (best == INVALID_INDEX)
+        {
+            while (emitted[scan])
+            {
+                ++scan;
+            }
+            best = uint32_t(scan);
+        }
+
+        const uint32_t* triangle = indices + best * 3;
+        emitted[best] = 1;
+        output.insert(output.end(), triangle, triangle + 3);
+
+        // push the triangle to the front of the LRU
+        uint32_t newCache[FORSYTH_CACHE_SIZE + 3];
+        size_t newCount = 0;
+        for (size_t k = 0; k < 3; ++k)
+        {
+            --remaining[triangle[k]];
+            if (std::find(newCache, newCache + newCount, triangle[k]) == newCache + newCount)
+            {
+                newCache[newCount++] = triangle[k];
+            }
+        }
+
+        for (size_t i = 0; i < cacheCount; ++i)
+        {
+            if (std::find(newCache, newCache + newCount, cache[i]) == newCache + newCount)
+            {
+                newCache[newCount++] = cache[i];
+            }
+        }
+
+        // rescore everything that moved, anything past the end got evicted
+        for (size_t i = 0; i < newCount; ++i)
+        {
+            uint32_t v = newCache[i];
+            cachePosition[v] = i < FORSYTH_CACHE_SIZE ? int(i) : -1;
+
+            float score = VertexScore(cachePosition[v], remaining[v]);
+            float delta = score - vertexScore[v];
+            vertexScore[v] = score;
+
+            for (uint32_t a = offsets[v]; a < offsets[v + 1]; ++a)
+            {
+                triangleScore[adjacency[a]] += delta;
+            }
+        }
+
+        cacheCount = std::min<size_t>(newCount, FORSYTH_CACHE_SIZE);
+        std::copy(newCache, newCache + cacheCount, cache);
+
+        // best candidate is always touching the cache
+        best = INVALID_INDEX;
+        float bestScore = -FLT_MAX;
+        for (size_t i = 0; i < cacheCount; ++i)
+        {
+            uint32_t v = cache[i];
+            for (uint32_t a = offsets[v]; a < offsets[v + 1]; ++a)
+            {
+                uint32_t t = adjacency[a];
+                if (!emitted[t] && triangleScore[t] > bestScore)
+                {
+                    bestScore = triangleScore[t];
+                    best = t;
+                }
+            }
+        }
+    }
+
+    std::copy(output.begin(), output.end(), indices);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Reorder vertices into the order the indices first reference them, so the
+  vertex fetch walks memory linearly. Unreferenced vertices are dropped.
+
+\param vertices
+  vertexCount * stride bytes of vertex data
+
+\param vertexCount
+  Number of vertices
+
+\param stride
+  Size of a vertex
+
+\param indices
+  The index list to remap
+
+\param indexCount
+  Number of indices
+
+\return
+  The number of vertices still referenced
+*/
+/****************************************************************************/
+size_t DX11::MeshOptimizer::OptimizeVertexFetch(void* vertices, size_t vertexCount, size_t stride, uint32_t* indices, size_t indexCount)
+{
+    std::vector<uint32_t> remap(vertexCount, INVALID_INDEX);
+    uint32_t next = 0;
+
+    for (size_t i = 0; i < indexCount; ++i)
+    {
+        uint32_t& index = remap[indices[i]];
+        if (index == INVALID_INDEX)
+        {
+            index = next++;
+        }
+        indices[i] = index;
+    }
+
+    uint8_t* data = static_cast<uint8_t*>(vertices);
+    std::vector<uint8_t> source(data, data + vertexCount * stride);
+    for (size_t v = 0; v < vertexCount; ++v)
+    {
+        if (remap[v] != INVALID_INDEX)
+        {
+            std::memcpy(data + remap[v] * stride, source.data() + v * stride, stride);
+        }
+    }
+
+    return next;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Pack index lists into one buffer. Lists over at most MAX_NARROW_VERTICES
+  vertices are narrowed and packed into a leading R16 region, the rest
+  follow in a 4 byte aligned R32 region. Each list keeps indexing its own
+  vertices, so lists of the same width share one index buffer binding and
+  a draw only needs the region and the first index.
+
+\param indices
+  count lists of indices
+
+\param indexCounts
+  Number of indices in each list
+
+\param vertexCounts
+  Number of vertices each list indexes, every index is below it
+
+\param count
+  Number of lists
+
+\param out
+  Receives the packed buffer
+
+\param ranges
+  Receives where each of the count lists went
+
+\param pool
+  Copies the lists in parallel
+*/
+/****************************************************************************/
+void DX11::MeshOptimizer::PackIndices(const uint32_t* const* indices, const size_t* indexCounts, const uint32_t* vertexCounts, size_t count,
+    std::vector<uint8_t>& out, PackedRange* ranges, DX11::WorkerPool& pool)
+{
+    // prefix sum each region
+    size_t narrowCount = 0;
+    size_t wideCount = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (vertexCounts[i] <= MAX_NARROW_VERTICES)
+        {
+            ranges[i].indexFormat = DXGI_FORMAT_R16_UINT;
+            ranges[i].firstIndex = uint32_t(narrowCount);
+            narrowCount += indexCounts[i];
+        }
+        else
+        {
+            ranges[i].indexFormat = DXGI_FORMAT_R32_UINT;
+            ranges[i].firstIndex = uint32_t(wideCount);
+            wideCount += indexCounts[i];
+        }
+    }
+
+    // R16 region first, R32 region 4 byte aligned after it
+    const size_t wideOffset = (narrowCount * sizeof(uint16_t) + 3) & ~size_t(3);
+    out.assign(wideOffset + wideCount * sizeof(uint32_t), 0);
+
+    uint16_t* narrowOut = reinterpret_cast<uint16_t*>(out.data());
+    uint32_t* wideOut = reinterpret_cast<uint32_t*>(out.data() + wideOffset);
+
+    pool.ParallelFor(count, [&](size_t i)
+    {
+        PackedRange& range = ranges[i];
+        if (range.indexFormat == DXGI_FORMAT_R16_UINT)
+        {
+            range.indexOffset = 0;
+            std::transform(indices[i], indices[i] + indexCounts[i], narrowOut + range.firstIndex, [](uint32_t index) { return uint16_t(index); });
+        }
+        else
+        {
+            range.indexOffset = uint32_t(wideOffset);
+            std::copy(indices[i], indices[i] + indexCounts[i], wideOut + range.firstIndex);
+        }
+    });
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Simulate a FIFO post-transform cache to measure how much vertex shading a
+  triangle list costs.
+
+\param indices
+  Triangle list
+
+\param indexCount
+  Number of indices
+
+\param vertexCount
+  Number of vertices the indices reference
+
+\param cacheSize
+  Entries in the simulated FIFO
+
+\return
+  ACMR and ATVR of the list
+*/
+/****************************************************************************/
+DX11::MeshOptimizer::VertexCacheStats DX11::MeshOptimizer::AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize)
+{
+    VertexCacheStats stats;
+    if (indexCount < 3 || vertexCount == 0)
+    {
+        return stats;
+    }
+
+    // a vertex is cached if it was pushed less than cacheSize pushes ago
+    std::vector<uint32_t> timestamp(vertexCount, 0);
+    uint32_t time = cacheSize + 1;
+
+    for (size_t i = 0; i < indexCount; ++i)
+    {
+        uint32_t v = indices[i];
+        if (time - timestamp[v] > cacheSize)
+        {
+            timestamp[v] = time++;
+            ++stats.transformed;
+        }
+    }
+
+    stats.acmr = float(stats.transformed) / float(indexCount / 3);
+    stats.atvr = float(stats.transformed) / float(vertexCount);
+    return stats;
+}
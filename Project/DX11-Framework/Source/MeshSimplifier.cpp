@@ -0,0 +1,774 @@
+/****************************************************************************/
+/*!
+\file
+   MeshSimplifier.cpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Import time LOD generation. Quadric error edge collapse (Garland and
+    Heckbert) that only ever moves a vertex onto one of its neighbours, so
+    every level indexes the original vertices and can share their buffer.
+    Open borders only collapse along themselves and vertices on attribute
+    seams are never moved. Vertices are treated as raw bytes of a given
+    stride, the position is read from the first 3 floats.
+*/
+/****************************************************************************/
+
+/*============================================================================*\
+|| ------------------------------ INCLUDES ---------------------------------- ||
+\*============================================================================*/
+
+#include "DX11PCH.hpp"
+#include "MeshSimplifier.hpp"
+#include "MeshOptimizer.hpp"
+#include <cfloat>
+#include <numeric>
+
+/*============================================================================*\
+|| --------------------------- GLOBAL VARIABLES ----------------------------- ||
+\*============================================================================*/
+
+namespace DX11
+{
+    namespace MeshSimplifier
+    {
+        //! how hard border planes pull compared to the surface planes
+        static const double BORDER_WEIGHT = 10.0;
+
+        //! a level has to get at least this much of the way to its target or the chain stops
+        static const float MIN_PROGRESS = 0.5f;
+
+        //! cheapest candidates sorted per collapse a pass wants, the rest wait for the next pass
+        static const size_t CANDIDATES_PER_COLLAPSE = 4;
+
+        enum VertexKind : uint8_t
+        {
+            KIND_MANIFOLD,  //!< free to collapse onto any neighbour
+            KIND_BORDER,    //!< on an open edge, only collapses along it
+            KIND_LOCKED     //!< shares its position with another vertex, never moves
+        };
+    }
+}
+
+/*============================================================================*\
+|| -------------------------- STATIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+namespace DX11
+{
+    namespace MeshSimplifier
+    {
+        //! symmetric 4x4 error quadric, summed plane equations weighted by area
+        struct Quadric
+        {
+            double a00 = 0, a11 = 0, a22 = 0;
+            double a01 = 0, a02 = 0, a12 = 0;
+            double b0 = 0, b1 = 0, b2 = 0;
+            double c = 0;
+            double weight = 0;
+        };
+
+        //! move from onto to
+        struct Collapse
+        {
+            uint32_t from;
+            uint32_t to;
+            double cost;
+        };
+
+        //! the mesh being simplified, the per pass scratch is kept to reuse its memory
+        struct State
+        {
+            std::vector<float> positions;
+            std::vector<uint32_t> positionId;   //!< lowest vertex sharing this vertex's position
+            std::vector<uint8_t> kind;
+            std::vector<Quadric> quadrics;
+            std::vector<uint32_t> indices;
+            double error = 0.0;                 //!< worst collapse so far, squared distance
+
+            std::vector<uint32_t> triangleOffsets;
+            std::vector<uint32_t> triangles;
+            std::vector<uint64_t> edges;        //!< directed edges between position ids, sorted
+            std::vector<Collapse> collapses;
+            std::vector<uint8_t> touched;
+            std::vector<uint32_t> remap;
+        };
+
+        /****************************************************************************/
+        /*!
+        \brief
+          Add a weighted plane to a quadric
+
+        \param quadric
+          The quadric to add to
+
+        \param normal
+          Unit plane normal
+
+        \param distance
+          Plane offset, dot(normal, p) + distance = 0 on the plane
+
+        \param weight
+          How much the plane counts
+        */
+        /****************************************************************************/
+        static void AddPlane(Quadric& quadric, const double normal[3], double distance, double weight)
+        {
+            quadric.a00 += weight * normal[0] * normal[0];
+            quadric.a11 += weight * normal[1] * normal[1];
+            quadric.a22 += weight * normal[2] * normal[2];
+            quadric.a01 += weight * normal[0] * normal[1];
+            quadric.a02 += weight * normal[0] * normal[2];
+            quadric.a12 += weight * normal[1] * normal[2];
+            quadric.b0 += weight * normal[0] * distance;
+            quadric.b1 += weight * normal[1] * distance;
+            quadric.b2 += weight * normal[2] * distance;
+            quadric.c += weight * distance * distance;
+            quadric.weight += weight;
+        }
+
+        /****************************************************************************/
+        /*!
+        \brief
+          Sum two quadrics
+
+        \param quadric
+          Receives the sum
+
+        \param other
+          The quadric to add
+        */
+        /****************************************************************************/
+        static void AddQuadric(Quadric& quadric, const Quadric& other)
+        {
+            quadric.a00 += other.a00;
+            quadric.a11 += other.a11;
+            quadric.a22 += other.a22;
+            quadric.a01 += other.a01;
+            quadric.a02 += other.a02;
+            quadric.a12 += other.a12;
+            quadric.b0 += other.b0;
+            quadric.b1 += other.b1;
+            quadric.b2 += other.b2;
+            quadric.c += other.c;
+            quadric.weight += other.weight;
+        }
+
+        /****************************************************************************/
+        /*!
+        \brief
+          Weighted sum of squared distances from a point to the quadric's
+          planes, divided by the total weight
+
+        \param quadric
+          The quadric
+
+        \param p
+          The point
+
+        \return
+          Mean squared distance, 0 for an empty quadric
+        */
+        /****************************************************************************/
+        static double QuadricError(const Quadric& quadric, const float* p)
+        {
+            if (quadric.weight <= 0.0)
+            {
+                return 0.0;
+            }
+
+            const double x = p[0], y = p[1], z = p[2];
+            double error = quadric.a00 * x * x + quadric.a11 * y * y + quadric.a22 * z * z
+                + 2.0 * (quadric.a01 * x * y + quadric.a02 * x * z + quadric.a12 * y * z)
+                + 2.0 * (quadric.b0 * x + quadric.b1 * y + quadric.b2 * z)
+                + quadric.c;
+
+            // rounding can push a perfect fit just below zero
+            return std::max(error, 0.0) / quadric.weight;
+        }
+
+        /****************************************************************************/
+        /*!
+        \brief
+          Unnormalized normal of a triangle, twice its area long
+
+        \param a, b, c
+          The corner positions
+
+        \param normal
+          Receives the normal
+        */
+        /****************************************************************************/
+        static void TriangleNormal(const float* a, const float* b, const float* c, double normal[3])
+        {
+            const double ab[3] = { double(b[0]) - a[0], double(b[1]) - a[1], double(b[2]) - a[2] };
+            const double ac[3] = { double(c[0]) - a[0], double(c[1]) - a[1], double(c[2]) - a[2] };
+            normal[0] = ab[1] * ac[2] - ab[2] * ac[1];
+            normal[1] = ab[2] * ac[0] - ab[0] * ac[2];
+            normal[2] = ab[0] * ac[1] - ab[1] * ac[0];
+        }
+
+        /****************************************************************************/
+        /*!
+        \brief
+          Pack a directed edge between position ids
+        */
+        /****************************************************************************/
+        static uint64_t EdgeKey(uint32_t from, uint32_t to)
+        {
+            return (uint64_t(from) << 32) | to;
+        }
+
+        /****************************************************************************/
+        /*!
+        \brief
+          Check the sorted edge list for a directed edge between positions
+        */
+        /****************************************************************************/
+        static bool HasEdge(const State& state, uint32_t from, uint32_t to)
+        {
+            return std::binary_search(state.edges.begin(), state.edges.end(), EdgeKey(from, to));
+        }
+
+        /****************************************************************************/
+        /*!
+        \brief
+          An edge is open when only one of its directions is used by a
+          triangle. Checked by position so attribute seams do not count.
+        */
+        /****************************************************************************/
+        static bool IsBorderEdge(const State& state, uint32_t a, uint32_t b)
+        {
+            const uint32_t pa = state.positionId[a];
+            const uint32_t pb = state.positionId[b];
+            return HasEdge(state, pa, pb) != HasEdge(state, pb, pa);
+        }
+
+        /****************************************************************************/
+        /*!
+        \brief
+          Rebuild the sorted list of directed position edges
+        */
+        /****************************************************************************/
+        static void BuildEdges(State& state)
+        {
+            state.edges.clear();
+            state.edges.reserve(state.indices.size());
+            for (size_t i = 0; i < state.indices.size(); i += 3)
+            {
+                for (size_t e = 0; e < 3; ++e)
+                {
+                    const uint32_t a = state.positionId[state.indices[i + e]];
+                    const uint32_t b = state.positionId[state.indices[i + (e + 1) % 3]];
+                    state.edges.push_back(EdgeKey(a, b));
+                }
+            }
+            std::sort(state.edges.begin(), state.edges.end());
+        }
+
+        /****************************************************************************/
+        /*!
+        \brief
+          Copy the mesh in, find seams and borders and accumulate the
+          quadrics of the original surface
+
+        \param state
+          The state to fill
+
+        \param indices, indexCount
+          The triangle list
+
+        \param vertices, vertexCount, stride
+          The vertex data, the position is the first 3 floats
+        */
+        /****************************************************************************/
+        static void Setup(State& state, const uint32_t* indices, size_t indexCount, const void* vertices, size_t vertexCount, size_t stride)
+        {
+            const uint8_t* bytes = static_cast<const uint8_t*>(vertices);
+            state.positions.resize(vertexCount * 3);
+            for (size_t v = 0; v < vertexCount; ++v)
+            {
+                std::memcpy(&state.positions[v * 3], bytes + v * stride, sizeof(float) * 3);
+            }
+            state.indices.assign(indices, indices + indexCount - indexCount % 3);
+            state.error = 0.0;
+
+            // group vertices by position, split normals / uvs leave several per position
+            std::vector<uint32_t> order(vertexCount);
+            std::iota(order.begin(), order.end(), 0u);
+            const float* positions = state.positions.data();
+            std::sort(order.begin(), order.end(), [positions](uint32_t a, uint32_t b)
+            {
+                return std::lexicographical_compare(positions + a * 3, positions + a * 3 + 3, positions + b * 3, positions + b * 3 + 3) ||
+                    (std::equal(positions + a * 3, positions + a * 3 + 3, positions + b * 3) && a < b);
+            });
+
+            state.positionId.resize(vertexCount);
+            state.kind.assign(vertexCount, KIND_MANIFOLD);
+            for (size_t begin = 0, end = 0; begin < vertexCount; begin = end)
+            {
+                end = begin + 1;
+                while (end < vertexCount && std::equal(positions + order[begin] * 3, positions + order[begin] * 3 + 3, positions + order[end] * 3))
+                {
+                    ++end;
+                }
+
+                for (size_t i = begin; i < end; ++i)
+                {
+                    state.positionId[order[i]] = order[begin];
+                    if (end - begin > 1)
+                    {
+                        state.kind[order[i]] = KIND_LOCKED;
+                    }
+                }
+            }
+
+            // open edges are the undirected edges only one triangle uses, one sort finds them all
+            std::vector<std::pair<uint64_t, uint32_t>> halfEdges(state.indices.size());
+            for (size_t i = 0; i < state.indices.size(); ++i)
+            {
+                const uint32_t a = state.positionId[state.indices[i]];
+                const uint32_t b = state.positionId[state.indices[i - i % 3 + (i + 1) % 3]];
+                halfEdges[i] = std::make_pair(EdgeKey(std::min(a, b), std::max(a, b)), uint32_t(i));
+            }
+            std::sort(halfEdges.begin(), halfEdges.end());
+
+            std::vector<uint8_t> open(state.indices.size(), 0);
+            for (size_t begin = 0, end = 0; begin < halfEdges.size(); begin = end)
+            {
+                end = begin + 1;
+                while (end < halfEdges.size() && halfEdges[end].first == halfEdges[begin].first)
+                {
+                    ++end;
+                }
+                open[halfEdges[begin].second] = end - begin == 1;
+            }
+
+            // every triangle's plane goes to its corners, open edges add a plane standing on the edge
+            state.quadrics.assign(vertexCount, Quadric());
+            for (size_t i = 0; i < state.indices.size(); i += 3)
+            {
+                const uint32_t corner[3] = { state.indices[i], state.indices[i + 1], state.indices[i + 2] };
+                const float* p[3] = { positions + corner[0] * 3, positions + corner[1] * 3, positions + corner[2] * 3 };
+
+                double normal[3];
+                TriangleNormal(p[0], p[1], p[2], normal);
+                const double length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+                if (length <= 0.0)
+                {
+                    continue;
+                }
+                normal[0] /= length;
+                normal[1] /= length;
+                normal[2] /= length;
+
+                const double distance = -(normal[0] * p[0][0] + normal[1] * p[0][1] + normal[2] * p[0][2]);
+                for (uint32_t v : corner)
+                {
+                    AddPlane(state.quadrics[v], normal, distance, length * 0.5);
+                }
+
+                for (size_t e = 0; e < 3; ++e)
+                {
+                    if (!open[i + e])
+                    {
+                        continue;
+                    }
+
+                    const uint32_t a = corner[e];
+                    const uint32_t b = corner[(e + 1) % 3];
+
+                    for (uint32_t v : { a, b })
+                    {
+                        if (state.kind[v] != KIND_LOCKED)
+                        {
+                            state.kind[v] = KIND_BORDER;
+                        }
+                    }
+
+                    const float* pa = positions + a * 3;
+                    const float* pb = positions + b * 3;
+                    const double edge[3] = { double(pb[0]) - pa[0], double(pb[1]) - pa[1], double(pb[2]) - pa[2] };
+                    double side[3] = {
+                        edge[1] * normal[2] - edge[2] * normal[1],
+                        edge[2] * normal[0] - edge[0] * normal[2],
+                        edge[0] * normal[1] - edge[1] * normal[0] };
+                    const double sideLength = std::sqrt(side[0] * side[0] + side[1] * side[1] + side[2] * side[2]);
+                    if (sideLength <= 0.0)
+                    {
+                        continue;
+                    }
+                    side[0] /= sideLength;
+                    side[1] /= sideLength;
+                    side[2] /= sideLength;
+
+                    const double sideDistance = -(side[0] * pa[0] + side[1] * pa[1] + side[2] * pa[2]);
+                    const double weight = (edge[0] * edge[0] + edge[1] * edge[1] + edge[2] * edge[2]) * BORDER_WEIGHT;
+                    AddPlane(state.quadrics[a], side, sideDistance, weight);
+                    AddPlane(state.quadrics[b], side, sideDistance, weight);
+                }
+            }
+        }
+
+        /****************************************************************************/
+        /*!
+        \brief
+          Check whether a vertex may move onto a neighbour
+        */
+        /****************************************************************************/
+        static bool CanCollapse(const State& state, uint32_t from, uint32_t to)
+        {
+            switch (state.kind[from])
+            {
+            case KIND_MANIFOLD:
+                return true;
+            case KIND_BORDER:
+                return IsBorderEdge(state, from, to);
+            default:
+                return false;
+            }
+        }
+
+        /****************************************************************************/
+        /*!
+        \brief
+          Check whether moving from onto to would turn any of from's
+          surviving triangles over
+
+        \return
+          True if a triangle would flip
+        */
+        /****************************************************************************/
+        static bool Flips(const State& state, uint32_t from, uint32_t to)
+        {
+            const float* positions = state.positions.data();
+            for (uint32_t o = state.triangleOffsets[from]; o < state.triangleOffsets[from + 1]; ++o)
+            {
+                const uint32_t* corner = &state.indices[size_t(state.triangles[o]) * 3];
+                if (corner[0] == to || corner[1] == to || corner[2] == to)
+                {
+                    continue; // collapses away
+                }
+
+                const float* before[3] = { positions + corner[0] * 3, positions + corner[1] * 3, positions + corner[2] * 3 };
+                const float* after[3] = { before[0], before[1], before[2] };
+                for (int i = 0; i < 3; ++i)
+                {
+                    if (corner[i] == from)
+                    {
+                        after[i] = positions + to * 3;
+                    }
+                }
+
+                double normalBefore[3], normalAfter[3];
+                TriangleNormal(before[0], before[1], before[2], normalBefore);
+                TriangleNormal(after[0], after[1], after[2], normalAfter);
+                if (normalBefore[0] * normalAfter[0] + normalBefore[1] * normalAfter[1] + normalBefore[2] * normalAfter[2] <= 0.0)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /****************************************************************************/
+        /*!
+        \brief
+          One round of collapses. Every candidate edge is costed, then the
+          cheapest are taken in order as long as they do not touch a vertex
+          or triangle an earlier collapse in the round already changed.
+
+        \param state
+          The mesh to simplify
+
+        \param targetIndexCount
+          Stop collapsing once about this many indices would be left
+
+        \param maxError
+          Largest squared error a collapse may cost
+
+        \return
+          Number of collapses made, 0 when nothing more can go
+        */
+        /****************************************************************************/
+        static size_t CollapsePass(State& state, size_t targetIndexCount, double maxError)
+        {
+            const size_t vertexCount = state.positionId.size();
+            std::vector<uint32_t>& indices = state.indices;
+
+            // vertex -> triangle adjacency
+            state.triangleOffsets.assign(vertexCount + 1, 0);
+            for (uint32_t index : indices)
+            {
+                ++state.triangleOffsets[index + 1];
+            }
+            std::partial_sum(state.triangleOffsets.begin(), state.triangleOffsets.end(), state.triangleOffsets.begin());
+            state.triangles.resize(indices.size());
+
+            // remap doubles as the fill cursor until the collapses need it
+            state.remap.assign(state.triangleOffsets.begin(), state.triangleOffsets.end() - 1);
+            for (size_t i = 0; i < indices.size(); ++i)
+            {
+                state.triangles[state.remap[indices[i]]++] = uint32_t(i / 3);
+            }
+
+            BuildEdges(state);
+
+            // cost both directions of every edge. Only an edge touching a border vertex can be
+            // missing its other half, the rest are seen from both sides so take them once
+            state.collapses.clear();
+            for (size_t i = 0; i < indices.size(); i += 3)
+            {
+                for (size_t e = 0; e < 3; ++e)
+                {
+                    const uint32_t a = indices[i + e];
+                    const uint32_t b = indices[i + (e + 1) % 3];
+                    if (a > b && ((state.kind[a] != KIND_BORDER && state.kind[b] != KIND_BORDER) || HasEdge(state, state.positionId[b], state.positionId[a])))
+                    {
+                        continue;
+                    }
+
+                    const uint32_t ends[2] = { a, b };
+                    for (int direction = 0; direction < 2; ++direction)
+                    {
+                        const uint32_t from = ends[direction];
+                        const uint32_t to = ends[1 - direction];
+                        if (!CanCollapse(state, from, to))
+                        {
+                            continue;
+                        }
+
+                        Quadric quadric = state.quadrics[from];
+                        AddQuadric(quadric, state.quadrics[to]);
+                        state.collapses.push_back({ from, to, QuadricError(quadric, &state.positions[size_t(to) * 3]) });
+                    }
+                }
+            }
+
+            // each collapse takes out about 2 triangles, do not overshoot the target by much
+            const size_t budget = (indices.size() - std::min(indices.size(), targetIndexCount)) / 6 + 1;
+
+            // conflicts turn a lot of candidates away, but only the cheap end is ever looked at
+            const auto cheaper = [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; };
+            const size_t considered = std::min(state.collapses.size(), budget * CANDIDATES_PER_COLLAPSE);
+            std::nth_element(state.collapses.begin(), state.collapses.begin() + considered, state.collapses.end(), cheaper);
+            state.collapses.resize(considered);
+            std::sort(state.collapses.begin(), state.collapses.end(), cheaper);
+
+            state.touched.assign(vertexCount, 0);
+            std::iota(state.remap.begin(), state.remap.end(), 0u);
+
+            size_t collapsed = 0;
+            for (const Collapse& collapse : state.collapses)
+            {
+                if (collapse.cost > maxError || collapsed >= budget)
+                {
+                    break;
+                }
+                if (state.touched[collapse.from] || state.touched[collapse.to] || Flips(state, collapse.from, collapse.to))
+                {
+                    continue;
+                }
+
+                state.remap[collapse.from] = collapse.to;
+                AddQuadric(state.quadrics[collapse.to], state.quadrics[collapse.from]);
+                state.error = std::max(state.error, collapse.cost);
+                ++collapsed;
+
+                // the ring around from changes shape, later flip checks in this round would be stale
+                for (uint32_t o = state.triangleOffsets[collapse.from]; o < state.triangleOffsets[collapse.from + 1]; ++o)
+                {
+                    const uint32_t* corner = &indices[size_t(state.triangles[o]) * 3];
+                    state.touched[corner[0]] = state.touched[corner[1]] = state.touched[corner[2]] = 1;
+                }
+                state.touched[collapse.to] = 1;
+            }
+
+            // remap and drop the triangles that collapsed away
+            size_t write = 0;
+            for (size_t i = 0; i < indices.size(); i += 3)
+            {
+                const uint32_t a = state.remap[indices[i]];
+                const uint32_t b = state.remap[indices[i + 1]];
+                const uint32_t c = state.remap[indices[i + 2]];
+                if (a == b || b == c || a == c)
+                {
+                    continue;
+                }
+                indices[write++] = a;
+                indices[write++] = b;
+                indices[write++] = c;
+            }
+            indices.resize(write);
+
+            return collapsed;
+        }
+
+        /****************************************************************************/
+        /*!
+        \brief
+          Collapse until the target is reached or nothing cheap enough is left
+
+        \param state
+          The mesh to simplify
+
+        \param targetIndexCount
+          Index count to get down to
+
+        \param maxError
+          Largest squared error a collapse may cost
+        */
+        /****************************************************************************/
+        static void Run(State& state, size_t targetIndexCount, double maxError)
+        {
+            while (state.indices.size() > targetIndexCount)
+            {
+                if (CollapsePass(state, targetIndexCount, maxError) == 0)
+                {
+                    break;
+                }
+            }
+        }
+    }
+}
+
+/*============================================================================*\
+|| -------------------------- PUBLIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Simplify a triangle list down to a target index count or error,
+  whichever comes first. The result indexes the same vertices.
+
+\param indices
+  The triangle list to simplify
+
+\param indexCount
+  Number of indices
+
+\param vertices
+  vertexCount * stride bytes of vertex data, position in the first 3 floats
+
+\param vertexCount
+  Number of vertices
+
+\param stride
+  Size of a vertex
+
+\param targetIndexCount
+  Index count to get down to
+
+\param targetError
+  Largest distance from the original surface a collapse may introduce
+
+\param out
+  indexCount indices to write to, may be the same as indices
+
+\param error
+  Optionally receives the error the result reached
+
+\return
+  Number of indices written to out
+*/
+/****************************************************************************/
+size_t DX11::MeshSimplifier::Simplify(const uint32_t* indices, size_t indexCount, const void* vertices, size_t vertexCount, size_t stride,
+    size_t targetIndexCount, float targetError, uint32_t* out, float* error)
+{
+    State state;
+    Setup(state, indices, indexCount, vertices, vertexCount, stride);
+    Run(state, targetIndexCount, double(targetError) * double(targetError));
+
+    std::copy(state.indices.begin(), state.indices.end(), out);
+    if (error)
+    {
+        *error = float(std::sqrt(state.error));
+    }
+    return state.indices.size();
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Build a chain of coarser levels, each about reduction times the triangles
+  of the one before. One simplification carries on from level to level so
+  the errors only grow and each level is a collapse of the one before.
+  Each level is reordered for the post-transform cache. The chain stops
+  early once collapses stop making real progress.
+
+\param indices
+  The full detail triangle list
+
+\param indexCount
+  Number of indices
+
+\param vertices
+  vertexCount * stride bytes of vertex data, position in the first 3 floats
+
+\param vertexCount
+  Number of vertices
+
+\param stride
+  Size of a vertex
+
+\param reduction
+  Fraction of the triangles each level keeps
+
+\param maxLevels
+  Most levels to build, the full detail list is not one of them
+
+\param levels
+  Receives the levels, coarsest last
+
+\return
+  Number of levels built
+*/
+/****************************************************************************/
+size_t DX11::MeshSimplifier::BuildLevels(const uint32_t* indices, size_t indexCount, const void* vertices, size_t vertexCount, size_t stride,
+    float reduction, uint32_t maxLevels, std::vector<Level>& levels)
+{
+    levels.clear();
+    if (indexCount < 3 || maxLevels == 0)
+    {
+        return 0;
+    }
+
+    State state;
+    Setup(state, indices, indexCount, vertices, vertexCount, stride);
+
+    size_t previous = state.indices.size();
+    for (uint32_t l = 0; l < maxLevels; ++l)
+    {
+        const size_t target = size_t(float(previous / 3) * reduction) * 3;
+        if (target == 0)
+        {
+            break;
+        }
+
+        Run(state, target, DBL_MAX);
+
+        // borders and seams can stall it well short of the target
+        const size_t wanted = previous - target;
+        if (state.indices.empty() || float(previous - state.indices.size()) < float(wanted) * MIN_PROGRESS)
+        {
+            break;
+        }
+
+        Level level;
+        level.indices = state.indices;
+        level.error = float(std::sqrt(state.error));
+        DX11::MeshOptimizer::OptimizeVertexCache(level.indices.data(), level.indices.size(), vertexCount);
+        levels.push_back(std::move(level));
+        previous = state.indices.size();
+    }
+
+    return levels.size();
+}
+
+/*============================================================================*\
+|| ------------------------- PRIVATE FUNCTIONS ------------------------------ ||
+\*============================================================================*/
@@ -0,0 +1,546 @@
+/****************************************************************************/
+/*!
+\file
+   Meshlets.cpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Meshlet clustering and culling. Import reorders a triangle list into
+    small clusters of neighbouring triangles, each a contiguous run of
+    indices with a bounding sphere and a cone around its triangle normals.
+    The culler drops clusters outside the frustum or facing away from the
+    camera and hands back the index ranges left to draw, runs of adjacent
+    survivors merged into one.
+*/
+/****************************************************************************/
+
+/*============================================================================*\
+|| ------------------------------ INCLUDES ---------------------------------- ||
+\*============================================================================*/
+
+#include "DX11PCH.hpp"
+#include "Meshlets.hpp"
+#include "MeshOptimizer.hpp"
+#include <cfloat>
+#include <numeric>
+
+/*============================================================================*\
+|| --------------------------- GLOBAL VARIABLES ----------------------------- ||
+\*============================================================================*/
+
+namespace
+{
+    static const uint32_t INVALID_INDEX = ~0u;
+
+    //! how much a candidate's facing counts against its distance when growing a meshlet
+    static const float CONE_WEIGHT = 0.5f;
+
+    //! unused triangles around a candidate's corners at which it stops counting as hemmed in, 6 per vertex on a regular grid
+    static const float HEMMED_LIVE = 18.0f;
+}
+
+/*============================================================================*\
+|| -------------------------- STATIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+namespace
+{
+    //! per triangle data the builder scores candidates with
+    struct TriangleInfo
+    {
+        DirectX::XMFLOAT3 centroid;
+        DirectX::XMFLOAT3 normal;   //!< unit length, zero for degenerate triangles
+    };
+
+    /****************************************************************************/
+    /*!
+    \brief
+      Read a position out of a strided vertex array
+
+    \param vertices
+      The vertex bytes
+
+    \param stride
+      Size of a vertex
+
+    \param index
+      Which vertex
+    */
+    /****************************************************************************/
+    static DirectX::XMVECTOR LoadPosition(const uint8_t* vertices, size_t stride, uint32_t index)
+    {
+        DirectX::XMFLOAT3 position;
+        std::memcpy(&position, vertices + size_t(index) * stride, sizeof(position));
+        return DirectX::XMLoadFloat3(&position);
+    }
+
+    /****************************************************************************/
+    /*!
+    \brief
+      Fill in a finished meshlet's bounding sphere and normal cone
+
+    \param meshlet
+      The meshlet, firstIndex and indexCount set
+
+    \param indices
+      The reordered index list
+
+    \param vertices
+      The vertex bytes
+
+    \param stride
+      Size of a vertex
+
+    \param triangles
+      Per triangle normals, in the original triangle order
+
+    \param order
+      Original triangle index of each reordered triangle
+    */
+    /****************************************************************************/
+    static void ComputeBounds(DX11::Meshlet& meshlet, const uint32_t* indices, const uint8_t* vertices, size_t stride,
+        const std::vector<TriangleInfo>& triangles, const uint32_t* order)
+    {
+        using namespace DirectX;
+
+        // sphere around the box center
+        XMVECTOR boundsMin = XMVectorReplicate(FLT_MAX);
+        XMVECTOR boundsMax = XMVectorReplicate(-FLT_MAX);
+        for (uint32_t i = meshlet.firstIndex; i < meshlet.firstIndex + meshlet.indexCount; ++i)
+        {
+            XMVECTOR position = LoadPosition(vertices, stride, indices[i]);
+            boundsMin = XMVectorMin(boundsMin, position);
+            boundsMax = XMVectorMax(boundsMax, position);
+        }
+        const XMVECTOR center = XMVectorScale(XMVectorAdd(boundsMin, boundsMax), 0.5f);
+
+        float radiusSquared = 0.0f;
+        for (uint32_t i = meshlet.firstIndex; i < meshlet.firstIndex + meshlet.indexCount; ++i)
+        {
+            XMVECTOR offset = XMVectorSubtract(LoadPosition(vertices, stride, indices[i]), center);
+            radiusSquared = std::max(radiusSquared, XMVectorGetX(XMVector3LengthSq(offset)));
+        }
+        XMStoreFloat3(&meshlet.center, center);
+        meshlet.radius = std::sqrt(radiusSquared);
+
+        // cone around the average facing, the widest normal sets the angle
+        XMVECTOR axis = XMVectorZero();
+        for (uint32_t i = meshlet.firstIndex; i < meshlet.firstIndex + meshlet.indexCount; i += 3)
+        {
+            axis = XMVectorAdd(axis, XMLoadFloat3(&triangles[order[i / 3]].normal));
+        }
+
+        const float length = XMVectorGetX(XMVector3Length(axis));
+        float minDot = 1.0f;
+        if (length > 0.0f)
+        {
+            axis = XMVectorScale(axis, 1.0f / length);
+            for (uint32_t i = meshlet.firstIndex; i < meshlet.firstIndex + meshlet.indexCount; i += 3)
+            {
+                minDot = std::min(minDot, XMVectorGetX(XMVector3Dot(axis, XMLoadFloat3(&triangles[order[i / 3]].normal))));
+            }
+        }
+        else
+        {
+            minDot = 0.0f;
+        }
+
+        XMStoreFloat3(&meshlet.coneAxis, axis);
+
+        // a cone of 90 degrees or more always has some triangle facing the camera
+        meshlet.coneCutoff = minDot <= 0.0f ? 1.0f : std::sqrt(1.0f - minDot * minDot);
+    }
+}
+
+/*============================================================================*\
+|| -------------------------- PUBLIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Split a triangle list into meshlets and reorder it so each meshlet is a
+  contiguous run. A meshlet starts on the edge of the previous one and
+  grows by always taking the neighbouring triangle that adds the fewest new
+  vertices, ties going to the one with the fewest unused neighbours, then
+  the one closest to the meshlet and facing the same way, until a limit is
+  hit or nothing touching it is left.
+
+\param indices
+  The triangle list, reordered in place. The triangles keep their winding.
+
+\param indexCount
+  Number of indices
+
+\param vertices
+  vertexCount * stride bytes of vertex data, position in the first 3 floats
+
+\param vertexCount
+  Number of vertices
+
+\param stride
+  Size of a vertex
+
+\param meshlets
+  Receives the meshlets in index order, firstIndex is relative to indices
+
+\param maxVertices
+  Most unique vertices a meshlet may use
+
+\param maxTriangles
+  Most triangles a meshlet may hold
+
+\return
+  Number of meshlets
+*/
+/****************************************************************************/
+size_t DX11::Meshlets::Build(uint32_t* indices, size_t indexCount, const void* vertices, size_t vertexCount, size_t stride,
+    std::vector<DX11::Meshlet>& meshlets, uint32_t maxVertices, uint32_t maxTriangles)
+{
+    using namespace DirectX;
+
+    meshlets.clear();
+    const uint8_t* bytes = static_cast<const uint8_t*>(vertices);
+    const size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0)
+    {
+        return 0;
+    }
+
+    // centroid and facing of every triangle, and a typical size to measure distance in
+    std::vector<TriangleInfo> triangles(triangleCount);
+    float edgeSum = 0.0f;
+    for (size_t t = 0; t < triangleCount; ++t)
+    {
+        XMVECTOR a = LoadPosition(bytes, stride, indices[t * 3]);
+        XMVECTOR b = LoadPosition(bytes, stride, indices[t * 3 + 1]);
+        XMVECTOR c = LoadPosition(bytes, stride, indices[t * 3 + 2]);
+        XMStoreFloat3(&triangles[t].centroid, XMVectorScale(XMVectorAdd(XMVectorAdd(a, b), c), 1.0f / 3.0f));
+
+        // the side the rasterizer draws, see Renderer's cull mode
+        XMVECTOR normal = XMVector3Cross(XMVectorSubtract(b, a), XMVectorSubtract(c, a));
+        const float length = XMVectorGetX(XMVector3Length(normal));
+        XMStoreFloat3(&triangles[t].normal, length > 0.0f ? XMVectorScale(normal, 1.0f / length) : XMVectorZero());
+        edgeSum += XMVectorGetX(XMVector3Length(XMVectorSubtract(b, a)));
+    }
+    const float scale = std::max(edgeSum / float(triangleCount), FLT_MIN);
+
+    // vertex -> triangle adjacency
+    std::vector<uint32_t> offsets(vertexCount + 1, 0);
+    for (size_t i = 0; i < triangleCount * 3; ++i)
+    {
+        ++offsets[indices[i] + 1];
+    }
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+    std::vector<uint32_t> adjacency(triangleCount * 3);
+    std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < triangleCount * 3; ++i)
+    {
+        adjacency[cursor[indices[i]]++] = uint32_t(i / 3);
+    }
+
+    std::vector<uint8_t> emitted(triangleCount, 0);
+    std::vector<uint32_t> owner(vertexCount, INVALID_INDEX);   // last meshlet to use each vertex
+    std::vector<uint32_t> live(vertexCount, 0);                // unused triangles around each vertex
+    std::vector<uint32_t> order;
+    std::vector<uint32_t> candidates;
+    order.reserve(triangleCount);
+    for (uint32_t v = 0; v < vertexCount; ++v)
+    {
+        live[v] = offsets[v + 1] - offsets[v];
+    }
+
+    size_t scan = 0;
+    while (order.size() < triangleCount)
+    {
+        // carry on from the last meshlet's edge, starting with the triangle
+        // most hemmed in so leftovers don't end up as tiny islands
+        uint32_t seed = INVALID_INDEX;
+        uint32_t seedLive = UINT32_MAX;
+        for (uint32_t candidate : candidates)
+        {
+            if (emitted[candidate])
+            {
+                continue;
+            }
+            const uint32_t* corners = indices + size_t(candidate) * 3;
+            const uint32_t around = live[corners[0]] + live[corners[1]] + live[corners[2]];
+            if (around < seedLive)
+            {
+                seedLive = around;
+                seed = candidate;
+            }
+        }
+        if (seed == INVALID_INDEX)
+        {
+            while (emitted[scan])
+            {
+                ++scan;
+            }
+            seed = uint32_t(scan);
+        }
+
+        const uint32_t id = uint32_t(meshlets.size());
+        DX11::Meshlet meshlet;
+        meshlet.firstIndex = uint32_t(order.size() * 3);
+        uint32_t meshletVertices = 0;
+        uint32_t meshletTriangles = 0;
+        XMVECTOR centroidSum = XMVectorZero();
+        XMVECTOR normalSum = XMVectorZero();
+        candidates.clear();
+
+        uint32_t next = seed;
+        while (next != INVALID_INDEX)
+        {
+            // take the triangle, its vertices' other triangles become candidates
+            emitted[next] = 1;
+            order.push_back(next);
+            for (size_t corner = 0; corner < 3; ++corner)
+            {
+                --live[indices[size_t(next) * 3 + corner]];
+            }
+            ++meshletTriangles;
+            centroidSum = XMVectorAdd(centroidSum, XMLoadFloat3(&triangles[next].centroid));
+            normalSum = XMVectorAdd(normalSum, XMLoadFloat3(&triangles[next].normal));
+            for (size_t corner = 0; corner < 3; ++corner)
+            {
+                const uint32_t v = indices[size_t(next) * 3 + corner];
+                if (owner[v] == id)
+                {
+                    continue;
+                }
+                owner[v] = id;
+                ++meshletVertices;
+                for (uint32_t o = offsets[v]; o < offsets[v + 1]; ++o)
+                {
+                    if (!emitted[adjacency[o]])
+                    {
+                        candidates.push_back(adjacency[o]);
+                    }
+                }
+            }
+
+            if (meshletTriangles == maxTriangles)
+            {
+                break;
+            }
+
+            const XMVECTOR center = XMVectorScale(centroidSum, 1.0f / float(meshletTriangles));
+            const XMVECTOR facing = XMVector3Normalize(normalSum);
+
+            // score the candidates that still fit, dropping the ones already used
+            next = INVALID_INDEX;
+            float best = FLT_MAX;
+            size_t kept = 0;
+            for (uint32_t candidate : candidates)
+            {
+                if (emitted[candidate])
+                {
+                    continue;
+                }
+
+                candidates[kept++] = candidate;
+
+                uint32_t fresh = 0;
+                for (size_t corner = 0; corner < 3; ++corner)
+                {
+                    fresh += owner[indices[size_t(candidate) * 3 + corner]] != id ? 1 : 0;
+                }
+                if (meshletVertices + fresh > maxVertices)
+                {
+                    continue;
+                }
+
+                const float distance = XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&triangles[candidate].centroid), center))) / scale;
+                const float turn = 0.5f * (1.0f - XMVectorGetX(XMVector3Dot(facing, XMLoadFloat3(&triangles[candidate].normal))));
+
+                // new vertices dominate, then triangles that would be stranded
+                // if left behind, then staying compact and facing one way
+                const uint32_t* corners = indices + size_t(candidate) * 3;
+                const float hemmed = std::min(float(live[corners[0]] + live[corners[1]] + live[corners[2]]) / HEMMED_LIVE, 1.0f);
+                const float spread = CONE_WEIGHT * turn + (1.0f - CONE_WEIGHT) * distance / (distance + 1.0f);
+                const float score = float(fresh) + 0.5f * (hemmed + spread);
+                if (score < best)
+                {
+                    best = score;
+                    next = candidate;
+                }
+            }
+            candidates.resize(kept);
+        }
+
+        meshlet.indexCount = meshletTriangles * 3;
+        meshlets.push_back(meshlet);
+    }
+
+    // write the triangles back in meshlet order
+    std::vector<uint32_t> source(indices, indices + triangleCount * 3);
+    for (size_t t = 0; t < triangleCount; ++t)
+    {
+        std::copy(source.begin() + size_t(order[t]) * 3, source.begin() + size_t(order[t]) * 3 + 3, indices + t * 3);
+    }
+
+    for (DX11::Meshlet& meshlet : meshlets)
+    {
+        ComputeBounds(meshlet, indices, bytes, stride, triangles, order.data());
+    }
+
+    return meshlets.size();
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Reorder the triangles inside each meshlet for the post-transform vertex
+  cache. Build picks triangles by locality and fill, not cache order, and
+  a meshlet's bounds and cone don't depend on the order of its triangles.
+  Each meshlet is optimized over its own few vertices.
+
+\param indices
+  The triangle list the meshlets were built from, reordered in place
+
+\param vertexCount
+  Number of vertices the indices reference
+
+\param meshlets
+  The meshlets from Build
+*/
+/****************************************************************************/
+void DX11::Meshlets::OptimizeVertexCache(uint32_t* indices, size_t vertexCount, const std::vector<DX11::Meshlet>& meshlets)
+{
+    // mesh vertex -> meshlet vertex, reset after each meshlet
+    std::vector<uint32_t> local(vertexCount, ~0u);
+    std::vector<uint32_t> global;
+    for (const DX11::Meshlet& meshlet : meshlets)
+    {
+        uint32_t* range = indices + meshlet.firstIndex;
+        global.clear();
+        for (uint32_t i = 0; i < meshlet.indexCount; ++i)
+        {
+            uint32_t& slot = local[range[i]];
+            if (slot == ~0u)
+            {
+                slot = uint32_t(global.size());
+                global.push_back(range[i]);
+            }
+            range[i] = slot;
+        }
+
+        DX11::MeshOptimizer::OptimizeVertexCache(range, meshlet.indexCount, global.size());
+
+        for (uint32_t i = 0; i < meshlet.indexCount; ++i)
+        {
+            range[i] = global[range[i]];
+        }
+        for (uint32_t vertex : global)
+        {
+            local[vertex] = ~0u;
+        }
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Drop the meshlets outside the frustum or facing away from the camera and
+  collect what is left as index ranges. Neighbouring survivors are merged
+  so a mostly visible submesh stays a few draws.
+
+\param meshlets
+  The meshlets of one submesh, in index order
+
+\param count
+  Number of meshlets
+
+\param frustum
+  The frustum in the meshlets' model space
+
+\param camera
+  The camera position in the meshlets' model space
+
+\param ranges
+  Receives the index ranges to draw
+
+\return
+  Number of ranges
+*/
+/****************************************************************************/
+size_t DX11::MeshletCuller::Cull(const DX11::Meshlet* meshlets, size_t count, const DX11::Frustum& frustum, const DirectX::XMFLOAT3& camera,
+    std::vector<DX11::IndexRange>& ranges)
+{
+    ranges.clear();
+    for (size_t m = 0; m < count; ++m)
+    {
+        const DX11::Meshlet& meshlet = meshlets[m];
+        const uint32_t triangles = meshlet.indexCount / 3;
+        mStats.triangles += triangles;
+
+        bool inside = true;
+        for (const DirectX::XMFLOAT4& plane : frustum.planes)
+        {
+            inside = inside && meshlet.center.x * plane.x + meshlet.center.y * plane.y + meshlet.center.z * plane.z + plane.w >= -meshlet.radius;
+        }
+        if (!inside)
+        {
+            ++mStats.frustumCulled;
+            mStats.trianglesCulled += triangles;
+            continue;
+        }
+
+        // every normal in the cone points away from anywhere the camera could see the sphere from
+        const float toCenter[3] = { meshlet.center.x - camera.x, meshlet.center.y - camera.y, meshlet.center.z - camera.z };
+        const float distance = std::sqrt(toCenter[0] * toCenter[0] + toCenter[1] * toCenter[1] + toCenter[2] * toCenter[2]);
+        const float along = toCenter[0] * meshlet.coneAxis.x + toCenter[1] * meshlet.coneAxis.y + toCenter[2] * meshlet.coneAxis.z;
+        if (along > meshlet.coneCutoff * distance + meshlet.radius)
+        {
+            ++mStats.backfaceCulled;
+            mStats.trianglesCulled += triangles;
+            continue;
+        }
+
+        if (!ranges.empty() && ranges.back().firstIndex + ranges.back().indexCount == meshlet.firstIndex)
+        {
+            ranges.back().indexCount += meshlet.indexCount;
+        }
+        else
+        {
+            DX11::IndexRange range;
+            range.firstIndex = meshlet.firstIndex;
+            range.indexCount = meshlet.indexCount;
+            ranges.push_back(range);
+        }
+    }
+
+    mStats.tested += uint32_t(count);
+    mStats.ranges += uint32_t(ranges.size());
+    return ranges.size();
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Zero the counts, the renderer does this once a frame
+*/
+/****************************************************************************/
+void DX11::MeshletCuller::ResetStats()
+{
+    mStats = DX11::MeshletStats();
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the counts since the last ResetStats
+*/
+/****************************************************************************/
+const DX11::MeshletStats& DX11::MeshletCuller::Stats() const
+{
+    return mStats;
+}
+
+/*============================================================================*\
+|| ------------------------- PRIVATE FUNCTIONS ------------------------------ ||
+\*============================================================================*/
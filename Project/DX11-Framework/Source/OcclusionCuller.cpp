@@ -0,0 +1,724 @@
+/****************************************************************************/
+/*!
+\file
+   OcclusionCuller.cpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    CPU occlusion culling. Occluder triangles are binned into screen tiles
+    and each tile is rasterized into a small depth buffer by one job, 4
+    pixels at a time with SSE coverage masks. A max depth mip chain is
+    built on top so an occludee box is tested against a few texels at the
+    level that fits it.
+*/
+/****************************************************************************/
+
+/*============================================================================*\
+|| ------------------------------ INCLUDES ---------------------------------- ||
+\*============================================================================*/
+
+#include "DX11PCH.hpp"
+#include "OcclusionCuller.hpp"
+#include "WorkerPool.hpp"
+#include <cfloat>
+#include <fstream>
+#include <immintrin.h>
+
+/*============================================================================*\
+|| --------------------------- GLOBAL VARIABLES ----------------------------- ||
+\*============================================================================*/
+
+namespace
+{
+    //! what an empty depth buffer holds, D3D depth runs 0 near to 1 far
+    static const float FAR_DEPTH = 1.0f;
+
+    //! texels an occludee may span per axis at the level it is tested on
+    static const int32_t TEST_TEXELS = 4;
+}
+
+/*============================================================================*\
+|| -------------------------- STATIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+namespace
+{
+    /****************************************************************************/
+    /*!
+    \brief
+      Point between two clip space vertices
+
+    \param a
+      Vertex at t = 0
+
+    \param b
+      Vertex at t = 1
+
+    \param t
+      Where between them
+    */
+    /****************************************************************************/
+    static DirectX::XMFLOAT4 Lerp(const DirectX::XMFLOAT4& a, const DirectX::XMFLOAT4& b, float t)
+    {
+        return DirectX::XMFLOAT4(a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t, a.z + (b.z - a.z) * t, a.w + (b.w - a.w) * t);
+    }
+
+    /****************************************************************************/
+    /*!
+    \brief
+      Smallest of the 4 lanes
+    */
+    /****************************************************************************/
+    static float HorizontalMin(__m128 value)
+    {
+        value = _mm_min_ps(value, _mm_shuffle_ps(value, value, _MM_SHUFFLE(1, 0, 3, 2)));
+        value = _mm_min_ps(value, _mm_shuffle_ps(value, value, _MM_SHUFFLE(2, 3, 0, 1)));
+        return _mm_cvtss_f32(value);
+    }
+
+    /****************************************************************************/
+    /*!
+    \brief
+      Largest of the 4 lanes
+    */
+    /****************************************************************************/
+    static float HorizontalMax(__m128 value)
+    {
+        value = _mm_max_ps(value, _mm_shuffle_ps(value, value, _MM_SHUFFLE(1, 0, 3, 2)));
+        value = _mm_max_ps(value, _mm_shuffle_ps(value, value, _MM_SHUFFLE(2, 3, 0, 1)));
+        return _mm_cvtss_f32(value);
+    }
+
+    /****************************************************************************/
+    /*!
+    \brief
+      Transform a point by a row vector matrix into clip space
+    */
+    /****************************************************************************/
+    static DirectX::XMFLOAT4 TransformPoint(const DirectX::XMFLOAT4X4& m, float x, float y, float z)
+    {
+        return DirectX::XMFLOAT4(
+            x * m.m[0][0] + y * m.m[1][0] + z * m.m[2][0] + m.m[3][0],
+            x * m.m[0][1] + y * m.m[1][1] + z * m.m[2][1] + m.m[3][1],
+            x * m.m[0][2] + y * m.m[1][2] + z * m.m[2][2] + m.m[3][2],
+            x * m.m[0][3] + y * m.m[1][3] + z * m.m[2][3] + m.m[3][3]);
+    }
+}
+
+/*============================================================================*\
+|| -------------------------- PUBLIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Constructor, allocates the depth buffer and its mip chain
+
+\param width
+  Depth buffer width in pixels, rounded up to TILE_WIDTH
+
+\param height
+  Depth buffer height in pixels, rounded up to TILE_HEIGHT
+*/
+/****************************************************************************/
+DX11::OcclusionCuller::OcclusionCuller(uint32_t width, uint32_t height)
+    : mViewProjection(DirectX::XMMatrixIdentity()), mTested(0), mOccluded(0)
+{
+    mTilesX = std::max(1u, (width + TILE_WIDTH - 1) / TILE_WIDTH);
+    mTilesY = std::max(1u, (height + TILE_HEIGHT - 1) / TILE_HEIGHT);
+    mWidth = mTilesX * TILE_WIDTH;
+    mHeight = mTilesY * TILE_HEIGHT;
+    mBins.resize(size_t(mTilesX) * mTilesY);
+
+    uint32_t levelWidth = mWidth;
+    uint32_t levelHeight = mHeight;
+    while (true)
+    {
+        mLevels.emplace_back(size_t(levelWidth) * levelHeight, FAR_DEPTH);
+        mLevelWidths.push_back(levelWidth);
+        mLevelHeights.push_back(levelHeight);
+        if (levelWidth == 1 && levelHeight == 1)
+        {
+            break;
+        }
+        levelWidth = (levelWidth + 1) / 2;
+        levelHeight = (levelHeight + 1) / 2;
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Start a frame, drops the last frame's occluders and counts
+
+\param viewProjection
+  View * projection the occluders and occludees are seen through
+*/
+/****************************************************************************/
+void DX11::OcclusionCuller::Begin(DirectX::FXMMATRIX viewProjection)
+{
+    mViewProjection = viewProjection;
+    mTriangles.clear();
+    for (std::vector<uint32_t>& bin : mBins)
+    {
+        bin.clear();
+    }
+
+    mOccluders = 0;
+    mTested = 0;
+    mOccluded = 0;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Transform an occluder, clip it to the near plane and bin its triangles.
+  Only closed, solid geometry should occlude, both faces are drawn.
+
+\param positions
+  Model space vertex positions
+
+\param vertexCount
+  Number of positions
+
+\param indices
+  Triangle list
+
+\param indexCount
+  Number of indices
+
+\param world
+  Model to world matrix
+*/
+/****************************************************************************/
+void DX11::OcclusionCuller::AddOccluder(const DirectX::XMFLOAT3* positions, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount, DirectX::FXMMATRIX world)
+{
+    DirectX::XMFLOAT4X4 transform;
+    DirectX::XMStoreFloat4x4(&transform, DirectX::XMMatrixMultiply(world, mViewProjection));
+
+    mClip.resize(vertexCount);
+    for (uint32_t i = 0; i < vertexCount; ++i)
+    {
+        mClip[i] = TransformPoint(transform, positions[i].x, positions[i].y, positions[i].z);
+    }
+
+    for (uint32_t i = 0; i + 2 < indexCount; i += 3)
+    {
+        AddTriangle(mClip[indices[i]], mClip[indices[i + 1]], mClip[indices[i + 2]]);
+    }
+    ++mOccluders;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Rasterize the occluders on the global worker pool
+*/
+/****************************************************************************/
+void DX11::OcclusionCuller::Rasterize()
+{
+    Rasterize(DX11::WorkerPool::Global());
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Rasterize the occluders, one tile per job so no two threads write the
+  same pixel, then build the mip chain
+
+\param pool
+  Threads to rasterize on
+*/
+/****************************************************************************/
+void DX11::OcclusionCuller::Rasterize(DX11::WorkerPool& pool)
+{
+    pool.ParallelFor(mBins.size(), [this](size_t tile)
+    {
+        RasterizeTile(uint32_t(tile));
+    });
+    BuildHierarchy();
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Test an occludee against the occluders rasterized this frame. Boxes
+  crossing the near plane or off screen are kept, frustum culling is
+  expected to have dropped the latter.
+
+\param boundsMin
+  Model space box minimum
+
+\param boundsMax
+  Model space box maximum
+
+\param world
+  Model to world matrix
+
+\return
+  False only if every pixel the box covers has an occluder in front of it
+*/
+/****************************************************************************/
+bool DX11::OcclusionCuller::Visible(const DirectX::XMFLOAT3& boundsMin, const DirectX::XMFLOAT3& boundsMax, DirectX::FXMMATRIX world) const
+{
+    DirectX::XMFLOAT4X4 transform;
+    DirectX::XMStoreFloat4x4(&transform, DirectX::XMMatrixMultiply(world, mViewProjection));
+
+    const bool visible = TestBox(transform, boundsMin, boundsMax);
+    ++mTested;
+    if (!visible)
+    {
+        ++mOccluded;
+    }
+    return visible;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Drop the occluded objects from a list, the boxes are in world space
+
+\param boundsMin
+  World space box minimum of every object
+
+\param boundsMax
+  World space box maximum of every object
+
+\param visible
+  Indices into the boxes, occluded ones are removed in place
+
+\return
+  Number of objects left
+*/
+/****************************************************************************/
+size_t DX11::OcclusionCuller::Cull(const std::vector<DirectX::XMFLOAT3>& boundsMin, const std::vector<DirectX::XMFLOAT3>& boundsMax, std::vector<uint32_t>& visible) const
+{
+    DirectX::XMFLOAT4X4 transform;
+    DirectX::XMStoreFloat4x4(&transform, mViewProjection);
+
+    size_t kept = 0;
+    for (uint32_t object : visible)
+    {
+        if (TestBox(transform, boundsMin[object], boundsMax[object]))
+        {
+            visible[kept++] = object;
+        }
+    }
+    mTested += uint32_t(visible.size());
+    mOccluded += uint32_t(visible.size() - kept);
+    visible.resize(kept);
+    return kept;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the counts since the last Begin
+*/
+/****************************************************************************/
+DX11::OcclusionStats DX11::OcclusionCuller::Stats() const
+{
+    DX11::OcclusionStats stats;
+    stats.occluders = mOccluders;
+    stats.triangles = uint32_t(mTriangles.size());
+    stats.tested = mTested;
+    stats.occluded = mOccluded;
+    return stats;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the depth buffer width in pixels
+*/
+/****************************************************************************/
+uint32_t DX11::OcclusionCuller::Width() const
+{
+    return mWidth;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the depth buffer height in pixels
+*/
+/****************************************************************************/
+uint32_t DX11::OcclusionCuller::Height() const
+{
+    return mHeight;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the depth buffer, row major, 1 where no occluder was drawn
+*/
+/****************************************************************************/
+const std::vector<float>& DX11::OcclusionCuller::Depth() const
+{
+    return mLevels[0];
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Write the depth buffer as a binary PGM, the drawn depth range stretched
+  from white (near) to dark grey, black where nothing was drawn
+
+\param path
+  File to write
+
+\return
+  False if the file could not be written
+*/
+/****************************************************************************/
+bool DX11::OcclusionCuller::SaveDepthImage(const std::string& path) const
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+    {
+        return false;
+    }
+
+    const std::vector<float>& depth = mLevels[0];
+    float nearest = FAR_DEPTH;
+    float farthest = 0.0f;
+    for (float value : depth)
+    {
+        if (value < FAR_DEPTH)
+        {
+            nearest = std::min(nearest, value);
+            farthest = std::max(farthest, value);
+        }
+    }
+    const float range = farthest > nearest ? farthest - nearest : 1.0f;
+
+    std::vector<uint8_t> pixels(depth.size());
+    for (size_t i = 0; i < depth.size(); ++i)
+    {
+        pixels[i] = depth[i] < FAR_DEPTH ? uint8_t(255.0f - 191.0f * (depth[i] - nearest) / range) : 0;
+    }
+
+    file << "P5\n" << mWidth << " " << mHeight << "\n255\n";
+    file.write(reinterpret_cast<const char*>(pixels.data()), std::streamsize(pixels.size()));
+    return bool(file);
+}
+
+/*============================================================================*\
+|| ------------------------- PRIVATE FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Clip a clip space triangle to the near plane (z >= 0), which leaves a
+  triangle or a quad, and set up what is left
+*/
+/****************************************************************************/
+void DX11::OcclusionCuller::AddTriangle(const DirectX::XMFLOAT4& a, const DirectX::XMFLOAT4& b, const DirectX::XMFLOAT4& c)
+{
+    if (a.z >= 0.0f && b.z >= 0.0f && c.z >= 0.0f)
+    {
+        SetupTriangle(a, b, c);
+        return;
+    }
+
+    const DirectX::XMFLOAT4 input[3] = { a, b, c };
+    DirectX::XMFLOAT4 polygon[4];
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < 3; ++i)
+    {
+        const DirectX::XMFLOAT4& current = input[i];
+        const DirectX::XMFLOAT4& next = input[(i + 1) % 3];
+        if (current.z >= 0.0f)
+        {
+            polygon[count++] = current;
+        }
+        if ((current.z >= 0.0f) != (next.z >= 0.0f))
+        {
+            polygon[count++] = Lerp(current, next, current.z / (current.z - next.z));
+        }
+    }
+
+    for (uint32_t i = 1; i + 1 < count; ++i)
+    {
+        SetupTriangle(polygon[0], polygon[i], polygon[i + 1]);
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Project a triangle in front of the near plane to pixels, compute its
+  edge and depth planes and bin it into every tile its bounds touch
+*/
+/****************************************************************************/
+void DX11::OcclusionCuller::SetupTriangle(const DirectX::XMFLOAT4& a, const DirectX::XMFLOAT4& b, const DirectX::XMFLOAT4& c)
+{
+    const DirectX::XMFLOAT4* clip[3] = { &a, &b, &c };
+    float x[3];
+    float y[3];
+    float z[3];
+    for (uint32_t i = 0; i < 3; ++i)
+    {
+        if (clip[i]->w <= 0.0f)
+        {
+            return;
+        }
+
+        // pixel centers sit at + 0.5, y runs down the screen
+        const float inverse = 1.0f / clip[i]->w;
+        x[i] = (clip[i]->x * inverse * 0.5f + 0.5f) * float(mWidth);
+        y[i] = (0.5f - clip[i]->y * inverse * 0.5f) * float(mHeight);
+        z[i] = clip[i]->z * inverse;
+    }
+
+    float area = (x[1] - x[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (x[2] - x[0]);
+    if (area == 0.0f)
+    {
+        return;
+    }
+    if (area < 0.0f)
+    {
+        std::swap(x[1], x[2]);
+        std::swap(y[1], y[2]);
+        std::swap(z[1], z[2]);
+        area = -area;
+    }
+
+    const float minX = std::max(0.0f, std::floor(std::min({ x[0], x[1], x[2] })));
+    const float minY = std::max(0.0f, std::floor(std::min({ y[0], y[1], y[2] })));
+    const float maxX = std::min(float(mWidth - 1), std::ceil(std::max({ x[0], x[1], x[2] })));
+    const float maxY = std::min(float(mHeight - 1), std::ceil(std::max({ y[0], y[1], y[2] })));
+    if (minX > maxX || minY > maxY)
+    {
+        return;
+    }
+
+    // edge i runs from vertex i to i + 1 and is 0 at the opposite vertex's barycentric 0
+    Triangle triangle;
+    for (uint32_t i = 0; i < 3; ++i)
+    {
+        const uint32_t j = (i + 1) % 3;
+        triangle.edgeA[i] = y[i] - y[j];
+        triangle.edgeB[i] = x[j] - x[i];
+        triangle.edgeC[i] = -(triangle.edgeA[i] * x[i] + triangle.edgeB[i] * y[i]);
+    }
+
+    // edge 0 weighs vertex 2, edge 1 vertex 0, edge 2 vertex 1
+    const float inverseArea = 1.0f / area;
+    triangle.depthX = (triangle.edgeA[1] * z[0] + triangle.edgeA[2] * z[1] + triangle.edgeA[0] * z[2]) * inverseArea;
+    triangle.depthY = (triangle.edgeB[1] * z[0] + triangle.edgeB[2] * z[1] + triangle.edgeB[0] * z[2]) * inverseArea;
+    triangle.depthConstant = (triangle.edgeC[1] * z[0] + triangle.edgeC[2] * z[1] + triangle.edgeC[0] * z[2]) * inverseArea;
+    triangle.minX = int32_t(minX);
+    triangle.minY = int32_t(minY);
+    triangle.maxX = int32_t(maxX);
+    triangle.maxY = int32_t(maxY);
+
+    const uint32_t index = uint32_t(mTriangles.size());
+    mTriangles.push_back(triangle);
+    for (int32_t tileY = triangle.minY / int32_t(TILE_HEIGHT); tileY <= triangle.maxY / int32_t(TILE_HEIGHT); ++tileY)
+    {
+        for (int32_t tileX = triangle.minX / int32_t(TILE_WIDTH); tileX <= triangle.maxX / int32_t(TILE_WIDTH); ++tileX)
+        {
+            mBins[size_t(tileY) * mTilesX + tileX].push_back(index);
+        }
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Clear one tile and draw every triangle binned to it, keeping the
+  nearest depth. 4 pixels of a row are tested per step, the SSE compare
+  of the 3 edges is the coverage mask of the step.
+
+\param tile
+  Tile index, row major
+*/
+/****************************************************************************/
+void DX11::OcclusionCuller::RasterizeTile(uint32_t tile)
+{
+    const int32_t tileX = int32_t(tile % mTilesX) * int32_t(TILE_WIDTH);
+    const int32_t tileY = int32_t(tile / mTilesX) * int32_t(TILE_HEIGHT);
+    float* depth = mLevels[0].data();
+
+    for (int32_t y = tileY; y < tileY + int32_t(TILE_HEIGHT); ++y)
+    {
+        std::fill_n(depth + size_t(y) * mWidth + tileX, TILE_WIDTH, FAR_DEPTH);
+    }
+
+    const __m128 offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+    const __m128 zero = _mm_setzero_ps();
+    for (uint32_t index : mBins[tile])
+    {
+        const Triangle& triangle = mTriangles[index];
+
+        // tile widths are a multiple of 4 so aligning down stays in the tile
+        const int32_t startX = std::max(triangle.minX, tileX) & ~3;
+        const int32_t endX = std::min(triangle.maxX, tileX + int32_t(TILE_WIDTH) - 1);
+        const int32_t startY = std::max(triangle.minY, tileY);
+        const int32_t endY = std::min(triangle.maxY, tileY + int32_t(TILE_HEIGHT) - 1);
+
+        const __m128 edgeA0 = _mm_set1_ps(triangle.edgeA[0]);
+        const __m128 edgeA1 = _mm_set1_ps(triangle.edgeA[1]);
+        const __m128 edgeA2 = _mm_set1_ps(triangle.edgeA[2]);
+        const __m128 depthX = _mm_set1_ps(triangle.depthX);
+
+        for (int32_t y = startY; y <= endY; ++y)
+        {
+            const float centerY = float(y) + 0.5f;
+            const __m128 row0 = _mm_set1_ps(triangle.edgeB[0] * centerY + triangle.edgeC[0]);
+            const __m128 row1 = _mm_set1_ps(triangle.edgeB[1] * centerY + triangle.edgeC[1]);
+            const __m128 row2 = _mm_set1_ps(triangle.edgeB[2] * centerY + triangle.edgeC[2]);
+            const __m128 rowDepth = _mm_set1_ps(triangle.depthY * centerY + triangle.depthConstant);
+            float* line = depth + size_t(y) * mWidth;
+
+            for (int32_t x = startX; x <= endX; x += 4)
+            {
+                const __m128 centerX = _mm_add_ps(_mm_set1_ps(float(x)), offsets);
+                const __m128 edge0 = _mm_add_ps(_mm_mul_ps(edgeA0, centerX), row0);
+                const __m128 edge1 = _mm_add_ps(_mm_mul_ps(edgeA1, centerX), row1);
+                const __m128 edge2 = _mm_add_ps(_mm_mul_ps(edgeA2, centerX), row2);
+                const __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(edge0, zero), _mm_cmpge_ps(edge1, zero)), _mm_cmpge_ps(edge2, zero));
+                if (_mm_movemask_ps(inside) == 0)
+                {
+                    continue;
+                }
+
+                const __m128 pixelDepth = _mm_add_ps(_mm_mul_ps(depthX, centerX), rowDepth);
+                const __m128 current = _mm_loadu_ps(line + x);
+                const __m128 nearest = _mm_min_ps(current, pixelDepth);
+                _mm_storeu_ps(line + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, current)));
+            }
+        }
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Fill each mip level with the farthest depth of the 2x2 texels under it
+*/
+/****************************************************************************/
+void DX11::OcclusionCuller::BuildHierarchy()
+{
+    for (size_t level = 1; level < mLevels.size(); ++level)
+    {
+        const std::vector<float>& source = mLevels[level - 1];
+        const uint32_t sourceWidth = mLevelWidths[level - 1];
+        const uint32_t sourceHeight = mLevelHeights[level - 1];
+        std::vector<float>& target = mLevels[level];
+
+        for (uint32_t y = 0; y < mLevelHeights[level]; ++y)
+        {
+            const uint32_t y0 = y * 2;
+            const uint32_t y1 = std::min(y0 + 1, sourceHeight - 1);
+            for (uint32_t x = 0; x < mLevelWidths[level]; ++x)
+            {
+                const uint32_t x0 = x * 2;
+                const uint32_t x1 = std::min(x0 + 1, sourceWidth - 1);
+                target[size_t(y) * mLevelWidths[level] + x] = std::max(
+                    std::max(source[size_t(y0) * sourceWidth + x0], source[size_t(y0) * sourceWidth + x1]),
+                    std::max(source[size_t(y1) * sourceWidth + x0], source[size_t(y1) * sourceWidth + x1]));
+            }
+        }
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Project a box's 8 corners with SSE and compare its nearest depth against the
+  farthest depth of the texels its screen rectangle covers, at the
+  first mip level where that is at most TEST_TEXELS per axis
+
+\param transform
+  Box space to clip space
+
+\param boundsMin
+  Box minimum
+
+\param boundsMax
+  Box maximum
+
+\return
+  False if the box is hidden
+*/
+/****************************************************************************/
+bool DX11::OcclusionCuller::TestBox(const DirectX::XMFLOAT4X4& transform, const DirectX::XMFLOAT3& boundsMin, const DirectX::XMFLOAT3& boundsMax) const
+{
+    // all 8 corners at once, lanes 0-3 at the min z face and 4-7 at the max z face
+    const __m128 selectX = _mm_setr_ps(0.0f, 1.0f, 0.0f, 1.0f);
+    const __m128 selectY = _mm_setr_ps(0.0f, 0.0f, 1.0f, 1.0f);
+    const float size[3] = { boundsMax.x - boundsMin.x, boundsMax.y - boundsMin.y, boundsMax.z - boundsMin.z };
+    __m128 low[4];
+    __m128 high[4];
+    for (uint32_t c = 0; c < 4; ++c)
+    {
+        const float base = boundsMin.x * transform.m[0][c] + boundsMin.y * transform.m[1][c] + boundsMin.z * transform.m[2][c] + transform.m[3][c];
+        low[c] = _mm_add_ps(_mm_set1_ps(base), _mm_add_ps(
+            _mm_mul_ps(selectX, _mm_set1_ps(size[0] * transform.m[0][c])),
+            _mm_mul_ps(selectY, _mm_set1_ps(size[1] * transform.m[1][c]))));
+        high[c] = _mm_add_ps(low[c], _mm_set1_ps(size[2] * transform.m[2][c]));
+    }
+
+    // crosses the near plane, the camera may be inside it
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 behind = _mm_or_ps(
+        _mm_or_ps(_mm_cmplt_ps(low[2], zero), _mm_cmple_ps(low[3], zero)),
+        _mm_or_ps(_mm_cmplt_ps(high[2], zero), _mm_cmple_ps(high[3], zero)));
+    if (_mm_movemask_ps(behind))
+    {
+        return true;
+    }
+
+    const __m128 halfWidth = _mm_set1_ps(float(mWidth) * 0.5f);
+    const __m128 halfHeight = _mm_set1_ps(float(mHeight) * 0.5f);
+    const __m128 inverseLow = _mm_div_ps(_mm_set1_ps(1.0f), low[3]);
+    const __m128 inverseHigh = _mm_div_ps(_mm_set1_ps(1.0f), high[3]);
+    const __m128 xLow = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(low[0], inverseLow), halfWidth), halfWidth);
+    const __m128 xHigh = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(high[0], inverseHigh), halfWidth), halfWidth);
+    const __m128 yLow = _mm_sub_ps(halfHeight, _mm_mul_ps(_mm_mul_ps(low[1], inverseLow), halfHeight));
+    const __m128 yHigh = _mm_sub_ps(halfHeight, _mm_mul_ps(_mm_mul_ps(high[1], inverseHigh), halfHeight));
+
+    const float minX = HorizontalMin(_mm_min_ps(xLow, xHigh));
+    const float maxX = HorizontalMax(_mm_max_ps(xLow, xHigh));
+    const float minY = HorizontalMin(_mm_min_ps(yLow, yHigh));
+    const float maxY = HorizontalMax(_mm_max_ps(yLow, yHigh));
+    const float minDepth = HorizontalMin(_mm_min_ps(_mm_mul_ps(low[2], inverseLow), _mm_mul_ps(high[2], inverseHigh)));
+
+    if (maxX < 0.0f || maxY < 0.0f || minX >= float(mWidth) || minY >= float(mHeight))
+    {
+        return true;
+    }
+
+    const int32_t x0 = int32_t(std::max(0.0f, std::floor(minX)));
+    const int32_t y0 = int32_t(std::max(0.0f, std::floor(minY)));
+    const int32_t x1 = int32_t(std::min(float(mWidth - 1), std::floor(maxX)));
+    const int32_t y1 = int32_t(std::min(float(mHeight - 1), std::floor(maxY)));
+
+    uint32_t level = 0;
+    while (level + 1 < mLevels.size() && ((x1 >> level) - (x0 >> level) >= TEST_TEXELS || (y1 >> level) - (y0 >> level) >= TEST_TEXELS))
+    {
+        ++level;
+    }
+
+    const std::vector<float>& texels = mLevels[level];
+    const uint32_t levelWidth = mLevelWidths[level];
+    for (int32_t y = y0 >> level; y <= (y1 >> level); ++y)
+    {
+        for (int32_t x = x0 >> level; x <= (x1 >> level); ++x)
+        {
+            if (texels[size_t(y) * levelWidth + x] >= minDepth)
+            {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,335 @@
+/****************************************************************************/
+/*!
+\file
+   PipelineStateCache.cpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Deduplicates rasterizer, depth stencil and blend states. Each desc is
+    hashed and looked up, only a desc never seen before creates a new D3D
+    object and every caller asking for the same desc shares it.
+*/
+/****************************************************************************/
+
+/*============================================================================*\
+|| ------------------------------ INCLUDES ---------------------------------- ||
+\*============================================================================*/
+
+#include "DX11PCH.hpp"
+#include "PipelineStateCache.hpp"
+
+/*============================================================================*\
+|| --------------------------- GLOBAL VARIABLES ----------------------------- ||
+\*============================================================================*/
+
+/*============================================================================*\
+|| -------------------------- STATIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+namespace
+{
+    /****************************************************************************/
+    /*!
+    \brief
+      FNV-1a over raw bytes
+
+    \param data
+      Bytes to hash
+
+    \param size
+      Number of bytes
+    */
+    /****************************************************************************/
+    static uint64_t HashBytes(const void* data, size_t size)
+    {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        uint64_t hash = 14695981039346656037ull;
+        for (size_t i = 0; i < size; ++i)
+        {
+            hash = (hash ^ bytes[i]) * 1099511628211ull;
+        }
+        return hash;
+    }
+
+    /****************************************************************************/
+    /*!
+    \brief
+      Make a desc safe to hash and compare as bytes. The rasterizer desc
+      has no padding and is used as is.
+
+    \param desc
+      The desc as the caller built it
+    */
+    /****************************************************************************/
+    static D3D11_RASTERIZER_DESC Normalize(const D3D11_RASTERIZER_DESC& desc)
+    {
+        return desc;
+    }
+
+    /****************************************************************************/
+    /*!
+    \brief
+      Copy a depth stencil desc field by field into zeroed memory so the
+      padding after the stencil masks is zero
+
+    \param desc
+      The desc as the caller built it
+    */
+    /****************************************************************************/
+    static D3D11_DEPTH_STENCIL_DESC Normalize(const D3D11_DEPTH_STENCIL_DESC& desc)
+    {
+        D3D11_DEPTH_STENCIL_DESC normalized;
+        std::memset(&normalized, 0, sizeof(normalized));
+        normalized.DepthEnable = desc.DepthEnable;
+        normalized.DepthWriteMask = desc.DepthWriteMask;
+        normalized.DepthFunc = desc.DepthFunc;
+        normalized.StencilEnable = desc.StencilEnable;
+        normalized.StencilReadMask = desc.StencilReadMask;
+        normalized.StencilWriteMask = desc.StencilWriteMask;
+        normalized.FrontFace = desc.FrontFace;
+        normalized.BackFace = desc.BackFace;
+        return normalized;
+    }
+
+    /****************************************************************************/
+    /*!
+    \brief
+      Copy a blend desc field by field into zeroed memory so the padding
+      after each write mask is zero, and drop the targets D3D ignores
+
+    \param desc
+      The desc as the caller built it
+    */
+    /****************************************************************************/
+    static D3D11_BLEND_DESC Normalize(const D3D11_BLEND_DESC& desc)
+    {
+        D3D11_BLEND_DESC normalized;
+        std::memset(&normalized, 0, sizeof(normalized));
+        normalized.AlphaToCoverageEnable = desc.AlphaToCoverageEnable;
+        normalized.IndependentBlendEnable = desc.IndependentBlendEnable;
+
+        // without independent blend only the first target is used
+        const uint32_t targets = desc.IndependentBlendEnable ? 8 : 1;
+        for (uint32_t i = 0; i < targets; ++i)
+        {
+            const D3D11_RENDER_TARGET_BLEND_DESC& source = desc.RenderTarget[i];
+            D3D11_RENDER_TARGET_BLEND_DESC& target = normalized.RenderTarget[i];
+            target.BlendEnable = source.BlendEnable;
+            target.SrcBlend = source.SrcBlend;
+            target.DestBlend = source.DestBlend;
+            target.BlendOp = source.BlendOp;
+            target.SrcBlendAlpha = source.SrcBlendAlpha;
+            target.DestBlendAlpha = source.DestBlendAlpha;
+            target.BlendOpAlpha = source.BlendOpAlpha;
+            target.RenderTargetWriteMask = source.RenderTargetWriteMask;
+        }
+        return normalized;
+    }
+}
+
+/*============================================================================*\
+|| -------------------------- PUBLIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Get the rasterizer state for a desc, created on first use
+
+\param device
+  The ID3D11Device
+
+\param desc
+  The state description
+
+\return
+  A handle shared with every other caller of the same desc
+*/
+/****************************************************************************/
+DX11::RasterizerState DX11::PipelineStateCache::Rasterizer(DX11::Device device, const D3D11_RASTERIZER_DESC& desc)
+{
+    return Find(device, mRasterizers, Normalize(desc), false);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the depth stencil state for a desc, created on first use
+
+\param device
+  The ID3D11Device
+
+\param desc
+  The state description
+
+\return
+  A handle shared with every other caller of the same desc
+*/
+/****************************************************************************/
+DX11::DepthStencilState DX11::PipelineStateCache::DepthStencil(DX11::Device device, const D3D11_DEPTH_STENCIL_DESC& desc)
+{
+    return Find(device, mDepthStencils, Normalize(desc), false);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the blend state for a desc, created on first use
+
+\param device
+  The ID3D11Device
+
+\param desc
+  The state description
+
+\return
+  A handle shared with every other caller of the same desc
+*/
+/****************************************************************************/
+DX11::BlendState DX11::PipelineStateCache::Blend(DX11::Device device, const D3D11_BLEND_DESC& desc)
+{
+    return Find(device, mBlends, Normalize(desc), false);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Create every listed state up front so the first frame that uses one does
+  not pay for creation. Counted as prewarmed, not as misses.
+
+\param device
+  The ID3D11Device
+
+\param rasterizers
+  Rasterizer descs to create
+
+\param depthStencils
+  Depth stencil descs to create
+
+\param blends
+  Blend descs to create
+*/
+/****************************************************************************/
+void DX11::PipelineStateCache::Prewarm(DX11::Device device,
+    const std::vector<D3D11_RASTERIZER_DESC>& rasterizers,
+    const std::vector<D3D11_DEPTH_STENCIL_DESC>& depthStencils,
+    const std::vector<D3D11_BLEND_DESC>& blends)
+{
+    for (const D3D11_RASTERIZER_DESC& desc : rasterizers)
+    {
+        Find(device, mRasterizers, Normalize(desc), true);
+    }
+    for (const D3D11_DEPTH_STENCIL_DESC& desc : depthStencils)
+    {
+        Find(device, mDepthStencils, Normalize(desc), true);
+    }
+    for (const D3D11_BLEND_DESC& desc : blends)
+    {
+        Find(device, mBlends, Normalize(desc), true);
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Drop every state, needed when the device is recreated
+*/
+/****************************************************************************/
+void DX11::PipelineStateCache::Clear()
+{
+    mRasterizers.clear();
+    mDepthStencils.clear();
+    mBlends.clear();
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the hit / miss counts and how many states are held
+*/
+/****************************************************************************/
+DX11::PipelineStateCacheStats DX11::PipelineStateCache::Stats() const
+{
+    DX11::PipelineStateCacheStats stats = mStats;
+    stats.states = mRasterizers.size() + mDepthStencils.size() + mBlends.size();
+    return stats;
+}
+
+/*============================================================================*\
+|| ------------------------- PRIVATE FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Hash a normalized desc
+*/
+/****************************************************************************/
+template <typename Desc>
+size_t DX11::PipelineStateCache::DescHash<Desc>::operator()(const Desc& desc) const
+{
+    return size_t(HashBytes(&desc, sizeof(Desc)));
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Compare two normalized descs
+*/
+/****************************************************************************/
+template <typename Desc>
+bool DX11::PipelineStateCache::DescEqual<Desc>::operator()(const Desc& a, const Desc& b) const
+{
+    return std::memcmp(&a, &b, sizeof(Desc)) == 0;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Look a normalized desc up and create the state if it is new
+
+\param device
+  The ID3D11Device
+
+\param table
+  The table for this kind of state
+
+\param desc
+  Normalized desc
+
+\param prewarm
+  Count a creation as prewarmed instead of a miss, and a find as nothing
+
+\return
+  The shared state
+*/
+/****************************************************************************/
+template <typename Desc, typename State>
+State DX11::PipelineStateCache::Find(DX11::Device device, Table<Desc, State>& table, const Desc& desc, bool prewarm)
+{
+    typename Table<Desc, State>::iterator found = table.find(desc);
+    if (found != table.end())
+    {
+        if (!prewarm)
+        {
+            ++mStats.hits;
+        }
+        return found->second;
+    }
+
+    if (prewarm)
+    {
+        ++mStats.prewarmed;
+    }
+    else
+    {
+        ++mStats.misses;
+    }
+
+    State state(device, desc);
+    table.emplace(desc, state);
+    return state;
+}
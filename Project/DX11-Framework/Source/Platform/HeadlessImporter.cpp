@@ -0,0 +1,78 @@
+/****************************************************************************/
+/*!
+\file
+   HeadlessImporter.cpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    The part of Assimp::Importer Mesh::Import uses, for builds where the
+    assimp library is not available (only the Windows .lib ships in Lib).
+    Every import fails with a readable error, meshes already in memory
+    still go through Mesh::Convert and cached meshes still load.
+*/
+/****************************************************************************/
+
+/*============================================================================*\
+|| ------------------------------ INCLUDES ---------------------------------- ||
+\*============================================================================*/
+
+#include "DX11PCH.hpp"
+#include <assimp/Importer.hpp>
+
+/*============================================================================*\
+|| -------------------------- PUBLIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Constructor, there is no implementation to create
+*/
+/****************************************************************************/
+Assimp::Importer::Importer() :
+    pimpl(nullptr)
+{
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Destructor
+*/
+/****************************************************************************/
+Assimp::Importer::~Importer()
+{
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Fail every import, GetErrorString says why
+
+\return
+  nullptr
+*/
+/****************************************************************************/
+const aiScene* Assimp::Importer::ReadFile(const char* pFile, unsigned int pFlags)
+{
+    UNUSED(pFile);
+    UNUSED(pFlags);
+    return nullptr;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Why ReadFile failed
+
+\return
+  The error
+*/
+/****************************************************************************/
+const char* Assimp::Importer::GetErrorString() const
+{
+    return "assimp is not available in this build";
+}
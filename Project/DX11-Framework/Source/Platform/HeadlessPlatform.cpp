@@ -0,0 +1,647 @@
+/****************************************************************************/
+/*!
+\file
+   HeadlessPlatform.cpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Definitions behind HeadlessPlatform.hpp. Files and read only mappings go
+    to POSIX so the mesh cache works, everything that would create a GPU
+    object or a window fails the way a machine without D3D11 would.
+*/
+/****************************************************************************/
+
+/*============================================================================*\
+|| ------------------------------ INCLUDES ---------------------------------- ||
+\*============================================================================*/
+
+#include "DX11PCH.hpp"
+#include <chrono>
+#include <cstring>
+#include <cstdio>
+#include <mutex>
+#include <unordered_map>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*============================================================================*\
+|| --------------------------- GLOBAL VARIABLES ----------------------------- ||
+\*============================================================================*/
+
+namespace HEADLESS
+{
+    //! what a HANDLE points at, files and mappings share it
+    struct FileHandle
+    {
+        int fd = -1;
+        bool mapping = false;
+    };
+
+    //! munmap needs the length MapViewOfFile was given
+    static std::mutex gViewLock;
+    static std::unordered_map<const void*, size_t> gViews;
+
+    static GLFWerrorfun gErrorCallback = nullptr;
+    static const std::chrono::steady_clock::time_point gStartTime = std::chrono::steady_clock::now();
+}
+
+/*============================================================================*\
+|| -------------------------- STATIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+namespace HEADLESS
+{
+    /****************************************************************************/
+    /*!
+    \brief
+      Turn a wide path from utf8ToUtf16 back into the UTF-8 POSIX expects
+
+    \param wide
+      Null terminated path, one code point per wchar_t
+
+    \return
+      The UTF-8 path
+    */
+    /****************************************************************************/
+    static std::string ToUtf8(const WCHAR* wide)
+    {
+        std::string out;
+        for (; *wide; ++wide)
+        {
+            uint32_t c = uint32_t(*wide);
+            if (c < 0x80)
+            {
+                out += char(c);
+            }
+            else if (c < 0x800)
+            {
+                out += char(0xc0 | (c >> 6));
+                out += char(0x80 | (c & 0x3f));
+            }
+            else if (c < 0x10000)
+            {
+                out += char(0xe0 | (c >> 12));
+                out += char(0x80 | ((c >> 6) & 0x3f));
+                out += char(0x80 | (c & 0x3f));
+            }
+            else
+            {
+                out += char(0xf0 | (c >> 18));
+                out += char(0x80 | ((c >> 12) & 0x3f));
+                out += char(0x80 | ((c >> 6) & 0x3f));
+                out += char(0x80 | (c & 0x3f));
+            }
+        }
+        return out;
+    }
+
+    /****************************************************************************/
+    /*!
+    \brief
+      Get the handle behind a HANDLE
+
+    \param handle
+      Handle from CreateFileW or CreateFileMappingW
+
+    \return
+      The handle, nullptr for null or INVALID_HANDLE_VALUE
+    */
+    /****************************************************************************/
+    static FileHandle* FromHandle(HANDLE handle)
+    {
+        if (handle == nullptr || handle == INVALID_HANDLE_VALUE)
+        {
+            return nullptr;
+        }
+        return static_cast<FileHandle*>(handle);
+    }
+}
+
+/*============================================================================*\
+|| -------------------------- PUBLIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Decode UTF-8 into one wchar_t per code point, with the MultiByteToWideChar
+  contract: a null output or zero count only measures.
+
+\return
+  Number of wide characters written or needed, 0 on a bad sequence
+*/
+/****************************************************************************/
+int MultiByteToWideChar(UINT codePage, DWORD flags, const char* multiByte, int multiByteCount, WCHAR* wideChar, int wideCharCount)
+{
+    UNUSED(flags);
+    if (codePage != CP_UTF8 || multiByte == nullptr)
+    {
+        return 0;
+    }
+
+    const size_t size = multiByteCount < 0 ? std::strlen(multiByte) + 1 : size_t(multiByteCount);
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(multiByte);
+    int written = 0;
+    for (size_t i = 0; i < size;)
+    {
+        uint32_t c = bytes[i];
+        size_t extra = c < 0x80 ? 0 : (c >> 5) == 0x6 ? 1 : (c >> 4) == 0xe ? 2 : (c >> 3) == 0x1e ? 3 : 4;
+        if (extra == 4 || i + extra >= size)
+        {
+            return 0;
+        }
+
+        c &= extra == 0 ? 0x7f : (0x3f >> extra);
+        for (size_t k = 1; k <= extra; ++k)
+        {
+            c = (c << 6) | (bytes[i + k] & 0x3f);
+        }
+        i += extra + 1;
+
+        if (wideChar != nullptr && wideCharCount > 0)
+        {
+            if (written >= wideCharCount)
+            {
+                return 0;
+            }
+            wideChar[written] = WCHAR(c);
+        }
+        ++written;
+    }
+    return written;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Open a file for reading, the only mode the framework uses
+
+\return
+  The handle, INVALID_HANDLE_VALUE on failure
+*/
+/****************************************************************************/
+HANDLE CreateFileW(const WCHAR* fileName, DWORD access, DWORD shareMode, void* security, DWORD creation, DWORD flags, HANDLE templateFile)
+{
+    UNUSED(access);
+    UNUSED(shareMode);
+    UNUSED(security);
+    UNUSED(creation);
+    UNUSED(flags);
+    UNUSED(templateFile);
+
+    int fd = ::open(HEADLESS::ToUtf8(fileName).c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return INVALID_HANDLE_VALUE;
+    }
+
+    HEADLESS::FileHandle* handle = new HEADLESS::FileHandle();
+    handle->fd = fd;
+    return handle;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Size of an open file
+
+\return
+  TRUE on success
+*/
+/****************************************************************************/
+BOOL GetFileSizeEx(HANDLE file, LARGE_INTEGER* size)
+{
+    HEADLESS::FileHandle* handle = HEADLESS::FromHandle(file);
+    struct stat info;
+    if (!handle || ::fstat(handle->fd, &info) != 0)
+    {
+        return FALSE;
+    }
+
+    size->QuadPart = INT64(info.st_size);
+    return TRUE;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Read only mapping object for a whole file
+
+\return
+  The mapping, nullptr on failure
+*/
+/****************************************************************************/
+HANDLE CreateFileMappingW(HANDLE file, void* security, DWORD protect, DWORD sizeHigh, DWORD sizeLow, const WCHAR* name)
+{
+    UNUSED(security);
+    UNUSED(sizeHigh);
+    UNUSED(sizeLow);
+    UNUSED(name);
+
+    HEADLESS::FileHandle* handle = HEADLESS::FromHandle(file);
+    if (!handle || protect != PAGE_READONLY)
+    {
+        return nullptr;
+    }
+
+    // the mapping outlives the file handle on Windows, so it gets its own descriptor
+    int fd = ::dup(handle->fd);
+    if (fd < 0)
+    {
+        return nullptr;
+    }
+
+    HEADLESS::FileHandle* mapping = new HEADLESS::FileHandle();
+    mapping->fd = fd;
+    mapping->mapping = true;
+    return mapping;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Map a view of a mapping, 0 bytes maps to the end of the file
+
+\return
+  The view, nullptr on failure
+*/
+/****************************************************************************/
+void* MapViewOfFile(HANDLE mapping, DWORD access, DWORD offsetHigh, DWORD offsetLow, SIZE_T bytes)
+{
+    UNUSED(access);
+
+    HEADLESS::FileHandle* handle = HEADLESS::FromHandle(mapping);
+    struct stat info;
+    if (!handle || !handle->mapping || ::fstat(handle->fd, &info) != 0)
+    {
+        return nullptr;
+    }
+
+    const off_t offset = off_t((uint64_t(offsetHigh) << 32) | offsetLow);
+    const size_t size = bytes != 0 ? bytes : size_t(info.st_size - offset);
+    if (size == 0)
+    {
+        return nullptr;
+    }
+
+    void* view = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, handle->fd, offset);
+    if (view == MAP_FAILED)
+    {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(HEADLESS::gViewLock);
+    HEADLESS::gViews[view] = size;
+    return view;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Unmap a view from MapViewOfFile
+
+\return
+  TRUE on success
+*/
+/****************************************************************************/
+BOOL UnmapViewOfFile(const void* view)
+{
+    size_t size = 0;
+    {
+        std::lock_guard<std::mutex> lock(HEADLESS::gViewLock);
+        auto it = HEADLESS::gViews.find(view);
+        if (it == HEADLESS::gViews.end())
+        {
+            return FALSE;
+        }
+        size = it->second;
+        HEADLESS::gViews.erase(it);
+    }
+
+    return ::munmap(const_cast<void*>(view), size) == 0 ? TRUE : FALSE;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Close a file or mapping handle
+
+\return
+  TRUE on success
+*/
+/****************************************************************************/
+BOOL CloseHandle(HANDLE handle)
+{
+    HEADLESS::FileHandle* file = HEADLESS::FromHandle(handle);
+    if (!file)
+    {
+        return FALSE;
+    }
+
+    ::close(file->fd);
+    delete file;
+    return TRUE;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Rename a file over another, rename already replaces on POSIX
+
+\return
+  TRUE on success
+*/
+/****************************************************************************/
+BOOL MoveFileExW(const WCHAR* existing, const WCHAR* replacement, DWORD flags)
+{
+    UNUSED(flags);
+    return std::rename(HEADLESS::ToUtf8(existing).c_str(), HEADLESS::ToUtf8(replacement).c_str()) == 0 ? TRUE : FALSE;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Delete a file
+
+\return
+  TRUE on success
+*/
+/****************************************************************************/
+BOOL DeleteFileW(const WCHAR* fileName)
+{
+    return std::remove(HEADLESS::ToUtf8(fileName).c_str()) == 0 ? TRUE : FALSE;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  No DXGI without Windows
+
+\return
+  E_FAIL
+*/
+/****************************************************************************/
+HRESULT CreateDXGIFactory1(const IID& riid, void** factory)
+{
+    UNUSED(riid);
+    *factory = nullptr;
+    return E_FAIL;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  No D3D11 without Windows, use the headless device instead
+
+\return
+  E_FAIL
+*/
+/****************************************************************************/
+HRESULT D3D11CreateDevice(IDXGIAdapter1* adapter, D3D_DRIVER_TYPE driverType, void* software, UINT flags, const D3D_FEATURE_LEVEL* featureLevels,
+    UINT featureLevelCount, UINT sdkVersion, ID3D11Device** device, D3D_FEATURE_LEVEL* featureLevel, ID3D11DeviceContext** context)
+{
+    UNUSED(adapter);
+    UNUSED(driverType);
+    UNUSED(software);
+    UNUSED(flags);
+    UNUSED(featureLevels);
+    UNUSED(featureLevelCount);
+    UNUSED(sdkVersion);
+    UNUSED(featureLevel);
+
+    if (device)
+    {
+        *device = nullptr;
+    }
+    if (context)
+    {
+        *context = nullptr;
+    }
+    return E_FAIL;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  No shader bytecode without Windows, headless shaders never load it
+
+\return
+  E_FAIL
+*/
+/****************************************************************************/
+HRESULT D3DReadFileToBlob(const WCHAR* fileName, ID3DBlob** contents)
+{
+    UNUSED(fileName);
+    *contents = nullptr;
+    return E_FAIL;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  No shader reflection without Windows
+
+\return
+  E_FAIL
+*/
+/****************************************************************************/
+HRESULT D3DReflect(const void* data, SIZE_T size, const IID& riid, void** reflector)
+{
+    UNUSED(data);
+    UNUSED(size);
+    UNUSED(riid);
+    *reflector = nullptr;
+    return E_FAIL;
+}
+
+/*============================================================================*\
+|| -------------------------------- GLFW ------------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Windows need Win32, report it through the error callback like GLFW would
+
+\return
+  GLFW_FALSE
+*/
+/****************************************************************************/
+int glfwInit(void)
+{
+    if (HEADLESS::gErrorCallback)
+    {
+        HEADLESS::gErrorCallback(GLFW_PLATFORM_ERROR, "This build has no window system, run with --headless");
+    }
+    return GLFW_FALSE;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Nothing to shut down
+*/
+/****************************************************************************/
+void glfwTerminate(void)
+{
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Keep the callback glfwInit reports through
+
+\return
+  The previous callback
+*/
+/****************************************************************************/
+GLFWerrorfun glfwSetErrorCallback(GLFWerrorfun callback)
+{
+    GLFWerrorfun previous = HEADLESS::gErrorCallback;
+    HEADLESS::gErrorCallback = callback;
+    return previous;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Ignored, no window is ever created
+*/
+/****************************************************************************/
+void glfwWindowHint(int hint, int value)
+{
+    UNUSED(hint);
+    UNUSED(value);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  No window system
+
+\return
+  nullptr
+*/
+/****************************************************************************/
+GLFWwindow* glfwCreateWindow(int width, int height, const char* title, GLFWmonitor* monitor, GLFWwindow* share)
+{
+    UNUSED(width);
+    UNUSED(height);
+    UNUSED(title);
+    UNUSED(monitor);
+    UNUSED(share);
+    return nullptr;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Nothing to destroy
+*/
+/****************************************************************************/
+void glfwDestroyWindow(GLFWwindow* window)
+{
+    UNUSED(window);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  There is no window to keep open
+
+\return
+  GLFW_TRUE
+*/
+/****************************************************************************/
+int glfwWindowShouldClose(GLFWwindow* window)
+{
+    UNUSED(window);
+    return GLFW_TRUE;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Ignored, no window is ever created
+*/
+/****************************************************************************/
+void glfwSetWindowUserPointer(GLFWwindow* window, void* pointer)
+{
+    UNUSED(window);
+    UNUSED(pointer);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  No window, no pointer
+
+\return
+  nullptr
+*/
+/****************************************************************************/
+void* glfwGetWindowUserPointer(GLFWwindow* window)
+{
+    UNUSED(window);
+    return nullptr;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Ignored, the framebuffer never resizes
+
+\return
+  nullptr
+*/
+/****************************************************************************/
+GLFWframebuffersizefun glfwSetFramebufferSizeCallback(GLFWwindow* window, GLFWframebuffersizefun callback)
+{
+    UNUSED(window);
+    UNUSED(callback);
+    return nullptr;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  No events without a window
+*/
+/****************************************************************************/
+void glfwPollEvents(void)
+{
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Seconds since startup, the headless timer still works
+
+\return
+  The time in seconds
+*/
+/****************************************************************************/
+double glfwGetTime(void)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - HEADLESS::gStartTime).count();
+}
+
+/****************************************************************************/
+/*!
+\brief
+  No native window
+
+\return
+  nullptr
+*/
+/****************************************************************************/
+HWND glfwGetWin32Window(GLFWwindow* window)
+{
+    UNUSED(window);
+    return nullptr;
+}
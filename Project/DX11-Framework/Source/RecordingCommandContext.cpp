@@ -0,0 +1,654 @@
+/****************************************************************************/
+/*!
+\file
+   RecordingCommandContext.cpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    CommandContext that records every command into a flat log and counts
+    what a frame costs on the CPU. With no forward context it is the whole
+    backend, so the render path runs headless without a GPU. With one it
+    tees into the real context and the stats come from live frames.
+*/
+/****************************************************************************/
+
+/*============================================================================*\
+|| ------------------------------ INCLUDES ---------------------------------- ||
+\*============================================================================*/
+
+#include "DX11PCH.hpp"
+#include "RecordingCommandContext.hpp"
+
+/*============================================================================*\
+|| --------------------------- GLOBAL VARIABLES ----------------------------- ||
+\*============================================================================*/
+
+namespace
+{
+    //! enough for a few thousand draws before the log has to grow
+    static const size_t RESERVED_COMMANDS = 16384;
+}
+
+/*============================================================================*\
+|| -------------------------- STATIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+namespace
+{
+    /****************************************************************************/
+    /*!
+    \brief
+      Add one set of counts to another, the cpu time is left alone
+
+    \param total
+      Receives the counts
+
+    \param stats
+      Counts to add
+    */
+    /****************************************************************************/
+    static void Accumulate(DX11::CommandStats& total, const DX11::CommandStats& stats)
+    {
+        total.commands += stats.commands;
+        total.draws += stats.draws;
+        total.instances += stats.instances;
+        total.indices += stats.indices;
+        total.stateChanges += stats.stateChanges;
+        total.maps += stats.maps;
+        total.bytesMapped += stats.bytesMapped;
+        total.copies += stats.copies;
+    }
+}
+
+/*============================================================================*\
+|| -------------------------- PUBLIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Constructor
+
+\param forward
+  Context every command is passed on to, null to record only
+*/
+/****************************************************************************/
+DX11::RecordingCommandContext::RecordingCommandContext(std::shared_ptr<DX11::CommandContext> forward) :
+    mForward(forward)
+{
+    mCommands.reserve(RESERVED_COMMANDS);
+    mFrameStart = std::chrono::steady_clock::now();
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Start a new frame, clears the log and the stats
+*/
+/****************************************************************************/
+void DX11::RecordingCommandContext::BeginFrame()
+{
+    mCommands.clear();
+    mStats = DX11::CommandStats();
+    mExecutedCommands = 0;
+    mFrameStart = std::chrono::steady_clock::now();
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Finish the frame, the log and the stats stay valid until BeginFrame.
+  The stats include the command lists executed this frame, the log only
+  holds the ExecuteCommandList.
+*/
+/****************************************************************************/
+void DX11::RecordingCommandContext::EndFrame()
+{
+    mStats.commands = uint32_t(mCommands.size()) + mExecutedCommands;
+    mStats.cpuMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - mFrameStart).count();
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get every command recorded since BeginFrame, in order
+*/
+/****************************************************************************/
+const std::vector<DX11::Command>& DX11::RecordingCommandContext::Commands() const
+{
+    return mCommands;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the counts for the last frame, complete after EndFrame
+*/
+/****************************************************************************/
+const DX11::CommandStats& DX11::RecordingCommandContext::Stats() const
+{
+    return mStats;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Record a state change, see CommandContext::SetPrimitiveTopology
+*/
+/****************************************************************************/
+void DX11::RecordingCommandContext::SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology)
+{
+    RecordState(DX11::CommandType::SetPrimitiveTopology, nullptr, uint32_t(topology));
+    if (mForward)
+    {
+        mForward->SetPrimitiveTopology(topology);
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Record a state change, see CommandContext::SetInputLayout
+*/
+/****************************************************************************/
+void DX11::RecordingCommandContext::SetInputLayout(ID3D11InputLayout* layout)
+{
+    RecordState(DX11::CommandType::SetInputLayout, layout);
+    if (mForward)
+    {
+        mForward->SetInputLayout(layout);
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Record a state change, see CommandContext::SetVertexBuffers
+*/
+/****************************************************************************/
+void DX11::RecordingCommandContext::SetVertexBuffers(uint32_t slot, uint32_t count, ID3D11Buffer* const* buffers, const uint32_t* strides, const uint32_t* offsets)
+{
+    RecordState(DX11::CommandType::SetVertexBuffers, count ? buffers[0] : nullptr, slot, count, count ? strides[0] : 0);
+    if (mForward)
+    {
+        mForward->SetVertexBuffers(slot, count, buffers, strides, offsets);
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Record a state change, see CommandContext::SetIndexBuffer
+*/
+/****************************************************************************/
+void DX11::RecordingCommandContext::SetIndexBuffer(ID3D11Buffer* buffer, DXGI_FORMAT format, uint32_t offset)
+{
+    RecordState(DX11::CommandType::SetIndexBuffer, buffer, uint32_t(format), offset);
+    if (mForward)
+    {
+        mForward->SetIndexBuffer(buffer, format, offset);
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Record a state change, see CommandContext::SetVertexShader
+*/
+/****************************************************************************/
+void DX11::RecordingCommandContext::SetVertexShader(ID3D11VertexShader* shader)
+{
+    RecordState(DX11::CommandType::SetVertexShader, shader);
+    if (mForward)
+    {
+        mForward->SetVertexShader(shader);
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Record a state change, see CommandContext::SetPixelShader
+*/
+/****************************************************************************/
+void DX11::RecordingCommandContext::SetPixelShader(ID3D11PixelShader* shader)
+{
+    RecordState(DX11::CommandType::SetPixelShader, shader);
+    if (mForward)
+    {
+        mForward->SetPixelShader(shader);
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Record a state change, see CommandContext::SetVSConstantBuffer
+*/
+/****************************************************************************/
+void DX11::RecordingCommandContext::SetVSConstantBuffer(uint32_t slot, ID3D11Buffer* buffer, uint32_t firstConstant, uint32_t constantCount)
+{
+    RecordState(DX11::CommandType::SetVSConstantBuffer, buffer, slot, firstConstant, constantCount);
+    if (mForward)
+    {
+        mForward->SetVSConstantBuffer(slot, buffer, firstConstant, constantCount);
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Record a state change, see CommandContext::SetPSConstantBuffer
+*/
+/****************************************************************************/
+void DX11::RecordingCommandContext::SetPSConstantBuffer(uint32_t slot, ID3D11Buffer* buffer, uint32_t firstConstant, uint32_t constantCount)
+{
+    RecordState(DX11::CommandType::SetPSConstantBuffer, buffer, slot, firstConstant, constantCount);
+    if (mForward)
+    {
+        mForward->SetPSConstantBuffer(slot, buffer, firstConstant, constantCount);
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Record a state change, see CommandContext::SetRasterizerState
+*/
+/****************************************************************************/
+void DX11::RecordingCommandContext::SetRasterizerState(ID3D11RasterizerState* state)
+{
+    RecordState(DX11::CommandType::SetRasterizerState, state);
+    if (mForward)
+    {
+        mForward->SetRasterizerState(state);
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Record a state change, see CommandContext::SetViewports
+*/
+/****************************************************************************/
+void DX11::RecordingCommandContext::SetViewports(uint32_t count, const D3D11_VIEWPORT* viewports)
+{
+    RecordState(DX11::CommandType::SetViewports, nullptr, count);
+    if (mForward)
+    {
+        mForward->SetViewports(count, viewports);
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Record a state change, see CommandContext::SetBlendState
+*/
+/****************************************************************************/
+void DX11::RecordingCommandContext::SetBlendState(ID3D11BlendState* state, const float factors[4], uint32_t sampleMask)
+{
+    RecordState(DX11::CommandType::SetBlendState, state, sampleMask);
+    if (mForward)
+    {
+        mForward->SetBlendState(state, factors, sampleMask);
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Record a state change, see CommandContext::SetDepthStencilState
+*/
+/****************************************************************************/
+void DX11::RecordingCommandContext::SetDepthStencilState(ID3D11DepthStencilState* state, uint32_t stencilRef)
+{
+    RecordState(DX11::CommandType::SetDepthStencilState, state, stencilRef);
+    if (mForward)
+    {
+        mForward->SetDepthStencilState(state, stencilRef);
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Record a state change, see CommandContext::SetRenderTargets
+*/
+/****************************************************************************/
+void DX11::RecordingCommandContext::SetRenderTargets(uint32_t count, ID3D11RenderTargetView* const* views, ID3D11DepthStencilView* depth)
+{
+    RecordState(DX11::CommandType::SetRenderTargets, depth, count);
+    if (mForward)
+    {
+        mForward->SetRenderTargets(count, views, depth);
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Record a clear, see CommandContext::ClearRenderTargetView
+*/
+/****************************************************************************/
+void DX11::RecordingCommandContext::ClearRenderTargetView(ID3D11RenderTargetView* view, const float color[4])
+{
+    Record(DX11::CommandType::ClearRenderTargetView, view);
+    if (mForward)
+    {
+        mForward->ClearRenderTargetView(view, color);
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Record a clear, see CommandContext::ClearDepthStencilView
+*/
+/****************************************************************************/
+void DX11::RecordingCommandContext::ClearDepthStencilView(ID3D11DepthStencilView* view, uint32_t flags, float depth, uint8_t stencil)
+{
+    Record(DX11::CommandType::ClearDepthStencilView, view, flags, stencil);
+    if (mForward)
+    {
+        mForward->ClearDepthStencilView(view, flags, depth, stencil);
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Record a draw
+*/
+/****************************************************************************/
+void DX11::RecordingCommandContext::DrawIndexed(uint32_t indexCount, uint32_t firstIndex, int32_t baseVertex)
+{
+    Record(DX11::CommandType::DrawIndexed, nullptr, indexCount, firstIndex, uint32_t(baseVertex));
+    ++mStats.draws;
+    mStats.indices += indexCount;
+    if (mForward)
+    {
+        mForward->DrawIndexed(indexCount, firstIndex, baseVertex);
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Record an instanced draw, the base vertex is not kept
+*/
+/****************************************************************************/
+void DX11::RecordingCommandContext::DrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t baseVertex, uint32_t firstInstance)
+{
+    Record(DX11::CommandType::DrawIndexedInstanced, nullptr, indexCount, instanceCount, firstInstance);
+    ++mStats.draws;
+    mStats.instances += instanceCount;
+    mStats.indices += uint64_t(indexCount) * instanceCount;
+    if (mForward)
+    {
+        mForward->DrawIndexedInstanced(indexCount, instanceCount, firstIndex, baseVertex, firstInstance);
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Record a map. Without a forward context the memory is scratch owned
+  by the recorder, kept per resource so writes land somewhere real.
+*/
+/****************************************************************************/
+void* DX11::RecordingCommandContext::Map(ID3D11Resource* resource, D3D11_MAP mapType, uint32_t size)
+{
+    Record(DX11::CommandType::Map, resource, uint32_t(mapType), size);
+    ++mStats.maps;
+    mStats.bytesMapped += size;
+    if (mForward)
+    {
+        return mForward->Map(resource, mapType, size);
+    }
+
+    std::vector<uint8_t>& scratch = mScratch[resource];
+    if (scratch.size() < size)
+    {
+        scratch.resize(size);
+    }
+    return scratch.data();
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Record an unmap
+*/
+/****************************************************************************/
+void DX11::RecordingCommandContext::Unmap(ID3D11Resource* resource)
+{
+    Record(DX11::CommandType::Unmap, resource);
+    if (mForward)
+    {
+        mForward->Unmap(resource);
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Record a buffer copy
+*/
+/****************************************************************************/
+void DX11::RecordingCommandContext::CopyBufferRegion(ID3D11Buffer* destination, uint32_t destinationOffset, ID3D11Buffer* source, uint32_t sourceOffset, uint32_t size)
+{
+    Record(DX11::CommandType::CopyBufferRegion, destination, destinationOffset, sourceOffset, size);
+    ++mStats.copies;
+    if (mForward)
+    {
+        mForward->CopyBufferRegion(destination, destinationOffset, source, sourceOffset, size);
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Record a fence
+*/
+/****************************************************************************/
+void DX11::RecordingCommandContext::EndQuery(ID3D11Query* query)
+{
+    Record(DX11::CommandType::EndQuery, query);
+    if (mForward)
+    {
+        mForward->EndQuery(query);
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Poll a fence. Headless there is no GPU to wait on, every fence has passed.
+*/
+/****************************************************************************/
+HRESULT DX11::RecordingCommandContext::GetQueryData(ID3D11Query* query, bool flush)
+{
+    Record(DX11::CommandType::GetQueryData, query, flush);
+    if (mForward)
+    {
+        return mForward->GetQueryData(query, flush);
+    }
+    return S_OK;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Record a state reset
+*/
+/****************************************************************************/
+void DX11::RecordingCommandContext::ClearState()
+{
+    Record(DX11::CommandType::ClearState, nullptr);
+    if (mForward)
+    {
+        mForward->ClearState();
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Record a flush
+*/
+/****************************************************************************/
+void DX11::RecordingCommandContext::Flush()
+{
+    Record(DX11::CommandType::Flush, nullptr);
+    if (mForward)
+    {
+        mForward->Flush();
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Create a recording deferred context. Its counts end up in this context's
+  stats once its command list is executed here, so the frame stats cover
+  every thread. This context must outlive it.
+*/
+/****************************************************************************/
+std::shared_ptr<DX11::CommandContext> DX11::RecordingCommandContext::CreateDeferred()
+{
+    std::shared_ptr<DX11::RecordingCommandContext> deferred = std::make_shared<DX11::RecordingCommandContext>(mForward ? mForward->CreateDeferred() : nullptr);
+    deferred->mParent = this;
+    return deferred;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Record the end of a command list and hand the counts to the parent.
+  Headless there is no list, a null one is returned.
+*/
+/****************************************************************************/
+DX11::CommandList DX11::RecordingCommandContext::FinishCommandList()
+{
+    Record(DX11::CommandType::FinishCommandList, nullptr);
+    mStats.commands = uint32_t(mCommands.size());
+    if (mParent)
+    {
+        mParent->Defer(mStats);
+    }
+
+    mCommands.clear();
+    mStats = DX11::CommandStats();
+
+    if (mForward)
+    {
+        return mForward->FinishCommandList();
+    }
+    return DX11::CommandList();
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Record a command list execution and take in the deferred counts
+*/
+/****************************************************************************/
+void DX11::RecordingCommandContext::ExecuteCommandList(ID3D11CommandList* list)
+{
+    Record(DX11::CommandType::ExecuteCommandList, list);
+    {
+        std::lock_guard<std::mutex> lock(mDeferredMutex);
+        mExecutedCommands += mDeferred.commands;
+        mDeferred.commands = 0;
+        Accumulate(mStats, mDeferred);
+        mDeferred = DX11::CommandStats();
+    }
+
+    if (mForward)
+    {
+        mForward->ExecuteCommandList(list);
+    }
+}
+
+/*============================================================================*\
+|| ------------------------- PRIVATE FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Append a command to the log
+
+\param type
+  What was called
+
+\param object
+  The resource, view or state it touched
+
+\param a
+  First argument worth keeping
+
+\param b
+  Second argument worth keeping
+
+\param c
+  Third argument worth keeping
+*/
+/****************************************************************************/
+void DX11::RecordingCommandContext::Record(DX11::CommandType type, const void* object, uint32_t a, uint32_t b, uint32_t c)
+{
+    DX11::Command command;
+    command.type = type;
+    command.object = object;
+    command.args[0] = a;
+    command.args[1] = b;
+    command.args[2] = c;
+    mCommands.push_back(command);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Append a command that changes pipeline state and count it
+
+\param type
+  What was called
+
+\param object
+  The resource, view or state it touched
+
+\param a
+  First argument worth keeping
+
+\param b
+  Second argument worth keeping
+
+\param c
+  Third argument worth keeping
+*/
+/****************************************************************************/
+void DX11::RecordingCommandContext::RecordState(DX11::CommandType type, const void* object, uint32_t a, uint32_t b, uint32_t c)
+{
+    Record(type, object, a, b, c);
+    ++mStats.stateChanges;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Take the counts of a finished deferred command list, called from the
+  thread that recorded it
+
+\param stats
+  The deferred context's counts
+*/
+/****************************************************************************/
+void DX11::RecordingCommandContext::Defer(const DX11::CommandStats& stats)
+{
+    std::lock_guard<std::mutex> lock(mDeferredMutex);
+    Accumulate(mDeferred, stats);
+}
@@ -0,0 +1,518 @@
+/****************************************************************************/
+/*!
+\file
+   RenderQueue.cpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Draws are submitted as a 64 bit sort key and a payload index instead of
+    being issued on the spot. Once a frame the keys are radix sorted and the
+    draws played back in key order, only binding what changed since the
+    previous draw. Runs of the same draw with an instanced shader are
+    merged into one DrawIndexedInstanced over their per-instance data.
+    Playback can be split into slices recorded on deferred contexts.
+*/
+/****************************************************************************/
+
+/*============================================================================*\
+|| ------------------------------ INCLUDES ---------------------------------- ||
+\*============================================================================*/
+
+#include "DX11PCH.hpp"
+#include "RenderQueue.hpp"
+#include <functional>
+
+/*============================================================================*\
+|| --------------------------- GLOBAL VARIABLES ----------------------------- ||
+\*============================================================================*/
+
+/*============================================================================*\
+|| -------------------------- STATIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+namespace
+{
+    /****************************************************************************/
+    /*!
+    \brief
+      Keep the low bits of a key field
+
+    \param value
+      The field
+
+    \param bits
+      How wide the field is in the key
+    */
+    /****************************************************************************/
+    static uint64_t Field(uint32_t value, uint32_t bits)
+    {
+        return uint64_t(value) & ((uint64_t(1) << bits) - 1);
+    }
+
+    /****************************************************************************/
+    /*!
+    \brief
+      Whether two draws bind and draw exactly the same thing, so they
+      only differ in their per-instance data
+
+    \param a
+      One draw
+
+    \param b
+      The other
+    */
+    /****************************************************************************/
+    static bool SameDraw(const DX11::DrawItem& a, const DX11::DrawItem& b)
+    {
+        return a.inputLayout == b.inputLayout
+            && a.vertexShader == b.vertexShader
+            && a.pixelShader == b.pixelShader
+            && a.vertexBuffer == b.vertexBuffer
+            && a.stride == b.stride
+            && a.indexBuffer == b.indexBuffer
+            && a.indexFormat == b.indexFormat
+            && a.indexOffset == b.indexOffset
+            && a.indexCount == b.indexCount
+            && a.firstIndex == b.firstIndex
+            && a.baseVertex == b.baseVertex
+            && a.constants.data == b.constants.data
+            && a.constants.firstConstant == b.constants.firstConstant
+            && a.constants.constantCount == b.constants.constantCount;
+    }
+}
+
+/*============================================================================*\
+|| -------------------------- PUBLIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Build a sort key. Fields wider than their bits are truncated, so ids
+  should be small and dense.
+
+\param layer
+  Coarsest order, e.g. world before UI
+
+\param pass
+  Order inside a layer, e.g. opaque before transparent
+
+\param shader
+  Shader program id
+
+\param material
+  Material id, picks the constants / textures
+
+\param mesh
+  Mesh id, picks the vertex and index buffers
+
+\param depth
+  View depth in [0, 1], front to back. Pass 1 - depth for back to front.
+
+\return
+  The key, lower sorts first
+*/
+/****************************************************************************/
+uint64_t DX11::RenderQueue::Key(uint32_t layer, uint32_t pass, uint32_t shader, uint32_t material, uint32_t mesh, float depth)
+{
+    depth = std::min(std::max(depth, 0.0f), 1.0f);
+    uint32_t quantized = uint32_t(depth * float((1 << DEPTH_BITS) - 1) + 0.5f);
+
+    uint64_t key = Field(layer, LAYER_BITS);
+    key = (key << PASS_BITS) | Field(pass, PASS_BITS);
+    key = (key << SHADER_BITS) | Field(shader, SHADER_BITS);
+    key = (key << MATERIAL_BITS) | Field(material, MATERIAL_BITS);
+    key = (key << MESH_BITS) | Field(mesh, MESH_BITS);
+    key = (key << DEPTH_BITS) | Field(quantized, DEPTH_BITS);
+    return key;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Queue a draw for this frame
+
+\param key
+  Sort key from Key()
+
+\param item
+  What to bind and draw, copied
+
+\param instance
+  Per-instance data, only read when item.instanced is set
+
+\return
+  The payload index of the draw
+*/
+/****************************************************************************/
+uint32_t DX11::RenderQueue::Submit(uint64_t key, const DX11::DrawItem& item, const DX11::InstanceData& instance)
+{
+    uint32_t payload = uint32_t(mItems.size());
+    mItems.push_back(item);
+    mInstances.push_back(instance);
+
+    Entry entry;
+    entry.key = key;
+    entry.payload = payload;
+    mEntries.push_back(entry);
+    return payload;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Sort the queue by key. LSD radix sort, 8 bits a pass, all histograms
+  built in one read. Passes where every key has the same byte are skipped,
+  so unused key fields cost nothing. Stable, equal keys keep submit order.
+*/
+/****************************************************************************/
+void DX11::RenderQueue::Sort()
+{
+    const size_t count = mEntries.size();
+    if (count < 2)
+    {
+        return;
+    }
+
+    uint32_t histograms[8][256] = {};
+    for (const Entry& entry : mEntries)
+    {
+        for (uint32_t pass = 0; pass < 8; ++pass)
+        {
+            ++histograms[pass][(entry.key >> (pass * 8)) & 0xff];
+        }
+    }
+
+    mScratch.resize(count);
+    Entry* source = mEntries.data();
+    Entry* destination = mScratch.data();
+
+    for (uint32_t pass = 0; pass < 8; ++pass)
+    {
+        uint32_t* histogram = histograms[pass];
+        const uint32_t shift = pass * 8;
+
+        // every key has the same byte here, this pass would not move anything
+        if (histogram[(source[0].key >> shift) & 0xff] == count)
+        {
+            continue;
+        }
+
+        uint32_t offset = 0;
+        for (uint32_t bucket = 0; bucket < 256; ++bucket)
+        {
+            uint32_t bucketCount = histogram[bucket];
+            histogram[bucket] = offset;
+            offset += bucketCount;
+        }
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            destination[histogram[(source[i].key >> shift) & 0xff]++] = source[i];
+        }
+
+        std::swap(source, destination);
+    }
+
+    if (source != mEntries.data())
+    {
+        mEntries.swap(mScratch);
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Play the queue back in its current order on the immediate context.
+  Input layout, shaders, vertex buffer, index buffer and constants are
+  only bound when they differ from the previous draw. Topology, raster and
+  output merger state are left to the caller.
+
+  The per-instance data of every instanced draw is written in sorted order
+  with one map, then each run of identical instanced draws is issued as a
+  single DrawIndexedInstanced. Sorting by mesh and material puts the same
+  draws next to each other.
+
+\param device
+  The ID3D11Device
+
+\param constants
+  The ring the draws' constant slices came from
+
+\param instances
+  Receives this frame's per-instance data
+*/
+/****************************************************************************/
+void DX11::RenderQueue::Execute(const DX11::Device& device, DX11::ConstantRing& constants, DX11::InstanceBuffer& instances) const
+{
+    DX11::CommandContext& context = device.Commands();
+
+    uint32_t firstInstance = 0;
+    if (WriteInstances(device, instances, 1, &firstInstance) != 0)
+    {
+        instances.Bind(context);
+    }
+    ExecuteRange(device, context, constants, 0, mEntries.size(), 0);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Play the queue back like Execute, but cut into contiguous slices that
+  are recorded on deferred contexts as the scheduler decides and executed
+  in order, so the result is the same as one Execute. Deferred contexts
+  start from the default state, setup binds the pass state on each one.
+
+  Falls back to the immediate context when the scheduler asks for one
+  slice or the constant ring cannot bind by offset, its copying fallback
+  has to map on the immediate context.
+
+\param device
+  The ID3D11Device
+
+\param constants
+  The ring the draws' constant slices came from
+
+\param instances
+  Receives this frame's per-instance data
+
+\param recorder
+  Owns the deferred contexts
+
+\param scheduler
+  Picks the slice count and runs the slices
+
+\param setup
+  Binds topology, raster and output merger state on a context, called
+  once per slice from the thread recording it
+*/
+/****************************************************************************/
+void DX11::RenderQueue::Execute(const DX11::Device& device, DX11::ConstantRing& constants, DX11::InstanceBuffer& instances,
+    DX11::DeferredRecorder& recorder, DX11::CommandScheduler& scheduler,
+    const std::function<void(DX11::CommandContext&)>& setup) const
+{
+    const size_t count = mEntries.size();
+    uint32_t sliceCount = constants.Offsetting() ? scheduler.Partition(count) : 1;
+    sliceCount = uint32_t(std::max<size_t>(1, std::min<size_t>(sliceCount, count)));
+
+    if (sliceCount == 1)
+    {
+        setup(device.Commands());
+        Execute(device, constants, instances);
+        return;
+    }
+
+    // where each slice's instances start, written before any slice records
+    mFirstInstances.resize(sliceCount);
+    const bool instanced = WriteInstances(device, instances, sliceCount, mFirstInstances.data()) != 0;
+
+    auto record = [&](DX11::CommandContext& context, uint32_t slice)
+    {
+        setup(context);
+        if (instanced)
+        {
+            instances.Bind(context);
+        }
+        ExecuteRange(device, context, constants, SliceBegin(slice, sliceCount), SliceBegin(slice + 1, sliceCount), mFirstInstances[slice]);
+    };
+
+    // by reference, a std::function holding the whole capture list would allocate every frame
+    recorder.Record(device, scheduler, sliceCount, std::cref(record));
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Empty the queue for the next frame, keeps the memory
+*/
+/****************************************************************************/
+void DX11::RenderQueue::Clear()
+{
+    mItems.clear();
+    mInstances.clear();
+    mEntries.clear();
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Number of draws queued
+*/
+/****************************************************************************/
+size_t DX11::RenderQueue::Size() const
+{
+    return mEntries.size();
+}
+
+/*============================================================================*\
+|| ------------------------- PRIVATE FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  First entry of a slice, slices split the queue as evenly as possible
+
+\param slice
+  Which slice, sliceCount gives the end of the queue
+
+\param sliceCount
+  Number of slices
+*/
+/****************************************************************************/
+size_t DX11::RenderQueue::SliceBegin(uint32_t slice, uint32_t sliceCount) const
+{
+    return mEntries.size() * slice / sliceCount;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Copy the per-instance data of every instanced draw into the instance
+  buffer in sorted order, with one map
+
+\param device
+  The ID3D11Device
+
+\param instances
+  Receives the data
+
+\param sliceCount
+  Number of slices the queue is recorded in
+
+\param firstInstances
+  Receives the first instance of each slice, sliceCount of them
+
+\return
+  Number of instances written, nothing is mapped for 0
+*/
+/****************************************************************************/
+uint32_t DX11::RenderQueue::WriteInstances(const DX11::Device& device, DX11::InstanceBuffer& instances, uint32_t sliceCount, uint32_t* firstInstances) const
+{
+    uint32_t instanceCount = 0;
+    uint32_t slice = 0;
+    const size_t count = mEntries.size();
+    for (size_t i = 0; i < count; ++i)
+    {
+        while (slice < sliceCount && SliceBegin(slice, sliceCount) == i)
+        {
+            firstInstances[slice++] = instanceCount;
+        }
+        instanceCount += mItems[mEntries[i].payload].instanced ? 1 : 0;
+    }
+    while (slice < sliceCount)
+    {
+        firstInstances[slice++] = instanceCount;
+    }
+
+    if (instanceCount == 0)
+    {
+        return 0;
+    }
+
+    DX11::InstanceData* data = instances.Begin(device, instanceCount);
+    for (const Entry& entry : mEntries)
+    {
+        if (mItems[entry.payload].instanced)
+        {
+            *data++ = mInstances[entry.payload];
+        }
+    }
+    instances.End(device);
+    return instanceCount;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Play a range of the queue back on one context, see Execute. The first
+  draw binds everything, the context's state is not assumed.
+
+\param device
+  The ID3D11Device
+
+\param context
+  Where to record, the immediate or a deferred context
+
+\param constants
+  The ring the draws' constant slices came from
+
+\param begin
+  First entry to draw
+
+\param end
+  One past the last entry
+
+\param firstInstance
+  Where the range's per-instance data starts in the instance buffer
+*/
+/****************************************************************************/
+void DX11::RenderQueue::ExecuteRange(const DX11::Device& device, DX11::CommandContext& context, DX11::ConstantRing& constants,
+    size_t begin, size_t end, uint32_t firstInstance) const
+{
+    // nothing is known to be bound yet, first draw binds everything
+    const DX11::DrawItem* last = nullptr;
+
+    for (size_t i = begin; i < end; )
+    {
+        const DX11::DrawItem& item = mItems[mEntries[i].payload];
+
+        if (!last || item.inputLayout != last->inputLayout)
+        {
+            context.SetInputLayout(item.inputLayout);
+        }
+        if (!last || item.vertexShader != last->vertexShader)
+        {
+            context.SetVertexShader(item.vertexShader);
+        }
+        if (!last || item.pixelShader != last->pixelShader)
+        {
+            context.SetPixelShader(item.pixelShader);
+        }
+        if (!last || item.vertexBuffer != last->vertexBuffer || item.stride != last->stride)
+        {
+            uint32_t offset = 0;
+            context.SetVertexBuffers(0, 1, &item.vertexBuffer, &item.stride, &offset);
+        }
+        if (!last || item.indexBuffer != last->indexBuffer || item.indexFormat != last->indexFormat || item.indexOffset != last->indexOffset)
+        {
+            context.SetIndexBuffer(item.indexBuffer, item.indexFormat, item.indexOffset);
+        }
+        if (item.constants.constantCount != 0 && (!last
+            || item.constants.firstConstant != last->constants.firstConstant
+            || item.constants.data != last->constants.data))
+        {
+            constants.BindVS(device, context, 0, item.constants);
+        }
+
+        if (item.instanced)
+        {
+            // take every following draw in the range that only differs in its instance data
+            size_t runEnd = i + 1;
+            while (runEnd < end)
+            {
+                const DX11::DrawItem& next = mItems[mEntries[runEnd].payload];
+                if (!next.instanced || !SameDraw(item, next))
+                {
+                    break;
+                }
+                ++runEnd;
+            }
+
+            uint32_t run = uint32_t(runEnd - i);
+            context.DrawIndexedInstanced(item.indexCount, run, item.firstIndex, item.baseVertex, firstInstance);
+            firstInstance += run;
+            i = runEnd;
+        }
+        else
+        {
+            context.DrawIndexed(item.indexCount, item.firstIndex, item.baseVertex);
+            ++i;
+        }
+
+        last = &item;
+    }
+}
@@ -45,6 +45,11 @@
 /****************************************************************************/
 DX11::RenderTargetView::RenderTargetView(DX11::Device device, DX11::Texture2D texture)
 {
+    if (device.Headless())
+    {
+        return;
+    }
+
     if (!SUCCEEDED(device->CreateRenderTargetView(texture.Get(), nullptr, GetAddressOf())))
     {
         throw std::runtime_error("DX11: CreateRenderTargetView() failed!\n");
@@ -62,5 +67,5 @@ DX11::RenderTargetView::RenderTargetView(DX11::Device device, DX11::Texture2D te
 /****************************************************************************/
 void DX11::RenderTargetView::Clear(DX11::Device device)
 {
-    device.Context()->ClearRenderTargetView(Get(), DirectX::Colors::DarkGray);
+    device.Commands().ClearRenderTargetView(Get(), DirectX::Colors::DarkGray);
 }
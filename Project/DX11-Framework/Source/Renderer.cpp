@@ -18,6 +18,7 @@
 #include "DX11PCH.hpp"
 #include "Renderer.hpp"
 #include "Factory.hpp"
+#include "WorkerPool.hpp"
 #include <array>
 #include <math.h>
 
@@ -64,7 +65,7 @@ namespace DX11 {
       The new height
     */
     /****************************************************************************/
-    static void FramebufferResizeCallback(WindowPtr window, int width, int height)
+    void FramebufferResizeCallback(WindowPtr window, int width, int height)
     {
         DX11::Renderer* renderer = reinterpret_cast<DX11::Renderer*>(glfwGetWindowUserPointer(window));
         renderer->mFramebufferResized = true;
@@ -81,11 +82,18 @@ namespace DX11 {
 /*!
 \brief
   Initialize the renderer
+
+\param headless
+  Skip the window and the GPU and record every frame instead
 */
 /****************************************************************************/
-DX11::Renderer::Renderer()
+DX11::Renderer::Renderer(bool headless) :
+    mHeadless(headless)
 {
-    InitGLFW();
+    if (!mHeadless)
+    {
+        InitGLFW();
+    }
     InitDX11();
 }
 
@@ -97,14 +105,17 @@ DX11::Renderer::Renderer()
 /****************************************************************************/
 DX11::Renderer::~Renderer()
 {
-    ShutdownGLFW();
+    if (!mHeadless)
+    {
+        ShutdownGLFW();
+    }
     ShutdownDX11();
 }
 
 /****************************************************************************/
 /*!
 \brief
-  Render
+  Render, prepare and submit one frame on the calling thread
 
 \param dt
   Delta-Time
@@ -112,43 +123,217 @@ DX11::Renderer::~Renderer()
 /****************************************************************************/
 void DX11::Renderer::Draw(float dt)
 {
-    /* init render pass */
-    DX11::DeviceContext context = mDevice.Context();
-    context->IASetPrimitiveTopology(mPrimitiveTopology);
-    context->IASetInputLayout(mShader.InputLayout().Get());
-    context->RSSetState(mRasterizerState.Get());
-    context->RSSetViewports(uint32_t(vViewport.size()), vViewport.data());
-    context->OMSetBlendState(mBlendState.Get(), mBlendFactors, mBlendSampleMask);
-    context->OMSetDepthStencilState(mDepthStencilState.Get(), 1);
-    context->ClearDepthStencilView(mDepthView.Get(), D3D11_CLEAR_DEPTH, 1.0f, 0);
+    ++mPacket.frame;
+    Prepare(dt, mPacket);
+    Submit(mPacket);
+}
 
-    std::array<ID3D11RenderTargetView*, 1> renderTargetViews = { mSwapChain.View().Get() };
-    context->OMSetRenderTargets(UINT(renderTargetViews.size()), renderTargetViews.data(), mDepthView.Get());
+/****************************************************************************/
+/*!
+\brief
+  Simulate and cull a frame and describe it in a packet. Touches nothing
+  Submit does, so it can run on the main thread for the next frame while
+  the render thread submits the previous one. Pumps the window's events,
+  so it has to run on the thread that created it.
+
+\param dt
+  Delta-Time
+
+\param packet
+  Receives the camera and the draws, replacing what it held
+*/
+/****************************************************************************/
+void DX11::Renderer::Prepare(float dt, DX11::FramePacket& packet)
+{
+    PumpEvents();
+    mMeshletCuller.ResetStats();
 
     /* update matricies */
 
-    // calculate
-    DirectX::XMMATRIX worldMatrix = DirectX::XMMatrixIdentity();
+    // spin the model, its submeshes hang off it once it has streamed in
     mAngle -= dt;
-    worldMatrix = DirectX::XMMatrixRotationAxis({0, 1, 0}, mAngle) * worldMatrix;
-    worldMatrix = DirectX::XMMatrixTranspose(worldMatrix);
+    DirectX::XMFLOAT4 rotation;
+    DirectX::XMStoreFloat4(&rotation, DirectX::XMQuaternionRotationAxis({0, 1, 0}, mAngle));
+    mScene.SetRotation(mModelNode, rotation);
+    if (mDisplayMesh->Ready() && mVisibilitySet.Size() == 0)
+    {
+        for (const DX11::Submesh& submesh : mDisplayMesh->Submeshes())
+        {
+            const uint32_t node = mScene.Create(mModelNode);
+            mScene.SetBounds(node, submesh.boundsMin, submesh.boundsMax, submesh.boundingRadius);
+            mNodeObjects.resize(node + 1, uint32_t(DX11::SceneGraph::INVALID_NODE));
+            mNodeObjects[node] = mVisibilitySet.Add(DirectX::XMFLOAT3(0, 0, 0), DirectX::XMFLOAT3(0, 0, 0), 0.0f);
+        }
+    }
+
+    // only what moved is recomputed, and only its bounds are culled against anew
+    mScene.Update();
+    for (uint32_t node : mScene.Changed())
+    {
+        if (node < mNodeObjects.size() && mNodeObjects[node] != DX11::SceneGraph::INVALID_NODE)
+        {
+            DirectX::XMFLOAT3 center;
+            DirectX::XMFLOAT3 extent;
+            float radius;
+            mScene.WorldBounds(node, center, extent, radius);
+            mVisibilitySet.Set(mNodeObjects[node], center, extent, radius);
+        }
+    }
+
+    const DirectX::XMMATRIX modelMatrix = mScene.World(mModelNode);
+
+    // the camera goes to the render thread as matrices, it owns the constant ring
+    packet.projection = mProjectionMatrix;
+    packet.view = mViewMatrix;
+    packet.draws.clear();
+
+    /* queue the test object, one draw per submesh the camera can see */
+    if (mDisplayMesh->Ready())
+    {
+        // the loader thread writes the quantization bounds, Ready is what makes them safe to read
+        DX11::InstanceData instance;
+        DirectX::XMStoreFloat4x4(&instance.world, mDisplayMesh->DequantizeMatrix() * modelMatrix);
+
+        DX11::DrawItem item;
+        mShader.FillItem(item);
+
+        // the set holds one object per submesh, in submesh order
+        const std::vector<DX11::Submesh>& submeshes = mDisplayMesh->Submeshes();
+        mVisibilitySet.Cull(DX11::Frustum::FromMatrix(mViewMatrix * mProjectionMatrix), mVisible);
+
+        // what the frustum kept occludes itself, drawn at its coarsest level shrunk to fit inside.
+        // a submesh can't hide behind its own occluder, so with fewer than two there is nothing to test
+        const std::vector<DX11::MeshOccluder>& occluders = mDisplayMesh->Occluders();
+        mOcclusionCuller.Begin(mViewMatrix * mProjectionMatrix);
+        size_t occluderIndices = 0;
+        if (mVisible.size() > 1)
+        {
+            for (uint32_t i : mVisible)
+            {
+                const DX11::MeshOccluder& occluder = occluders[i];
+                if (occluder.indices.empty())
+                {
+                    continue;
+                }
+                mOcclusionCuller.AddOccluder(occluder.positions.data(), uint32_t(occluder.positions.size()),
+                    occluder.indices.data(), uint32_t(occluder.indices.size()), modelMatrix);
+                occluderIndices += occluder.indices.size();
+            }
+        }
+        if (occluderIndices > 0)
+        {
+            mOcclusionCuller.Rasterize(DX11::WorkerPool::Global());
+            mVisible.erase(std::remove_if(mVisible.begin(), mVisible.end(), [&](uint32_t i)
+            {
+                return !mOcclusionCuller.Visible(submeshes[i].boundsMin, submeshes[i].boundsMax, modelMatrix);
+            }), mVisible.end());
+        }
+
+        // meshlets are culled in model space
+        const std::vector<DX11::Meshlet>& meshlets = mDisplayMesh->Meshlets();
+        const DX11::Frustum modelFrustum = DX11::Frustum::FromMatrix(modelMatrix * mViewMatrix * mProjectionMatrix);
+        DirectX::XMFLOAT3 modelCamera;
+        DirectX::XMStoreFloat3(&modelCamera, DirectX::XMVector3Transform(mCameraPosition, DirectX::XMMatrixInverse(nullptr, modelMatrix)));
+
+        // level of detail from the error each level would show on screen
+        mLods.resize(submeshes.size(), 0);
+        for (uint32_t i : mVisible)
+        {
+            const DX11::Submesh& submesh = submeshes[i];
+            DirectX::XMVECTOR center = DirectX::XMVectorScale(DirectX::XMVectorAdd(DirectX::XMLoadFloat3(&submesh.boundsMin), DirectX::XMLoadFloat3(&submesh.boundsMax)), 0.5f);
+            center = DirectX::XMVector3Transform(center, modelMatrix);
+            float distance = DirectX::XMVectorGetX(DirectX::XMVector3Length(DirectX::XMVectorSubtract(center, mCameraPosition))) - submesh.boundingRadius;
+            distance = std::max(distance, mNearPlane);
+
+            mLods[i] = mDisplayMesh->SelectLod(i, mLodScale / distance, mLods[i]);
+            mDisplayMesh->FillItem(i, item, mLods[i]);
+            const uint64_t key = DX11::RenderQueue::Key(0, 0, 0, submesh.materialId, 0, 0.0f);
+
+            // full detail draws only the meshlets that survive, coarser levels are too cheap to split
+            if (mLods[i] != 0 || submesh.meshletCount == 0)
+            {
+                packet.draws.push_back({ key, item, instance });
+                continue;
+            }
+
+            mMeshletCuller.Cull(meshlets.data() + submesh.firstMeshlet, submesh.meshletCount, modelFrustum, modelCamera, mRanges);
+            for (const DX11::IndexRange& range : mRanges)
+            {
+                item.firstIndex = range.firstIndex;
+                item.indexCount = range.indexCount;
+                packet.draws.push_back({ key, item, instance });
+            }
+        }
+    }
+}
 
-    // update buffer
-    std::array<DirectX::XMMATRIX, 3> bufferData = { worldMatrix, mProjectionMatrix, mViewMatrix };
-    size_t bufferSize = sizeof(bufferData[0]) * bufferData.size();
-    mMatrixBuffer.Update(mDevice, bufferData.data(), 0, uint32_t(bufferSize));
-    std::array<ID3D11Buffer*, 1> constantBuffers = { mMatrixBuffer.Get() };
-    context->VSSetConstantBuffers(0, uint32_t(constantBuffers.size()), constantBuffers.data());
+/****************************************************************************/
+/*!
+\brief
+  Submit a prepared frame and present it. Owns the device, the streaming
+  uploads and every per frame GPU ring, so only one thread may call it.
+
+\param packet
+  The frame from Prepare
+*/
+/****************************************************************************/
+void DX11::Renderer::Submit(const DX11::FramePacket& packet)
+{
+    if (mRecorder)
+    {
+        mRecorder->BeginFrame();
+    }
+    mDevice.StateCache().ResetStats();
+
+    /* finish streamed assets, a few a frame, copied in before anything draws */
+    mLoader.Upload(mDevice, mStagingPool, mUploadsPerFrame);
+    mStagingPool.Flush(mDevice);
+
+    /* init render pass, the pass state is bound by whichever context records the draws */
+    mDevice.Commands().ClearDepthStencilView(mDepthView.Get(), D3D11_CLEAR_DEPTH, 1.0f, 0);
+
+    // write this frame's camera with one map, the world matrix goes per instance
+    mConstantRing.Begin(mDevice);
+    DX11::ConstantRing::Slice camera = mConstantRing.Allocate(mDevice, uint32_t(sizeof(DirectX::XMMATRIX) * 2));
+    DirectX::XMMATRIX* bufferData = static_cast<DirectX::XMMATRIX*>(camera.data);
+    bufferData[0] = packet.projection;
+    bufferData[1] = packet.view;
+    mConstantRing.End(mDevice);
+
+    mRenderQueue.Clear();
+    for (const DX11::FrameDraw& draw : packet.draws)
+    {
+        DX11::DrawItem item = draw.item;
+        item.constants = camera;
+        mRenderQueue.Submit(draw.key, item, draw.instance);
+    }
 
-    /* draw the test object */
-    mShader.Bind(context);
-    mDisplayMesh.Draw(mDevice);
-    mShader.Unbind(context);
+    /* draw in key order, recorded across threads once there are enough draws */
+    mRenderQueue.Sort();
+    mRenderQueue.Execute(mDevice, mConstantRing, mInstanceBuffer, mDeferredRecorder, *mScheduler,
+        [this](DX11::CommandContext& context) { BindPassState(context); });
 
     /* present */
     Present();
-    glfwPollEvents();
-    context->ClearState();
+
+    if (mRecorder)
+    {
+        mRecorder->EndFrame();
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Handle the window's pending messages, on the thread that created it
+*/
+/****************************************************************************/
+void DX11::Renderer::PumpEvents()
+{
+    if (!mHeadless)
+    {
+        glfwPollEvents();
+    }
 }
 
 /****************************************************************************/
@@ -166,6 +351,53 @@ WindowPtr DX11::Renderer::Window() const
     return mWindow;
 }
 
+/****************************************************************************/
+/*!
+\brief
+  Get what the last frame asked of the backend
+
+\return
+  The recorded counts, all zero unless headless
+*/
+/****************************************************************************/
+DX11::CommandStats DX11::Renderer::FrameStats() const
+{
+    return mRecorder ? mRecorder->Stats() : DX11::CommandStats();
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get how many Set* calls the last frame made and how many were redundant
+*/
+/****************************************************************************/
+DX11::StateCacheStats DX11::Renderer::StateStats() const
+{
+    return mDevice.StateCache().Stats();
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get how many meshlets and triangles the last frame culled
+*/
+/****************************************************************************/
+DX11::MeshletStats DX11::Renderer::MeshletCullStats() const
+{
+    return mMeshletCuller.Stats();
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get how many submeshes the last frame tested for occlusion and dropped
+*/
+/****************************************************************************/
+DX11::OcclusionStats DX11::Renderer::OcclusionCullStats() const
+{
+    return mOcclusionCuller.Stats();
+}
+
 /*============================================================================*\
 || ------------------------- PRIVATE FUNCTIONS ------------------------------ ||
 \*============================================================================*/
@@ -208,7 +440,7 @@ void DX11::Renderer::InitGLFW()
 /****************************************************************************/
 void DX11::Renderer::InitWindow()
 {
-    glfwWindowHint(GLFW_RESIZABLE, GL_FALSE);
+    glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
     glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
     mWindow = glfwCreateWindow(mWindowWidth, mWindowHeight, "DX11-Framework", nullptr, nullptr);
     glfwSetWindowUserPointer(mWindow, this);
@@ -225,15 +457,23 @@ void DX11::Renderer::InitWindow()
 void DX11::Renderer::InitDX11()
 {
     // init core DX11
-    DX11::Factory factory;
-    DX11::Adaptor adaptor(factory);
+    if (mHeadless)
+    {
+        mRecorder = std::make_shared<DX11::RecordingCommandContext>();
+        mDevice = DX11::Device(mRecorder);
+    }
+    else
+    {
+        DX11::Factory factory;
+        DX11::Adaptor adaptor(factory);
 
-    mDevice = DX11::Device(adaptor);
-    mSwapChain = DX11::SwapChain(factory, mDevice, mWindow, mWindowWidth, mWindowHeight);
+        mDevice = DX11::Device(adaptor);
+        mSwapChain = DX11::SwapChain(factory, mDevice, mWindow, mWindowWidth, mWindowHeight);
 
-    if (!SUCCEEDED(factory->MakeWindowAssociation(glfwGetWin32Window(mWindow), DXGI_MWA_NO_ALT_ENTER)))
-    {
-        throw std::runtime_error("DX11: MakeWindowAssociation() failed from InitDX11!\n");
+        if (!SUCCEEDED(factory->MakeWindowAssociation(glfwGetWin32Window(mWindow), DXGI_MWA_NO_ALT_ENTER)))
+        {
+            throw std::runtime_error("DX11: MakeWindowAssociation() failed from InitDX11!\n");
+        }
     }
 
     InitPipelineDescription();
@@ -244,17 +484,27 @@ void DX11::Renderer::InitDX11()
     // view port
     vViewport = { { 0.0f, 0.0f, float(mWindowWidth), float(mWindowHeight), 0.0f, 1.0f } };
 
-    // matrix buffer
-    mMatrixBuffer = DX11::Buffer(mDevice, uint32_t(sizeof(DirectX::XMMATRIX) * 3), D3D11_USAGE_DYNAMIC);
+    // constant ring and instance stream
+    mConstantRing = DX11::ConstantRing(mDevice);
+    mInstanceBuffer = DX11::InstanceBuffer(mDevice);
+
+    // deferred recording on the shared pool
+    mScheduler = std::make_unique<DX11::WorkerPoolScheduler>(DX11::WorkerPool::Global());
+    mStagingPool = DX11::StagingPool();
 
     // display shader -- delete this
     DX11::ShaderInfo shaderInfo;
-    shaderInfo.vertex = "../Resource/Shaders/Simple.vs.cso";
+    shaderInfo.vertex = "../Resource/Shaders/Instanced.vs.cso";
     shaderInfo.pixel = "../Resource/Shaders/Simple.ps.cso";
+    shaderInfo.vertexFormat = DX11::VertexFormat::Quantized;
     mShader = DX11::Shader(mDevice, shaderInfo);
 
-    // display mesh -- delete this
-    mDisplayMesh = DX11::Mesh(mDevice, "../Resource/Models/StanfordBunny.obj");
+    // display mesh, streams in while we present -- delete this
+    mDisplayMesh = mLoader.LoadMesh("../Resource/Models/StanfordBunny.obj", shaderInfo.vertexFormat);
+    mScene.Clear();
+    mVisibilitySet.Clear();
+    mNodeObjects.clear();
+    mModelNode = mScene.Create();
 
     // camera -- delete this
     DirectX::XMVECTOR position = { 0, 0.1f, 1 };
@@ -269,6 +519,9 @@ void DX11::Renderer::InitDX11()
     mProjectionMatrix = DirectX::XMMatrixPerspectiveFovLH(fov, aspectRatio, nearPlane, farPlane);
     DirectX::XMVECTOR front = DirectX::XMVector3Normalize({ std::sin(yaw) * std::cos(pitch), std::sin(pitch),   -std::cos(yaw) * std::cos(pitch) });
     mViewMatrix = DirectX::XMMatrixLookAtLH(position, DirectX::XMVectorAdd(position, front), up);
+    mCameraPosition = position;
+    mNearPlane = nearPlane;
+    mLodScale = float(mWindowHeight) / (2.0f * std::tan(fov * 0.5f));
 
 }
 
@@ -286,13 +539,11 @@ void DX11::Renderer::InitPipelineDescription()
     rasterDesc.FillMode = D3D11_FILL_SOLID;
     rasterDesc.CullMode = D3D11_CULL_FRONT;
     rasterDesc.FrontCounterClockwise = true;
-    mRasterizerState = DX11::RasterizerState(mDevice, rasterDesc);
 
     D3D11_DEPTH_STENCIL_DESC depthStencilDesc = {};
     depthStencilDesc.DepthEnable = true;
     depthStencilDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ALL;
     depthStencilDesc.DepthFunc = D3D11_COMPARISON_LESS;
-    mDepthStencilState = DX11::DepthStencilState(mDevice, depthStencilDesc);
 
     D3D11_RENDER_TARGET_BLEND_DESC renderTargetBlendDesc = {};
     renderTargetBlendDesc.BlendEnable = false;
@@ -308,7 +559,13 @@ void DX11::Renderer::InitPipelineDescription()
     blendDesc.AlphaToCoverageEnable = false;
     blendDesc.IndependentBlendEnable = false;
     blendDesc.RenderTarget[0] = renderTargetBlendDesc;
-    mBlendState = DX11::BlendState(mDevice, blendDesc);
+
+    // everything the renderer knows it will use, created before the first frame
+    mPipelineStates.Prewarm(mDevice, { rasterDesc }, { depthStencilDesc }, { blendDesc });
+
+    mRasterizerState = mPipelineStates.Rasterizer(mDevice, rasterDesc);
+    mDepthStencilState = mPipelineStates.DepthStencil(mDevice, depthStencilDesc);
+    mBlendState = mPipelineStates.Blend(mDevice, blendDesc);
 }
 
 /****************************************************************************/
@@ -362,17 +619,22 @@ void DX11::Renderer::ShutdownWindow()
 /****************************************************************************/
 void DX11::Renderer::ShutdownDX11()
 {
+    DX11::PipelineStateCacheStats pipelineStats = mPipelineStates.Stats();
+    DEBUG::log.Info("PipelineStateCache:", pipelineStats.states, "states,", pipelineStats.hits, "hits,",
+        pipelineStats.misses, "misses,", pipelineStats.prewarmed, "prewarmed");
+    DEBUG::log.Info("StagingPool:", mStagingPool.Allocated(), "bytes of staging blocks");
+    mPipelineStates.Clear();
+    mDeferredRecorder.Clear();
+
     mSwapChain.View().Reset();
     mSwapChain.Buffer().Reset();
     mSwapChain.Reset();
 
-    DX11::DeviceContext context = mDevice.Context();
-    if (context != nullptr)
+    if (mDevice.Context() != nullptr || mDevice.Headless())
     {
-        context->ClearState();
-        context->Flush();
+        mDevice.Commands().ClearState();
+        mDevice.Commands().Flush();
     }
-    context.Reset();
 
 #ifdef USE_DEBUG_DEVICE
     DX11::DebugDevice debug = mDevice.Debug();
@@ -385,6 +647,28 @@ void DX11::Renderer::ShutdownDX11()
 #endif
 }
 
+/****************************************************************************/
+/*!
+\brief
+  Bind the main pass's topology, raster and output merger state. Called
+  for every context that records draws, from the thread recording it.
+
+\param context
+  The immediate or a deferred context
+*/
+/****************************************************************************/
+void DX11::Renderer::BindPassState(DX11::CommandContext& context) const
+{
+    context.SetPrimitiveTopology(mPrimitiveTopology);
+    context.SetRasterizerState(mRasterizerState.Get());
+    context.SetViewports(uint32_t(vViewport.size()), vViewport.data());
+    context.SetBlendState(mBlendState.Get(), mBlendFactors, mBlendSampleMask);
+    context.SetDepthStencilState(mDepthStencilState.Get(), 1);
+
+    std::array<ID3D11RenderTargetView*, 1> renderTargetViews = { mSwapChain.View().Get() };
+    context.SetRenderTargets(UINT(renderTargetViews.size()), renderTargetViews.data(), mDepthView.Get());
+}
+
 /****************************************************************************/
 /*!
 \brief
@@ -394,9 +678,15 @@ void DX11::Renderer::ShutdownDX11()
 void DX11::Renderer::Present()
 {
     ID3D11RenderTargetView* renderTargetViews[] = { mSwapChain.View().Get() };
-    DX11::DeviceContext context = mDevice.Context();
-    context->OMSetRenderTargets(1, renderTargetViews, nullptr);
-    mSwapChain->Present(mVSync, 0);
+    DX11::CommandContext& context = mDevice.Commands();
+    context.SetRenderTargets(1, renderTargetViews, nullptr);
+    if (!mHeadless)
+    {
+        mSwapChain->Present(mVSync, 0);
+        mDevice.StateCache().InvalidateRenderTargets();
+    }
+    mConstantRing.EndFrame(mDevice);
+    mStagingPool.EndFrame(mDevice);
     const DirectX::XMVECTORF32 actuallyDarkGray = { { { 0.1f, 0.1f, 0.1f, 1.000000000f } } };
-    context->ClearRenderTargetView(renderTargetViews[0], actuallyDarkGray);
+    context.ClearRenderTargetView(renderTargetViews[0], actuallyDarkGray);
 }
\ No newline at end of file
@@ -0,0 +1,176 @@
+/****************************************************************************/
+/*!
+\file
+   RingAllocator.cpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Offset bookkeeping for a ring of GPU visible memory. Hands out aligned
+    ranges and frees them a whole frame at a time once that frame's fence
+    has passed. Knows nothing about D3D so it can be exercised headless.
+*/
+/****************************************************************************/
+
+/*============================================================================*\
+|| ------------------------------ INCLUDES ---------------------------------- ||
+\*============================================================================*/
+
+#include "DX11PCH.hpp"
+#include "RingAllocator.hpp"
+
+/*============================================================================*\
+|| --------------------------- GLOBAL VARIABLES ----------------------------- ||
+\*============================================================================*/
+
+/*============================================================================*\
+|| -------------------------- STATIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/*============================================================================*\
+|| -------------------------- PUBLIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Constructor
+
+\param capacity
+  Size of the ring, a multiple of alignment
+
+\param alignment
+  Power of two every allocation is aligned and padded to
+*/
+/****************************************************************************/
+DX11::RingAllocator::RingAllocator(size_t capacity, size_t alignment) :
+    mCapacity(capacity),
+    mAlignment(alignment)
+{
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0 || capacity % alignment != 0)
+    {
+        throw std::runtime_error("DX11: invalid capacity / alignment from RingAllocator!\n");
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Take a range from the ring. Ranges never straddle the end, if it does
+  not fit before the end the rest of the lap is skipped.
+
+\param size
+  Bytes wanted, rounded up to the alignment
+
+\param offset
+  Receives the byte offset of the range
+
+\return
+  False if the ring is full until an older frame is retired
+*/
+/****************************************************************************/
+bool DX11::RingAllocator::Allocate(size_t size, size_t& offset)
+{
+    size = (size + mAlignment - 1) & ~(mAlignment - 1);
+    if (size == 0 || size > mCapacity)
+    {
+        return false;
+    }
+
+    size_t start = mHead;
+    size_t position = start % mCapacity;
+    if (position + size > mCapacity)
+    {
+        start += mCapacity - position;
+        position = 0;
+    }
+
+    if (start + size - mTail > mCapacity)
+    {
+        return false;
+    }
+
+    mHead = start + size;
+    offset = position;
+    return true;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Mark everything allocated so far as belonging to the frame just
+  submitted. Call when that frame's fence is issued.
+
+\return
+  False if MAX_FRAMES frames are already waiting, retire one first
+*/
+/****************************************************************************/
+bool DX11::RingAllocator::EndFrame()
+{
+    if (mFrameCount == MAX_FRAMES)
+    {
+        return false;
+    }
+
+    mFrameEnds[(mFirstFrame + mFrameCount) % MAX_FRAMES] = mHead;
+    ++mFrameCount;
+    return true;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Free the oldest frame's ranges. Call once its fence has passed.
+
+\return
+  False if no frame is waiting
+*/
+/****************************************************************************/
+bool DX11::RingAllocator::RetireFrame()
+{
+    if (mFrameCount == 0)
+    {
+        return false;
+    }
+
+    mTail = mFrameEnds[mFirstFrame];
+    mFirstFrame = (mFirstFrame + 1) % MAX_FRAMES;
+    --mFrameCount;
+    return true;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Bytes the GPU may still be reading or that belong to the current frame,
+  including padding skipped at the end of a lap
+*/
+/****************************************************************************/
+size_t DX11::RingAllocator::Used() const
+{
+    return mHead - mTail;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Size of the ring
+*/
+/****************************************************************************/
+size_t DX11::RingAllocator::Capacity() const
+{
+    return mCapacity;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Number of frames waiting to be retired
+*/
+/****************************************************************************/
+uint32_t DX11::RingAllocator::PendingFrames() const
+{
+    return mFrameCount;
+}
@@ -0,0 +1,806 @@
+/****************************************************************************/
+/*!
+\file
+   SceneGraph.cpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Transform hierarchy stored as structure of arrays. Nodes are kept in
+    breadth first order so each depth is one contiguous run with every
+    parent ahead of its children. Changing a node's local transform marks
+    it dirty and Update recomputes only the dirty nodes and everything
+    below them, one depth at a time and 4 nodes per SSE iteration, along
+    with their world space bounds.
+*/
+/****************************************************************************/
+
+/*============================================================================*\
+|| ------------------------------ INCLUDES ---------------------------------- ||
+\*============================================================================*/
+
+#include "DX11PCH.hpp"
+#include "SceneGraph.hpp"
+#include "WorkerPool.hpp"
+#include <cstring>
+#include <immintrin.h>
+#include <numeric>
+
+/*============================================================================*\
+|| --------------------------- GLOBAL VARIABLES ----------------------------- ||
+\*============================================================================*/
+
+/*============================================================================*\
+|| -------------------------- STATIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+namespace
+{
+    /****************************************************************************/
+    /*!
+    \brief
+      Reorder an array so entry k becomes the old entry order[k]
+
+    \param values
+      The array, reordered in place
+
+    \param order
+      Old index of every new entry
+
+    \param scratch
+      Reused between arrays, left holding the old order
+    */
+    /****************************************************************************/
+    template <typename T>
+    static void Permute(std::vector<T>& values, const std::vector<uint32_t>& order, std::vector<T>& scratch)
+    {
+        scratch.resize(order.size());
+        for (size_t k = 0; k < order.size(); ++k)
+        {
+            scratch[k] = values[order[k]];
+        }
+        values.swap(scratch);
+    }
+
+    /****************************************************************************/
+    /*!
+    \brief
+      Absolute value of 4 floats
+    */
+    /****************************************************************************/
+    static __m128 Abs(__m128 value)
+    {
+        return _mm_andnot_ps(_mm_set1_ps(-0.0f), value);
+    }
+}
+
+/*============================================================================*\
+|| -------------------------- PUBLIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Constructor, starts empty
+*/
+/****************************************************************************/
+DX11::SceneGraph::SceneGraph()
+{
+    Clear();
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Add a node with an identity local transform and no bounds. It is placed
+  in depth order and gets its world transform on the next Update.
+
+\param parent
+  Node to hang it from, INVALID_NODE for a top level node
+
+\return
+  Handle of the node, stays valid until Clear
+*/
+/****************************************************************************/
+uint32_t DX11::SceneGraph::Create(uint32_t parent)
+{
+    if (parent != INVALID_NODE && parent >= mSlot.size())
+    {
+        throw std::runtime_error("SceneGraph: Create() given a parent that does not exist!\n");
+    }
+
+    const uint32_t node = uint32_t(mSlot.size());
+    const uint32_t slot = uint32_t(mParent.size());
+    mSlot.push_back(slot);
+    mNode.push_back(node);
+    mParent.push_back(parent == INVALID_NODE ? 0 : mSlot[parent]);
+    mDirty.push_back(0);
+
+    for (std::vector<float>& values : mLocal)
+    {
+        values.push_back(0.0f);
+    }
+    mLocal[RotationW].back() = 1.0f;
+    mLocal[ScaleX].back() = 1.0f;
+    mLocal[ScaleY].back() = 1.0f;
+    mLocal[ScaleZ].back() = 1.0f;
+    for (std::vector<float>& values : mWorld)
+    {
+        values.push_back(0.0f);
+    }
+
+    MarkDirty(slot);
+    mSorted = false;
+    return node;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Reserve space for a number of nodes
+
+\param count
+  Number of nodes
+*/
+/****************************************************************************/
+void DX11::SceneGraph::Reserve(size_t count)
+{
+    for (std::vector<float>& values : mLocal)
+    {
+        values.reserve(count + 1);
+    }
+    for (std::vector<float>& values : mWorld)
+    {
+        values.reserve(count + 1);
+    }
+    mParent.reserve(count + 1);
+    mNode.reserve(count + 1);
+    mDirty.reserve(count + 1);
+    mSlot.reserve(count);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Remove every node, only the hidden root is left
+*/
+/****************************************************************************/
+void DX11::SceneGraph::Clear()
+{
+    for (std::vector<float>& values : mLocal)
+    {
+        values.assign(1, 0.0f);
+    }
+    for (std::vector<float>& values : mWorld)
+    {
+        values.assign(1, 0.0f);
+    }
+    mWorld[0][0] = 1.0f;
+    mWorld[4][0] = 1.0f;
+    mWorld[8][0] = 1.0f;
+
+    mParent.assign(1, 0);
+    mNode.assign(1, uint32_t(INVALID_NODE));
+    mDirty.assign(1, 0);
+    mSlot.clear();
+    mLevels.assign({ 0, 1 });
+    mChanged.clear();
+    mSorted = true;
+    mAnyDirty = false;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the number of nodes
+*/
+/****************************************************************************/
+size_t DX11::SceneGraph::Size() const
+{
+    return mSlot.size();
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the number of depths as of the last Update, 1 when every node is top
+  level
+*/
+/****************************************************************************/
+uint32_t DX11::SceneGraph::Depth() const
+{
+    return uint32_t(mLevels.size() - 2);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the parent of a node
+
+\param node
+  The node
+
+\return
+  The parent, INVALID_NODE for a top level node
+*/
+/****************************************************************************/
+uint32_t DX11::SceneGraph::Parent(uint32_t node) const
+{
+    return mNode[mParent[mSlot[node]]];
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Move a node relative to its parent
+
+\param node
+  The node
+
+\param translation
+  Offset in the parent's space
+*/
+/****************************************************************************/
+void DX11::SceneGraph::SetTranslation(uint32_t node, const DirectX::XMFLOAT3& translation)
+{
+    const uint32_t slot = mSlot[node];
+    mLocal[TranslationX][slot] = translation.x;
+    mLocal[TranslationY][slot] = translation.y;
+    mLocal[TranslationZ][slot] = translation.z;
+    MarkDirty(slot);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Rotate a node relative to its parent
+
+\param node
+  The node
+
+\param rotation
+  Unit quaternion, as XMQuaternionRotationAxis and friends make them
+*/
+/****************************************************************************/
+void DX11::SceneGraph::SetRotation(uint32_t node, const DirectX::XMFLOAT4& rotation)
+{
+    const uint32_t slot = mSlot[node];
+    mLocal[RotationX][slot] = rotation.x;
+    mLocal[RotationY][slot] = rotation.y;
+    mLocal[RotationZ][slot] = rotation.z;
+    mLocal[RotationW][slot] = rotation.w;
+    MarkDirty(slot);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Scale a node relative to its parent
+
+\param node
+  The node
+
+\param scale
+  Scale on each local axis, applied before the rotation
+*/
+/****************************************************************************/
+void DX11::SceneGraph::SetScale(uint32_t node, const DirectX::XMFLOAT3& scale)
+{
+    const uint32_t slot = mSlot[node];
+    mLocal[ScaleX][slot] = scale.x;
+    mLocal[ScaleY][slot] = scale.y;
+    mLocal[ScaleZ][slot] = scale.z;
+    MarkDirty(slot);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Give a node bounds, Update keeps a world space copy of them
+
+\param node
+  The node
+
+\param boundsMin
+  Box minimum in the node's space
+
+\param boundsMax
+  Box maximum in the node's space
+
+\param radius
+  Sphere radius around the box center
+*/
+/****************************************************************************/
+void DX11::SceneGraph::SetBounds(uint32_t node, const DirectX::XMFLOAT3& boundsMin, const DirectX::XMFLOAT3& boundsMax, float radius)
+{
+    const uint32_t slot = mSlot[node];
+    mLocal[CenterX][slot] = (boundsMin.x + boundsMax.x) * 0.5f;
+    mLocal[CenterY][slot] = (boundsMin.y + boundsMax.y) * 0.5f;
+    mLocal[CenterZ][slot] = (boundsMin.z + boundsMax.z) * 0.5f;
+    mLocal[ExtentX][slot] = (boundsMax.x - boundsMin.x) * 0.5f;
+    mLocal[ExtentY][slot] = (boundsMax.y - boundsMin.y) * 0.5f;
+    mLocal[ExtentZ][slot] = (boundsMax.z - boundsMin.z) * 0.5f;
+    mLocal[Radius][slot] = radius;
+    MarkDirty(slot);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Update the world transforms on the global worker pool
+
+\return
+  Number of nodes whose world transform was recomputed
+*/
+/****************************************************************************/
+size_t DX11::SceneGraph::Update()
+{
+    return Update(DX11::WorkerPool::Global());
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Recompute the world transform and bounds of every dirty node and every
+  node below one. Nodes created since the last Update are sorted into
+  place first. The dirt is pushed down in one pass, parents come first,
+  then each depth with anything dirty is updated in groups of 4, depths
+  of more than one chunk split across the pool.
+
+\param pool
+  Threads to update on
+
+\return
+  Number of nodes whose world transform was recomputed
+*/
+/****************************************************************************/
+size_t DX11::SceneGraph::Update(DX11::WorkerPool& pool)
+{
+    if (!mSorted)
+    {
+        Sort();
+    }
+
+    mChanged.clear();
+    if (!mAnyDirty)
+    {
+        return 0;
+    }
+
+    const size_t levels = mLevels.size() - 1;
+    mLevelDirty.assign(levels, 0);
+    for (size_t level = 1; level < levels; ++level)
+    {
+        for (uint32_t slot = mLevels[level]; slot < mLevels[level + 1]; ++slot)
+        {
+            mDirty[slot] |= mDirty[mParent[slot]];
+            if (mDirty[slot])
+            {
+                mChanged.push_back(mNode[slot]);
+                ++mLevelDirty[level];
+            }
+        }
+    }
+
+    // a depth only reads the one above it, so its nodes are independent
+    for (size_t level = 1; level < levels; ++level)
+    {
+        if (mLevelDirty[level] == 0)
+        {
+            continue;
+        }
+
+        const size_t begin = mLevels[level];
+        const size_t end = mLevels[level + 1];
+        if (end - begin <= CHUNK_SIZE || pool.ThreadCount() <= 1)
+        {
+            UpdateRange(begin, end);
+            continue;
+        }
+
+        const size_t chunks = (end - begin + CHUNK_SIZE - 1) / CHUNK_SIZE;
+        pool.ParallelFor(chunks, [&](size_t chunk)
+        {
+            const size_t first = begin + chunk * CHUNK_SIZE;
+            UpdateRange(first, std::min(first + CHUNK_SIZE, end));
+        });
+    }
+
+    std::fill(mDirty.begin(), mDirty.end(), uint8_t(0));
+    mAnyDirty = false;
+    return mChanged.size();
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the nodes the last Update recomputed, parents before their children
+
+\return
+  Node handles, for refreshing whatever copies their bounds
+*/
+/****************************************************************************/
+const std::vector<uint32_t>& DX11::SceneGraph::Changed() const
+{
+    return mChanged;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get a node's world transform as of the last Update
+
+\param node
+  The node
+
+\return
+  Local to world matrix
+*/
+/****************************************************************************/
+DirectX::XMMATRIX DX11::SceneGraph::World(uint32_t node) const
+{
+    const uint32_t slot = mSlot[node];
+    const DirectX::XMFLOAT4X4 m(
+        mWorld[0][slot], mWorld[1][slot], mWorld[2][slot], 0.0f,
+        mWorld[3][slot], mWorld[4][slot], mWorld[5][slot], 0.0f,
+        mWorld[6][slot], mWorld[7][slot], mWorld[8][slot], 0.0f,
+        mWorld[9][slot], mWorld[10][slot], mWorld[11][slot], 1.0f);
+    return DirectX::XMLoadFloat4x4(&m);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get a node's world bounds as of the last Update, the box around its
+  transformed box (Arvo) and its sphere scaled by the largest axis scale
+
+\param node
+  The node
+
+\param center
+  Receives the center of the box and the sphere
+
+\param extent
+  Receives the half size of the box on each axis
+
+\param radius
+  Receives the radius of the sphere
+*/
+/****************************************************************************/
+void DX11::SceneGraph::WorldBounds(uint32_t node, DirectX::XMFLOAT3& center, DirectX::XMFLOAT3& extent, float& radius) const
+{
+    const uint32_t slot = mSlot[node];
+    center = DirectX::XMFLOAT3(mWorld[WorldCenterX][slot], mWorld[WorldCenterY][slot], mWorld[WorldCenterZ][slot]);
+    extent = DirectX::XMFLOAT3(mWorld[WorldExtentX][slot], mWorld[WorldExtentY][slot], mWorld[WorldExtentZ][slot]);
+    radius = mWorld[WorldRadius][slot];
+}
+
+/*============================================================================*\
+|| ------------------------- PRIVATE FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Flag a slot for the next Update
+
+\param slot
+  The slot
+*/
+/****************************************************************************/
+void DX11::SceneGraph::MarkDirty(uint32_t slot)
+{
+    mDirty[slot] = 1;
+    mAnyDirty = true;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Put the slots in breadth first order from the hidden root. Each depth
+  becomes one run, children of one parent sit next to each other and in
+  the order they were created, so a dirty subtree stays a few short runs
+  per depth.
+*/
+/****************************************************************************/
+void DX11::SceneGraph::Sort()
+{
+    const size_t count = mParent.size();
+
+    // children of every slot, in slot order
+    std::vector<uint32_t> offsets(count + 1, 0);
+    for (size_t slot = 1; slot < count; ++slot)
+    {
+        ++offsets[mParent[slot] + 1];
+    }
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+    std::vector<uint32_t> children(count);
+    std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+    for (size_t slot = 1; slot < count; ++slot)
+    {
+        children[cursor[mParent[slot]]++] = uint32_t(slot);
+    }
+
+    // a depth ends with the last child of the depth above it
+    std::vector<uint32_t> order;
+    order.reserve(count);
+    order.push_back(0);
+    mLevels.assign(1, 0);
+    size_t levelEnd = 1;
+    for (size_t head = 0; head < order.size(); ++head)
+    {
+        if (head == levelEnd)
+        {
+            mLevels.push_back(uint32_t(head));
+            levelEnd = order.size();
+        }
+        for (uint32_t o = offsets[order[head]]; o < offsets[order[head] + 1]; ++o)
+        {
+            order.push_back(children[o]);
+        }
+    }
+    mLevels.push_back(uint32_t(count));
+
+    // move every array into the new order
+    std::vector<uint32_t> newSlot(count);
+    for (size_t k = 0; k < count; ++k)
+    {
+        newSlot[order[k]] = uint32_t(k);
+    }
+
+    std::vector<float> floats;
+    for (std::vector<float>& values : mLocal)
+    {
+        Permute(values, order, floats);
+    }
+    for (std::vector<float>& values : mWorld)
+    {
+        Permute(values, order, floats);
+    }
+    std::vector<uint8_t> bytes;
+    Permute(mDirty, order, bytes);
+    std::vector<uint32_t> words;
+    Permute(mNode, order, words);
+    Permute(mParent, order, words);
+    for (size_t k = 0; k < count; ++k)
+    {
+        mParent[k] = newSlot[mParent[k]];
+    }
+    for (size_t k = 1; k < count; ++k)
+    {
+        mSlot[mNode[k]] = uint32_t(k);
+    }
+
+    mSorted = true;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Update the dirty slots of a run within one depth. Groups of 4 with more
+  than one dirty slot are recomputed whole, the clean ones come out bit
+  for bit the same since their inputs did not change and UpdateSlot does
+  the same math in the same order.
+
+\param begin
+  First slot
+
+\param end
+  One past the last slot
+*/
+/****************************************************************************/
+void DX11::SceneGraph::UpdateRange(size_t begin, size_t end)
+{
+    size_t slot = begin;
+    for (; slot + 4 <= end; slot += 4)
+    {
+        uint32_t dirty;
+        std::memcpy(&dirty, mDirty.data() + slot, sizeof(dirty));
+        if (dirty == 0)
+        {
+            continue;
+        }
+
+        // a lone dirty slot is cheaper on its own than with 3 clean ones
+        if ((dirty & (dirty - 1)) == 0)
+        {
+            for (size_t k = slot; k < slot + 4; ++k)
+            {
+                if (mDirty[k])
+                {
+                    UpdateSlot(k);
+                }
+            }
+            continue;
+        }
+        UpdateGroup(slot);
+    }
+    for (; slot < end; ++slot)
+    {
+        if (mDirty[slot])
+        {
+            UpdateSlot(slot);
+        }
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Recompute 4 neighbouring slots with SSE. Local matrix is scale, then
+  rotation, then translation, multiplied into the parent's world matrix
+  as 3x3 plus a translation row.
+
+\param slot
+  First of the 4 slots
+*/
+/****************************************************************************/
+void DX11::SceneGraph::UpdateGroup(size_t slot)
+{
+    auto local = [&](Local field) { return _mm_loadu_ps(mLocal[field].data() + slot); };
+
+    // rotation matrix from the quaternions, as XMMatrixRotationQuaternion lays it out
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 qx = local(RotationX);
+    const __m128 qy = local(RotationY);
+    const __m128 qz = local(RotationZ);
+    const __m128 qw = local(RotationW);
+    const __m128 x2 = _mm_add_ps(qx, qx);
+    const __m128 y2 = _mm_add_ps(qy, qy);
+    const __m128 z2 = _mm_add_ps(qz, qz);
+    const __m128 xx = _mm_mul_ps(qx, x2);
+    const __m128 yy = _mm_mul_ps(qy, y2);
+    const __m128 zz = _mm_mul_ps(qz, z2);
+    const __m128 xy = _mm_mul_ps(qx, y2);
+    const __m128 xz = _mm_mul_ps(qx, z2);
+    const __m128 yz = _mm_mul_ps(qy, z2);
+    const __m128 wx = _mm_mul_ps(qw, x2);
+    const __m128 wy = _mm_mul_ps(qw, y2);
+    const __m128 wz = _mm_mul_ps(qw, z2);
+
+    const __m128 sx = local(ScaleX);
+    const __m128 sy = local(ScaleY);
+    const __m128 sz = local(ScaleZ);
+    const __m128 l[4][3] =
+    {
+        { _mm_mul_ps(sx, _mm_sub_ps(one, _mm_add_ps(yy, zz))), _mm_mul_ps(sx, _mm_add_ps(xy, wz)), _mm_mul_ps(sx, _mm_sub_ps(xz, wy)) },
+        { _mm_mul_ps(sy, _mm_sub_ps(xy, wz)), _mm_mul_ps(sy, _mm_sub_ps(one, _mm_add_ps(xx, zz))), _mm_mul_ps(sy, _mm_add_ps(yz, wx)) },
+        { _mm_mul_ps(sz, _mm_add_ps(xz, wy)), _mm_mul_ps(sz, _mm_sub_ps(yz, wx)), _mm_mul_ps(sz, _mm_sub_ps(one, _mm_add_ps(xx, yy))) },
+        { local(TranslationX), local(TranslationY), local(TranslationZ) }
+    };
+
+    // parents are anywhere in the depth above, gather them
+    const uint32_t* parent = mParent.data() + slot;
+    __m128 p[MATRIX_COUNT];
+    for (uint32_t k = 0; k < MATRIX_COUNT; ++k)
+    {
+        const float* world = mWorld[k].data();
+        p[k] = _mm_set_ps(world[parent[3]], world[parent[2]], world[parent[1]], world[parent[0]]);
+    }
+
+    __m128 w[MATRIX_COUNT];
+    for (uint32_t row = 0; row < 4; ++row)
+    {
+        for (uint32_t column = 0; column < 3; ++column)
+        {
+            __m128 value = _mm_add_ps(_mm_mul_ps(l[row][0], p[column]), _mm_mul_ps(l[row][1], p[3 + column]));
+            value = _mm_add_ps(value, _mm_mul_ps(l[row][2], p[6 + column]));
+            w[row * 3 + column] = row == 3 ? _mm_add_ps(value, p[9 + column]) : value;
+        }
+    }
+    for (uint32_t k = 0; k < MATRIX_COUNT; ++k)
+    {
+        _mm_storeu_ps(mWorld[k].data() + slot, w[k]);
+    }
+
+    // bounds, the box around the transformed box and the sphere by the largest scale
+    const __m128 cx = local(CenterX);
+    const __m128 cy = local(CenterY);
+    const __m128 cz = local(CenterZ);
+    const __m128 ex = local(ExtentX);
+    const __m128 ey = local(ExtentY);
+    const __m128 ez = local(ExtentZ);
+    for (uint32_t column = 0; column < 3; ++column)
+    {
+        __m128 center = _mm_add_ps(_mm_mul_ps(cx, w[column]), _mm_mul_ps(cy, w[3 + column]));
+        center = _mm_add_ps(_mm_add_ps(center, _mm_mul_ps(cz, w[6 + column])), w[9 + column]);
+        __m128 extent = _mm_add_ps(_mm_mul_ps(ex, Abs(w[column])), _mm_mul_ps(ey, Abs(w[3 + column])));
+        extent = _mm_add_ps(extent, _mm_mul_ps(ez, Abs(w[6 + column])));
+        _mm_storeu_ps(mWorld[WorldCenterX + column].data() + slot, center);
+        _mm_storeu_ps(mWorld[WorldExtentX + column].data() + slot, extent);
+    }
+
+    __m128 scale = _mm_setzero_ps();
+    for (uint32_t row = 0; row < 3; ++row)
+    {
+        __m128 length = _mm_add_ps(_mm_mul_ps(w[row * 3], w[row * 3]), _mm_mul_ps(w[row * 3 + 1], w[row * 3 + 1]));
+        length = _mm_add_ps(length, _mm_mul_ps(w[row * 3 + 2], w[row * 3 + 2]));
+        scale = _mm_max_ps(scale, length);
+    }
+    _mm_storeu_ps(mWorld[WorldRadius].data() + slot, _mm_mul_ps(local(Radius), _mm_sqrt_ps(scale)));
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Recompute one slot, the same math as UpdateGroup one lane at a time
+
+\param slot
+  The slot
+*/
+/****************************************************************************/
+void DX11::SceneGraph::UpdateSlot(size_t slot)
+{
+    auto local = [&](Local field) { return mLocal[field][slot]; };
+
+    const float qx = local(RotationX);
+    const float qy = local(RotationY);
+    const float qz = local(RotationZ);
+    const float qw = local(RotationW);
+    const float x2 = qx + qx;
+    const float y2 = qy + qy;
+    const float z2 = qz + qz;
+    const float xx = qx * x2;
+    const float yy = qy * y2;
+    const float zz = qz * z2;
+    const float xy = qx * y2;
+    const float xz = qx * z2;
+    const float yz = qy * z2;
+    const float wx = qw * x2;
+    const float wy = qw * y2;
+    const float wz = qw * z2;
+
+    const float sx = local(ScaleX);
+    const float sy = local(ScaleY);
+    const float sz = local(ScaleZ);
+    const float l[4][3] =
+    {
+        { sx * (1.0f - (yy + zz)), sx * (xy + wz), sx * (xz - wy) },
+        { sy * (xy - wz), sy * (1.0f - (xx + zz)), sy * (yz + wx) },
+        { sz * (xz + wy), sz * (yz - wx), sz * (1.0f - (xx + yy)) },
+        { local(TranslationX), local(TranslationY), local(TranslationZ) }
+    };
+
+    const uint32_t parent = mParent[slot];
+    float p[MATRIX_COUNT];
+    for (uint32_t k = 0; k < MATRIX_COUNT; ++k)
+    {
+        p[k] = mWorld[k][parent];
+    }
+
+    float w[MATRIX_COUNT];
+    for (uint32_t row = 0; row < 4; ++row)
+    {
+        for (uint32_t column = 0; column < 3; ++column)
+        {
+            float value = l[row][0] * p[column] + l[row][1] * p[3 + column];
+            value = value + l[row][2] * p[6 + column];
+            w[row * 3 + column] = row == 3 ? value + p[9 + column] : value;
+        }
+    }
+    for (uint32_t k = 0; k < MATRIX_COUNT; ++k)
+    {
+        mWorld[k][slot] = w[k];
+    }
+
+    for (uint32_t column = 0; column < 3; ++column)
+    {
+        float center = local(CenterX) * w[column] + local(CenterY) * w[3 + column];
+        center = (center + local(CenterZ) * w[6 + column]) + w[9 + column];
+        float extent = local(ExtentX) * std::fabs(w[column]) + local(ExtentY) * std::fabs(w[3 + column]);
+        extent = extent + local(ExtentZ) * std::fabs(w[6 + column]);
+        mWorld[WorldCenterX + column][slot] = center;
+        mWorld[WorldExtentX + column][slot] = extent;
+    }
+
+    float scale = 0.0f;
+    for (uint32_t row = 0; row < 3; ++row)
+    {
+        float length = w[row * 3] * w[row * 3] + w[row * 3 + 1] * w[row * 3 + 1];
+        length = length + w[row * 3 + 2] * w[row * 3 + 2];
+        scale = std::max(scale, length);
+    }
+    mWorld[WorldRadius][slot] = local(Radius) * std::sqrt(scale);
+}
@@ -50,6 +50,11 @@ DX11::Shader::Shader(DX11::Device device, DX11::ShaderInfo paths)
 		throw std::runtime_error("DX11: ShaderInfo Vertex or Pixel Shader invalid!\n");
 	}
 
+	if (device.Headless())
+	{
+		return;
+	}
+
 	ShaderStage vertexShader = CreateShaderStage(paths.vertex);
 	ShaderStage pixelShader = CreateShaderStage(paths.pixel);
 
@@ -58,7 +63,7 @@ DX11::Shader::Shader(DX11::Device device, DX11::ShaderInfo paths)
 		throw std::runtime_error("DX11: CreateVertexShader failed!");
 	}
 
-	pInputLayout = DX11::InputLayout(device, vertexShader);
+	pInputLayout = DX11::InputLayout(device, vertexShader, paths.vertexFormat);
 
 	if (!SUCCEEDED(device->CreatePixelShader(pixelShader->GetBufferPointer(), pixelShader->GetBufferSize(), nullptr, pPixelShader.ReleaseAndGetAddressOf())))
 	{
@@ -71,14 +76,14 @@ DX11::Shader::Shader(DX11::Device device, DX11::ShaderInfo paths)
 \brief
   Set the bound shader program to this
 
-\param device
-  The ID3D11DeviceContext
+\param context
+  The CommandContext to record into
 */
 /****************************************************************************/
-void DX11::Shader::Bind(DX11::DeviceContext context)
+void DX11::Shader::Bind(DX11::CommandContext& context)
 {
-	context->VSSetShader(pVertexShader.Get(), nullptr, 0);
-	context->PSSetShader(pPixelShader.Get(), nullptr, 0);
+	context.SetVertexShader(pVertexShader.Get());
+	context.SetPixelShader(pPixelShader.Get());
 }
 
 /****************************************************************************/
@@ -86,14 +91,32 @@ void DX11::Shader::Bind(DX11::DeviceContext context)
 \brief
   Set the bound shader program to null
 
-\param device
-  The ID3D11DeviceContext
+\param context
+  The CommandContext to record into
+*/
+/****************************************************************************/
+void DX11::Shader::Unbind(DX11::CommandContext& context)
+{
+	context.SetVertexShader(nullptr);
+	context.SetPixelShader(nullptr);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Fill in the shader half of a queued draw
+
+\param item
+  Receives the input layout and shaders, and whether the shader reads
+  per-instance data
 */
 /****************************************************************************/
-void DX11::Shader::Unbind(DX11::DeviceContext context)
+void DX11::Shader::FillItem(DX11::DrawItem& item) const
 {
-	context->VSSetShader(nullptr, nullptr, 0);
-	context->PSSetShader(nullptr, nullptr, 0);
+	item.inputLayout = pInputLayout.Get();
+	item.vertexShader = pVertexShader.Get();
+	item.pixelShader = pPixelShader.Get();
+	item.instanced = pInputLayout.Instanced();
 }
 
 /****************************************************************************/
@@ -0,0 +1,251 @@
+/****************************************************************************/
+/*!
+\file
+   StagingPool.cpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Recycled staging buffers for updating GPU only (BufferUsage::Default)
+    buffers. Every upload of a frame is packed into the same mapped
+    staging blocks, the copies are issued together by Flush and blocks go
+    back to the pool once the frame that used them has been fenced as
+    done on the GPU.
+*/
+/****************************************************************************/
+
+/*============================================================================*\
+|| ------------------------------ INCLUDES ---------------------------------- ||
+\*============================================================================*/
+
+#include "DX11PCH.hpp"
+#include "StagingPool.hpp"
+
+/*============================================================================*\
+|| --------------------------- GLOBAL VARIABLES ----------------------------- ||
+\*============================================================================*/
+
+/*============================================================================*\
+|| -------------------------- STATIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/*============================================================================*\
+|| -------------------------- PUBLIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Write data into this frame's staging blocks, to be copied into part of a
+  GPU only buffer by the next Flush. Uploads are packed back to back and
+  split across blocks when they don't fit in what is left of one.
+
+\param device
+  The ID3D11Device
+
+\param destination
+  A BufferUsage::Default buffer, has to stay alive until the next Flush
+
+\param offset
+  Byte offset into destination
+
+\param data
+  The data to copy
+
+\param size
+  Bytes to copy
+*/
+/****************************************************************************/
+void DX11::StagingPool::Upload(const DX11::Device& device, DX11::Buffer& destination, uint32_t offset, const void* data, uint32_t size)
+{
+    if (offset + size > destination.Size())
+    {
+        throw std::runtime_error("DX11: upload out of range from StagingPool::Upload!\n");
+    }
+
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    while (size > 0)
+    {
+        if (mCursor >= BLOCK_SIZE)
+        {
+            Open(device);
+        }
+
+        const uint32_t chunk = std::min(size, BLOCK_SIZE - mCursor);
+        std::memcpy(static_cast<uint8_t*>(mFrameBlocks.back().Data()) + mCursor, bytes, chunk);
+
+        Copy copy;
+        copy.destination = destination.Get();
+        copy.destinationOffset = offset;
+        copy.block = uint32_t(mFrameBlocks.size() - 1);
+        copy.sourceOffset = mCursor;
+        copy.size = chunk;
+        mCopies.push_back(copy);
+
+        mCursor = (mCursor + chunk + COPY_ALIGNMENT - 1) & ~(COPY_ALIGNMENT - 1);
+        bytes += chunk;
+        offset += chunk;
+        size -= chunk;
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Unmap the blocks written since the last flush and issue their copies.
+  Call before anything reads the destinations, later uploads in the frame
+  start a new block.
+
+\param device
+  The ID3D11Device
+*/
+/****************************************************************************/
+void DX11::StagingPool::Flush(const DX11::Device& device)
+{
+    for (size_t i = mFlushedBlocks; i < mFrameBlocks.size(); ++i)
+    {
+        mFrameBlocks[i].Unmap(device);
+    }
+    mFlushedBlocks = mFrameBlocks.size();
+    mCursor = BLOCK_SIZE;
+
+    DX11::CommandContext& context = device.Commands();
+    for (const Copy& copy : mCopies)
+    {
+        context.CopyBufferRegion(copy.destination, copy.destinationOffset, mFrameBlocks[copy.block].Get(), copy.sourceOffset, copy.size);
+    }
+    mCopies.clear();
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Flush, fence the blocks used this frame and take back blocks whose
+  copies the GPU has finished. Call once a frame after Present.
+
+\param device
+  The ID3D11Device
+*/
+/****************************************************************************/
+void DX11::StagingPool::EndFrame(const DX11::Device& device)
+{
+    Flush(device);
+    Retire(device);
+
+    if (mFrameBlocks.empty())
+    {
+        return;
+    }
+
+    Batch batch;
+    if (!mFences.empty())
+    {
+        batch.fence = std::move(mFences.back());
+        mFences.pop_back();
+    }
+    else if (!device.Headless())
+    {
+        D3D11_QUERY_DESC queryDesc = {};
+        queryDesc.Query = D3D11_QUERY_EVENT;
+        if (!SUCCEEDED(device->CreateQuery(&queryDesc, batch.fence.ReleaseAndGetAddressOf())))
+        {
+            throw std::runtime_error("DX11: CreateQuery() failed from StagingPool!\n");
+        }
+    }
+
+    device.Commands().EndQuery(batch.fence.Get());
+    batch.blocks.swap(mFrameBlocks);
+    mFlushedBlocks = 0;
+    mInFlight.push_back(std::move(batch));
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Total bytes of staging memory the pool has created
+*/
+/****************************************************************************/
+size_t DX11::StagingPool::Allocated() const
+{
+    return mAllocated;
+}
+
+/*============================================================================*\
+|| ------------------------- PRIVATE FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Start writing into a fresh block, mapped until the next Flush. Its
+  copies from earlier frames are fenced as done so the map never waits.
+
+\param device
+  The ID3D11Device
+*/
+/****************************************************************************/
+void DX11::StagingPool::Open(const DX11::Device& device)
+{
+    mFrameBlocks.push_back(Acquire(device));
+    mFrameBlocks.back().Map(device, D3D11_MAP_WRITE);
+    mCursor = 0;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get a free block, creating one only when none is free
+
+\param device
+  The ID3D11Device
+*/
+/****************************************************************************/
+DX11::Buffer DX11::StagingPool::Acquire(const DX11::Device& device)
+{
+    if (!mFree.empty())
+    {
+        DX11::Buffer block = std::move(mFree.back());
+        mFree.pop_back();
+        return block;
+    }
+
+    mAllocated += BLOCK_SIZE;
+    return DX11::Buffer(device, BLOCK_SIZE, 0, DX11::BufferUsage::Upload);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Return the blocks of every batch the GPU has finished with to the pool
+
+\param device
+  The ID3D11Device
+*/
+/****************************************************************************/
+void DX11::StagingPool::Retire(const DX11::Device& device)
+{
+    while (!mInFlight.empty())
+    {
+        Batch& batch = mInFlight.front();
+        HRESULT result = device.Commands().GetQueryData(batch.fence.Get(), false);
+        if (result == S_FALSE)
+        {
+            return;
+        }
+
+        if (!SUCCEEDED(result))
+        {
+            throw std::runtime_error("DX11: GetData() failed from StagingPool::Retire!\n");
+        }
+
+        for (DX11::Buffer& block : batch.blocks)
+        {
+            mFree.push_back(std::move(block));
+        }
+        batch.blocks.clear();
+        mFences.push_back(std::move(batch.fence));
+        mInFlight.pop_front();
+    }
+}
@@ -0,0 +1,717 @@
+/****************************************************************************/
+/*!
+\file
+   StateCacheCommandContext.cpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    CommandContext that shadows the bound pipeline state and drops Set*
+    calls that would bind what is already bound, then forwards the rest.
+    Objects are compared by pointer, so anything that binds state behind
+    its back or frees a bound object must call Invalidate.
+*/
+/****************************************************************************/
+
+/*============================================================================*\
+|| ------------------------------ INCLUDES ---------------------------------- ||
+\*============================================================================*/
+
+#include "DX11PCH.hpp"
+#include "StateCacheCommandContext.hpp"
+
+/*============================================================================*\
+|| --------------------------- GLOBAL VARIABLES ----------------------------- ||
+\*============================================================================*/
+
+/*============================================================================*\
+|| -------------------------- STATIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/*============================================================================*\
+|| -------------------------- PUBLIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Constructor, nothing is known about the bound state yet
+
+\param forward
+  Context the calls that change something are passed on to
+*/
+/****************************************************************************/
+DX11::StateCacheCommandContext::StateCacheCommandContext(std::shared_ptr<DX11::CommandContext> forward) :
+    mForward(forward)
+{
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Forget the shadowed state, the next bind of everything goes through.
+  Call after binding on the real context directly.
+*/
+/****************************************************************************/
+void DX11::StateCacheCommandContext::Invalidate()
+{
+    Reset(false);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Forget only the bound render targets. Flip model Present unbinds the
+  back buffer behind our back.
+*/
+/****************************************************************************/
+void DX11::StateCacheCommandContext::InvalidateRenderTargets()
+{
+    mRenderTargets.known = false;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Zero the counters, call once a frame
+*/
+/****************************************************************************/
+void DX11::StateCacheCommandContext::ResetStats()
+{
+    mStats = DX11::StateCacheStats();
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the Set* calls seen and dropped since ResetStats
+*/
+/****************************************************************************/
+const DX11::StateCacheStats& DX11::StateCacheCommandContext::Stats() const
+{
+    return mStats;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Set the primitive topology if it changed
+*/
+/****************************************************************************/
+void DX11::StateCacheCommandContext::SetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology)
+{
+    if (Changed(mTopology, topology))
+    {
+        mForward->SetPrimitiveTopology(topology);
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Set the input layout if it changed
+*/
+/****************************************************************************/
+void DX11::StateCacheCommandContext::SetInputLayout(ID3D11InputLayout* layout)
+{
+    if (Changed(mInputLayout, layout))
+    {
+        mForward->SetInputLayout(layout);
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Set vertex buffers if any slot in the range changed. The whole range is
+  forwarded so the call count stays the same as without the cache.
+*/
+/****************************************************************************/
+void DX11::StateCacheCommandContext::SetVertexBuffers(uint32_t slot, uint32_t count, ID3D11Buffer* const* buffers, const uint32_t* strides, const uint32_t* offsets)
+{
+    ++mStats.submitted;
+
+    // past the shadowed slots, bind and stop trusting what we had
+    if (slot + count > VERTEX_BUFFER_SLOTS)
+    {
+        for (uint32_t i = slot; i < VERTEX_BUFFER_SLOTS; ++i)
+        {
+            mVertexBuffers[i].known = false;
+        }
+        mForward->SetVertexBuffers(slot, count, buffers, strides, offsets);
+        return;
+    }
+
+    bool changed = false;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        VertexBinding binding;
+        binding.buffer = buffers[i];
+        binding.stride = strides[i];
+        binding.offset = offsets[i];
+
+        Shadow<VertexBinding>& shadow = mVertexBuffers[slot + i];
+        if (!shadow.known || !(shadow.value == binding))
+        {
+            shadow.value = binding;
+            shadow.known = true;
+            changed = true;
+        }
+    }
+
+    if (!changed)
+    {
+        ++mStats.filtered;
+        return;
+    }
+    mForward->SetVertexBuffers(slot, count, buffers, strides, offsets);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Set the index buffer if it changed
+*/
+/****************************************************************************/
+void DX11::StateCacheCommandContext::SetIndexBuffer(ID3D11Buffer* buffer, DXGI_FORMAT format, uint32_t offset)
+{
+    IndexBinding binding;
+    binding.buffer = buffer;
+    binding.format = format;
+    binding.offset = offset;
+
+    if (Changed(mIndexBuffer, binding))
+    {
+        mForward->SetIndexBuffer(buffer, format, offset);
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Set the vertex shader if it changed
+*/
+/****************************************************************************/
+void DX11::StateCacheCommandContext::SetVertexShader(ID3D11VertexShader* shader)
+{
+    if (Changed(mVertexShader, shader))
+    {
+        mForward->SetVertexShader(shader);
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Set the pixel shader if it changed
+*/
+/****************************************************************************/
+void DX11::StateCacheCommandContext::SetPixelShader(ID3D11PixelShader* shader)
+{
+    if (Changed(mPixelShader, shader))
+    {
+        mForward->SetPixelShader(shader);
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Set a vertex shader constant buffer if the buffer or range changed
+*/
+/****************************************************************************/
+void DX11::StateCacheCommandContext::SetVSConstantBuffer(uint32_t slot, ID3D11Buffer* buffer, uint32_t firstConstant, uint32_t constantCount)
+{
+    SetConstantBuffer(mVSConstants, slot, buffer, firstConstant, constantCount, false);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Set a pixel shader constant buffer if the buffer or range changed
+*/
+/****************************************************************************/
+void DX11::StateCacheCommandContext::SetPSConstantBuffer(uint32_t slot, ID3D11Buffer* buffer, uint32_t firstConstant, uint32_t constantCount)
+{
+    SetConstantBuffer(mPSConstants, slot, buffer, firstConstant, constantCount, true);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Set the rasterizer state if it changed
+*/
+/****************************************************************************/
+void DX11::StateCacheCommandContext::SetRasterizerState(ID3D11RasterizerState* state)
+{
+    if (Changed(mRasterizerState, state))
+    {
+        mForward->SetRasterizerState(state);
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Set the viewports if any of them changed
+*/
+/****************************************************************************/
+void DX11::StateCacheCommandContext::SetViewports(uint32_t count, const D3D11_VIEWPORT* viewports)
+{
+    if (count > VIEWPORT_SLOTS)
+    {
+        ++mStats.submitted;
+        mViewports.known = false;
+        mForward->SetViewports(count, viewports);
+        return;
+    }
+
+    ViewportBinding binding;
+    binding.count = count;
+    std::copy(viewports, viewports + count, binding.viewports);
+
+    if (Changed(mViewports, binding))
+    {
+        mForward->SetViewports(count, viewports);
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Set the blend state if the state, factors or mask changed
+*/
+/****************************************************************************/
+void DX11::StateCacheCommandContext::SetBlendState(ID3D11BlendState* state, const float factors[4], uint32_t sampleMask)
+{
+    BlendBinding binding;
+    binding.state = state;
+    binding.sampleMask = sampleMask;
+    if (factors != nullptr)
+    {
+        std::copy(factors, factors + 4, binding.factors);
+    }
+
+    if (Changed(mBlendState, binding))
+    {
+        mForward->SetBlendState(state, factors, sampleMask);
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Set the depth stencil state if the state or reference changed
+*/
+/****************************************************************************/
+void DX11::StateCacheCommandContext::SetDepthStencilState(ID3D11DepthStencilState* state, uint32_t stencilRef)
+{
+    DepthStencilBinding binding;
+    binding.state = state;
+    binding.stencilRef = stencilRef;
+
+    if (Changed(mDepthStencilState, binding))
+    {
+        mForward->SetDepthStencilState(state, stencilRef);
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Set the render targets if any view changed
+*/
+/****************************************************************************/
+void DX11::StateCacheCommandContext::SetRenderTargets(uint32_t count, ID3D11RenderTargetView* const* views, ID3D11DepthStencilView* depth)
+{
+    if (count > RENDER_TARGET_SLOTS)
+    {
+        ++mStats.submitted;
+        mRenderTargets.known = false;
+        mForward->SetRenderTargets(count, views, depth);
+        return;
+    }
+
+    RenderTargetBinding binding;
+    binding.count = count;
+    binding.depth = depth;
+    std::copy(views, views + count, binding.views);
+
+    if (Changed(mRenderTargets, binding))
+    {
+        mForward->SetRenderTargets(count, views, depth);
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Clear a render target, never filtered
+*/
+/****************************************************************************/
+void DX11::StateCacheCommandContext::ClearRenderTargetView(ID3D11RenderTargetView* view, const float color[4])
+{
+    mForward->ClearRenderTargetView(view, color);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Clear a depth stencil view, never filtered
+*/
+/****************************************************************************/
+void DX11::StateCacheCommandContext::ClearDepthStencilView(ID3D11DepthStencilView* view, uint32_t flags, float depth, uint8_t stencil)
+{
+    mForward->ClearDepthStencilView(view, flags, depth, stencil);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Draw, never filtered
+*/
+/****************************************************************************/
+void DX11::StateCacheCommandContext::DrawIndexed(uint32_t indexCount, uint32_t firstIndex, int32_t baseVertex)
+{
+    mForward->DrawIndexed(indexCount, firstIndex, baseVertex);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Instanced draw, never filtered
+*/
+/****************************************************************************/
+void DX11::StateCacheCommandContext::DrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t baseVertex, uint32_t firstInstance)
+{
+    mForward->DrawIndexedInstanced(indexCount, instanceCount, firstIndex, baseVertex, firstInstance);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Map, never filtered
+*/
+/****************************************************************************/
+void* DX11::StateCacheCommandContext::Map(ID3D11Resource* resource, D3D11_MAP mapType, uint32_t size)
+{
+    return mForward->Map(resource, mapType, size);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Unmap, never filtered
+*/
+/****************************************************************************/
+void DX11::StateCacheCommandContext::Unmap(ID3D11Resource* resource)
+{
+    mForward->Unmap(resource);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Copy part of a buffer, never filtered
+*/
+/****************************************************************************/
+void DX11::StateCacheCommandContext::CopyBufferRegion(ID3D11Buffer* destination, uint32_t destinationOffset, ID3D11Buffer* source, uint32_t sourceOffset, uint32_t size)
+{
+    mForward->CopyBufferRegion(destination, destinationOffset, source, sourceOffset, size);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Issue a fence, never filtered
+*/
+/****************************************************************************/
+void DX11::StateCacheCommandContext::EndQuery(ID3D11Query* query)
+{
+    mForward->EndQuery(query);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Poll a fence, never filtered
+*/
+/****************************************************************************/
+HRESULT DX11::StateCacheCommandContext::GetQueryData(ID3D11Query* query, bool flush)
+{
+    return mForward->GetQueryData(query, flush);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Reset the pipeline, after this every slot is known to hold its default
+*/
+/****************************************************************************/
+void DX11::StateCacheCommandContext::ClearState()
+{
+    mForward->ClearState();
+    Reset(true);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Flush, never filtered
+*/
+/****************************************************************************/
+void DX11::StateCacheCommandContext::Flush()
+{
+    mForward->Flush();
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Create a deferred context with its own cache in front of it
+*/
+/****************************************************************************/
+std::shared_ptr<DX11::CommandContext> DX11::StateCacheCommandContext::CreateDeferred()
+{
+    return std::make_shared<DX11::StateCacheCommandContext>(mForward->CreateDeferred());
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Finish a command list, the context is back to its default state
+*/
+/****************************************************************************/
+DX11::CommandList DX11::StateCacheCommandContext::FinishCommandList()
+{
+    DX11::CommandList list = mForward->FinishCommandList();
+    Reset(true);
+    return list;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Execute a command list, the context is back to its default state
+*/
+/****************************************************************************/
+void DX11::StateCacheCommandContext::ExecuteCommandList(ID3D11CommandList* list)
+{
+    mForward->ExecuteCommandList(list);
+    Reset(true);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Compare two vertex buffer bindings
+*/
+/****************************************************************************/
+bool DX11::StateCacheCommandContext::VertexBinding::operator==(const VertexBinding& other) const
+{
+    return buffer == other.buffer && stride == other.stride && offset == other.offset;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Compare two index buffer bindings
+*/
+/****************************************************************************/
+bool DX11::StateCacheCommandContext::IndexBinding::operator==(const IndexBinding& other) const
+{
+    return buffer == other.buffer && format == other.format && offset == other.offset;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Compare two constant buffer bindings
+*/
+/****************************************************************************/
+bool DX11::StateCacheCommandContext::ConstantBinding::operator==(const ConstantBinding& other) const
+{
+    return buffer == other.buffer && firstConstant == other.firstConstant && constantCount == other.constantCount;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Compare two blend bindings
+*/
+/****************************************************************************/
+bool DX11::StateCacheCommandContext::BlendBinding::operator==(const BlendBinding& other) const
+{
+    return state == other.state && sampleMask == other.sampleMask
+        && std::equal(factors, factors + 4, other.factors);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Compare two depth stencil bindings
+*/
+/****************************************************************************/
+bool DX11::StateCacheCommandContext::DepthStencilBinding::operator==(const DepthStencilBinding& other) const
+{
+    return state == other.state && stencilRef == other.stencilRef;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Compare two sets of viewports, only the bound ones
+*/
+/****************************************************************************/
+bool DX11::StateCacheCommandContext::ViewportBinding::operator==(const ViewportBinding& other) const
+{
+    return count == other.count
+        && std::memcmp(viewports, other.viewports, sizeof(D3D11_VIEWPORT) * count) == 0;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Compare two sets of render targets, only the bound ones
+*/
+/****************************************************************************/
+bool DX11::StateCacheCommandContext::RenderTargetBinding::operator==(const RenderTargetBinding& other) const
+{
+    return count == other.count && depth == other.depth
+        && std::equal(views, views + count, other.views);
+}
+
+/*============================================================================*\
+|| ------------------------- PRIVATE FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Count a Set* call and update its shadow
+
+\param shadow
+  What is bound now
+
+\param value
+  What the call wants bound
+
+\return
+  True if the call has to go through, false if it was filtered
+*/
+/****************************************************************************/
+template <typename T>
+bool DX11::StateCacheCommandContext::Changed(Shadow<T>& shadow, const T& value)
+{
+    ++mStats.submitted;
+    if (shadow.known && shadow.value == value)
+    {
+        ++mStats.filtered;
+        return false;
+    }
+
+    shadow.value = value;
+    shadow.known = true;
+    return true;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Set a constant buffer slot on either stage if it changed
+
+\param slots
+  The stage's shadowed slots
+
+\param slot
+  Constant buffer register
+
+\param buffer
+  The buffer
+
+\param firstConstant
+  First 16 byte constant of the range, 0 with constantCount 0 for all
+
+\param constantCount
+  Number of constants, 0 for the whole buffer
+
+\param pixel
+  Pixel shader if true, vertex shader otherwise
+*/
+/****************************************************************************/
+void DX11::StateCacheCommandContext::SetConstantBuffer(Shadow<ConstantBinding>* slots, uint32_t slot, ID3D11Buffer* buffer, uint32_t firstConstant, uint32_t constantCount, bool pixel)
+{
+    ConstantBinding binding;
+    binding.buffer = buffer;
+    binding.firstConstant = firstConstant;
+    binding.constantCount = constantCount;
+
+    if (slot < CONSTANT_BUFFER_SLOTS && !Changed(slots[slot], binding))
+    {
+        return;
+    }
+    if (slot >= CONSTANT_BUFFER_SLOTS)
+    {
+        ++mStats.submitted;
+    }
+
+    if (pixel)
+    {
+        mForward->SetPSConstantBuffer(slot, buffer, firstConstant, constantCount);
+    }
+    else
+    {
+        mForward->SetVSConstantBuffer(slot, buffer, firstConstant, constantCount);
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Put every shadow back to the D3D11 defaults
+
+\param known
+  True if the context really is in its default state (after ClearState),
+  false if nothing is known and the next bind of everything must go through
+*/
+/****************************************************************************/
+void DX11::StateCacheCommandContext::Reset(bool known)
+{
+    mTopology = Shadow<D3D11_PRIMITIVE_TOPOLOGY>();
+    mInputLayout = Shadow<ID3D11InputLayout*>();
+    for (Shadow<VertexBinding>& shadow : mVertexBuffers)
+    {
+        shadow = Shadow<VertexBinding>();
+        shadow.known = known;
+    }
+    mIndexBuffer = Shadow<IndexBinding>();
+
+    mVertexShader = Shadow<ID3D11VertexShader*>();
+    mPixelShader = Shadow<ID3D11PixelShader*>();
+    for (uint32_t i = 0; i < CONSTANT_BUFFER_SLOTS; ++i)
+    {
+        mVSConstants[i] = Shadow<ConstantBinding>();
+        mVSConstants[i].known = known;
+        mPSConstants[i] = Shadow<ConstantBinding>();
+        mPSConstants[i].known = known;
+    }
+
+    mRasterizerState = Shadow<ID3D11RasterizerState*>();
+    mViewports = Shadow<ViewportBinding>();
+    mBlendState = Shadow<BlendBinding>();
+    mDepthStencilState = Shadow<DepthStencilBinding>();
+    mRenderTargets = Shadow<RenderTargetBinding>();
+
+    mTopology.known = known;
+    mInputLayout.known = known;
+    mIndexBuffer.known = known;
+    mVertexShader.known = known;
+    mPixelShader.known = known;
+    mRasterizerState.known = known;
+    mViewports.known = known;
+    mBlendState.known = known;
+    mDepthStencilState.known = known;
+    mRenderTargets.known = known;
+}
@@ -21,9 +21,11 @@
 #include "Device.hpp"
 #include "Factory.hpp"
 
+#if defined(_WIN32)
 #define GLFW_EXPOSE_NATIVE_WIN32
 #include "glfw3native.h"
 #undef GLFW_EXPOSE_NATIVE_WIN32
+#endif
 
 /*============================================================================*\
 || --------------------------- GLOBAL VARIABLES ----------------------------- ||
@@ -45,6 +45,11 @@
 /****************************************************************************/
 DX11::Texture2D::Texture2D(DX11::Device device, D3D11_TEXTURE2D_DESC desc)
 {  
+    if (device.Headless())
+    {
+        return;
+    }
+
     if (!SUCCEEDED(device->CreateTexture2D(&desc, nullptr, ReleaseAndGetAddressOf())))
     {
         throw std::runtime_error("DX11: CreateTexture2D() failed from Texture2D!\n");
@@ -0,0 +1,640 @@
+/****************************************************************************/
+/*!
+\file
+   VisibilitySet.cpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    World space bounds of everything that might be drawn, stored as
+    structure of arrays so the frustum test runs on 4 (SSE) or 8 (AVX2)
+    objects at once. Each object is a box and a sphere sharing a center,
+    it is culled when either lies fully outside one of the 6 planes.
+*/
+/****************************************************************************/
+
+/*============================================================================*\
+|| ------------------------------ INCLUDES ---------------------------------- ||
+\*============================================================================*/
+
+#include "DX11PCH.hpp"
+#include "VisibilitySet.hpp"
+#include "WorkerPool.hpp"
+#include <immintrin.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define AVX2_TARGET
+#else
+#define AVX2_TARGET __attribute__((target("avx2")))
+#endif
+
+/*============================================================================*\
+|| --------------------------- GLOBAL VARIABLES ----------------------------- ||
+\*============================================================================*/
+
+/*============================================================================*\
+|| -------------------------- STATIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+namespace
+{
+    //! the arrays of a VisibilitySet as the kernels see them
+    struct Bounds
+    {
+        const float* centerX;
+        const float* centerY;
+        const float* centerZ;
+        const float* extentX;
+        const float* extentY;
+        const float* extentZ;
+        const float* radius;
+    };
+
+    /****************************************************************************/
+    /*!
+    \brief
+      Test one object at a time. Also finishes the objects left over by the
+      wide kernels, every kernel does the same math in the same order so
+      they agree bit for bit.
+
+    \param frustum
+      Planes to test against
+
+    \param bounds
+      The objects
+
+    \param begin
+      First object
+
+    \param end
+      One past the last object
+
+    \param visible
+      Indices of visible objects are written here
+
+    \return
+      Number of visible objects
+    */
+    /****************************************************************************/
+    static size_t CullScalar(const DX11::Frustum& frustum, const Bounds& bounds, size_t begin, size_t end, uint32_t* visible)
+    {
+        size_t count = 0;
+        for (size_t i = begin; i < end; ++i)
+        {
+            bool inside = true;
+            for (uint32_t p = 0; p < DX11::Frustum::PLANE_COUNT; ++p)
+            {
+                const DirectX::XMFLOAT4& plane = frustum.planes[p];
+                const float distance = bounds.centerX[i] * plane.x + bounds.centerY[i] * plane.y + bounds.centerZ[i] * plane.z + plane.w;
+                float reach = bounds.extentX[i] * std::fabs(plane.x) + bounds.extentY[i] * std::fabs(plane.y) + bounds.extentZ[i] * std::fabs(plane.z);
+                reach = reach < bounds.radius[i] ? reach : bounds.radius[i];
+                inside = inside && distance + reach >= 0.0f;
+            }
+
+            // branchless write, the slot is overwritten when the object is culled
+            visible[count] = uint32_t(i);
+            count += inside ? 1 : 0;
+        }
+        return count;
+    }
+
+    /****************************************************************************/
+    /*!
+    \brief
+      Test 4 objects per iteration with SSE, always available on x64
+    */
+    /****************************************************************************/
+    static size_t CullSSE(const DX11::Frustum& frustum, const Bounds& bounds, size_t begin, size_t end, uint32_t* visible)
+    {
+        __m128 normalX[DX11::Frustum::PLANE_COUNT];
+        __m128 normalY[DX11::Frustum::PLANE_COUNT];
+        __m128 normalZ[DX11::Frustum::PLANE_COUNT];
+        __m128 absX[DX11::Frustum::PLANE_COUNT];
+        __m128 absY[DX11::Frustum::PLANE_COUNT];
+        __m128 absZ[DX11::Frustum::PLANE_COUNT];
+        __m128 offset[DX11::Frustum::PLANE_COUNT];
+        for (uint32_t p = 0; p < DX11::Frustum::PLANE_COUNT; ++p)
+        {
+            const DirectX::XMFLOAT4& plane = frustum.planes[p];
+            normalX[p] = _mm_set1_ps(plane.x);
+            normalY[p] = _mm_set1_ps(plane.y);
+            normalZ[p] = _mm_set1_ps(plane.z);
+            absX[p] = _mm_set1_ps(std::fabs(plane.x));
+            absY[p] = _mm_set1_ps(std::fabs(plane.y));
+            absZ[p] = _mm_set1_ps(std::fabs(plane.z));
+            offset[p] = _mm_set1_ps(plane.w);
+        }
+
+        const __m128 zero = _mm_setzero_ps();
+        size_t count = 0;
+        size_t i = begin;
+        for (; i + 4 <= end; i += 4)
+        {
+            const __m128 centerX = _mm_loadu_ps(bounds.centerX + i);
+            const __m128 centerY = _mm_loadu_ps(bounds.centerY + i);
+            const __m128 centerZ = _mm_loadu_ps(bounds.centerZ + i);
+            const __m128 extentX = _mm_loadu_ps(bounds.extentX + i);
+            const __m128 extentY = _mm_loadu_ps(bounds.extentY + i);
+            const __m128 extentZ = _mm_loadu_ps(bounds.extentZ + i);
+            const __m128 radius = _mm_loadu_ps(bounds.radius + i);
+
+            __m128 inside = _mm_cmpeq_ps(zero, zero);
+            for (uint32_t p = 0; p < DX11::Frustum::PLANE_COUNT; ++p)
+            {
+                __m128 distance = _mm_add_ps(_mm_mul_ps(centerX, normalX[p]), _mm_mul_ps(centerY, normalY[p]));
+                distance = _mm_add_ps(_mm_add_ps(distance, _mm_mul_ps(centerZ, normalZ[p])), offset[p]);
+                __m128 reach = _mm_add_ps(_mm_mul_ps(extentX, absX[p]), _mm_mul_ps(extentY, absY[p]));
+                reach = _mm_add_ps(reach, _mm_mul_ps(extentZ, absZ[p]));
+                reach = _mm_min_ps(reach, radius);
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, reach), zero));
+            }
+
+            const int mask = _mm_movemask_ps(inside);
+            for (uint32_t k = 0; k < 4; ++k)
+            {
+                visible[count] = uint32_t(i + k);
+                count += (mask >> k) & 1;
+            }
+        }
+        return count + CullScalar(frustum, bounds, i, end, visible + count);
+    }
+
+    /****************************************************************************/
+    /*!
+    \brief
+      Test 8 objects per iteration with AVX2, only called after
+      VisibilitySet::SupportsAVX2 said yes
+    */
+    /****************************************************************************/
+    AVX2_TARGET static size_t CullAVX2(const DX11::Frustum& frustum, const Bounds& bounds, size_t begin, size_t end, uint32_t* visible)
+    {
+        __m256 normalX[DX11::Frustum::PLANE_COUNT];
+        __m256 normalY[DX11::Frustum::PLANE_COUNT];
+        __m256 normalZ[DX11::Frustum::PLANE_COUNT];
+        __m256 absX[DX11::Frustum::PLANE_COUNT];
+        __m256 absY[DX11::Frustum::PLANE_COUNT];
+        __m256 absZ[DX11::Frustum::PLANE_COUNT];
+        __m256 offset[DX11::Frustum::PLANE_COUNT];
+        for (uint32_t p = 0; p < DX11::Frustum::PLANE_COUNT; ++p)
+        {
+            const DirectX::XMFLOAT4& plane = frustum.planes[p];
+            normalX[p] = _mm256_set1_ps(plane.x);
+            normalY[p] = _mm256_set1_ps(plane.y);
+            normalZ[p] = _mm256_set1_ps(plane.z);
+            absX[p] = _mm256_set1_ps(std::fabs(plane.x));
+            absY[p] = _mm256_set1_ps(std::fabs(plane.y));
+            absZ[p] = _mm256_set1_ps(std::fabs(plane.z));
+            offset[p] = _mm256_set1_ps(plane.w);
+        }
+
+        // multiply then add, no fma, so the results match the other kernels
+        const __m256 zero = _mm256_setzero_ps();
+        size_t count = 0;
+        size_t i = begin;
+        for (; i + 8 <= end; i += 8)
+        {
+            const __m256 centerX = _mm256_loadu_ps(bounds.centerX + i);
+            const __m256 centerY = _mm256_loadu_ps(bounds.centerY + i);
+            const __m256 centerZ = _mm256_loadu_ps(bounds.centerZ + i);
+            const __m256 extentX = _mm256_loadu_ps(bounds.extentX + i);
+            const __m256 extentY = _mm256_loadu_ps(bounds.extentY + i);
+            const __m256 extentZ = _mm256_loadu_ps(bounds.extentZ + i);
+            const __m256 radius = _mm256_loadu_ps(bounds.radius + i);
+
+            __m256 inside = _mm256_cmp_ps(zero, zero, _CMP_EQ_OQ);
+            for (uint32_t p = 0; p < DX11::Frustum::PLANE_COUNT; ++p)
+            {
+                __m256 distance = _mm256_add_ps(_mm256_mul_ps(centerX, normalX[p]), _mm256_mul_ps(centerY, normalY[p]));
+                distance = _mm256_add_ps(_mm256_add_ps(distance, _mm256_mul_ps(centerZ, normalZ[p])), offset[p]);
+                __m256 reach = _mm256_add_ps(_mm256_mul_ps(extentX, absX[p]), _mm256_mul_ps(extentY, absY[p]));
+                reach = _mm256_add_ps(reach, _mm256_mul_ps(extentZ, absZ[p]));
+                reach = _mm256_min_ps(reach, radius);
+                inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(distance, reach), zero, _CMP_GE_OQ));
+            }
+
+            const int mask = _mm256_movemask_ps(inside);
+            for (uint32_t k = 0; k < 8; ++k)
+            {
+                visible[count] = uint32_t(i + k);
+                count += (mask >> k) & 1;
+            }
+        }
+        return count + CullScalar(frustum, bounds, i, end, visible + count);
+    }
+
+    /****************************************************************************/
+    /*!
+    \brief
+      Scale a plane so its normal has unit length, keeps distances in world
+      units so they can be compared against the radius
+    */
+    /****************************************************************************/
+    static DirectX::XMFLOAT4 NormalizePlane(float x, float y, float z, float w)
+    {
+        const float length = std::sqrt(x * x + y * y + z * z);
+        const float scale = length > 0.0f ? 1.0f / length : 0.0f;
+        return DirectX::XMFLOAT4(x * scale, y * scale, z * scale, w * scale);
+    }
+}
+
+/*============================================================================*\
+|| -------------------------- PUBLIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Extract the planes of a view projection matrix (Gribb / Hartmann). Row
+  vectors as DirectXMath uses them, clip z in 0..1 as D3D uses it.
+
+\param viewProjection
+  View * projection, world space to clip space
+
+\return
+  Normalized planes facing inwards in world space
+*/
+/****************************************************************************/
+DX11::Frustum DX11::Frustum::FromMatrix(DirectX::FXMMATRIX viewProjection)
+{
+    DirectX::XMFLOAT4X4 m;
+    DirectX::XMStoreFloat4x4(&m, viewProjection);
+
+    // clip = p * m, so column j of m gives clip component j
+    DX11::Frustum frustum;
+    frustum.planes[Left] = NormalizePlane(m.m[0][3] + m.m[0][0], m.m[1][3] + m.m[1][0], m.m[2][3] + m.m[2][0], m.m[3][3] + m.m[3][0]);
+    frustum.planes[Right] = NormalizePlane(m.m[0][3] - m.m[0][0], m.m[1][3] - m.m[1][0], m.m[2][3] - m.m[2][0], m.m[3][3] - m.m[3][0]);
+    frustum.planes[Bottom] = NormalizePlane(m.m[0][3] + m.m[0][1], m.m[1][3] + m.m[1][1], m.m[2][3] + m.m[2][1], m.m[3][3] + m.m[3][1]);
+    frustum.planes[Top] = NormalizePlane(m.m[0][3] - m.m[0][1], m.m[1][3] - m.m[1][1], m.m[2][3] - m.m[2][1], m.m[3][3] - m.m[3][1]);
+    frustum.planes[Near] = NormalizePlane(m.m[0][2], m.m[1][2], m.m[2][2], m.m[3][2]);
+    frustum.planes[Far] = NormalizePlane(m.m[0][3] - m.m[0][2], m.m[1][3] - m.m[1][2], m.m[2][3] - m.m[2][2], m.m[3][3] - m.m[3][2]);
+    return frustum;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Constructor, picks the widest kernel the CPU runs
+*/
+/****************************************************************************/
+DX11::VisibilitySet::VisibilitySet()
+{
+    mKernel = SupportsAVX2() ? DX11::CullKernel::AVX2 : DX11::CullKernel::SSE;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Add an object already in world space
+
+\param center
+  Center of the box and the sphere
+
+\param extent
+  Half size of the box on each axis
+
+\param radius
+  Radius of the sphere
+
+\return
+  Index of the object, as reported by Cull
+*/
+/****************************************************************************/
+uint32_t DX11::VisibilitySet::Add(const DirectX::XMFLOAT3& center, const DirectX::XMFLOAT3& extent, float radius)
+{
+    mCenterX.push_back(center.x);
+    mCenterY.push_back(center.y);
+    mCenterZ.push_back(center.z);
+    mExtentX.push_back(extent.x);
+    mExtentY.push_back(extent.y);
+    mExtentZ.push_back(extent.z);
+    mRadius.push_back(radius);
+    return uint32_t(mRadius.size() - 1);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Add an object from its model space bounds. The box is transformed to the
+  world space box around it (Arvo), the sphere is scaled by the largest
+  axis scale.
+
+\param boundsMin
+  Model space box minimum
+
+\param boundsMax
+  Model space box maximum
+
+\param radius
+  Model space sphere radius around the box center
+
+\param world
+  Model to world matrix
+
+\return
+  Index of the object, as reported by Cull
+*/
+/****************************************************************************/
+uint32_t DX11::VisibilitySet::Add(const DirectX::XMFLOAT3& boundsMin, const DirectX::XMFLOAT3& boundsMax, float radius, DirectX::FXMMATRIX world)
+{
+    DirectX::XMFLOAT4X4 m;
+    DirectX::XMStoreFloat4x4(&m, world);
+
+    const float center[3] = { (boundsMin.x + boundsMax.x) * 0.5f, (boundsMin.y + boundsMax.y) * 0.5f, (boundsMin.z + boundsMax.z) * 0.5f };
+    const float extent[3] = { (boundsMax.x - boundsMin.x) * 0.5f, (boundsMax.y - boundsMin.y) * 0.5f, (boundsMax.z - boundsMin.z) * 0.5f };
+
+    float worldCenter[3];
+    float worldExtent[3];
+    for (uint32_t j = 0; j < 3; ++j)
+    {
+        worldCenter[j] = m.m[3][j];
+        worldExtent[j] = 0.0f;
+        for (uint32_t i = 0; i < 3; ++i)
+        {
+            worldCenter[j] += center[i] * m.m[i][j];
+            worldExtent[j] += extent[i] * std::fabs(m.m[i][j]);
+        }
+    }
+
+    float scale = 0.0f;
+    for (uint32_t i = 0; i < 3; ++i)
+    {
+        scale = std::max(scale, m.m[i][0] * m.m[i][0] + m.m[i][1] * m.m[i][1] + m.m[i][2] * m.m[i][2]);
+    }
+
+    return Add(DirectX::XMFLOAT3(worldCenter[0], worldCenter[1], worldCenter[2]),
+        DirectX::XMFLOAT3(worldExtent[0], worldExtent[1], worldExtent[2]),
+        radius * std::sqrt(scale));
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Move an object already in the set, for objects whose bounds changed
+
+\param index
+  Index returned by Add
+
+\param center
+  Center of the box and the sphere, world space
+
+\param extent
+  Half size of the box on each axis
+
+\param radius
+  Radius of the sphere
+*/
+/****************************************************************************/
+void DX11::VisibilitySet::Set(uint32_t index, const DirectX::XMFLOAT3& center, const DirectX::XMFLOAT3& extent, float radius)
+{
+    mCenterX[index] = center.x;
+    mCenterY[index] = center.y;
+    mCenterZ[index] = center.z;
+    mExtentX[index] = extent.x;
+    mExtentY[index] = extent.y;
+    mExtentZ[index] = extent.z;
+    mRadius[index] = radius;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Reserve space for a number of objects
+
+\param count
+  Number of objects
+*/
+/****************************************************************************/
+void DX11::VisibilitySet::Reserve(size_t count)
+{
+    mCenterX.reserve(count);
+    mCenterY.reserve(count);
+    mCenterZ.reserve(count);
+    mExtentX.reserve(count);
+    mExtentY.reserve(count);
+    mExtentZ.reserve(count);
+    mRadius.reserve(count);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Remove every object, keeps the memory for the next frame
+*/
+/****************************************************************************/
+void DX11::VisibilitySet::Clear()
+{
+    mCenterX.clear();
+    mCenterY.clear();
+    mCenterZ.clear();
+    mExtentX.clear();
+    mExtentY.clear();
+    mExtentZ.clear();
+    mRadius.clear();
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the number of objects
+*/
+/****************************************************************************/
+size_t DX11::VisibilitySet::Size() const
+{
+    return mRadius.size();
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Choose the kernel, mostly for comparing them
+
+\param kernel
+  The kernel to use
+
+\return
+  False and nothing changes if the CPU cannot run the kernel
+*/
+/****************************************************************************/
+bool DX11::VisibilitySet::SetKernel(DX11::CullKernel kernel)
+{
+    if (kernel == DX11::CullKernel::AVX2 && !SupportsAVX2())
+    {
+        return false;
+    }
+
+    mKernel = kernel;
+    return true;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Get the kernel in use
+*/
+/****************************************************************************/
+DX11::CullKernel DX11::VisibilitySet::Kernel() const
+{
+    return mKernel;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Cull every object on the global worker pool
+
+\param frustum
+  Planes to test against
+
+\param visible
+  Replaced with the indices of visible objects, in ascending order
+
+\return
+  Number of visible objects
+*/
+/****************************************************************************/
+size_t DX11::VisibilitySet::Cull(const DX11::Frustum& frustum, std::vector<uint32_t>& visible) const
+{
+    return Cull(frustum, visible, DX11::WorkerPool::Global());
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Cull every object. Sets of more than one chunk are split into CHUNK_SIZE
+  ranges run across the pool, each range packs its visible indices at its
+  own start in the scratch buffer and the ranges are joined in order.
+
+\param frustum
+  Planes to test against
+
+\param visible
+  Replaced with the indices of visible objects, in ascending order
+
+\param pool
+  Threads to cull on
+
+\return
+  Number of visible objects
+*/
+/****************************************************************************/
+size_t DX11::VisibilitySet::Cull(const DX11::Frustum& frustum, std::vector<uint32_t>& visible, DX11::WorkerPool& pool) const
+{
+    const size_t count = Size();
+    if (mScratch.size() < count)
+    {
+        mScratch.resize(count);
+    }
+
+    visible.clear();
+    if (count <= CHUNK_SIZE || pool.ThreadCount() <= 1)
+    {
+        const size_t found = CullRange(frustum, 0, count, mScratch.data());
+        visible.insert(visible.end(), mScratch.data(), mScratch.data() + found);
+        return found;
+    }
+
+    const size_t chunks = (count + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    mChunkCounts.resize(chunks);
+    pool.ParallelFor(chunks, [&](size_t chunk)
+    {
+        const size_t begin = chunk * CHUNK_SIZE;
+        const size_t end = std::min(begin + CHUNK_SIZE, count);
+        mChunkCounts[chunk] = CullRange(frustum, begin, end, mScratch.data() + begin);
+    });
+
+    size_t found = 0;
+    for (size_t chunk = 0; chunk < chunks; ++chunk)
+    {
+        found += mChunkCounts[chunk];
+    }
+
+    visible.reserve(found);
+    for (size_t chunk = 0; chunk < chunks; ++chunk)
+    {
+        const uint32_t* begin = mScratch.data() + chunk * CHUNK_SIZE;
+        visible.insert(visible.end(), begin, begin + mChunkCounts[chunk]);
+    }
+    return found;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Check once whether the CPU and the OS support AVX2
+
+\return
+  True if the AVX2 kernel can run
+*/
+/****************************************************************************/
+bool DX11::VisibilitySet::SupportsAVX2()
+{
+    static const bool supported = []()
+    {
+#if defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7)
+        {
+            return false;
+        }
+
+        // AVX and OSXSAVE, then the OS has to save the ymm registers
+        __cpuid(info, 1);
+        const int avxBits = (1 << 27) | (1 << 28);
+        if ((info[2] & avxBits) != avxBits || (_xgetbv(0) & 6) != 6)
+        {
+            return false;
+        }
+
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+#else
+        return __builtin_cpu_supports("avx2") != 0;
+#endif
+    }();
+    return supported;
+}
+
+/*============================================================================*\
+|| ------------------------- PRIVATE FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Cull a range of objects with the chosen kernel
+
+\param frustum
+  Planes to test against
+
+\param begin
+  First object
+
+\param end
+  One past the last object
+
+\param visible
+  Room for end - begin indices
+
+\return
+  Number of visible objects written
+*/
+/****************************************************************************/
+size_t DX11::VisibilitySet::CullRange(const DX11::Frustum& frustum, size_t begin, size_t end, uint32_t* visible) const
+{
+    const Bounds bounds = { mCenterX.data(), mCenterY.data(), mCenterZ.data(),
+        mExtentX.data(), mExtentY.data(), mExtentZ.data(), mRadius.data() };
+
+    switch (mKernel)
+    {
+    case DX11::CullKernel::AVX2:
+        return CullAVX2(frustum, bounds, begin, end, visible);
+    case DX11::CullKernel::SSE:
+        return CullSSE(frustum, bounds, begin, end, visible);
+    default:
+        return CullScalar(frustum, bounds, begin, end, visible);
+    }
+}
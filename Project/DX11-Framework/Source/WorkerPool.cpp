@@ -0,0 +1,514 @@
+/****************************************************************************/
+/*!
+\file
+   WorkerPool.cpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Fixed set of worker threads running jobs. Each worker keeps its own
+    work stealing deque, jobs scheduled from a worker go on its deque and
+    idle workers steal from the others, jobs from outside the pool go
+    through a shared queue. A job can count down a JobCounter when it
+    finishes and can be held back until another counter reaches zero.
+    Waiting on a counter runs jobs instead of blocking, so loops and waits
+    nest freely. Jobs live in a fixed set of slots, scheduling one does not
+    touch the heap.
+*/
+/****************************************************************************/
+
+/*============================================================================*\
+|| ------------------------------ INCLUDES ---------------------------------- ||
+\*============================================================================*/
+
+#include "DX11PCH.hpp"
+#include "WorkerPool.hpp"
+
+/*============================================================================*\
+|| --------------------------- GLOBAL VARIABLES ----------------------------- ||
+\*============================================================================*/
+
+namespace
+{
+    static const uint32_t NO_WORKER = 0xffffffff;
+
+    // the pool a worker thread belongs to and its index in it
+    thread_local const DX11::WorkerPool* tPool = nullptr;
+    thread_local uint32_t tWorker = NO_WORKER;
+}
+
+/*============================================================================*\
+|| -------------------------- STATIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/*============================================================================*\
+|| -------------------------- PUBLIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Check if every job counted on this has finished. Still Wait before the
+  counter goes away, the last job may be releasing what waited on it.
+*/
+/****************************************************************************/
+bool DX11::JobCounter::Done() const
+{
+    return mCount.load(std::memory_order_acquire) == 0;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Start the worker threads
+
+\param threadCount
+  Total threads running jobs including a thread that waits,
+  0 uses one per hardware thread
+*/
+/****************************************************************************/
+DX11::WorkerPool::WorkerPool(uint32_t threadCount) :
+    mJobs(std::make_unique<DX11::Job[]>(JOB_CAPACITY)),
+    mFreeJobs(JOB_CAPACITY),
+    mInjected(DEQUE_SIZE)
+{
+    if (threadCount == 0)
+    {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    for (uint32_t i = 0; i < JOB_CAPACITY; ++i)
+    {
+        uint32_t index = i;
+        mFreeJobs.TryPush(index);
+    }
+
+    // every deque exists before any worker can steal from it
+    for (uint32_t i = 1; i < threadCount; ++i)
+    {
+        mDeques.push_back(std::make_unique<DX11::WorkStealingDeque<DX11::Job*>>(uint32_t(DEQUE_SIZE)));
+    }
+    for (uint32_t i = 1; i < threadCount; ++i)
+    {
+        mThreads.emplace_back(&WorkerPool::WorkerLoop, this, i - 1);
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Stop and join the worker threads, every job must have been waited on
+*/
+/****************************************************************************/
+DX11::WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mQuit = true;
+    }
+    mWake.notify_all();
+
+    for (std::thread& thread : mThreads)
+    {
+        thread.join();
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Run jobs until every job counted on the counter has finished. Workers
+  start with their own deque, so the jobs they just scheduled come first,
+  and run anything they find. Other threads only run the counter's own
+  jobs while there are workers for the rest, so the render thread waiting
+  on its recording can't pick up a long import job some other thread
+  scheduled.
+
+\param counter
+  The counter to wait on
+*/
+/****************************************************************************/
+void DX11::WorkerPool::Wait(DX11::JobCounter& counter)
+{
+    const uint32_t worker = CurrentWorker();
+    while (!counter.Done())
+    {
+        DX11::Job* job = Find(worker);
+        if (job == nullptr)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        // not ours, back on the shared queue for a worker, without workers nobody else would run it
+        if (worker == NO_WORKER && !mThreads.empty() && job->counter != &counter)
+        {
+            Push(job, false);
+            std::this_thread::yield();
+            continue;
+        }
+        Execute(job);
+    }
+
+    // the last job may still hold the lock while it releases what waited on the counter
+    std::lock_guard<std::mutex> lock(counter.mMutex);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Call function(i) for every i in [0, count) across the pool and wait for
+  all of them to finish. The items are split into JOBS_PER_THREAD ranges
+  per thread.
+
+\param count
+  Number of items
+
+\param function
+  Called once per item, must be safe to call from any thread
+*/
+/****************************************************************************/
+void DX11::WorkerPool::ParallelFor(size_t count, const std::function<void(size_t)>& function)
+{
+    const size_t jobs = std::min<size_t>(count, size_t(ThreadCount()) * JOBS_PER_THREAD);
+    if (jobs == 0)
+    {
+        return;
+    }
+
+    ParallelFor(count, (count + jobs - 1) / jobs, [&function](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            function(i);
+        }
+    });
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Call function(begin, end) for consecutive ranges of grain items covering
+  [0, count) and wait for all of them to finish. The calling thread takes
+  the first range itself, then helps with the rest.
+
+\param count
+  Number of items
+
+\param grain
+  Items per range, the last range may be shorter
+
+\param function
+  Called once per range, must be safe to call from any thread
+*/
+/****************************************************************************/
+void DX11::WorkerPool::ParallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& function)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    grain = std::max<size_t>(grain, 1);
+    if (mThreads.empty() || grain >= count)
+    {
+        function(0, count);
+        return;
+    }
+
+    DX11::JobCounter counter;
+    for (size_t begin = grain; begin < count; begin += grain)
+    {
+        const size_t end = std::min(begin + grain, count);
+        Schedule([&function, begin, end]() { function(begin, end); }, &counter);
+    }
+    function(0, grain);
+    Wait(counter);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Number of threads that run jobs, including one waiting on them
+*/
+/****************************************************************************/
+uint32_t DX11::WorkerPool::ThreadCount() const
+{
+    return uint32_t(mThreads.size()) + 1;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Shared pool used by the engine
+*/
+/****************************************************************************/
+DX11::WorkerPool& DX11::WorkerPool::Global()
+{
+    static WorkerPool pool;
+    return pool;
+}
+
+/*============================================================================*\
+|| ------------------------- PRIVATE FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+/****************************************************************************/
+/*!
+\brief
+  Take a free job slot. If there is none and the job is held back by a
+  counter that is still counting, run other jobs until a slot frees up.
+
+\param after
+  The counter the job will wait on, may be null
+
+\return
+  The slot, null if there is none and the job can run right away
+*/
+/****************************************************************************/
+DX11::Job* DX11::WorkerPool::Allocate(DX11::JobCounter* after)
+{
+    uint32_t index = 0;
+    while (!mFreeJobs.TryPop(index))
+    {
+        if (after == nullptr || after->Done())
+        {
+            return nullptr;
+        }
+
+        DX11::Job* job = Find(CurrentWorker());
+        if (job)
+        {
+            Execute(job);
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+    return &mJobs[index];
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Count a constructed job and queue it, or hold it back
+
+\param job
+  The job, its callable already in place
+
+\param counter
+  Counted up now and down once the job has run, may be null
+
+\param after
+  The job is held back until this counter reaches zero, may be null
+*/
+/****************************************************************************/
+void DX11::WorkerPool::Submit(DX11::Job* job, DX11::JobCounter* counter, DX11::JobCounter* after)
+{
+    job->counter = counter;
+    if (counter)
+    {
+        counter->mCount.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // the count only reaches zero under the lock, so it can't slip by between the check and the push
+    if (after)
+    {
+        std::lock_guard<std::mutex> lock(after->mMutex);
+        if (after->mCount.load(std::memory_order_acquire) != 0)
+        {
+            job->next = after->mWaiting;
+            after->mWaiting = job;
+            return;
+        }
+    }
+    Push(job);
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Worker thread body, runs jobs and sleeps while there are none
+
+\param worker
+  Index of the worker's deque
+*/
+/****************************************************************************/
+void DX11::WorkerPool::WorkerLoop(uint32_t worker)
+{
+    tPool = this;
+    tWorker = worker;
+
+    while (true)
+    {
+        DX11::Job* job = Find(worker);
+        if (job)
+        {
+            Execute(job);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(mMutex);
+        ++mSleeping;
+        mWake.wait(lock, [this]() { return mQuit || mQueued.load() > 0; });
+        --mSleeping;
+        if (mQuit)
+        {
+            return;
+        }
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Take a job: the newest from the worker's own deque, else the oldest
+  from the shared queue, else the oldest from another worker's deque
+
+\param worker
+  Index of the caller's deque, NO_WORKER for threads outside the pool
+
+\return
+  The job, null if none was found
+*/
+/****************************************************************************/
+DX11::Job* DX11::WorkerPool::Find(uint32_t worker)
+{
+    DX11::Job* job = nullptr;
+    bool found = worker != NO_WORKER && mDeques[worker]->Pop(job);
+    found = found || mInjected.TryPop(job);
+
+    const size_t deques = mDeques.size();
+    const size_t first = worker != NO_WORKER ? worker + 1 : 0;
+    for (size_t k = 0; !found && k < deques; ++k)
+    {
+        const size_t victim = (first + k) % deques;
+        found = victim != worker && mDeques[victim]->Steal(job);
+    }
+
+    if (!found)
+    {
+        return nullptr;
+    }
+    mQueued.fetch_sub(1);
+    return job;
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Make a job available and wake a sleeping worker
+
+\param job
+  The job
+
+\param runIfFull
+  Run the job on the spot if its queue is full, otherwise wait for room
+*/
+/****************************************************************************/
+void DX11::WorkerPool::Push(DX11::Job* job, bool runIfFull)
+{
+    mQueued.fetch_add(1);
+
+    const uint32_t worker = CurrentWorker();
+    bool queued = worker != NO_WORKER ? mDeques[worker]->Push(job) : mInjected.TryPush(job);
+    while (!queued && !runIfFull)
+    {
+        std::this_thread::yield();
+        queued = worker != NO_WORKER ? mDeques[worker]->Push(job) : mInjected.TryPush(job);
+    }
+    if (!queued)
+    {
+        mQueued.fetch_sub(1);
+        Execute(job);
+        return;
+    }
+
+    // a sleeper checks mQueued under the lock, so taking it once means it either saw the job or is waiting
+    if (mSleeping.load() > 0)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+        }
+        mWake.notify_one();
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Run a job, free its slot, then count down its counter
+
+\param job
+  The job
+*/
+/****************************************************************************/
+void DX11::WorkerPool::Execute(DX11::Job* job)
+{
+    DX11::JobCounter* counter = job->counter;
+    job->run(*job);
+
+    uint32_t index = uint32_t(job - mJobs.get());
+    mFreeJobs.TryPush(index);
+
+    if (counter)
+    {
+        Finish(*counter);
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Count a counter down. The job that takes it to zero does so under the
+  lock and queues everything that was waiting on it, the others never
+  touch it again after their decrement.
+
+\param counter
+  The counter
+*/
+/****************************************************************************/
+void DX11::WorkerPool::Finish(DX11::JobCounter& counter)
+{
+    uint32_t count = counter.mCount.load(std::memory_order_relaxed);
+    while (count > 1)
+    {
+        if (counter.mCount.compare_exchange_weak(count, count - 1, std::memory_order_acq_rel, std::memory_order_relaxed))
+        {
+            return;
+        }
+    }
+
+    DX11::Job* released = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(counter.mMutex);
+        if (counter.mCount.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            std::swap(released, counter.mWaiting);
+        }
+    }
+
+    // a pushed job may run and be reused at once, read the link first
+    while (released)
+    {
+        DX11::Job* job = released;
+        released = job->next;
+        job->next = nullptr;
+        Push(job);
+    }
+}
+
+/****************************************************************************/
+/*!
+\brief
+  Index of the calling thread's deque, NO_WORKER if it is not one of this
+  pool's workers
+*/
+/****************************************************************************/
+uint32_t DX11::WorkerPool::CurrentWorker() const
+{
+    return tPool == this ? tWorker : NO_WORKER;
+}
@@ -0,0 +1,895 @@
+/****************************************************************************/
+/*!
+\file
+   Tests.cpp
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Correctness tests for the CPU side systems, run headless by ctest.
+    Each test is a function that reports through CHECK, the executable
+    runs every test (or the ones named on the command line) and fails if
+    any check did.
+*/
+/****************************************************************************/
+
+/*============================================================================*\
+|| ------------------------------ INCLUDES ---------------------------------- ||
+\*============================================================================*/
+
+#include "DX11PCH.hpp"
+#include "VertexFormat.hpp"
+#include "MeshOptimizer.hpp"
+#include "RingQueue.hpp"
+#include "WorkStealingDeque.hpp"
+#include "WorkerPool.hpp"
+#include "RenderQueue.hpp"
+#include "RecordingCommandContext.hpp"
+#include "Meshlets.hpp"
+#include "Buffer.hpp"
+#include "FrameArena.hpp"
+#include <atomic>
+#include <random>
+#include <thread>
+
+/*============================================================================*\
+|| --------------------------- GLOBAL VARIABLES ----------------------------- ||
+\*============================================================================*/
+
+namespace TESTS
+{
+    //! checks that failed in the running test
+    static uint32_t gFailures = 0;
+}
+
+//! record a failure with its location and keep going, so one run shows every broken check
+#define CHECK(x)                                                                        \
+    do                                                                                  \
+    {                                                                                   \
+        if (!(x))                                                                       \
+        {                                                                               \
+            std::cerr << "  " << __FILE__ << ":" << __LINE__ << ": CHECK(" #x ") failed" << std::endl; \
+            ++TESTS::gFailures;                                                         \
+        }                                                                               \
+    } while (false)
+
+/*============================================================================*\
+|| -------------------------- STATIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+namespace TESTS
+{
+    /****************************************************************************/
+    /*!
+    \brief
+      Quantized positions land within half a unorm16 step of the source on
+      every axis, octahedral normals within the snorm16 error, both
+      through EncodeVertex / DecodeVertex and for values on the bounds.
+    */
+    /****************************************************************************/
+    static void Quantization()
+    {
+        const float boundsMin[3] = { -3.0f, 0.5f, -100.0f };
+        const float boundsExtent[3] = { 6.0f, 0.25f, 250.0f };
+
+        std::mt19937 random(7);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        std::normal_distribution<float> gaussian;
+
+        float worstPosition[3] = { 0.0f, 0.0f, 0.0f };
+        float worstNormal = 0.0f;
+        for (uint32_t i = 0; i < 100000; ++i)
+        {
+            float position[3];
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                // every 16th vertex sits exactly on the bounds
+                float t = i % 16 == 0 ? float(i / 16 % 2) : unit(random);
+                position[axis] = boundsMin[axis] + t * boundsExtent[axis];
+            }
+
+            float normal[3] = { gaussian(random), gaussian(random), gaussian(random) };
+            const float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+            for (float& n : normal)
+            {
+                n /= length;
+            }
+
+            for (DX11::VertexFormat format : { DX11::VertexFormat::Compact, DX11::VertexFormat::Quantized })
+            {
+                uint8_t vertex[32];
+                DX11::EncodeVertex(format, position, normal, boundsMin, boundsExtent, vertex);
+
+                float decodedPosition[3];
+                float decodedNormal[3];
+                DX11::DecodeVertex(format, vertex, boundsMin, boundsExtent, decodedPosition, decodedNormal);
+
+                for (int axis = 0; axis < 3; ++axis)
+                {
+                    const float error = std::fabs(decodedPosition[axis] - position[axis]);
+                    if (format == DX11::VertexFormat::Compact)
+                    {
+                        CHECK(error == 0.0f);
+                    }
+                    else
+                    {
+                        worstPosition[axis] = std::max(worstPosition[axis], error / boundsExtent[axis]);
+                    }
+                }
+
+                const float dx = decodedNormal[0] - normal[0];
+                const float dy = decodedNormal[1] - normal[1];
+                const float dz = decodedNormal[2] - normal[2];
+                worstNormal = std::max(worstNormal, std::sqrt(dx * dx + dy * dy + dz * dz));
+            }
+        }
+
+        // half a step of the 65535 steps across the bounds, plus float rounding
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            CHECK(worstPosition[axis] <= 0.5f / 65535.0f + 1e-6f);
+        }
+
+        // snorm16 octahedral, half a step per component stretched by the fold
+        // onto the sphere, measured worst is about 2.1 steps
+        CHECK(worstNormal <= 3.0f / 32767.0f);
+
+        // degenerate bounds collapse to the minimum instead of dividing by zero
+        const float flatExtent[3] = { 0.0f, 0.0f, 0.0f };
+        const float point[3] = { 1.0f, 2.0f, 3.0f };
+        const float up[3] = { 0.0f, 1.0f, 0.0f };
+        uint8_t vertex[32];
+        float decoded[3];
+        DX11::EncodeVertex(DX11::VertexFormat::Quantized, point, up, point, flatExtent, vertex);
+        DX11::DecodeVertex(DX11::VertexFormat::Quantized, vertex, point, flatExtent, decoded, nullptr);
+        CHECK(decoded[0] == 1.0f && decoded[1] == 2.0f && decoded[2] == 3.0f);
+    }
+
+    /****************************************************************************/
+    /*!
+    \brief
+      PackIndices keeps every list's triangles, puts lists that fit 16 bits
+      in the R16 region and the rest in an aligned R32 region, with the
+      boundary at exactly MAX_NARROW_VERTICES vertices.
+    */
+    /****************************************************************************/
+    static void IndexPacking()
+    {
+        const uint32_t LIMIT = DX11::MeshOptimizer::MAX_NARROW_VERTICES;
+        const uint32_t vertexCounts[] = { 3, LIMIT, LIMIT + 1, 1000, 7 };
+        const size_t count = sizeof(vertexCounts) / sizeof(vertexCounts[0]);
+
+        // random triangles, each list touches its highest vertex so the width matters
+        std::mt19937 random(11);
+        std::vector<std::vector<uint32_t>> lists(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            std::uniform_int_distribution<uint32_t> vertex(0, vertexCounts[i] - 1);
+            lists[i].resize(3 * (1 + i * 97));
+            for (uint32_t& index : lists[i])
+            {
+                index = vertex(random);
+            }
+            lists[i][1] = vertexCounts[i] - 1;
+        }
+
+        std::vector<const uint32_t*> indices(count);
+        std::vector<size_t> indexCounts(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            indices[i] = lists[i].data();
+            indexCounts[i] = lists[i].size();
+        }
+
+        DX11::WorkerPool pool(2);
+        std::vector<uint8_t> packed;
+        std::vector<DX11::MeshOptimizer::PackedRange> ranges(count);
+        DX11::MeshOptimizer::PackIndices(indices.data(), indexCounts.data(), vertexCounts, count, packed, ranges.data(), pool);
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            const DX11::MeshOptimizer::PackedRange& range = ranges[i];
+            const bool narrow = vertexCounts[i] <= LIMIT;
+            CHECK(range.indexFormat == uint32_t(narrow ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT));
+
+            const size_t width = narrow ? sizeof(uint16_t) : sizeof(uint32_t);
+            CHECK(range.indexOffset % width == 0);
+            CHECK(range.indexOffset + (range.firstIndex + lists[i].size()) * width <= packed.size());
+            if (range.indexOffset + (range.firstIndex + lists[i].size()) * width > packed.size())
+            {
+                continue;
+            }
+
+            // the same triangles, in the same order and winding
+            bool same = true;
+            for (size_t k = 0; k < lists[i].size(); ++k)
+            {
+                const uint8_t* at = packed.data() + range.indexOffset + (range.firstIndex + k) * width;
+                uint32_t index;
+                if (narrow)
+                {
+                    uint16_t narrowIndex;
+                    std::memcpy(&narrowIndex, at, sizeof(narrowIndex));
+                    index = narrowIndex;
+                }
+                else
+                {
+                    std::memcpy(&index, at, sizeof(index));
+                }
+                same = same && index == lists[i][k];
+            }
+            CHECK(same);
+        }
+
+        // lists of one width never overlap
+        for (size_t a = 0; a < count; ++a)
+        {
+            for (size_t b = a + 1; b < count; ++b)
+            {
+                if (ranges[a].indexFormat != ranges[b].indexFormat)
+                {
+                    continue;
+                }
+                const uint32_t endA = ranges[a].firstIndex + uint32_t(lists[a].size());
+                const uint32_t endB = ranges[b].firstIndex + uint32_t(lists[b].size());
+                CHECK(endA <= ranges[b].firstIndex || endB <= ranges[a].firstIndex);
+            }
+        }
+    }
+
+    /****************************************************************************/
+    /*!
+    \brief
+      RingQueue is bounded and, with several producers and consumers, hands
+      every value to exactly one consumer.
+    */
+    /****************************************************************************/
+    static void RingQueue()
+    {
+        // bounded: capacity rounds up to a power of two, then pushes fail
+        {
+            DX11::RingQueue<uint32_t> queue(5);
+            CHECK(queue.Capacity() == 8);
+            uint32_t pushed = 0;
+            for (uint32_t i = 0; i < 16; ++i)
+            {
+                uint32_t value = i;
+                pushed += queue.TryPush(value) ? 1 : 0;
+            }
+            CHECK(pushed == 8);
+
+            uint32_t value = 0;
+            for (uint32_t i = 0; i < 8; ++i)
+            {
+                CHECK(queue.TryPop(value) && value == i);
+            }
+            CHECK(!queue.TryPop(value));
+        }
+
+        // contended: four producers, four consumers, every value taken once
+        const uint32_t PRODUCERS = 4;
+        const uint32_t PER_PRODUCER = 50000;
+        DX11::RingQueue<uint32_t> queue(64);
+        std::vector<std::atomic<uint32_t>> seen(PRODUCERS * PER_PRODUCER);
+        std::atomic<uint32_t> taken = 0;
+
+        std::vector<std::thread> threads;
+        for (uint32_t p = 0; p < PRODUCERS; ++p)
+        {
+            threads.emplace_back([&, p]()
+            {
+                for (uint32_t i = 0; i < PER_PRODUCER; ++i)
+                {
+                    uint32_t value = p * PER_PRODUCER + i;
+                    while (!queue.TryPush(value))
+                    {
+                        std::this_thread::yield();
+                    }
+                }
+            });
+            threads.emplace_back([&]()
+            {
+                uint32_t value;
+                while (taken.load() < PRODUCERS * PER_PRODUCER)
+                {
+                    if (queue.TryPop(value))
+                    {
+                        seen[value].fetch_add(1);
+                        taken.fetch_add(1);
+                    }
+                    else
+                    {
+                        std::this_thread::yield();
+                    }
+                }
+            });
+        }
+        for (std::thread& thread : threads)
+        {
+            thread.join();
+        }
+
+        bool once = true;
+        for (std::atomic<uint32_t>& count : seen)
+        {
+            once = once && count.load() == 1;
+        }
+        CHECK(once);
+        CHECK(taken.load() == PRODUCERS * PER_PRODUCER);
+    }
+
+    /****************************************************************************/
+    /*!
+    \brief
+      WorkStealingDeque pops newest first for its owner, steals oldest
+      first for everyone else, and never hands one value out twice while
+      thieves race the owner for the last items.
+    */
+    /****************************************************************************/
+    static void WorkStealingDeque()
+    {
+        // ordering without contention
+        {
+            DX11::WorkStealingDeque<uint32_t> deque(4);
+            for (uint32_t i = 0; i < 4; ++i)
+            {
+                CHECK(deque.Push(i));
+            }
+            CHECK(!deque.Push(4));
+
+            uint32_t value = 0;
+            CHECK(deque.Pop(value) && value == 3);
+            CHECK(deque.Steal(value) && value == 0);
+            CHECK(deque.Pop(value) && value == 2);
+            CHECK(deque.Steal(value) && value == 1);
+            CHECK(!deque.Pop(value));
+            CHECK(!deque.Steal(value));
+        }
+
+        // the owner pushes and pops while three thieves steal
+        const uint32_t THIEVES = 3;
+        const uint32_t TOTAL = 200000;
+        DX11::WorkStealingDeque<uint32_t> deque(256);
+        std::vector<std::atomic<uint32_t>> seen(TOTAL);
+        std::atomic<uint32_t> taken = 0;
+
+        std::vector<std::thread> thieves;
+        for (uint32_t t = 0; t < THIEVES; ++t)
+        {
+            thieves.emplace_back([&]()
+            {
+                uint32_t value;
+                while (taken.load() < TOTAL)
+                {
+                    if (deque.Steal(value))
+                    {
+                        seen[value].fetch_add(1);
+                        taken.fetch_add(1);
+                    }
+                }
+            });
+        }
+
+        uint32_t value;
+        for (uint32_t i = 0; i < TOTAL; ++i)
+        {
+            while (!deque.Push(i))
+            {
+                if (deque.Pop(value))
+                {
+                    seen[value].fetch_add(1);
+                    taken.fetch_add(1);
+                }
+            }
+
+            // take some back every so often, the single item case races the thieves
+            if (i % 3 == 0 && deque.Pop(value))
+            {
+                seen[value].fetch_add(1);
+                taken.fetch_add(1);
+            }
+        }
+        while (deque.Pop(value))
+        {
+            seen[value].fetch_add(1);
+            taken.fetch_add(1);
+        }
+        for (std::thread& thread : thieves)
+        {
+            thread.join();
+        }
+
+        bool once = true;
+        for (std::atomic<uint32_t>& count : seen)
+        {
+            once = once && count.load() == 1;
+        }
+        CHECK(once);
+        CHECK(taken.load() == TOTAL);
+    }
+
+    /****************************************************************************/
+    /*!
+    \brief
+      RenderQueue::Sort plays draws back in ascending key order, and keeps
+      submit order between equal keys (the radix sort is stable).
+    */
+    /****************************************************************************/
+    static void RadixSort()
+    {
+        std::shared_ptr<DX11::RecordingCommandContext> recorder = std::make_shared<DX11::RecordingCommandContext>();
+        DX11::Device device(recorder);
+        DX11::ConstantRing ring(device);
+        DX11::InstanceBuffer instances(device);
+
+        // few distinct keys so plenty collide, spread over every byte the sort passes over
+        const uint32_t COUNT = 20000;
+        std::mt19937_64 random(3);
+        std::vector<uint64_t> keys(COUNT);
+        DX11::RenderQueue queue;
+        for (uint32_t i = 0; i < COUNT; ++i)
+        {
+            keys[i] = (random() % 64) * 0x0101010101010101ull ^ (random() % 4);
+
+            // firstIndex tells the draws apart in the recording
+            DX11::DrawItem item;
+            item.indexCount = 3;
+            item.firstIndex = i;
+            queue.Submit(keys[i], item);
+        }
+
+        queue.Sort();
+        recorder->BeginFrame();
+        queue.Execute(device, ring, instances);
+        recorder->EndFrame();
+
+        std::vector<uint32_t> order;
+        for (const DX11::Command& command : recorder->Commands())
+        {
+            if (command.type == DX11::CommandType::DrawIndexed)
+            {
+                order.push_back(command.args[1]);
+            }
+        }
+
+        CHECK(order.size() == COUNT);
+        if (order.size() != COUNT)
+        {
+            return;
+        }
+
+        bool sorted = true;
+        bool stable = true;
+        std::vector<uint32_t> drawn(COUNT, 0);
+        for (uint32_t i = 0; i < COUNT; ++i)
+        {
+            drawn[order[i]]++;
+            if (i > 0)
+            {
+                sorted = sorted && keys[order[i - 1]] <= keys[order[i]];
+                stable = stable && (keys[order[i - 1]] != keys[order[i]] || order[i - 1] < order[i]);
+            }
+        }
+        CHECK(sorted);
+        CHECK(stable);
+        CHECK(std::all_of(drawn.begin(), drawn.end(), [](uint32_t count) { return count == 1; }));
+
+        // a second sort of the sorted queue is a no-op
+        queue.Sort();
+        recorder->BeginFrame();
+        queue.Execute(device, ring, instances);
+        recorder->EndFrame();
+        uint32_t i = 0;
+        bool same = true;
+        for (const DX11::Command& command : recorder->Commands())
+        {
+            if (command.type == DX11::CommandType::DrawIndexed)
+            {
+                same = same && i < COUNT && command.args[1] == order[i];
+                ++i;
+            }
+        }
+        CHECK(same && i == COUNT);
+    }
+
+    /****************************************************************************/
+    /*!
+    \brief
+      Multiply like HLSL mul(matrix, vector), the column vector convention
+      the shaders use
+
+    \param m
+      The matrix as the shader indexes it, m[row][column]
+
+    \param v
+      The vector
+
+    \param out
+      Receives m * v
+    */
+    /****************************************************************************/
+    static void ShaderMul(const float m[4][4], const float v[4], float out[4])
+    {
+        for (int row = 0; row < 4; ++row)
+        {
+            out[row] = m[row][0] * v[0] + m[row][1] * v[1] + m[row][2] * v[2] + m[row][3] * v[3];
+        }
+    }
+
+    /****************************************************************************/
+    /*!
+    \brief
+      The meshlet cull Renderer::Prepare runs agrees with what the GPU draws.
+      A quantized sphere is transformed the way Instanced.vs sees it (the
+      instance rows transposed once, the camera read column_major) and
+      rasterized with the renderer's cull mode, every triangle that lands
+      on screen facing the camera must be in a range the culler kept.
+    */
+    /****************************************************************************/
+    static void MeshletCulling()
+    {
+        using namespace DirectX;
+
+        // unit sphere, triangles wound so cross(b - a, c - a) points out
+        const uint32_t RINGS = 48;
+        const uint32_t SEGMENTS = 96;
+        std::vector<XMFLOAT3> positions;
+        for (uint32_t ring = 0; ring <= RINGS; ++ring)
+        {
+            const float theta = XM_PI * ring / RINGS;
+            for (uint32_t segment = 0; segment <= SEGMENTS; ++segment)
+            {
+                const float phi = XM_2PI * segment / SEGMENTS;
+                positions.push_back({ std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi) });
+            }
+        }
+
+        std::vector<uint32_t> indices;
+        for (uint32_t ring = 0; ring < RINGS; ++ring)
+        {
+            for (uint32_t segment = 0; segment < SEGMENTS; ++segment)
+            {
+                const uint32_t a = ring * (SEGMENTS + 1) + segment;
+                const uint32_t quad[2][3] = { { a, a + 1, a + SEGMENTS + 1 }, { a + 1, a + SEGMENTS + 2, a + SEGMENTS + 1 } };
+                for (const uint32_t* triangle : quad)
+                {
+                    const XMVECTOR p0 = XMLoadFloat3(&positions[triangle[0]]);
+                    const XMVECTOR normal = XMVector3Cross(XMLoadFloat3(&positions[triangle[1]]) - p0, XMLoadFloat3(&positions[triangle[2]]) - p0);
+                    const float facing = XMVectorGetX(XMVector3Dot(normal, p0));
+                    if (facing == 0.0f)
+                    {
+                        continue;   // collapsed at a pole
+                    }
+                    indices.push_back(triangle[0]);
+                    indices.push_back(facing > 0.0f ? triangle[1] : triangle[2]);
+                    indices.push_back(facing > 0.0f ? triangle[2] : triangle[1]);
+                }
+            }
+        }
+
+        std::vector<DX11::Meshlet> meshlets;
+        DX11::Meshlets::Build(indices.data(), indices.size(), positions.data(), positions.size(), sizeof(XMFLOAT3), meshlets);
+
+        // quantize like the mesh does, the GPU only ever sees these
+        const float boundsMin[3] = { -1.0f, -1.0f, -1.0f };
+        const float boundsExtent[3] = { 2.0f, 2.0f, 2.0f };
+        std::vector<DX11::VertexQuantized> vertices(positions.size());
+        for (size_t i = 0; i < positions.size(); ++i)
+        {
+            const float* position = &positions[i].x;
+            DX11::EncodeVertex(DX11::VertexFormat::Quantized, position, position, boundsMin, boundsExtent, &vertices[i]);
+        }
+        const XMMATRIX dequantize = XMMatrixScaling(boundsExtent[0], boundsExtent[1], boundsExtent[2])
+            * XMMatrixTranslation(boundsMin[0], boundsMin[1], boundsMin[2]);
+
+        // a rotation without symmetry, off to the side so part of it leaves the screen
+        const XMMATRIX modelMatrix = XMMatrixRotationQuaternion(XMQuaternionRotationRollPitchYaw(0.7f, 1.9f, -0.4f))
+            * XMMatrixTranslation(1.5f, 0.6f, 2.5f);
+        const XMVECTOR cameraPosition = XMVectorSet(0.0f, 0.4f, 0.0f, 1.0f);
+        const XMMATRIX viewMatrix = XMMatrixLookAtLH(cameraPosition, XMVectorSet(0.3f, 0.0f, 1.0f, 1.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+        const XMMATRIX projectionMatrix = XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.0f / 9.0f, 0.1f, 100.0f);
+
+        // the cull, as Renderer::Prepare runs it
+        const DX11::Frustum modelFrustum = DX11::Frustum::FromMatrix(modelMatrix * viewMatrix * projectionMatrix);
+        XMFLOAT3 modelCamera;
+        XMStoreFloat3(&modelCamera, XMVector3Transform(cameraPosition, XMMatrixInverse(nullptr, modelMatrix)));
+
+        DX11::MeshletCuller culler;
+        std::vector<DX11::IndexRange> ranges;
+        culler.Cull(meshlets.data(), meshlets.size(), modelFrustum, modelCamera, ranges);
+
+        std::vector<bool> kept(indices.size() / 3, false);
+        for (const DX11::IndexRange& range : ranges)
+        {
+            std::fill(kept.begin() + range.firstIndex / 3, kept.begin() + (range.firstIndex + range.indexCount) / 3, true);
+        }
+
+        // what the GPU gets: the instance rows and the camera as stored by Prepare and Submit
+        XMFLOAT4X4 instanceRows;
+        XMStoreFloat4x4(&instanceRows, dequantize * modelMatrix);
+        XMFLOAT4X4 view;
+        XMFLOAT4X4 projection;
+        XMStoreFloat4x4(&view, viewMatrix);
+        XMStoreFloat4x4(&projection, projectionMatrix);
+
+        // transpose(float4x4(rows)) for the world, column_major reads for the cbuffer
+        float world[4][4];
+        float viewShader[4][4];
+        float projectionShader[4][4];
+        for (int row = 0; row < 4; ++row)
+        {
+            for (int column = 0; column < 4; ++column)
+            {
+                world[row][column] = instanceRows.m[column][row];
+                viewShader[row][column] = view.m[column][row];
+                projectionShader[row][column] = projection.m[column][row];
+            }
+        }
+
+        uint32_t drawn = 0;
+        uint32_t drawnButCulled = 0;
+        uint32_t clipped = 0;
+        for (size_t t = 0; t < kept.size(); ++t)
+        {
+            float clip[3][4];
+            for (int corner = 0; corner < 3; ++corner)
+            {
+                const DX11::VertexQuantized& vertex = vertices[indices[t * 3 + corner]];
+                const float position[4] = { vertex.position[0] / 65535.0f, vertex.position[1] / 65535.0f, vertex.position[2] / 65535.0f, 1.0f };
+                float worldPosition[4];
+                float viewPosition[4];
+                ShaderMul(world, position, worldPosition);
+                ShaderMul(viewShader, worldPosition, viewPosition);
+                ShaderMul(projectionShader, viewPosition, clip[corner]);
+            }
+
+            // the whole sphere is past the near plane, so no triangle needs clipping
+            if (clip[0][3] <= 0.1f || clip[1][3] <= 0.1f || clip[2][3] <= 0.1f)
+            {
+                ++clipped;
+                continue;
+            }
+
+            float ndc[3][2];
+            float low[2] = { FLT_MAX, FLT_MAX };
+            float high[2] = { -FLT_MAX, -FLT_MAX };
+            for (int corner = 0; corner < 3; ++corner)
+            {
+                for (int axis = 0; axis < 2; ++axis)
+                {
+                    ndc[corner][axis] = clip[corner][axis] / clip[corner][3];
+                    low[axis] = std::min(low[axis], ndc[corner][axis]);
+                    high[axis] = std::max(high[axis], ndc[corner][axis]);
+                }
+            }
+            if (high[0] < -1.0f || low[0] > 1.0f || high[1] < -1.0f || low[1] > 1.0f)
+            {
+                continue;
+            }
+
+            // FrontCounterClockwise with CULL_FRONT, clockwise on screen is drawn
+            const float area = (ndc[1][0] - ndc[0][0]) * (ndc[2][1] - ndc[0][1]) - (ndc[1][1] - ndc[0][1]) * (ndc[2][0] - ndc[0][0]);
+            if (area >= 0.0f)
+            {
+                continue;
+            }
+
+            ++drawn;
+            drawnButCulled += kept[t] ? 0 : 1;
+        }
+
+        // the scene has to exercise both kinds of cull and still draw something
+        const DX11::MeshletStats& stats = culler.Stats();
+        CHECK(stats.frustumCulled > 0);
+        CHECK(stats.backfaceCulled > 0);
+        CHECK(drawn > 0);
+        CHECK(clipped == 0);
+
+        // nothing the GPU would show was culled, and most of what it would not show was
+        CHECK(drawnButCulled == 0);
+        CHECK(stats.triangles - stats.trianglesCulled >= drawn);
+        CHECK(stats.trianglesCulled * 3 > stats.triangles * 2);
+        if (drawnButCulled != 0)
+        {
+            std::cerr << "  " << drawnButCulled << " of " << drawn << " drawn triangles were culled" << std::endl;
+        }
+    }
+
+    /****************************************************************************/
+    /*!
+    \brief
+      Buffers on a headless device get distinct handles, so mapping one
+      never hands out another's memory
+    */
+    /****************************************************************************/
+    static void HeadlessBuffers()
+    {
+        std::shared_ptr<DX11::RecordingCommandContext> recorder = std::make_shared<DX11::RecordingCommandContext>();
+        DX11::Device device(recorder);
+
+        DX11::Buffer a(device, 64, D3D11_BIND_VERTEX_BUFFER, DX11::BufferUsage::Dynamic);
+        DX11::Buffer b(device, 64, D3D11_BIND_VERTEX_BUFFER, DX11::BufferUsage::Dynamic);
+        DX11::Buffer c(device, 256, D3D11_USAGE_DYNAMIC);
+        CHECK(a.Get() != nullptr && b.Get() != nullptr && c.Get() != nullptr);
+        CHECK(a.Get() != b.Get() && a.Get() != c.Get() && b.Get() != c.Get());
+
+        a.Map(device);
+        b.Map(device);
+        CHECK(a.Data() != nullptr && b.Data() != nullptr && a.Data() != b.Data());
+        std::memset(a.Data(), 0xaa, 64);
+        std::memset(b.Data(), 0xbb, 64);
+        CHECK(static_cast<const uint8_t*>(a.Data())[63] == 0xaa);
+        b.Unmap(device);
+        a.Unmap(device);
+    }
+
+    /****************************************************************************/
+    /*!
+    \brief
+      Jobs scheduled after a counter only start once every job on it has
+      run, and every held back job runs exactly once
+    */
+    /****************************************************************************/
+    static void DependentJobs()
+    {
+        const uint32_t STAGE = 2000;
+        DX11::WorkerPool pool(3);
+
+        for (uint32_t round = 0; round < 20; ++round)
+        {
+            DX11::JobCounter first;
+            DX11::JobCounter second;
+            std::atomic<uint32_t> firstDone = 0;
+            std::atomic<uint32_t> secondRuns = 0;
+            std::atomic<uint32_t> early = 0;
+
+            for (uint32_t i = 0; i < STAGE; ++i)
+            {
+                pool.Schedule([&]() { firstDone.fetch_add(1); }, &first);
+            }
+            for (uint32_t i = 0; i < STAGE; ++i)
+            {
+                pool.Schedule([&]()
+                {
+                    early.fetch_add(firstDone.load() == STAGE ? 0 : 1);
+                    secondRuns.fetch_add(1);
+                }, &second, &first);
+            }
+            pool.Wait(second);
+
+            CHECK(early.load() == 0);
+            CHECK(firstDone.load() == STAGE);
+            CHECK(secondRuns.load() == STAGE);
+        }
+    }
+
+    /****************************************************************************/
+    /*!
+    \brief
+      FrameArena hands out aligned, non overlapping memory, Reset rewinds
+      onto the same blocks, and once a frame's worth has been seen the
+      arena stops growing
+    */
+    /****************************************************************************/
+    static void FrameArena()
+    {
+        DX11::FrameArena arena(1024);
+
+        // aligned and in order, the block boundary is crossed along the way
+        uint8_t* last = nullptr;
+        std::vector<std::pair<uint8_t*, size_t>> spans;
+        for (uint32_t i = 0; i < 64; ++i)
+        {
+            const size_t alignment = size_t(1) << (i % 7);
+            const size_t size = 1 + i * 13;
+            uint8_t* data = static_cast<uint8_t*>(arena.Allocate(size, alignment));
+            CHECK(uintptr_t(data) % alignment == 0);
+            std::memset(data, int(i), size);
+            spans.push_back({ data, size });
+            last = data;
+        }
+        bool intact = true;
+        for (size_t i = 0; i < spans.size(); ++i)
+        {
+            intact = intact && std::all_of(spans[i].first, spans[i].first + spans[i].second, [&](uint8_t b) { return b == uint8_t(i); });
+        }
+        CHECK(intact);
+        CHECK(last != nullptr);
+
+        const size_t used = arena.Used();
+        const size_t capacity = arena.Capacity();
+        CHECK(used > 1024 && used <= capacity);
+        CHECK(arena.HighWater() == used);
+
+        // the same frame again lands on the same memory without growing
+        arena.Reset();
+        CHECK(arena.Used() == 0);
+        for (uint32_t i = 0; i < 64; ++i)
+        {
+            uint8_t* data = static_cast<uint8_t*>(arena.Allocate(1 + i * 13, size_t(1) << (i % 7)));
+            CHECK(data == spans[i].first);
+        }
+        CHECK(arena.Capacity() == capacity);
+
+        // typed allocations and the STL adapter
+        arena.Reset();
+        DirectX::XMFLOAT4X4* matrices = arena.Alloc<DirectX::XMFLOAT4X4>(3);
+        CHECK(uintptr_t(matrices) % alignof(DirectX::XMFLOAT4X4) == 0);
+        uint64_t* counts = arena.Alloc<uint64_t>(4);
+        CHECK(reinterpret_cast<uint8_t*>(counts) >= reinterpret_cast<uint8_t*>(matrices + 3));
+
+        DX11::FrameVector<uint32_t> list{ DX11::FrameAllocator<uint32_t>(arena) };
+        list.reserve(100);
+        for (uint32_t i = 0; i < 5000; ++i)
+        {
+            list.push_back(i);
+        }
+        CHECK(list.size() == 5000 && list[4999] == 4999 && list[100] == 100);
+        CHECK(arena.HighWater() >= 5000 * sizeof(uint32_t));
+
+        // one bigger than a block gets a block of its own
+        arena.Reset();
+        void* big = arena.Allocate(10000, 64);
+        CHECK(big != nullptr && uintptr_t(big) % 64 == 0);
+        CHECK(arena.Used() >= 10000);
+    }
+
+    //! every test, in the order they run
+    struct Test
+    {
+        const char* name;
+        void (*run)();
+    };
+
+    static const Test TESTS[] =
+    {
+        { "quantization", Quantization },
+        { "indices", IndexPacking },
+        { "ringqueue", RingQueue },
+        { "deque", WorkStealingDeque },
+        { "sort", RadixSort },
+        { "meshlets", MeshletCulling },
+        { "buffers", HeadlessBuffers },
+        { "jobs", DependentJobs },
+        { "arena", FrameArena },
+    };
+}
+
+/*============================================================================*\
+|| -------------------------- PUBLIC FUNCTIONS ------------------------------ ||
+\*============================================================================*/
+
+int main(int argc, char** argv)
+{
+    // no arguments runs everything, otherwise only the named tests
+    uint32_t failed = 0;
+    uint32_t ran = 0;
+    for (const TESTS::Test& test : TESTS::TESTS)
+    {
+        bool selected = argc < 2;
+        for (int i = 1; i < argc; ++i)
+        {
+            selected = selected || std::strcmp(argv[i], test.name) == 0;
+        }
+        if (!selected)
+        {
+            continue;
+        }
+
+        TESTS::gFailures = 0;
+        test.run();
+        ++ran;
+        failed += TESTS::gFailures > 0 ? 1 : 0;
+        std::cout << (TESTS::gFailures > 0 ? "FAIL " : "ok   ") << test.name << std::endl;
+    }
+
+    DEBUG::log.Flush();
+    if (ran == 0)
+    {
+        std::cerr << "No test matched" << std::endl;
+        return EXIT_FAILURE;
+    }
+    return failed == 0 ? 0 : EXIT_FAILURE;
+}
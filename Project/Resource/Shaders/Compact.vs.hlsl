@@ -0,0 +1,47 @@
+/****************************************************************************/
+/*!
+\file
+   Compact.vs.hlsl
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Vertex shader for the Compact and Quantized vertex layouts. Quantized
+    positions arrive as unorm, the dequantize is folded into worldMatrix.
+*/
+/****************************************************************************/
+
+cbuffer Matrices : register( b0 ) {
+    matrix worldMatrix;
+    matrix projectionMatrix;
+    matrix viewMatrix;
+};
+
+struct OutData {
+    float4 position : SV_POSITION;
+    float4 color : COLOR;
+};
+
+struct InData {
+    float3 position : POSITION;
+    float2 normal : NORMAL;
+};
+
+float3 OctDecode(float2 e) {
+    float3 n = float3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+    float t = saturate(-n.z);
+    n.xy += n.xy >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
+OutData main(InData inData) {
+    OutData outData;
+
+    float4 position = float4(inData.position, 1.0);
+    outData.position = mul(mul(projectionMatrix, mul(viewMatrix, worldMatrix)), position);
+    outData.color = normalize(float4(OctDecode(inData.normal), 1.0));
+
+    return outData;
+}
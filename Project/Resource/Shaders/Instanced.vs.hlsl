@@ -0,0 +1,56 @@
+/****************************************************************************/
+/*!
+\file
+   Instanced.vs.hlsl
+\Author
+   Ryan Dugie
+\brief
+    Copyright (c) Ryan Dugie. All rights reserved.
+    Licensed under the Apache License 2.0
+
+    Instanced vertex shader for the Compact and Quantized vertex layouts.
+    The world matrix comes per instance from the INSTANCE stream, the
+    camera from the constant buffer.
+*/
+/****************************************************************************/
+
+cbuffer Camera : register( b0 ) {
+    matrix projectionMatrix;
+    matrix viewMatrix;
+};
+
+struct OutData {
+    float4 position : SV_POSITION;
+    float4 color : COLOR;
+};
+
+struct InData {
+    float3 position : POSITION;
+    float2 normal : NORMAL;
+
+    // the four rows of the world matrix, stored untransposed like the camera
+    float4 world0 : INSTANCE0;
+    float4 world1 : INSTANCE1;
+    float4 world2 : INSTANCE2;
+    float4 world3 : INSTANCE3;
+};
+
+float3 OctDecode(float2 e) {
+    float3 n = float3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+    float t = saturate(-n.z);
+    n.xy += n.xy >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
+OutData main(InData inData) {
+    OutData outData;
+
+    // cbuffer matrices are read column_major, transpose once so world matches them
+    matrix worldMatrix = transpose(float4x4(inData.world0, inData.world1, inData.world2, inData.world3));
+
+    float4 position = float4(inData.position, 1.0);
+    outData.position = mul(mul(projectionMatrix, mul(viewMatrix, worldMatrix)), position);
+    outData.color = normalize(float4(OctDecode(inData.normal), 1.0));
+
+    return outData;
+}